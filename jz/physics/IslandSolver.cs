@@ -0,0 +1,419 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using System;
+using System.Collections.Generic;
+
+using jz.physics.narrowphase;
+using siat;
+
+namespace jz.physics
+{
+    /// <summary>
+    /// Solves the contacts of World.Tick() in islands, in parallel on WorkPool.
+    /// </summary>
+    /// <remarks>
+    /// An island is a set of dynamic bodies connected by contacts. Static and kinematic bodies
+    /// do not connect islands, since ContactPoint never writes to them. Islands share no written
+    /// data, so each is solved on one thread with its own iteration count.
+    ///
+    /// Islands with more than kColoringThreshold arbiters are colored instead: arbiters of the
+    /// same color share no dynamic body, so each color is solved in parallel batches, one color
+    /// after another. Arbiters that do not fit in kMaxColors are solved serially.
+    ///
+    /// Islands are numbered in arbiter order and arbiters keep their order within islands and
+    /// colors, and every error sum is taken in that order, so results do not depend on the
+    /// thread count or on scheduling.
+    /// </remarks>
+    internal sealed class IslandSolver
+    {
+        public const int kColoringThreshold = 128;
+        public const int kMaxColors = 32;
+        public const int kMinBatch = 16;
+
+        #region Private members
+        private List<Arbiter> mArbiters = null;
+        private int mThreads = WorkPool.ThreadCount;
+
+        private int[] mParents = new int[0];
+        private int[] mIslandOfRoot = new int[0];
+        private uint[] mColorMasks = new uint[0];
+
+        private int[] mActive = new int[0];
+        private int[] mActiveIsland = new int[0];
+        private int mActiveCount = 0;
+
+        private int[] mIslandBegin = new int[1];
+        private int mIslandCount = 0;
+        private int[] mOrder = new int[0];
+        private float[] mErrors = new float[0];
+
+        private List<int> mSmallIslands = new List<int>();
+        private int mLargeIslandCount = 0;
+
+        private int[] mColored = new int[0];
+        private int[] mColors = new int[0];
+        private int[] mColorBegin = new int[kMaxColors + 2];
+        private int mColorCount = 0;
+
+        private int mBatchBegin = 0;
+        private int mBatchEnd = 0;
+        private int mBatchCount = 0;
+        private bool mbBatchPre = false;
+
+        private int[] mThreadIterations = new int[WorkPool.kMaxThreads];
+        private int mIterations = 0;
+
+        private WorkItem mIslandItem;
+        private WorkItem mBatchItem;
+
+        private static int _GetSolverIndex(Body b)
+        {
+            return (b.Type == BodyFlags.kDynamic) ? ((RigidBody)b).mSolverIndex : -1;
+        }
+
+        private int _Find(int a)
+        {
+            while (mParents[a] != a)
+            {
+                mParents[a] = mParents[mParents[a]];
+                a = mParents[a];
+            }
+
+            return a;
+        }
+
+        private void _Union(int a, int b)
+        {
+            if (a < 0 || b < 0) { return; }
+
+            a = _Find(a);
+            b = _Find(b);
+
+            // The lower index is always the root, so roots do not depend on union order.
+            if (a < b) { mParents[b] = a; }
+            else if (b < a) { mParents[a] = b; }
+        }
+
+        private void _Pre(int aArbiter)
+        {
+            Arbiter arbiter = mArbiters[aArbiter];
+            int count = arbiter.Contacts.Count;
+            for (int i = 0; i < count; i++)
+            {
+                ContactPoint point = arbiter.Contacts[i];
+                point._Pre(arbiter.A, arbiter.B);
+                arbiter.Contacts[i] = point;
+            }
+        }
+
+        private float _Tick(int aArbiter)
+        {
+            float ret = 0.0f;
+
+            Arbiter arbiter = mArbiters[aArbiter];
+            int count = arbiter.Contacts.Count;
+            for (int i = 0; i < count; i++)
+            {
+                ContactPoint point = arbiter.Contacts[i];
+                ret += point._Tick(arbiter.A, arbiter.B);
+                arbiter.Contacts[i] = point;
+            }
+
+            return ret;
+        }
+
+        private int _GetChunkCount(int aCount, int aMinChunk)
+        {
+            return Utilities.Clamp(aCount / aMinChunk, 1, mThreads);
+        }
+
+        private void _BuildIslands(List<RigidBody> aDynamics)
+        {
+            int bodyCount = aDynamics.Count;
+            if (mParents.Length < bodyCount)
+            {
+                mParents = new int[bodyCount];
+                mIslandOfRoot = new int[bodyCount];
+                mColorMasks = new uint[bodyCount];
+            }
+
+            for (int i = 0; i < bodyCount; i++)
+            {
+                aDynamics[i].mSolverIndex = i;
+                mParents[i] = i;
+                mIslandOfRoot[i] = -1;
+            }
+
+            int count = mArbiters.Count;
+            if (mActive.Length < count)
+            {
+                mActive = new int[count];
+                mActiveIsland = new int[count];
+                mOrder = new int[count];
+                mErrors = new float[count];
+                mColored = new int[count];
+                mColors = new int[count];
+            }
+
+            #region Connect dynamic bodies
+            mActiveCount = 0;
+            for (int i = 0; i < count; i++)
+            {
+                Arbiter arbiter = mArbiters[i];
+                if (arbiter.Contacts.Count == 0) { continue; }
+
+                int a = _GetSolverIndex(arbiter.A);
+                int b = _GetSolverIndex(arbiter.B);
+                if (a < 0 && b < 0) { continue; }
+
+                _Union(a, b);
+                mActive[mActiveCount++] = i;
+            }
+            #endregion
+
+            #region Number islands in arbiter order
+            mIslandCount = 0;
+            for (int i = 0; i < mActiveCount; i++)
+            {
+                Arbiter arbiter = mArbiters[mActive[i]];
+                int a = _GetSolverIndex(arbiter.A);
+                int root = _Find((a >= 0) ? a : _GetSolverIndex(arbiter.B));
+
+                if (mIslandOfRoot[root] < 0) { mIslandOfRoot[root] = mIslandCount++; }
+                mActiveIsland[i] = mIslandOfRoot[root];
+            }
+            #endregion
+
+            #region Group arbiters by island
+            if (mIslandBegin.Length < mIslandCount + 1) { mIslandBegin = new int[mIslandCount + 1]; }
+            Array.Clear(mIslandBegin, 0, mIslandCount + 1);
+
+            for (int i = 0; i < mActiveCount; i++) { mIslandBegin[mActiveIsland[i] + 1]++; }
+            for (int i = 0; i < mIslandCount; i++) { mIslandBegin[i + 1] += mIslandBegin[i]; }
+            for (int i = 0; i < mActiveCount; i++) { mOrder[mIslandBegin[mActiveIsland[i]]++] = mActive[i]; }
+            for (int i = mIslandCount; i > 0; i--) { mIslandBegin[i] = mIslandBegin[i - 1]; }
+            mIslandBegin[0] = 0;
+            #endregion
+        }
+
+        private int _SolveIsland(int aIsland)
+        {
+            int begin = mIslandBegin[aIsland];
+            int end = mIslandBegin[aIsland + 1];
+
+            for (int i = begin; i < end; i++) { _Pre(mOrder[i]); }
+
+            int k = 0;
+            while (k < PhysicsConstants.kMaxSolverIterations)
+            {
+                float error = 0.0f;
+                for (int i = begin; i < end; i++) { error += _Tick(mOrder[i]); }
+                k++;
+
+                if (error < PhysicsConstants.kDesiredError) { break; }
+            }
+
+            return k;
+        }
+
+        private void _IslandItem(int aIndex, int aThread)
+        {
+            int count = mSmallIslands.Count;
+            int chunks = Utilities.Min(count, mThreads);
+
+            // With all threads, one item per island lets WorkPool balance uneven islands.
+            if (mThreads == WorkPool.ThreadCount) { mThreadIterations[aThread] += _SolveIsland(mSmallIslands[aIndex]); }
+            else
+            {
+                int end = ((count * (aIndex + 1)) / chunks);
+                for (int i = ((count * aIndex) / chunks); i < end; i++) { mThreadIterations[aThread] += _SolveIsland(mSmallIslands[i]); }
+            }
+        }
+
+        private void _BatchItem(int aIndex, int aThread)
+        {
+            int count = (mBatchEnd - mBatchBegin);
+            int begin = mBatchBegin + ((count * aIndex) / mBatchCount);
+            int end = mBatchBegin + ((count * (aIndex + 1)) / mBatchCount);
+
+            if (mbBatchPre) { for (int i = begin; i < end; i++) { _Pre(mColored[i]); } }
+            else { for (int i = begin; i < end; i++) { mErrors[mColored[i]] = _Tick(mColored[i]); } }
+        }
+
+        private void _Batch(int aColor, bool abPre)
+        {
+            mBatchBegin = mColorBegin[aColor];
+            mBatchEnd = mColorBegin[aColor + 1];
+            mbBatchPre = abPre;
+
+            if (mBatchBegin == mBatchEnd) { return; }
+            if (aColor == kMaxColors) { mBatchCount = 1; _BatchItem(0, 0); }
+            else
+            {
+                mBatchCount = _GetChunkCount(mBatchEnd - mBatchBegin, kMinBatch);
+                WorkPool.For(mBatchCount, mBatchItem);
+            }
+        }
+
+        private void _ColorIsland(int aIsland)
+        {
+            int begin = mIslandBegin[aIsland];
+            int end = mIslandBegin[aIsland + 1];
+
+            for (int i = begin; i < end; i++)
+            {
+                Arbiter arbiter = mArbiters[mOrder[i]];
+                int a = _GetSolverIndex(arbiter.A);
+                int b = _GetSolverIndex(arbiter.B);
+                if (a >= 0) { mColorMasks[a] = 0u; }
+                if (b >= 0) { mColorMasks[b] = 0u; }
+            }
+
+            Array.Clear(mColorBegin, 0, mColorBegin.Length);
+            mColorCount = 0;
+
+            #region Greedy coloring
+            for (int i = begin; i < end; i++)
+            {
+                Arbiter arbiter = mArbiters[mOrder[i]];
+                int a = _GetSolverIndex(arbiter.A);
+                int b = _GetSolverIndex(arbiter.B);
+
+                uint used = ((a >= 0) ? mColorMasks[a] : 0u) | ((b >= 0) ? mColorMasks[b] : 0u);
+                int color = 0;
+                while (color < kMaxColors && (used & (1u << color)) != 0u) { color++; }
+
+                if (color < kMaxColors)
+                {
+                    if (a >= 0) { mColorMasks[a] |= (1u << color); }
+                    if (b >= 0) { mColorMasks[b] |= (1u << color); }
+                    mColorCount = Utilities.Max(mColorCount, color + 1);
+                }
+
+                mColors[i - begin] = color;
+                mColorBegin[color + 1]++;
+            }
+            #endregion
+
+            #region Group arbiters by color
+            for (int i = 0; i <= kMaxColors; i++) { mColorBegin[i + 1] += mColorBegin[i]; }
+            for (int i = begin; i < end; i++) { mColored[mColorBegin[mColors[i - begin]]++] = mOrder[i]; }
+            for (int i = kMaxColors + 1; i > 0; i--) { mColorBegin[i] = mColorBegin[i - 1]; }
+            mColorBegin[0] = 0;
+            #endregion
+        }
+
+        private int _SolveColoredIsland(int aIsland)
+        {
+            _ColorIsland(aIsland);
+
+            int begin = mIslandBegin[aIsland];
+            int end = mIslandBegin[aIsland + 1];
+
+            for (int c = 0; c <= kMaxColors; c++) { _Batch(c, true); }
+
+            int k = 0;
+            while (k < PhysicsConstants.kMaxSolverIterations)
+            {
+                for (int c = 0; c <= kMaxColors; c++) { _Batch(c, false); }
+                k++;
+
+                float error = 0.0f;
+                for (int i = begin; i < end; i++) { error += mErrors[mOrder[i]]; }
+
+                if (error < PhysicsConstants.kDesiredError) { break; }
+            }
+
+            return k;
+        }
+        #endregion
+
+        public IslandSolver()
+        {
+            mIslandItem = _IslandItem;
+            mBatchItem = _BatchItem;
+        }
+
+        public int ColorCount { get { return mColorCount; } }
+        public int IslandCount { get { return mIslandCount; } }
+
+        /// <summary>
+        /// Sum over all islands of the solver iterations of the last call to Solve().
+        /// </summary>
+        public int Iterations { get { return mIterations; } }
+        public int LargeIslandCount { get { return mLargeIslandCount; } }
+
+        /// <summary>
+        /// Maximum number of threads used to solve, from 1 to WorkPool.ThreadCount.
+        /// </summary>
+        public int Threads
+        {
+            get { return mThreads; }
+            set { mThreads = Utilities.Clamp(value, 1, WorkPool.ThreadCount); }
+        }
+
+        /// <summary>
+        /// Solves the contacts of aArbiters. Arbiters without a dynamic body are ignored.
+        /// </summary>
+        public void Solve(List<RigidBody> aDynamics, List<Arbiter> aArbiters)
+        {
+            mArbiters = aArbiters;
+            _BuildIslands(aDynamics);
+
+            mSmallIslands.Clear();
+            mLargeIslandCount = 0;
+            mColorCount = 0;
+            mIterations = 0;
+            Array.Clear(mThreadIterations, 0, mThreadIterations.Length);
+
+            for (int i = 0; i < mIslandCount; i++)
+            {
+                if ((mIslandBegin[i + 1] - mIslandBegin[i]) > kColoringThreshold) { mLargeIslandCount++; }
+                else { mSmallIslands.Add(i); }
+            }
+
+            int smallCount = mSmallIslands.Count;
+            if (smallCount > 0)
+            {
+                WorkPool.For((mThreads == WorkPool.ThreadCount) ? smallCount : Utilities.Min(smallCount, mThreads), mIslandItem);
+                for (int i = 0; i < mThreadIterations.Length; i++) { mIterations += mThreadIterations[i]; }
+            }
+
+            if (mLargeIslandCount > 0)
+            {
+                int colorCount = 0;
+                for (int i = 0; i < mIslandCount; i++)
+                {
+                    if ((mIslandBegin[i + 1] - mIslandBegin[i]) > kColoringThreshold)
+                    {
+                        mIterations += _SolveColoredIsland(i);
+                        colorCount = Utilities.Max(colorCount, mColorCount);
+                    }
+                }
+                mColorCount = colorCount;
+            }
+
+            mArbiters = null;
+        }
+    }
+}
@@ -94,6 +94,19 @@ namespace jz.physics
         /// </summary>
         public const int kMaxSolverIterations = 30;
 
+        /// <summary>
+        /// Maximum change of position of each body of a pair, since the pair was last collided, below
+        /// which the contacts of the pair are reused without colliding it.
+        /// </summary>
+        public const float kContactReuseDistance = 0.1f * kMinimumThickness;
+        public const float kContactReuseDistance2 = (kContactReuseDistance * kContactReuseDistance);
+
+        /// <summary>
+        /// Maximum change of any element of the orientation of each body of a pair below which the
+        /// contacts of the pair are reused. See kContactReuseDistance.
+        /// </summary>
+        public const float kContactReuseRotation = 1e-3f;
+
         /// <summary>
         /// Threshold of the dot product of two normal vectors. Above this value, they are considered equal.
         /// </summary>
@@ -0,0 +1,198 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using Microsoft.Xna.Framework;
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+
+using jz.physics.narrowphase;
+using siat;
+
+namespace jz.physics
+{
+    /// <summary>
+    /// Measures how the narrow phase and contact solving in World.Tick() scale with
+    /// World.SolverThreads, with and without World.bReuseContacts.
+    /// </summary>
+    /// <remarks>
+    /// The scene is a grid of separate stacks of boxes, each a small island, and one layer of
+    /// overlapping boxes that is a single island large enough to be colored. The same scene is
+    /// run once per thread count. The checksum of final positions should be the same for every
+    /// thread count with the same World.bReuseContacts.
+    /// </remarks>
+    public static class SolverBenchmark
+    {
+        public const int kStackHeight = 4;
+        public const float kStackSpacing = 4.0f;
+        public const float kLayerSpacing = 1.98f;
+
+        public struct Result
+        {
+            public int Threads;
+            public bool bReuseContacts;
+            public double TickTime;
+            public double NarrowphaseTime;
+            public double SolveTime;
+            public int Iterations;
+            public int ReusedPairs;
+            public int Islands;
+            public float Checksum;
+        }
+
+        #region Private members
+        private static BoxBody _AddBox(World aWorld, Vector3 aPosition, Vector3 aHalfExtents, bool abDynamic)
+        {
+            BoundingBox box = new BoundingBox(-aHalfExtents, aHalfExtents);
+            BoxBody ret = new BoxBody(ref box);
+            ret.Frame = new CoordinateFrame(Matrix3.Identity, aPosition);
+
+            if (abDynamic)
+            {
+                ret.Type = BodyFlags.kDynamic;
+                ret.CollidesWith = BodyFlags.kDynamic | BodyFlags.kStatic;
+            }
+            else
+            {
+                ret.Type = BodyFlags.kStatic;
+                ret.CollidesWith = BodyFlags.kDynamic;
+            }
+
+            ret.World = aWorld;
+
+            return ret;
+        }
+
+        private static List<BoxBody> _Build(World aWorld, int aStacksSide, int aLayerSide)
+        {
+            List<BoxBody> ret = new List<BoxBody>();
+
+            float stacksExtent = (aStacksSide * kStackSpacing);
+            float layerExtent = (aLayerSide * kLayerSpacing);
+            float groundHalf = 0.5f * (stacksExtent + layerExtent) + kStackSpacing;
+            _AddBox(aWorld, new Vector3(0.0f, -1.0f, 0.0f), new Vector3(groundHalf, 1.0f, groundHalf), false);
+
+            Vector3 corner = new Vector3(-groundHalf + kStackSpacing, 1.0f, -groundHalf + kStackSpacing);
+
+            for (int x = 0; x < aStacksSide; x++)
+            {
+                for (int z = 0; z < aStacksSide; z++)
+                {
+                    for (int y = 0; y < kStackHeight; y++)
+                    {
+                        Vector3 p = corner + new Vector3(x * kStackSpacing, y * 2.0f, z * kStackSpacing);
+                        ret.Add(_AddBox(aWorld, p, Vector3.One, true));
+                    }
+                }
+            }
+
+            corner.X += stacksExtent;
+            for (int x = 0; x < aLayerSide; x++)
+            {
+                for (int z = 0; z < aLayerSide; z++)
+                {
+                    Vector3 p = corner + new Vector3(x * kLayerSpacing, 0.0f, z * kLayerSpacing);
+                    ret.Add(_AddBox(aWorld, p, Vector3.One, true));
+                }
+            }
+
+            return ret;
+        }
+        #endregion
+
+        /// <summary>
+        /// Runs aTicks steps of the scene with aThreads solver threads and World.bReuseContacts
+        /// set to abReuseContacts. Times are in milliseconds per step, Iterations and ReusedPairs
+        /// are per step.
+        /// </summary>
+        public static Result Run(int aThreads, bool abReuseContacts, int aStacksSide, int aLayerSide, int aTicks)
+        {
+            World world = new World();
+            world.SolverThreads = aThreads;
+            world.bReuseContacts = abReuseContacts;
+            List<BoxBody> bodies = _Build(world, aStacksSide, aLayerSide);
+
+            Result ret = new Result();
+            ret.Threads = aThreads;
+            ret.bReuseContacts = abReuseContacts;
+
+            Stopwatch timer = new Stopwatch();
+            for (int i = 0; i < aTicks; i++)
+            {
+                timer.Start();
+                world.Tick(PhysicsConstants.kTimeStep);
+                timer.Stop();
+
+                ret.NarrowphaseTime += world.NarrowphaseTime;
+                ret.SolveTime += world.SolveTime;
+                ret.Iterations += world.SolverIterations;
+                ret.ReusedPairs += world.ReusedPairs;
+                ret.Islands = Utilities.Max(ret.Islands, world.IslandCount);
+            }
+
+            if (aTicks > 0)
+            {
+                ret.TickTime = (timer.Elapsed.TotalMilliseconds / aTicks);
+                ret.NarrowphaseTime /= aTicks;
+                ret.SolveTime /= aTicks;
+                ret.Iterations /= aTicks;
+                ret.ReusedPairs /= aTicks;
+            }
+
+            int count = bodies.Count;
+            for (int i = 0; i < count; i++)
+            {
+                Vector3 p = bodies[i].WorldTranslation;
+                ret.Checksum += (p.X + p.Y + p.Z);
+            }
+
+            return ret;
+        }
+
+        /// <summary>
+        /// Runs the scene with contact reuse off and on, each with 1 solver thread, then doubling
+        /// up to WorkPool.ThreadCount, and writes one line per run to aOut.
+        /// </summary>
+        public static void Run(TextWriter aOut, int aStacksSide, int aLayerSide, int aTicks)
+        {
+            aOut.WriteLine("reuse contacts,threads,tick ms,narrowphase ms,solve ms,iterations,reused pairs,islands,checksum");
+
+            foreach (bool bReuseContacts in new bool[] { false, true })
+            {
+                int threads = 1;
+                while (true)
+                {
+                    Result r = Run(threads, bReuseContacts, aStacksSide, aLayerSide, aTicks);
+
+                    aOut.WriteLine(r.bReuseContacts + "," + r.Threads + "," + r.TickTime.ToString("F3") + "," +
+                        r.NarrowphaseTime.ToString("F3") + "," + r.SolveTime.ToString("F3") + "," +
+                        r.Iterations + "," + r.ReusedPairs + "," + r.Islands + "," + r.Checksum.ToString("R"));
+                    aOut.Flush();
+
+                    if (threads == WorkPool.ThreadCount) { break; }
+                    threads = Utilities.Min(threads * 2, WorkPool.ThreadCount);
+                }
+            }
+        }
+    }
+}
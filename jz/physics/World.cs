@@ -22,6 +22,7 @@
 using Microsoft.Xna.Framework;
 using System;
 using System.Collections.Generic;
+using System.Diagnostics;
 
 using jz.physics.broadphase;
 using jz.physics.narrowphase;
@@ -31,6 +32,16 @@ namespace jz.physics
 {
     public sealed class World
     {
+        /// <summary>
+        /// Seed of the shuffle of arbiters before solving. Fixed so that results are repeatable.
+        /// </summary>
+        public const int kSortSeed = 0;
+
+        /// <summary>
+        /// Number of pairs collided by each narrow phase work item.
+        /// </summary>
+        public const int kNarrowphaseBatch = 32;
+
         #region Private members
         private IBroadphase mBroadphase;
         private List<RigidBody> mDynamics = new List<RigidBody>();
@@ -38,6 +49,103 @@ namespace jz.physics
         private List<Body> mStatics = new List<Body>();
         private Vector3 mGravity = PhysicsConstants.kDefaultGravity;
         private float mTimePool = 0.0f;
+        private Random mRandom = new Random(kSortSeed);
+        private IslandSolver mSolver = new IslandSolver();
+        private Stopwatch mSolveTimer = new Stopwatch();
+        private Stopwatch mNarrowphaseTimer = new Stopwatch();
+        private int mSolverIterations = 0;
+        private int[] mReusedPairs = new int[WorkPool.kMaxThreads];
+        private bool mbReuseContacts = true;
+
+        private Arbiter[] mNarrowphase = new Arbiter[0];
+        private int mNarrowphaseCount = 0;
+        private int mIteration = 0;
+        private WorkItem mNarrowphaseItem;
+
+        private static bool _BarelyMoved(ref CoordinateFrame a, ref CoordinateFrame b)
+        {
+            const float kR = PhysicsConstants.kContactReuseRotation;
+
+            return (Vector3.DistanceSquared(a.Translation, b.Translation) < PhysicsConstants.kContactReuseDistance2 &&
+                Math.Abs(a.Orientation.M11 - b.Orientation.M11) < kR && Math.Abs(a.Orientation.M12 - b.Orientation.M12) < kR && Math.Abs(a.Orientation.M13 - b.Orientation.M13) < kR &&
+                Math.Abs(a.Orientation.M21 - b.Orientation.M21) < kR && Math.Abs(a.Orientation.M22 - b.Orientation.M22) < kR && Math.Abs(a.Orientation.M23 - b.Orientation.M23) < kR &&
+                Math.Abs(a.Orientation.M31 - b.Orientation.M31) < kR && Math.Abs(a.Orientation.M32 - b.Orientation.M32) < kR && Math.Abs(a.Orientation.M33 - b.Orientation.M33) < kR);
+        }
+
+        /// <summary>
+        /// Collides one pair. Runs on WorkPool threads and only writes to the pair.
+        /// </summary>
+        private void _Collide(ref Arbiter a, int aThread)
+        {
+            ArbiterCache cache = a.Cache;
+
+            // Contacts are stored in the local frames of the bodies, but the normal is in world
+            // space, so contacts are only reused if neither body moved, not only if their
+            // relative frame is unchanged.
+            if (mbReuseContacts && cache.bValid &&
+                _BarelyMoved(ref cache.FrameA, ref a.A.mFrame) &&
+                _BarelyMoved(ref cache.FrameB, ref a.B.mFrame))
+            {
+                if (a.A is WorldBody || a.B is WorldBody) { a.bConcave = true; }
+                mReusedPairs[aThread]++;
+                return;
+            }
+
+            bool bCollided = false;
+            if (a.A is IConvex && a.B is IConvex)
+            {
+                WorldContactPoint wp;
+                bool bTouching = (mbReuseContacts)
+                    ? XenoCollide.Collide((IConvex)a.A, (IConvex)a.B, ref cache.SeparatingAxis, out wp)
+                    : XenoCollide.Collide((IConvex)a.A, (IConvex)a.B, out wp);
+
+                if (bTouching) { a.Add(new ContactPoint(a.A, a.B, wp)); }
+                else { a.Refresh(); }
+
+                bCollided = true;
+            }
+            else if (a.B is WorldBody)
+            {
+                if (a.A.Type == BodyFlags.kDynamic || mIteration == 0)
+                {
+                    WorldBody wb = (WorldBody)a.B;
+                    a.bConcave = true;
+                    a.Contacts.Clear();
+
+                    wb.WorldTree.Collide(a.A, wb, ref a);
+                    bCollided = true;
+                }
+            }
+            else if (a.A is WorldBody)
+            {
+                if (a.B.Type == BodyFlags.kDynamic || mIteration == 0)
+                {
+                    WorldBody wb = (WorldBody)a.A;
+                    a.bConcave = true;
+                    a.Contacts.Clear();
+
+                    wb.WorldTree.Collide(a.B, wb, ref a);
+
+                    for (int j = 0; j < a.Contacts.Count; j++) { a.Contacts[j] = a.Contacts[j].Flip(); }
+                    bCollided = true;
+                }
+            }
+
+            if (bCollided)
+            {
+                cache.FrameA = a.A.mFrame;
+                cache.FrameB = a.B.mFrame;
+                cache.bValid = true;
+            }
+        }
+
+        private void _NarrowphaseItem(int aIndex, int aThread)
+        {
+            int begin = (aIndex * kNarrowphaseBatch);
+            int end = Utilities.Min(begin + kNarrowphaseBatch, mNarrowphaseCount);
+
+            for (int i = begin; i < end; i++) { _Collide(ref mNarrowphase[i], aThread); }
+        }
         #endregion
 
         #region Internal members
@@ -84,13 +192,65 @@ namespace jz.physics
         public World(IBroadphase aBroadphase)
         {
             mBroadphase = (aBroadphase == null) ? new Sap() : aBroadphase;
+            mNarrowphaseItem = _NarrowphaseItem;
         }
 
         public Vector3 Gravity { get { return mGravity; } set { mGravity = value; } }
 
+        /// <summary>
+        /// Number of islands solved by the last step of Tick().
+        /// </summary>
+        public int IslandCount { get { return mSolver.IslandCount; } }
+
+        /// <summary>
+        /// Total time in milliseconds spent in the narrow phase by the last call to Tick().
+        /// </summary>
+        public double NarrowphaseTime { get { return mNarrowphaseTimer.Elapsed.TotalMilliseconds; } }
+
+        /// <summary>
+        /// If true (the default), pairs whose bodies did not move since they were last collided
+        /// keep their contacts without colliding, and XenoCollide is seeded with the last
+        /// separating direction of each pair.
+        /// </summary>
+        public bool bReuseContacts { get { return mbReuseContacts; } set { mbReuseContacts = value; } }
+
+        /// <summary>
+        /// Number of pairs whose contacts were reused without colliding by the last call to Tick().
+        /// </summary>
+        public int ReusedPairs
+        {
+            get
+            {
+                int ret = 0;
+                for (int i = 0; i < mReusedPairs.Length; i++) { ret += mReusedPairs[i]; }
+
+                return ret;
+            }
+        }
+
+        /// <summary>
+        /// Maximum number of threads used to solve contacts, from 1 to WorkPool.ThreadCount.
+        /// Results do not depend on this value.
+        /// </summary>
+        public int SolverThreads { get { return mSolver.Threads; } set { mSolver.Threads = value; } }
+
+        /// <summary>
+        /// Total time in milliseconds spent solving contacts by the last call to Tick().
+        /// </summary>
+        public double SolveTime { get { return mSolveTimer.Elapsed.TotalMilliseconds; } }
+
+        /// <summary>
+        /// Sum over all islands of the solver iterations of the last call to Tick().
+        /// </summary>
+        public int SolverIterations { get { return mSolverIterations; } }
+
         public void Tick(float aTimeStep)
         {
             mTimePool += aTimeStep;
+            mSolveTimer.Reset();
+            mNarrowphaseTimer.Reset();
+            mSolverIterations = 0;
+            Array.Clear(mReusedPairs, 0, mReusedPairs.Length);
 
             int iteration = 0;
             while (Utilities.GreaterThan(mTimePool, PhysicsConstants.kTimeStep))
@@ -112,7 +272,7 @@ namespace jz.physics
                 #region Narrow phase
                 if (arbiters.Count > 0)
                 {
-                    Random r = new Random();
+                    Random r = mRandom;
                     List<Arbiter> ps = arbiters;
                     int count = ps.Count;
 
@@ -122,66 +282,23 @@ namespace jz.physics
                     #endregion
 
                     #region Collision
-                    for (int i = 0; i < count; i++)
-                    {
-                        if (ps[i].A is IConvex && ps[i].B is IConvex)
-                        {
-                            WorldContactPoint wp;
-                            if (XenoCollide.Collide((IConvex)(ps[i].A), (IConvex)(ps[i].B), out wp))
-                            {
-                                ContactPoint point = new ContactPoint(ps[i].A, ps[i].B, wp);
+                    if (mNarrowphase.Length < count) { mNarrowphase = new Arbiter[count]; }
+                    ps.CopyTo(mNarrowphase);
+                    mNarrowphaseCount = count;
+                    mIteration = iteration;
 
-                                Arbiter a = ps[i];
-                                a.Add(point);
-                                ps[i] = a;
-                            }
-                        }
-                        else if (ps[i].B is WorldBody)
-                        {
-                            if (ps[i].A.Type == BodyFlags.kDynamic || iteration == 0)
-                            {
-                                WorldBody wb = (WorldBody)ps[i].B;
-                                Arbiter a = ps[i];
-                                a.bConcave = true;
-                                a.Contacts.Clear();
-
-                                wb.WorldTree.Collide(ps[i].A, wb, ref a);
-                                
-                                ps[i] = a;
-                            }
-                        }
-                        else if (ps[i].A is WorldBody)
-                        {
-                            if (ps[i].B.Type == BodyFlags.kDynamic || iteration == 0)
-                            {
-                                WorldBody wb = (WorldBody)ps[i].A;
-                                Arbiter a = ps[i];
-                                a.bConcave = true;
-                                a.Contacts.Clear();
-
-                                wb.WorldTree.Collide(ps[i].B, wb, ref a);
-                                
-                                for (int j = 0; j < a.Contacts.Count; j++) { a.Contacts[j] = a.Contacts[j].Flip(); }
-                                ps[i] = a;
-                            }
-                        }
-                    }
+                    mNarrowphaseTimer.Start();
+                    WorkPool.For((count + kNarrowphaseBatch - 1) / kNarrowphaseBatch, mNarrowphaseItem);
+                    mNarrowphaseTimer.Stop();
+
+                    for (int i = 0; i < count; i++) { ps[i] = mNarrowphase[i]; }
                     #endregion
 
-                    #region Pre
+                    #region Apply
+                    // Apply() may move either body (see CharacterBody), so it runs serially
+                    // before the parallel solve.
                     for (int i = 0; i < count; i++)
                     {
-                        if (ps[i].A.Type == BodyFlags.kDynamic || ps[i].B.Type == BodyFlags.kDynamic)
-                        {
-                            int subCount = ps[i].Contacts.Count;
-                            for (int j = 0; j < subCount; j++)
-                            {
-                                ContactPoint point = ps[i].Contacts[j];
-                                point._Pre(ps[i].A, ps[i].B);
-                                ps[i].Contacts[j] = point;
-                            }
-                        }
-
                         if (ps[i].A.Type == BodyFlags.kDynamic ||
                             ps[i].B.Type == BodyFlags.kDynamic ||
                             iteration == 0)
@@ -199,26 +316,11 @@ namespace jz.physics
                     }
                     #endregion
 
-                    #region Iterate
-                    for (int k = 0; k < PhysicsConstants.kMaxSolverIterations; k++)
-                    {
-                        float error = 0.0f;
-                        for (int i = 0; i < count; i++)
-                        {
-                            if (ps[i].A.Type == BodyFlags.kDynamic || ps[i].B.Type == BodyFlags.kDynamic)
-                            {
-                                int subCount = ps[i].Contacts.Count;
-                                for (int j = 0; j < subCount; j++)
-                                {
-                                    ContactPoint point = ps[i].Contacts[j];
-                                    error += point._Tick(ps[i].A, ps[i].B);
-                                    ps[i].Contacts[j] = point;
-                                }
-                            }
-                        }
-
-                        if (error < PhysicsConstants.kDesiredError) { break; }
-                    }
+                    #region Solve
+                    mSolveTimer.Start();
+                    mSolver.Solve(mDynamics, ps);
+                    mSolveTimer.Stop();
+                    mSolverIterations += mSolver.Iterations;
                     #endregion
                 }
                 #endregion
@@ -0,0 +1,648 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using Microsoft.Xna.Framework;
+using System;
+using System.Collections;
+using System.Collections.Generic;
+using System.Diagnostics;
+using jz.physics.narrowphase;
+using siat;
+
+namespace jz.physics.broadphase
+{
+    /// <summary>
+    /// Incremental dynamic AABB tree, see: http://www.box2d.org/ (b2DynamicTree).
+    /// </summary>
+    /// <remarks>
+    /// Each object is a leaf with a "fat" AABB, its AABB grown by kFatMargin. Update() only
+    /// records the new AABB. At Tick(), objects whose AABB left their fat AABB are reinserted,
+    /// then the tree is queried with the fat AABB of each reinserted or added object to find new
+    /// pairs. Objects that stay inside their fat AABB cost nothing, so static and slow objects
+    /// are nearly free regardless of the object count.
+    ///
+    /// The pair table holds pairs whose fat AABBs overlap, so a pair is already tracked when its
+    /// objects come into contact without leaving their fat AABBs. Each Tick() only reports the
+    /// pairs whose actual AABBs overlap, the same pairs Sap reports.
+    ///
+    /// Insertion picks the sibling that minimizes the surface area added to the tree. Nodes are
+    /// rebalanced with AVL rotations on the way back up.
+    ///
+    /// Queries only read the tree, so with more than kParallelThreshold moved objects they run on
+    /// WorkPool threads, each into its own pair list. The lists are then added to the PairTable
+    /// on the calling thread.
+    ///
+    /// Handles are ushort, as required by IBroadphase and PairTable, so the object limit is
+    /// the same as Sap's.
+    /// </remarks>
+    public class AabbTree : IBroadphase
+    {
+        public static readonly Vector3 kCollisionBoundary = new Vector3(PhysicsConstants.kMinimumThickness);
+        public static readonly Vector3 kFatMargin = new Vector3(0.1f);
+
+        public const int kNull = -1;
+        public const ushort kInvalidHandle = ushort.MaxValue;
+        public const int kParallelThreshold = 64;
+
+        #region Private members
+        private struct Node
+        {
+            public Vector3 Min;
+            public Vector3 Max;
+            public int Parent;
+            public int Child1;
+            public int Child2;
+            public int Height;
+            public ushort Handle;
+        }
+
+        private struct Proxy
+        {
+            public Body Object;
+            public BoundingBox AABB;
+            public int Leaf;
+        }
+
+        private Node[] mNodes = new Node[16];
+        private int mNodeCount = 0;
+        private int mFreeNode = kNull;
+        private int mRoot = kNull;
+
+        private AddressList<Proxy> mProxies = new AddressList<Proxy>();
+        private List<ushort> mUpdates = new List<ushort>();
+        private List<ushort> mMoves = new List<ushort>();
+        private List<ushort> mRemoves = new List<ushort>();
+        private BitArray mUpdateCache = new BitArray(ushort.MaxValue);
+        private BitArray mMoveCache = new BitArray(ushort.MaxValue);
+        private BitArray mRemoveCache = new BitArray(ushort.MaxValue);
+
+        private PairTable mPairs;
+        private Pair[] mPairScratch = new Pair[0];
+        private List<Pair>[] mThreadPairs = null;
+        private int[][] mThreadStacks = null;
+        private WorkItem mQueryItem;
+
+        private static float _Area(ref Vector3 aMin, ref Vector3 aMax)
+        {
+            Vector3 d = (aMax - aMin);
+            return 2.0f * ((d.X * d.Y) + (d.Y * d.Z) + (d.Z * d.X));
+        }
+
+        private static bool _Overlaps(ref Vector3 aMinA, ref Vector3 aMaxA, ref Vector3 aMinB, ref Vector3 aMaxB)
+        {
+            return !(aMaxA.X < aMinB.X || aMaxB.X < aMinA.X ||
+                     aMaxA.Y < aMinB.Y || aMaxB.Y < aMinA.Y ||
+                     aMaxA.Z < aMinB.Z || aMaxB.Z < aMinA.Z);
+        }
+
+        private static bool _Collideable(Body a, Body b)
+        {
+            return ((a.CollidesWith & b.Type) != 0) && ((a.Type & b.CollidesWith) != 0);
+        }
+
+        private bool _IsLeaf(int aNode)
+        {
+            return (mNodes[aNode].Child1 == kNull);
+        }
+
+        private int _AllocateNode()
+        {
+            if (mFreeNode == kNull)
+            {
+                if (mNodeCount == mNodes.Length) { Array.Resize(ref mNodes, mNodes.Length * 2); }
+
+                mNodes[mNodeCount].Parent = kNull;
+                mFreeNode = mNodeCount++;
+            }
+
+            int ret = mFreeNode;
+            mFreeNode = mNodes[ret].Parent;
+
+            mNodes[ret].Parent = kNull;
+            mNodes[ret].Child1 = kNull;
+            mNodes[ret].Child2 = kNull;
+            mNodes[ret].Height = 0;
+            mNodes[ret].Handle = kInvalidHandle;
+
+            return ret;
+        }
+
+        private void _FreeNode(int aNode)
+        {
+            // Free nodes are linked through Parent.
+            mNodes[aNode].Parent = mFreeNode;
+            mNodes[aNode].Height = -1;
+            mFreeNode = aNode;
+        }
+
+        private void _Refit(int aNode)
+        {
+            int c1 = mNodes[aNode].Child1;
+            int c2 = mNodes[aNode].Child2;
+
+            mNodes[aNode].Height = 1 + Math.Max(mNodes[c1].Height, mNodes[c2].Height);
+            mNodes[aNode].Min = Vector3.Min(mNodes[c1].Min, mNodes[c2].Min);
+            mNodes[aNode].Max = Vector3.Max(mNodes[c1].Max, mNodes[c2].Max);
+        }
+
+        private void _ReplaceChild(int aParent, int aOld, int aNew)
+        {
+            if (aParent == kNull) { mRoot = aNew; }
+            else if (mNodes[aParent].Child1 == aOld) { mNodes[aParent].Child1 = aNew; }
+            else { mNodes[aParent].Child2 = aNew; }
+        }
+
+        /// <summary>
+        /// If aA is unbalanced, rotates its taller child up. Returns the root of the subtree.
+        /// </summary>
+        private int _Balance(int aA)
+        {
+            if (_IsLeaf(aA) || mNodes[aA].Height < 2) { return aA; }
+
+            int b = mNodes[aA].Child1;
+            int c = mNodes[aA].Child2;
+            int balance = (mNodes[c].Height - mNodes[b].Height);
+
+            if (balance > 1)
+            {
+                int f = mNodes[c].Child1;
+                int g = mNodes[c].Child2;
+
+                mNodes[c].Child1 = aA;
+                mNodes[c].Parent = mNodes[aA].Parent;
+                mNodes[aA].Parent = c;
+                _ReplaceChild(mNodes[c].Parent, aA, c);
+
+                if (mNodes[f].Height > mNodes[g].Height)
+                {
+                    mNodes[c].Child2 = f;
+                    mNodes[aA].Child2 = g;
+                    mNodes[g].Parent = aA;
+                }
+                else
+                {
+                    mNodes[c].Child2 = g;
+                    mNodes[aA].Child2 = f;
+                    mNodes[f].Parent = aA;
+                }
+
+                _Refit(aA);
+                _Refit(c);
+
+                return c;
+            }
+            else if (balance < -1)
+            {
+                int d = mNodes[b].Child1;
+                int e = mNodes[b].Child2;
+
+                mNodes[b].Child1 = aA;
+                mNodes[b].Parent = mNodes[aA].Parent;
+                mNodes[aA].Parent = b;
+                _ReplaceChild(mNodes[b].Parent, aA, b);
+
+                if (mNodes[d].Height > mNodes[e].Height)
+                {
+                    mNodes[b].Child2 = d;
+                    mNodes[aA].Child1 = e;
+                    mNodes[e].Parent = aA;
+                }
+                else
+                {
+                    mNodes[b].Child2 = e;
+                    mNodes[aA].Child1 = d;
+                    mNodes[d].Parent = aA;
+                }
+
+                _Refit(aA);
+                _Refit(b);
+
+                return b;
+            }
+
+            return aA;
+        }
+
+        private void _RefitUp(int aNode)
+        {
+            int index = aNode;
+            while (index != kNull)
+            {
+                index = _Balance(index);
+                _Refit(index);
+                index = mNodes[index].Parent;
+            }
+        }
+
+        private float _DescendCost(int aChild, ref Vector3 aMin, ref Vector3 aMax, float aInheritance)
+        {
+            Vector3 min = Vector3.Min(mNodes[aChild].Min, aMin);
+            Vector3 max = Vector3.Max(mNodes[aChild].Max, aMax);
+
+            if (_IsLeaf(aChild)) { return _Area(ref min, ref max) + aInheritance; }
+            else { return (_Area(ref min, ref max) - _Area(ref mNodes[aChild].Min, ref mNodes[aChild].Max)) + aInheritance; }
+        }
+
+        private void _InsertLeaf(int aLeaf)
+        {
+            if (mRoot == kNull)
+            {
+                mRoot = aLeaf;
+                mNodes[aLeaf].Parent = kNull;
+                return;
+            }
+
+            Vector3 min = mNodes[aLeaf].Min;
+            Vector3 max = mNodes[aLeaf].Max;
+
+            #region Find the best sibling
+            int index = mRoot;
+            while (!_IsLeaf(index))
+            {
+                float area = _Area(ref mNodes[index].Min, ref mNodes[index].Max);
+                Vector3 combinedMin = Vector3.Min(mNodes[index].Min, min);
+                Vector3 combinedMax = Vector3.Max(mNodes[index].Max, max);
+                float combinedArea = _Area(ref combinedMin, ref combinedMax);
+
+                // Cost of making a new parent of this node and the leaf, and the minimum cost
+                // pushed down to the children if descending.
+                float cost = 2.0f * combinedArea;
+                float inheritance = 2.0f * (combinedArea - area);
+
+                float cost1 = _DescendCost(mNodes[index].Child1, ref min, ref max, inheritance);
+                float cost2 = _DescendCost(mNodes[index].Child2, ref min, ref max, inheritance);
+
+                if (cost < cost1 && cost < cost2) { break; }
+
+                index = (cost1 < cost2) ? mNodes[index].Child1 : mNodes[index].Child2;
+            }
+            #endregion
+
+            #region Make a new parent of the sibling and the leaf
+            int sibling = index;
+            int oldParent = mNodes[sibling].Parent;
+            int newParent = _AllocateNode();
+
+            mNodes[newParent].Parent = oldParent;
+            mNodes[newParent].Child1 = sibling;
+            mNodes[newParent].Child2 = aLeaf;
+            mNodes[sibling].Parent = newParent;
+            mNodes[aLeaf].Parent = newParent;
+            _ReplaceChild(oldParent, sibling, newParent);
+            #endregion
+
+            _RefitUp(newParent);
+        }
+
+        private void _RemoveLeaf(int aLeaf)
+        {
+            if (aLeaf == mRoot)
+            {
+                mRoot = kNull;
+                return;
+            }
+
+            int parent = mNodes[aLeaf].Parent;
+            int grandParent = mNodes[parent].Parent;
+            int sibling = (mNodes[parent].Child1 == aLeaf) ? mNodes[parent].Child2 : mNodes[parent].Child1;
+
+            _ReplaceChild(grandParent, parent, sibling);
+            mNodes[sibling].Parent = grandParent;
+            _FreeNode(parent);
+
+            if (grandParent != kNull) { _RefitUp(grandParent); }
+        }
+
+        private void _SetFatAABB(int aLeaf, ref BoundingBox aAABB)
+        {
+            BoundingBox fat = aAABB;
+            fat.Min -= kFatMargin;
+            fat.Max += kFatMargin;
+            Utilities.Clamp(ref fat, ref PhysicsConstants.kMaximumAABB, out fat);
+
+            mNodes[aLeaf].Min = fat.Min;
+            mNodes[aLeaf].Max = fat.Max;
+        }
+
+        private bool _FatContains(int aLeaf, ref BoundingBox aAABB)
+        {
+            return (mNodes[aLeaf].Min.X <= aAABB.Min.X && mNodes[aLeaf].Min.Y <= aAABB.Min.Y && mNodes[aLeaf].Min.Z <= aAABB.Min.Z &&
+                    mNodes[aLeaf].Max.X >= aAABB.Max.X && mNodes[aLeaf].Max.Y >= aAABB.Max.Y && mNodes[aLeaf].Max.Z >= aAABB.Max.Z);
+        }
+
+        private void _Move(ushort aHandle)
+        {
+            if (!mMoveCache[aHandle])
+            {
+                mMoveCache[aHandle] = true;
+                mMoves.Add(aHandle);
+            }
+        }
+
+        /// <summary>
+        /// Finds the pairs of one moved object. Runs on WorkPool threads, only reads the tree.
+        /// </summary>
+        private void _Query(int aIndex, int aThread)
+        {
+            ushort handle = mMoves[aIndex];
+            if (mRemoveCache[handle]) { return; }
+
+            Proxy[] proxies = mProxies.Data;
+            int leaf = proxies[handle].Leaf;
+            Body body = proxies[handle].Object;
+            Vector3 min = mNodes[leaf].Min;
+            Vector3 max = mNodes[leaf].Max;
+
+            List<Pair> pairs = mThreadPairs[aThread];
+            int[] stack = mThreadStacks[aThread];
+            int top = 0;
+
+            stack[top++] = mRoot;
+            while (top > 0)
+            {
+                int node = stack[--top];
+                if (!_Overlaps(ref min, ref max, ref mNodes[node].Min, ref mNodes[node].Max)) { continue; }
+
+                if (_IsLeaf(node))
+                {
+                    ushort other = mNodes[node].Handle;
+                    if (other == handle || mRemoveCache[other]) { continue; }
+
+                    // Both moved, the pair is found from the lower handle only.
+                    if (mMoveCache[other] && other < handle) { continue; }
+
+                    if (_Collideable(body, proxies[other].Object)) { pairs.Add(new Pair(handle, other)); }
+                }
+                else
+                {
+                    if (top + 2 > stack.Length) { Array.Resize(ref mThreadStacks[aThread], stack.Length * 2); stack = mThreadStacks[aThread]; }
+
+                    stack[top++] = mNodes[node].Child1;
+                    stack[top++] = mNodes[node].Child2;
+                }
+            }
+        }
+
+        private void _TickUpdates()
+        {
+            Proxy[] proxies = mProxies.Data;
+
+            int count = mUpdates.Count;
+            for (int i = 0; i < count; i++)
+            {
+                ushort handle = mUpdates[i];
+                mUpdateCache[handle] = false;
+
+                if (mRemoveCache[handle]) { continue; }
+
+                int leaf = proxies[handle].Leaf;
+                if (!_FatContains(leaf, ref proxies[handle].AABB))
+                {
+                    _RemoveLeaf(leaf);
+                    _SetFatAABB(leaf, ref proxies[handle].AABB);
+                    _InsertLeaf(leaf);
+                    _Move(handle);
+                }
+            }
+
+            mUpdates.Clear();
+        }
+
+        /// <summary>
+        /// Removes pairs of removed objects and pairs whose fat AABBs no longer overlap.
+        /// </summary>
+        private void _TickStalePairs()
+        {
+            if (mRemoves.Count > 0) { mPairs.Remove(mRemoveCache); }
+            if (mMoves.Count == 0) { return; }
+
+            Proxy[] proxies = mProxies.Data;
+
+            mPairs.GetAllPairs(ref mPairScratch);
+            int count = mPairScratch.Length;
+            for (int i = 0; i < count; i++)
+            {
+                ushort a = mPairScratch[i].A;
+                ushort b = mPairScratch[i].B;
+
+                if (!mMoveCache[a] && !mMoveCache[b]) { continue; }
+
+                int leafA = proxies[a].Leaf;
+                int leafB = proxies[b].Leaf;
+                if (!_Overlaps(ref mNodes[leafA].Min, ref mNodes[leafA].Max, ref mNodes[leafB].Min, ref mNodes[leafB].Max))
+                {
+                    mPairs.Remove(a, b);
+                }
+            }
+        }
+
+        private void _TickNewPairs()
+        {
+            int count = mMoves.Count;
+            if (count == 0) { return; }
+
+            int threadCount = WorkPool.ThreadCount;
+            if (mThreadPairs == null || mThreadPairs.Length != threadCount)
+            {
+                mThreadPairs = new List<Pair>[threadCount];
+                mThreadStacks = new int[threadCount][];
+                for (int i = 0; i < threadCount; i++)
+                {
+                    mThreadPairs[i] = new List<Pair>();
+                    mThreadStacks[i] = new int[64];
+                }
+            }
+
+            if (count > kParallelThreshold) { WorkPool.For(count, mQueryItem); }
+            else { for (int i = 0; i < count; i++) { _Query(i, 0); } }
+
+            for (int i = 0; i < threadCount; i++)
+            {
+                List<Pair> pairs = mThreadPairs[i];
+                int pairCount = pairs.Count;
+                for (int j = 0; j < pairCount; j++) { mPairs.Add(pairs[j].A, pairs[j].B); }
+                pairs.Clear();
+            }
+
+            for (int i = 0; i < count; i++) { mMoveCache[mMoves[i]] = false; }
+            mMoves.Clear();
+        }
+
+        private void _TickRemoves()
+        {
+            int count = mRemoves.Count;
+            for (int i = 0; i < count; i++)
+            {
+                ushort handle = mRemoves[i];
+                int leaf = mProxies.Data[handle].Leaf;
+
+                _RemoveLeaf(leaf);
+                _FreeNode(leaf);
+
+                mRemoveCache[handle] = false;
+                mProxies.Remove(handle);
+            }
+
+            mRemoves.Clear();
+        }
+        #endregion
+
+        #region Protected members
+        protected List<Arbiter> mArbiters;
+
+        protected PairCallback mAddHandler;
+        protected PairCallback mRemoveHandler;
+        protected PairPointCallback mUpdateHandler;
+
+        protected void _AddHandler(ref Pair aPair) { }
+        protected void _RemoveHandler(ref Pair aPair) { }
+
+        protected void _UpdateHandler(ref Pair aPair, ref Arbiter aPoints)
+        {
+            Proxy[] proxies = mProxies.Data;
+            if (!_Overlaps(ref proxies[aPair.A].AABB.Min, ref proxies[aPair.A].AABB.Max, ref proxies[aPair.B].AABB.Min, ref proxies[aPair.B].AABB.Max))
+            {
+                return;
+            }
+
+            aPoints.A = proxies[aPair.A].Object;
+            aPoints.B = proxies[aPair.B].Object;
+            mArbiters.Add(aPoints);
+        }
+        #endregion
+
+        #region Overrides
+        /// <summary>
+        /// Adds a new object to the tree.
+        /// </summary>
+        /// <param name="aCollideable">The object to add.</param>
+        /// <param name="aAABB">The initial AABB of the object.</param>
+        /// <returns>A handle to the object used for future calls to Update() and Remove()</returns>
+        public ushort Add(Body aCollideable, ref BoundingBox aAABB)
+        {
+            Debug.Assert(aCollideable != null);
+
+            Proxy proxy = new Proxy();
+            proxy.Object = aCollideable;
+            proxy.AABB = aAABB;
+            proxy.AABB.Max += kCollisionBoundary;
+            proxy.AABB.Min -= kCollisionBoundary;
+            Utilities.Clamp(ref proxy.AABB, ref PhysicsConstants.kMaximumAABB, out proxy.AABB);
+
+            int index = mProxies.Add(proxy);
+            if (index >= kInvalidHandle)
+            {
+                mProxies.Remove(index);
+                throw new Exception("Exceeded maximum number of physical objects.");
+            }
+            ushort handle = (ushort)index;
+
+            int leaf = _AllocateNode();
+            mNodes[leaf].Handle = handle;
+            _SetFatAABB(leaf, ref proxy.AABB);
+            _InsertLeaf(leaf);
+
+            mProxies.Data[handle].Leaf = leaf;
+            _Move(handle);
+
+            return handle;
+        }
+
+        public ushort CurrentMaxHandle
+        {
+            get
+            {
+                return (ushort)(mProxies.Count - 1);
+            }
+        }
+
+        /// <summary>
+        /// Batches removal of the object with the handle aHandle.
+        /// </summary>
+        /// <remarks>
+        /// The handle is invalid after this call and may be reused after the next Tick().
+        /// </remarks>
+        public void Remove(ushort aHandle)
+        {
+            Debug.Assert(aHandle != kInvalidHandle);
+
+            if (!mRemoveCache[aHandle])
+            {
+                mRemoveCache[aHandle] = true;
+                mRemoves.Add(aHandle);
+            }
+        }
+
+        public void Tick(List<Arbiter> aArbiters)
+        {
+            mArbiters = aArbiters;
+
+            // Pairs are found before removed objects leave the tree, so the remove callbacks
+            // can still access their entries.
+            _TickUpdates();
+            _TickStalePairs();
+            _TickNewPairs();
+            mPairs.Tick(mAddHandler, mUpdateHandler, mRemoveHandler);
+            _TickRemoves();
+        }
+
+        /// <summary>
+        /// Batches an object with handle aHandle for update to the new AABB aNewAABB.
+        /// </summary>
+        /// <param name="aHandle">The handle of the object to update.</param>
+        /// <param name="aNewAABB">The new AABB.</param>
+        public void Update(ushort aHandle, ref BoundingBox aNewAABB)
+        {
+            Debug.Assert(aHandle != kInvalidHandle);
+
+            if (mRemoveCache[aHandle]) { return; }
+
+            BoundingBox aabb = aNewAABB;
+            aabb.Max += kCollisionBoundary;
+            aabb.Min -= kCollisionBoundary;
+            Utilities.Clamp(ref aabb, ref PhysicsConstants.kMaximumAABB, out mProxies.Data[aHandle].AABB);
+
+            if (!mUpdateCache[aHandle])
+            {
+                mUpdateCache[aHandle] = true;
+                mUpdates.Add(aHandle);
+            }
+        }
+        #endregion
+
+        public AabbTree() : this(PairTable.kMinSizePower) { }
+        public AabbTree(int aPairTableSizePower)
+        {
+            mAddHandler = _AddHandler;
+            mRemoveHandler = _RemoveHandler;
+            mUpdateHandler = _UpdateHandler;
+            mQueryItem = _Query;
+
+            mPairs = new PairTable(aPairTableSizePower);
+        }
+
+        /// <summary>
+        /// Height of the tree, 0 if it has one object or none.
+        /// </summary>
+        public int Height { get { return (mRoot == kNull) ? 0 : mNodes[mRoot].Height; } }
+    }
+}
@@ -0,0 +1,181 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using Microsoft.Xna.Framework;
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using jz.physics.narrowphase;
+
+namespace jz.physics.broadphase
+{
+    /// <summary>
+    /// Compares IBroadphase implementations on generated scenes of unit boxes.
+    /// </summary>
+    /// <remarks>
+    /// Boxes are placed at random in a cube sized so that each box has about 16 units of volume.
+    /// Moving boxes take a random walk each step. The same seed gives the same scene and walk to
+    /// every broadphase, so arbiter counts of different broadphases should match.
+    /// </remarks>
+    public static class BroadphaseBenchmark
+    {
+        public delegate IBroadphase Factory();
+
+        public enum Workload
+        {
+            /// <summary>
+            /// 90% static boxes, 10% dynamic boxes that move every step.
+            /// </summary>
+            kStaticHeavy,
+
+            /// <summary>
+            /// All boxes are dynamic and move every step.
+            /// </summary>
+            kDynamic
+        }
+
+        public struct Result
+        {
+            public int Count;
+            public Workload Workload;
+            public double BuildTime;
+            public double StepTime;
+            public int Arbiters;
+        }
+
+        public const int kDefaultSeed = 1;
+        public const float kStepSize = 0.1f;
+        public const float kVolumePerBody = 16.0f;
+        public const float kStaticHeavyMovingFactor = 0.1f;
+
+        public static readonly int[] kDefaultCounts = new int[] { 1000, 10000, 50000 };
+
+        #region Private members
+        private static BoundingBox _GetAABB(ref Vector3 aCenter)
+        {
+            return new BoundingBox(aCenter - new Vector3(0.5f), aCenter + new Vector3(0.5f));
+        }
+
+        private static float _Next(Random r, float aMin, float aMax)
+        {
+            return (aMin + ((float)r.NextDouble() * (aMax - aMin)));
+        }
+        #endregion
+
+        /// <summary>
+        /// Adds aCount boxes to a new broadphase from aFactory, then runs aSteps of Update() and
+        /// Tick(). Times are in milliseconds, StepTime is per step.
+        /// </summary>
+        public static Result Run(Factory aFactory, int aCount, Workload aWorkload, int aSteps, int aSeed)
+        {
+            Random r = new Random(aSeed);
+            float halfSide = 0.5f * (float)Math.Pow(aCount * kVolumePerBody, 1.0 / 3.0);
+            int movingCount = (aWorkload == Workload.kDynamic) ? aCount : (int)(aCount * kStaticHeavyMovingFactor);
+
+            BoxBody[] bodies = new BoxBody[aCount];
+            Vector3[] centers = new Vector3[aCount];
+            ushort[] handles = new ushort[aCount];
+            List<Arbiter> arbiters = new List<Arbiter>();
+            Stopwatch timer = new Stopwatch();
+
+            BoundingBox unit = new BoundingBox(new Vector3(-0.5f), new Vector3(0.5f));
+            for (int i = 0; i < aCount; i++)
+            {
+                bodies[i] = new BoxBody(ref unit);
+                if (i < movingCount)
+                {
+                    bodies[i].Type = BodyFlags.kDynamic;
+                    bodies[i].CollidesWith = (BodyFlags.kDynamic | BodyFlags.kKinematic | BodyFlags.kStatic);
+                }
+
+                centers[i] = new Vector3(_Next(r, -halfSide, halfSide), _Next(r, -halfSide, halfSide), _Next(r, -halfSide, halfSide));
+            }
+
+            Result ret = new Result();
+            ret.Count = aCount;
+            ret.Workload = aWorkload;
+
+            timer.Start();
+            IBroadphase broadphase = aFactory();
+            for (int i = 0; i < aCount; i++)
+            {
+                BoundingBox aabb = _GetAABB(ref centers[i]);
+                handles[i] = broadphase.Add(bodies[i], ref aabb);
+            }
+            broadphase.Tick(arbiters);
+            timer.Stop();
+            ret.BuildTime = timer.Elapsed.TotalMilliseconds;
+
+            timer.Reset();
+            for (int step = 0; step < aSteps; step++)
+            {
+                for (int i = 0; i < movingCount; i++)
+                {
+                    Vector3 c = centers[i] + new Vector3(_Next(r, -kStepSize, kStepSize), _Next(r, -kStepSize, kStepSize), _Next(r, -kStepSize, kStepSize));
+                    centers[i] = Vector3.Clamp(c, new Vector3(-halfSide), new Vector3(halfSide));
+                }
+
+                arbiters.Clear();
+
+                timer.Start();
+                for (int i = 0; i < movingCount; i++)
+                {
+                    BoundingBox aabb = _GetAABB(ref centers[i]);
+                    broadphase.Update(handles[i], ref aabb);
+                }
+                broadphase.Tick(arbiters);
+                timer.Stop();
+
+                ret.Arbiters += arbiters.Count;
+            }
+            ret.StepTime = (aSteps > 0) ? (timer.Elapsed.TotalMilliseconds / aSteps) : 0.0;
+
+            return ret;
+        }
+
+        /// <summary>
+        /// Runs every broadphase in aFactories for kDefaultCounts under both workloads and
+        /// writes one line per run to aOut.
+        /// </summary>
+        public static void Run(TextWriter aOut, string[] aNames, Factory[] aFactories, int aSteps)
+        {
+            aOut.WriteLine("broadphase,workload,count,build ms,step ms,arbiters");
+
+            foreach (Workload workload in new Workload[] { Workload.kStaticHeavy, Workload.kDynamic })
+            {
+                foreach (int count in kDefaultCounts)
+                {
+                    for (int i = 0; i < aFactories.Length; i++)
+                    {
+                        Result result = Run(aFactories[i], count, workload, aSteps, kDefaultSeed);
+
+                        aOut.WriteLine(aNames[i] + "," + workload.ToString() + "," + count + "," +
+                            result.BuildTime.ToString("F3") + "," + result.StepTime.ToString("F3") + "," +
+                            result.Arbiters);
+                        aOut.Flush();
+                    }
+                }
+            }
+        }
+    }
+}
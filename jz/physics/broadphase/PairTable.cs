@@ -250,6 +250,8 @@ namespace jz.physics.broadphase
 
             // Add the new pair into the pair array.
             mPairs[pairIndex] = new Pair(a, b);
+            mPoints[pairIndex] = new Arbiter();
+            mPoints[pairIndex].Cache = new ArbiterCache();
             mPoints[pairIndex].Contacts = new List<ContactPoint>(4);
             mPairCount++;
 
@@ -29,6 +29,29 @@ using siat;
 
 namespace jz.physics.narrowphase
 {
+    /// <summary>
+    /// State of an Arbiter that persists between ticks.
+    /// </summary>
+    /// <remarks>
+    /// Arbiter is a struct that is copied out of the PairTable each tick, so persistent state other
+    /// than Contacts must be held by reference.
+    /// </remarks>
+    public sealed class ArbiterCache
+    {
+        /// <summary>
+        /// Frames of A and B when the pair was last collided. Valid if bValid is true.
+        /// </summary>
+        public CoordinateFrame FrameA;
+        public CoordinateFrame FrameB;
+
+        /// <summary>
+        /// Last separating direction found by XenoCollide, or zero if the pair was touching.
+        /// </summary>
+        public Vector3 SeparatingAxis = Vector3.Zero;
+
+        public bool bValid = false;
+    }
+
     /// <summary>
     /// Manages a persistent set of contact points between two rigid bodies.
     /// </summary>
@@ -100,6 +123,20 @@ namespace jz.physics.narrowphase
             Contacts[index] = p;
         }
 
+        private int _FindConvex(ContactPoint aPoint)
+        {
+            int count = Contacts.Count;
+            for (int i = 0; i < count; i++)
+            {
+                if (Vector3.DistanceSquared(Contacts[i].LocalPointA, aPoint.LocalPointA) < PhysicsConstants.kMinimumThickness2)
+                {
+                    return i;
+                }
+            }
+
+            return -1;
+        }
+
         private void _RefreshConvex()
         {
             int count = Contacts.Count;
@@ -129,6 +166,7 @@ namespace jz.physics.narrowphase
         public bool bConcave;
         public Body A;
         public Body B;
+        public ArbiterCache Cache;
         public List<ContactPoint> Contacts;
         public int SortOrder;
 
@@ -138,6 +176,19 @@ namespace jz.physics.narrowphase
             {
                 _RefreshConvex();
 
+                // A point at the same place as an existing point replaces it and keeps its
+                // accumulated impulse, so the solver is warm started.
+                int index = _FindConvex(ap);
+                if (index >= 0)
+                {
+                    ContactPoint p = Contacts[index];
+                    p.LocalPointA = ap.LocalPointA;
+                    p.LocalPointB = ap.LocalPointB;
+                    p.WorldNormal = ap.WorldNormal;
+                    Contacts[index] = p;
+                    return;
+                }
+
                 int count = Contacts.Count;
 
                 Debug.Assert(count <= kConvexMaxPoints);
@@ -149,6 +200,14 @@ namespace jz.physics.narrowphase
                 Contacts.Add(ap);
             }
         }
+
+        /// <summary>
+        /// Removes points of a convex pair that are no longer in contact.
+        /// </summary>
+        public void Refresh()
+        {
+            if (!bConcave) { _RefreshConvex(); }
+        }
     }
 
     public struct ContactEntry
@@ -222,6 +281,8 @@ namespace jz.physics.narrowphase
         #endregion
 
         #region Internal members
+        // _Pre() and _Tick() only write the momentum of dynamic bodies. Static and kinematic
+        // bodies can be shared by islands that IslandSolver solves concurrently.
         internal void _Pre(Body a, Body b)
         {
             Vector3 wa = a.mFrame.Transform(LocalPointA);
@@ -255,14 +316,14 @@ namespace jz.physics.narrowphase
 
             mMass = 1.0f / (invMa + invMb + Vector3.Dot(wn, (Vector3.Cross(ima, ra) + Vector3.Cross(imb, rb))));
 
-            if (a is RigidBody)
+            if (a.Type == BodyFlags.kDynamic)
             {
                 RigidBody rba = (RigidBody)a;
                 rba.mLinearMomentum -= mMomentum * wn;
                 rba.mAngularMomentum -= mMomentum * Vector3.Cross(ra, wn);
             }
 
-            if (b is RigidBody)
+            if (b.Type == BodyFlags.kDynamic)
             {
                 RigidBody rbb = (RigidBody)b;
                 rbb.mLinearMomentum += mMomentum * wn;
@@ -312,14 +373,14 @@ namespace jz.physics.narrowphase
                 ret += Math.Abs(mp);
                 Vector3 mpv = (mp * wn);
 
-                if (a is RigidBody)
+                if (a.Type == BodyFlags.kDynamic)
                 {
                     RigidBody rba = (RigidBody)a;
                     rba.mLinearMomentum -= mpv;
                     rba.mAngularMomentum -= (mp * Vector3.Cross(ra, wn));
                 }
 
-                if (b is RigidBody)
+                if (b.Type == BodyFlags.kDynamic)
                 {
                     RigidBody rbb = (RigidBody)b;
                     rbb.mLinearMomentum += mpv;
@@ -378,14 +439,14 @@ namespace jz.physics.narrowphase
                 ret += Math.Abs(mp);
                 Vector3 mpv = (mp * vn);
 
-                if (a is RigidBody)
+                if (a.Type == BodyFlags.kDynamic)
                 {
                     RigidBody rba = (RigidBody)a;
                     rba.mLinearMomentum -= (rba.Friction * mpv);
                     rba.mAngularMomentum -= (rba.Friction * mp * Vector3.Cross(ra, vn));
                 }
 
-                if (b is RigidBody)
+                if (b.Type == BodyFlags.kDynamic)
                 {
                     RigidBody rbb = (RigidBody)b;
                     rbb.mLinearMomentum += (rbb.Friction * mpv);
@@ -51,6 +51,7 @@ namespace jz.physics.narrowphase
         internal Matrix3 mInertiaTensor = Matrix3.Zero;
         internal Matrix3 mInverseInertiaTensor = Matrix3.Zero;
         internal Vector3 mLinearMomentum = Vector3.Zero;
+        internal int mSolverIndex = -1;
 
         internal void _Integrate()
         {
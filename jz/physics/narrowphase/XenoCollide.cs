@@ -247,5 +247,32 @@ namespace jz.physics.narrowphase
             return bReturn;
         }
 
+        /// <summary>
+        /// Collide() seeded with arSeparatingAxis, the separating direction found by a previous call
+        /// for the same pair, or zero.
+        /// </summary>
+        /// <remarks>
+        /// If the shapes are still separated along arSeparatingAxis, returns false after one support
+        /// query per shape instead of a full search. On return, arSeparatingAxis is the new separating
+        /// direction, or zero if the shapes touch.
+        /// </remarks>
+        public static bool Collide(IConvex a, IConvex b, ref Vector3 arSeparatingAxis, out WorldContactPoint arContactPoint)
+        {
+            if (!Utilities.AboutZero(ref arSeparatingAxis))
+            {
+                Vector3 v = (b.GetWorldSupport(arSeparatingAxis) - a.GetWorldSupport(-arSeparatingAxis));
+                if (Vector3.Dot(v, arSeparatingAxis) <= 0.0f)
+                {
+                    arContactPoint = new WorldContactPoint();
+                    arContactPoint.WorldNormal = arSeparatingAxis;
+                    return false;
+                }
+            }
+
+            bool bReturn = Collide(a, b, out arContactPoint);
+            arSeparatingAxis = (bReturn) ? Vector3.Zero : arContactPoint.WorldNormal;
+
+            return bReturn;
+        }
     }
 }
@@ -68,6 +68,37 @@ namespace jz
             table.GetAllPairs(ref pairs);
         }
 
+        private static void _BroadphaseBenchmark()
+        {
+            const int kSteps = 60;
+            const string kReportFile = "broadphase_benchmark.csv";
+
+            string[] names = new string[] { "Sap", "AabbTree" };
+            BroadphaseBenchmark.Factory[] factories = new BroadphaseBenchmark.Factory[]
+                {
+                    delegate() { return new Sap(PairTable.kMaxSizePower); },
+                    delegate() { return new AabbTree(PairTable.kMaxSizePower); }
+                };
+
+            using (StreamWriter writer = new StreamWriter(kReportFile))
+            {
+                BroadphaseBenchmark.Run(writer, names, factories, kSteps);
+            }
+        }
+
+        private static void _SolverBenchmark()
+        {
+            const int kStacksSide = 16;
+            const int kLayerSide = 24;
+            const int kTicks = 120;
+            const string kReportFile = "solver_benchmark.csv";
+
+            using (StreamWriter writer = new StreamWriter(kReportFile))
+            {
+                SolverBenchmark.Run(writer, kStacksSide, kLayerSide, kTicks);
+            }
+        }
+
         private const int kBoxCount = 5;
 
         private static SceneNodePoser mPoser;
@@ -186,6 +217,25 @@ namespace jz
             proc.Process(doc, null);
         }
 
+        private static void _ImportBenchmark()
+        {
+            const int kRuns = 3;
+            const string kReportFile = "import_benchmark.csv";
+            const string kStageReportFile = "import_stages.csv";
+
+            string[] files = new string[] { "..\\..\\sail_demo\\media\\1930_room\\SIAT_room_0013_lights.dae" };
+
+            using (StreamWriter writer = new StreamWriter(kReportFile))
+            {
+                ImportBenchmark.Run(writer, files, kRuns, true);
+            }
+
+            using (StreamWriter writer = new StreamWriter(kStageReportFile))
+            {
+                ImportBenchmark.RunStages(writer, files[0], kRuns);
+            }
+        }
+
         private static void _OnAnimationLoad()
         {
             Cell cell = Cell.GetCell("woman");
@@ -316,8 +366,11 @@ namespace jz
         public static void Go()
         {
             // _PairTableTest();
+            // _BroadphaseBenchmark();
+            // _SolverBenchmark();
             _RigidBodyTest();
             // _ColladaTest();
+            // _ImportBenchmark();
             // _AnimationTest();
             // _DepthSoftwareRasterizerTest();
         }
@@ -0,0 +1,292 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using Microsoft.Xna.Framework.Graphics;
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Threading;
+using siat;
+
+namespace sail
+{
+    /// <summary>
+    /// Called with the metrics extracted from a submitted frame and the tag it was submitted with.
+    /// </summary>
+    public delegate void ExtractionHandler(object aTag, ref ImageIlluminationMetrics arMetrics);
+
+    /// <summary>
+    /// Extracts lighting from rendered frames without stalling the render thread on read back.
+    /// </summary>
+    /// <remarks>
+    /// Submit() resolves the back buffer into the next target of a ring. Each target is read
+    /// back Latency frames after it was resolved, once the GPU is done with it, and the image
+    /// is passed to a worker thread. The worker runs LightingExtractor.ExtractLighting() and
+    /// then Extracted, one image at a time in submission order. Update() raises Ready on the
+    /// calling thread for each finished extraction, also in submission order, so results can
+    /// be applied to scene nodes.
+    ///
+    /// Interval limits submissions to one per Interval seconds of wall time, so the extraction
+    /// rate does not depend on the frame rate.
+    ///
+    /// Call Update() once per frame, before Submit().
+    ///
+    /// \warning Extracted runs on the worker thread. It must only touch data that the render
+    ///          thread does not use while extractions are pending.
+    /// </remarks>
+    public sealed class AsyncLightExtractor : IDisposable
+    {
+        public const int kDefaultLatency = 2;
+        public const int kMaxLatency = 4;
+
+        #region Private members
+        private sealed class Slot
+        {
+            public ResolveTexture2D Target = null;
+            public object Tag = null;
+            public long Frame = 0;
+            public bool bPending = false;
+        }
+
+        private sealed class Job
+        {
+            public object Tag = null;
+            public LightExtractorImage Image;
+            public ImageIlluminationMetrics Metrics;
+        }
+
+        private readonly GraphicsDevice mDevice;
+        private readonly int mLatency;
+        private readonly Slot[] mSlots;
+        private int mNextSlot = 0;
+        private int mReadbackSlot = 0;
+        private long mFrame = 0;
+        private int mPending = 0;
+
+        private double mInterval = 0.0;
+        private double mNextSubmitTime = 0.0;
+        private readonly Stopwatch mTimer = Stopwatch.StartNew();
+
+        private readonly object mLock = new object();
+        private readonly Stack<Job> mFree = new Stack<Job>();
+        private readonly Queue<Job> mWork = new Queue<Job>();
+        private readonly Queue<Job> mDone = new Queue<Job>();
+        private readonly AutoResetEvent mWake = new AutoResetEvent(false);
+        private readonly Thread mWorker;
+        private Exception mException = null;
+        private bool mbDisposed = false;
+
+        private void _Run()
+        {
+            while (true)
+            {
+                mWake.WaitOne();
+
+                while (true)
+                {
+                    Job job;
+                    lock (mLock)
+                    {
+                        if (mbDisposed) { return; }
+                        if (mWork.Count == 0) { break; }
+                        job = mWork.Dequeue();
+                    }
+
+                    try
+                    {
+                        LightingExtractor.ExtractLighting(ref job.Image, out job.Metrics);
+                        if (Extracted != null) { Extracted(job.Tag, ref job.Metrics); }
+                    }
+                    catch (Exception e)
+                    {
+                        lock (mLock) { if (mException == null) { mException = e; } }
+                    }
+
+                    lock (mLock) { mDone.Enqueue(job); }
+                }
+            }
+        }
+
+        private void _ReadBack()
+        {
+            while (true)
+            {
+                Slot slot = mSlots[mReadbackSlot];
+                if (!slot.bPending || (mFrame - slot.Frame) < mLatency) { return; }
+
+                Job job;
+                lock (mLock)
+                {
+                    // All images are still queued or extracting, try again next frame.
+                    if (mFree.Count == 0) { return; }
+                    job = mFree.Pop();
+                }
+
+                slot.Target.GetData<byte>(job.Image.Data);
+                job.Tag = slot.Tag;
+                slot.Tag = null;
+                slot.bPending = false;
+                mReadbackSlot = (mReadbackSlot + 1) % mSlots.Length;
+
+                lock (mLock) { mWork.Enqueue(job); }
+                mWake.Set();
+            }
+        }
+        #endregion
+
+        /// <summary>
+        /// Constructs an extractor for the back buffer of aDevice that reads each frame back
+        /// aLatency frames after it is submitted.
+        /// </summary>
+        public AsyncLightExtractor(GraphicsDevice aDevice, int aLatency)
+        {
+            if (aLatency < 1 || aLatency > kMaxLatency) { throw new ArgumentOutOfRangeException("aLatency"); }
+
+            PresentationParameters pp = aDevice.PresentationParameters;
+
+            mDevice = aDevice;
+            mLatency = aLatency;
+            mSlots = new Slot[aLatency + 1];
+            for (int i = 0; i < mSlots.Length; i++)
+            {
+                mSlots[i] = new Slot();
+                mSlots[i].Target = new ResolveTexture2D(aDevice, pp.BackBufferWidth, pp.BackBufferHeight, 1, pp.BackBufferFormat);
+            }
+
+            // Enough images for every slot plus one extracting on the worker.
+            for (int i = 0; i < mSlots.Length + 1; i++)
+            {
+                Job job = new Job();
+                job.Image.Width = pp.BackBufferWidth;
+                job.Image.Height = pp.BackBufferHeight;
+                job.Image.Format = pp.BackBufferFormat;
+                job.Image.Data = new byte[pp.BackBufferWidth * pp.BackBufferHeight * Utilities.GetStride(pp.BackBufferFormat)];
+                mFree.Push(job);
+            }
+
+            mWorker = new Thread(_Run);
+            mWorker.IsBackground = true;
+            mWorker.Name = "AsyncLightExtractor";
+            mWorker.Start();
+        }
+
+        /// <summary>
+        /// Raised on the worker thread after the lighting of a frame has been extracted.
+        /// </summary>
+        public event ExtractionHandler Extracted;
+
+        /// <summary>
+        /// Raised by Update() on the calling thread after Extracted has run for a frame.
+        /// </summary>
+        public event ExtractionHandler Ready;
+
+        /// <summary>
+        /// Frames between resolving a target and reading it back.
+        /// </summary>
+        public int Latency { get { return mLatency; } }
+
+        /// <summary>
+        /// Minimum time in seconds between submissions. 0 submits every frame.
+        /// </summary>
+        public double Interval { get { return mInterval; } set { mInterval = Math.Max(value, 0.0); } }
+
+        /// <summary>
+        /// Number of submitted frames for which Ready has not been raised yet.
+        /// </summary>
+        public int PendingCount { get { return mPending; } }
+
+        public void Dispose()
+        {
+            if (mWorker != null)
+            {
+                lock (mLock) { mbDisposed = true; }
+                mWake.Set();
+                mWorker.Join();
+            }
+
+            foreach (Slot e in mSlots)
+            {
+                if (e.Target != null) { e.Target.Dispose(); e.Target = null; }
+            }
+        }
+
+        /// <summary>
+        /// Resolves the back buffer for extraction, tagged with aTag. Returns false and does
+        /// nothing if Interval has not elapsed since the last submission or if every target is
+        /// waiting to be read back.
+        /// </summary>
+        public bool Submit(object aTag)
+        {
+            double now = mTimer.Elapsed.TotalSeconds;
+            if (now < mNextSubmitTime) { return false; }
+
+            Slot slot = mSlots[mNextSlot];
+            if (slot.bPending) { return false; }
+
+            mDevice.ResolveBackBuffer(slot.Target);
+            slot.Tag = aTag;
+            slot.Frame = mFrame;
+            slot.bPending = true;
+            mNextSlot = (mNextSlot + 1) % mSlots.Length;
+            mNextSubmitTime = now + mInterval;
+            mPending++;
+
+            return true;
+        }
+
+        /// <summary>
+        /// Advances one frame, reads back targets that are Latency frames old, and raises Ready
+        /// for finished extractions. Rethrows the first exception of the worker thread.
+        /// </summary>
+        public void Update()
+        {
+            mFrame++;
+            _ReadBack();
+
+            while (true)
+            {
+                Job job;
+                lock (mLock)
+                {
+                    if (mException != null)
+                    {
+                        Exception e = mException;
+                        mException = null;
+                        throw new Exception("Light extraction failed.", e);
+                    }
+
+                    if (mDone.Count == 0) { break; }
+                    job = mDone.Dequeue();
+                }
+
+                mPending--;
+                if (Ready != null) { Ready(job.Tag, ref job.Metrics); }
+                job.Tag = null;
+
+                lock (mLock) { mFree.Push(job); }
+            }
+
+            // Images freed above may let a target that was waiting be read back this frame.
+            _ReadBack();
+        }
+    }
+}
@@ -22,6 +22,7 @@
 
 #define ENABLE_CLEANUP
 
+using Microsoft.Xna.Framework;
 using Microsoft.Xna.Framework.Graphics;
 using System;
 using System.Collections.Generic;
@@ -93,6 +94,21 @@ namespace sail
         }
     }
 
+    /// <summary>
+    /// Learns the image illumination metrics of a three-point lighting rig over a grid of key roll,
+    /// fill and key yaw settings, and steps settings toward a target by gradient descent.
+    /// </summary>
+    /// <remarks>
+    /// Each metric of the grid is stored in its own array (structure-of-arrays), with yaw varying
+    /// fastest, so the two corners of a yaw interpolation are adjacent in every array. Step()
+    /// evaluates the current motivation and the six neighbours of the error gradient in one batch
+    /// that computes the corner indices of each point once and reads all four metric arrays in a
+    /// single tight loop.
+    ///
+    /// Step() does not write to the learner, so learners, including one shared by several
+    /// characters, can be stepped concurrently. Step(List, float) steps many characters on
+    /// WorkPool.
+    /// </remarks>
     public class LightLearner
     {
         #region Constants
@@ -100,216 +116,270 @@ namespace sail
         public const float kMotWeight = 0.7f;
         public const float kDesiredWeight = (1.0f - kMotWeight);
 
+        /// <summary>
+        /// Default number of segments of each axis of the grid.
+        /// </summary>
         public const int kSegments = 12;
-        public const int kSegmentsPlus1 = kSegments + 1;
-        public const int kSegmentsPlus1Square = kSegmentsPlus1 * kSegmentsPlus1;
-        public const float kSegmentsF = kSegments;
-
-        public const int kStorage = kSegments * kSegmentsPlus1Square;
-
-        public const float kJitterFactor = (kSegmentsF / 24.0f) * 0.80f;
+        #endregion
 
-        public const float kFillFactor = ThreePointSettings.kMaxFill / kSegmentsF;
-        public const float kFillFactorHalf = 0.5f * kFillFactor;
-        public const float kFillJitterScale = kFillFactor * kJitterFactor;
-        public const float kFillJitterScaleAdjust = 0.5f * kFillJitterScale;
+        /// <summary>
+        /// One character of Step(List, float). Current is updated in place.
+        /// </summary>
+        public sealed class StepJob
+        {
+            public LightLearner Learner;
+            public ImageIlluminationMetrics Target;
+            public ThreePointSettings Current;
+            public ThreePointSettings Motivation;
+        }
 
-        public static readonly float kRollFactor = Degree.k360.Value / kSegmentsF;
-        public static readonly float kRollFactorHalf = 0.5f * kRollFactor;
-        public static readonly float kRollJitterScale = kRollFactor * kJitterFactor;
-        public static readonly float kRollJitterScaleAdjust = 0.5f * kRollJitterScale;
+        #region Private members
+        private const int kRollLow = 0;
+        private const int kRollHigh = 1;
+        private const int kFillLow = 2;
+        private const int kFillHigh = 3;
+        private const int kYawLow = 4;
+        private const int kYawHigh = 5;
+        private const int kMotivation = 6;
+        private const int kBatchSize = 7;
+
+        /// <summary>
+        /// Grid coordinates of a batch of points and their interpolated metrics.
+        /// </summary>
+        private sealed class Batch
+        {
+            public readonly float[] R = new float[kBatchSize];
+            public readonly float[] F = new float[kBatchSize];
+            public readonly float[] Y = new float[kBatchSize];
+            public readonly ImageIlluminationMetrics[] Metrics = new ImageIlluminationMetrics[kBatchSize];
+        }
 
-        public static readonly float kYawFactor = ThreePointSettings.kMaxYaw.Value / kSegmentsF;
-        public static readonly float kYawFactorHalf = 0.5f * kYawFactor;
-        public static readonly float kYawJitterScale = kYawFactor * kJitterFactor;
-        public static readonly float kYawJitterScaleAdjust = 0.5f * kYawJitterScale;
-        #endregion
+        [ThreadStatic]
+        private static Batch tsBatch;
+
+        private static readonly object msJobsLock = new object();
+        private static List<StepJob> msJobs = null;
+        private static float msTimeStep = 0.0f;
+        private static WorkItem msStep = _Step;
+        private static bool msbParallel = true;
+
+        private readonly int mSegments;
+        private readonly int mSegmentsPlus1;
+        private readonly int mSegmentsPlus1Square;
+        private readonly int mStorage;
+
+        private readonly float mFillFactor;
+        private readonly float mFillJitterScale;
+        private readonly float mFillJitterScaleAdjust;
+        private readonly float mRollFactor;
+        private readonly float mRollJitterScale;
+        private readonly float mRollJitterScaleAdjust;
+        private readonly float mYawFactor;
+        private readonly float mYawJitterScale;
+        private readonly float mYawJitterScaleAdjust;
 
-        #region Private members
         private int mR = 0;
         private int mF = 0;
         private int mY = 0;
         private Random mRandom = null;
-        private ImageIlluminationMetrics[] mSamples = null;
+        private float[] mEntropy = null;
+        private float[] mMaxIntensity = null;
+        private float[] mRoll = null;
+        private float[] mYaw = null;
 
-        private void _Read(BinaryReader reader)
+        private static void _Step(int aIndex, int aThread)
         {
-            _Init();
-
-            for (int i = 0; i < kStorage; i++)
-            {
-                mSamples[i].Entropy = reader.ReadSingle();
-                mSamples[i].MaxIntensity = reader.ReadSingle();
-                mSamples[i].Roll = reader.ReadSingle();
-                mSamples[i].Yaw = reader.ReadSingle();
-            }
+            StepJob job = msJobs[aIndex];
+            job.Learner.Step(ref job.Target, ref job.Current, ref job.Motivation, msTimeStep);
         }
 
-        private void _Write(BinaryWriter writer)
+        private static Batch _GetBatch()
         {
-            for (int i = 0; i < kStorage; i++)
-            {
-                writer.Write(mSamples[i].Entropy);
-                writer.Write(mSamples[i].MaxIntensity);
-                writer.Write(mSamples[i].Roll);
-                writer.Write(mSamples[i].Yaw);
-            }
+            if (tsBatch == null) { tsBatch = new Batch(); }
+            return tsBatch;
         }
 
-        private void _GetNextSettings(ref ThreePointSettings arSettings)
+        private static float _Lerp(float[] a, int aA0, int aA1, int aB0, int aB1, int aY0, int aY1, float aYd, float aFd, float aRd)
         {
-            float roll = (mR * kRollFactor) + ((float)mRandom.NextDouble() * kRollJitterScale - kRollJitterScaleAdjust);
-            float fill = (mF * kFillFactor) + ((float)mRandom.NextDouble() * kFillJitterScale - kFillJitterScaleAdjust);
-            float yaw = (mY * kYawFactor) + ((float)mRandom.NextDouble() * kYawJitterScale - kYawJitterScaleAdjust);
+            float i0 = MathHelper.Lerp(a[aA0 + aY0], a[aA0 + aY1], aYd);
+            float i1 = MathHelper.Lerp(a[aA1 + aY0], a[aA1 + aY1], aYd);
+            float j0 = MathHelper.Lerp(a[aB0 + aY0], a[aB0 + aY1], aYd);
+            float j1 = MathHelper.Lerp(a[aB1 + aY0], a[aB1 + aY1], aYd);
 
-            arSettings.KeyRoll = new Degree(roll);
-            arSettings.Fill = Utilities.Max(fill, ThreePointSettings.kMinFill);
-            arSettings.KeyYaw = Utilities.Clamp(new Degree(yaw), ThreePointSettings.kMinYaw, ThreePointSettings.kMaxYaw);
+            float ret = MathHelper.Lerp(MathHelper.Lerp(i0, i1, aFd), MathHelper.Lerp(j0, j1, aFd), aRd);
+
+            return ret;
         }
 
-        private float _GetError(
-            ref ImageIlluminationMetrics arTarget, 
-            ref ImageIlluminationMetrics arCurrent)
+        // Matches ImageIlluminationMetrics.Lerp(), which interpolates roll the short way around.
+        private static float _LerpRoll(float a, float b, float aWeightOfB)
         {
-            ImageIlluminationMetrics a = (arTarget - arCurrent);
+            while (a - b > ImageIlluminationMetrics.kHalfRollMax) { a -= ImageIlluminationMetrics.kRollMax; }
+            while (b - a > ImageIlluminationMetrics.kHalfRollMax) { b -= ImageIlluminationMetrics.kRollMax; }
 
-            float ret = ImageIlluminationMetrics.Dot(ref a, ref a);
+            float ret = MathHelper.Lerp(a, b, aWeightOfB);
+
+            while (ret > ImageIlluminationMetrics.kRollMax) { ret -= ImageIlluminationMetrics.kRollMax; }
+            while (ret < ImageIlluminationMetrics.kRollMin) { ret += ImageIlluminationMetrics.kRollMax; }
 
             return ret;
         }
 
-        private float _GetErrorGradient(
-            ref ImageIlluminationMetrics arTarget,
-            ref ImageIlluminationMetrics ar0, 
-            ref ImageIlluminationMetrics ar1)
+        private static float _LerpRoll(float[] a, int aA0, int aA1, int aB0, int aB1, int aY0, int aY1, float aYd, float aFd, float aRd)
         {
-            float e0 = _GetError(ref arTarget, ref ar0);
-            float e1 = _GetError(ref arTarget, ref ar1);
-            
-            float ret = 0.5f * (e1 - e0);
+            float i0 = _LerpRoll(a[aA0 + aY0], a[aA0 + aY1], aYd);
+            float i1 = _LerpRoll(a[aA1 + aY0], a[aA1 + aY1], aYd);
+            float j0 = _LerpRoll(a[aB0 + aY0], a[aB0 + aY1], aYd);
+            float j1 = _LerpRoll(a[aB1 + aY0], a[aB1 + aY1], aYd);
+
+            float ret = _LerpRoll(_LerpRoll(i0, i1, aFd), _LerpRoll(j0, j1, aFd), aRd);
 
             return ret;
         }
 
-        public float _GetErrorGradientRoll(
-            ref ImageIlluminationMetrics arTarget,
-            ref ThreePointSettings arCurrent)
+        private static float _GetError(ref ImageIlluminationMetrics arTarget, ref ImageIlluminationMetrics arCurrent)
         {
-            float r = (arCurrent.KeyRoll.Value / kRollFactor);
-            float f = (Utilities.Clamp(arCurrent.Fill, ThreePointSettings.kMinFill, ThreePointSettings.kMaxFill) / kFillFactor);
-            float y = (Utilities.Clamp(arCurrent.KeyYaw, ThreePointSettings.kMinYaw, ThreePointSettings.kMaxYaw).Value / kYawFactor);
-
-            int r0 = (int)Math.Floor(r);
-            int f0 = (int)Math.Floor(f);
-            int y0 = (int)Math.Floor(y);
-
-            int r1 = (int)Math.Ceiling(r);
-            int f1 = (int)Math.Ceiling(f);
-            int y1 = (int)Math.Ceiling(y);
-
-            if (r0 == r1) { r0--; r1++; }
-            while (r0 < 0) { r0 += kSegments; }
-
-            while (r0 >= kSegments) { r0 -= kSegments; }
-            while (r1 >= kSegments) { r1 -= kSegments; }
-
-            float fd = f - (float)f0;
-            float yd = y - (float)y0;
-
-            ImageIlluminationMetrics i0 = ImageIlluminationMetrics.Lerp(ref mSamples[_I(r0, f0, y0)], ref mSamples[_I(r0, f0, y1)], yd);
-            ImageIlluminationMetrics i1 = ImageIlluminationMetrics.Lerp(ref mSamples[_I(r0, f1, y0)], ref mSamples[_I(r0, f1, y1)], yd);
-            ImageIlluminationMetrics j0 = ImageIlluminationMetrics.Lerp(ref mSamples[_I(r1, f0, y0)], ref mSamples[_I(r1, f0, y1)], yd);
-            ImageIlluminationMetrics j1 = ImageIlluminationMetrics.Lerp(ref mSamples[_I(r1, f1, y0)], ref mSamples[_I(r1, f1, y1)], yd);
-
-            ImageIlluminationMetrics k0 = ImageIlluminationMetrics.Lerp(ref i0, ref i1, fd);
-            ImageIlluminationMetrics k1 = ImageIlluminationMetrics.Lerp(ref j0, ref j1, fd);
+            ImageIlluminationMetrics a = (arTarget - arCurrent);
 
-            float ret = _GetErrorGradient(ref arTarget, ref k0, ref k1);
+            float ret = ImageIlluminationMetrics.Dot(ref a, ref a);
 
             return ret;
         }
 
-        public float _GetErrorGradientFill(
-            ref ImageIlluminationMetrics arTarget,
-            ref ThreePointSettings arCurrent)
+        private static float _GetErrorGradient(ref ImageIlluminationMetrics arTarget, Batch aBatch, int aLow, int aHigh)
         {
-            float r = (arCurrent.KeyRoll.Value / kRollFactor);
-            float f = (Utilities.Clamp(arCurrent.Fill, ThreePointSettings.kMinFill, ThreePointSettings.kMaxFill) / kFillFactor);
-            float y = (Utilities.Clamp(arCurrent.KeyYaw, ThreePointSettings.kMinYaw, ThreePointSettings.kMaxYaw).Value / kYawFactor);
+            float e0 = _GetError(ref arTarget, ref aBatch.Metrics[aLow]);
+            float e1 = _GetError(ref arTarget, ref aBatch.Metrics[aHigh]);
 
-            int r0 = (int)Math.Floor(r);
-            int f0 = (int)Math.Floor(f);
-            int y0 = (int)Math.Floor(y);
-
-            int r1 = (int)Math.Ceiling(r);
-            int f1 = (int)Math.Ceiling(f);
-            int y1 = (int)Math.Ceiling(y);
-
-            while (r0 >= kSegments) { r0 -= kSegments; }
-            while (r1 >= kSegments) { r1 -= kSegments; }
+            float ret = 0.5f * (e1 - e0);
 
-            if (f0 == f1) { f0--; f1++; }
-            if (f0 < 0) { f0 = 0; }
-            if (f1 > kSegments) { f1 = kSegments; }
+            return ret;
+        }
 
-            float rd = r - (float)r0;
-            float yd = y - (float)y0;
+        private void _Read(BinaryReader reader)
+        {
+            _Init();
 
-            ImageIlluminationMetrics i0 = ImageIlluminationMetrics.Lerp(ref mSamples[_I(r0, f0, y0)], ref mSamples[_I(r0, f0, y1)], yd);
-            ImageIlluminationMetrics i1 = ImageIlluminationMetrics.Lerp(ref mSamples[_I(r1, f0, y0)], ref mSamples[_I(r1, f0, y1)], yd);
-            ImageIlluminationMetrics j0 = ImageIlluminationMetrics.Lerp(ref mSamples[_I(r0, f1, y0)], ref mSamples[_I(r0, f1, y1)], yd);
-            ImageIlluminationMetrics j1 = ImageIlluminationMetrics.Lerp(ref mSamples[_I(r1, f1, y0)], ref mSamples[_I(r1, f1, y1)], yd);
+            for (int i = 0; i < mStorage; i++)
+            {
+                mEntropy[i] = reader.ReadSingle();
+                mMaxIntensity[i] = reader.ReadSingle();
+                mRoll[i] = reader.ReadSingle();
+                mYaw[i] = reader.ReadSingle();
+            }
+        }
 
-            ImageIlluminationMetrics k0 = ImageIlluminationMetrics.Lerp(ref i0, ref i1, rd);
-            ImageIlluminationMetrics k1 = ImageIlluminationMetrics.Lerp(ref j0, ref j1, rd);
+        private void _Write(BinaryWriter writer)
+        {
+            for (int i = 0; i < mStorage; i++)
+            {
+                writer.Write(mEntropy[i]);
+                writer.Write(mMaxIntensity[i]);
+                writer.Write(mRoll[i]);
+                writer.Write(mYaw[i]);
+            }
+        }
 
-            float ret = _GetErrorGradient(ref arTarget, ref k0, ref k1);
+        private void _GetNextSettings(ref ThreePointSettings arSettings)
+        {
+            float roll = (mR * mRollFactor) + ((float)mRandom.NextDouble() * mRollJitterScale - mRollJitterScaleAdjust);
+            float fill = (mF * mFillFactor) + ((float)mRandom.NextDouble() * mFillJitterScale - mFillJitterScaleAdjust);
+            float yaw = (mY * mYawFactor) + ((float)mRandom.NextDouble() * mYawJitterScale - mYawJitterScaleAdjust);
 
-            return ret;
+            arSettings.KeyRoll = new Degree(roll);
+            arSettings.Fill = Utilities.Max(fill, ThreePointSettings.kMinFill);
+            arSettings.KeyYaw = Utilities.Clamp(new Degree(yaw), ThreePointSettings.kMinYaw, ThreePointSettings.kMaxYaw);
         }
 
-        public float _GetErrorGradientYaw(
-            ref ImageIlluminationMetrics arTarget,
-            ref ThreePointSettings arCurrent)
+        /// <summary>
+        /// Converts settings to grid coordinates.
+        /// </summary>
+        private void _GetCoordinates(ref ThreePointSettings arSettings, out float arR, out float arF, out float arY)
         {
-            float r = (arCurrent.KeyRoll.Value / kRollFactor);
-            float f = (Utilities.Clamp(arCurrent.Fill, ThreePointSettings.kMinFill, ThreePointSettings.kMaxFill) / kFillFactor);
-            float y = (Utilities.Clamp(arCurrent.KeyYaw, ThreePointSettings.kMinYaw, ThreePointSettings.kMaxYaw).Value / kYawFactor);
-
-            int r0 = (int)Math.Floor(r);
-            int f0 = (int)Math.Floor(f);
-            int y0 = (int)Math.Floor(y);
+            arR = (arSettings.KeyRoll.Value / mRollFactor);
+            arF = (Utilities.Clamp(arSettings.Fill, ThreePointSettings.kMinFill, ThreePointSettings.kMaxFill) / mFillFactor);
+            arY = (Utilities.Clamp(arSettings.KeyYaw, ThreePointSettings.kMinYaw, ThreePointSettings.kMaxYaw).Value / mYawFactor);
+        }
 
-            int r1 = (int)Math.Ceiling(r);
-            int f1 = (int)Math.Ceiling(f);
-            int y1 = (int)Math.Ceiling(y);
+        /// <summary>
+        /// Sets the first six points of aBatch to the neighbours of the error gradient at (aR, aF, aY).
+        /// Each pair moves one coordinate to the grid lines around it, or one segment either side if
+        /// the coordinate is on a grid line. Roll wraps, fill and yaw are clamped to the grid.
+        /// </summary>
+        private void _SetGradientNeighbours(Batch aBatch, float aR, float aF, float aY)
+        {
+            int r0 = (int)Math.Floor(aR);
+            int r1 = (int)Math.Ceiling(aR);
+            if (r0 == r1) { r0--; r1++; }
+            while (r0 < 0) { r0 += mSegments; }
+            while (r0 >= mSegments) { r0 -= mSegments; }
+            while (r1 >= mSegments) { r1 -= mSegments; }
 
-            while (r0 >= kSegments) { r0 -= kSegments; }
-            while (r1 >= kSegments) { r1 -= kSegments; }
+            int f0 = (int)Math.Floor(aF);
+            int f1 = (int)Math.Ceiling(aF);
+            if (f0 == f1) { f0--; f1++; }
+            if (f0 < 0) { f0 = 0; }
+            if (f1 > mSegments) { f1 = mSegments; }
 
+            int y0 = (int)Math.Floor(aY);
+            int y1 = (int)Math.Ceiling(aY);
             if (y0 == y1) { y0--; y1++; }
             if (y0 < 0) { y0 = 0; }
-            if (y1 > kSegments) { y1 = kSegments; }
-
-            float rd = r - (float)r0;
-            float fd = f - (float)f0;
-
-            ImageIlluminationMetrics i0 = ImageIlluminationMetrics.Lerp(ref mSamples[_I(r0, f0, y0)], ref mSamples[_I(r0, f1, y0)], fd);
-            ImageIlluminationMetrics i1 = ImageIlluminationMetrics.Lerp(ref mSamples[_I(r1, f0, y0)], ref mSamples[_I(r1, f1, y0)], fd);
-            ImageIlluminationMetrics j0 = ImageIlluminationMetrics.Lerp(ref mSamples[_I(r0, f0, y1)], ref mSamples[_I(r0, f1, y1)], fd);
-            ImageIlluminationMetrics j1 = ImageIlluminationMetrics.Lerp(ref mSamples[_I(r1, f0, y1)], ref mSamples[_I(r1, f1, y1)], fd);
+            if (y1 > mSegments) { y1 = mSegments; }
 
-            ImageIlluminationMetrics k0 = ImageIlluminationMetrics.Lerp(ref i0, ref i1, rd);
-            ImageIlluminationMetrics k1 = ImageIlluminationMetrics.Lerp(ref j0, ref j1, rd);
+            for (int i = kRollLow; i <= kYawHigh; i++)
+            {
+                aBatch.R[i] = aR;
+                aBatch.F[i] = aF;
+                aBatch.Y[i] = aY;
+            }
 
-            float ret = _GetErrorGradient(ref arTarget, ref k0, ref k1);
+            aBatch.R[kRollLow] = r0; aBatch.R[kRollHigh] = r1;
+            aBatch.F[kFillLow] = f0; aBatch.F[kFillHigh] = f1;
+            aBatch.Y[kYawLow] = y0; aBatch.Y[kYawHigh] = y1;
+        }
 
-            return ret;
+        /// <summary>
+        /// Trilinearly interpolates the grid at the first aCount points of aBatch.
+        /// </summary>
+        private void _Interpolate(Batch aBatch, int aCount)
+        {
+            for (int i = 0; i < aCount; i++)
+            {
+                float r = aBatch.R[i];
+                float f = aBatch.F[i];
+                float y = aBatch.Y[i];
+
+                int r0 = (int)Math.Floor(r);
+                int f0 = (int)Math.Floor(f);
+                int y0 = (int)Math.Floor(y);
+
+                int r1 = (int)Math.Ceiling(r);
+                int f1 = (int)Math.Ceiling(f);
+                int y1 = (int)Math.Ceiling(y);
+
+                float rd = r - (float)r0;
+                float fd = f - (float)f0;
+                float yd = y - (float)y0;
+
+                while (r0 >= mSegments) { r0 -= mSegments; }
+                while (r1 >= mSegments) { r1 -= mSegments; }
+
+                int a0 = (r0 * mSegmentsPlus1Square) + (f0 * mSegmentsPlus1);
+                int a1 = (r0 * mSegmentsPlus1Square) + (f1 * mSegmentsPlus1);
+                int b0 = (r1 * mSegmentsPlus1Square) + (f0 * mSegmentsPlus1);
+                int b1 = (r1 * mSegmentsPlus1Square) + (f1 * mSegmentsPlus1);
+
+                aBatch.Metrics[i].Entropy = _Lerp(mEntropy, a0, a1, b0, b1, y0, y1, yd, fd, rd);
+                aBatch.Metrics[i].MaxIntensity = _Lerp(mMaxIntensity, a0, a1, b0, b1, y0, y1, yd, fd, rd);
+                aBatch.Metrics[i].Roll = _LerpRoll(mRoll, a0, a1, b0, b1, y0, y1, yd, fd, rd);
+                aBatch.Metrics[i].Yaw = _Lerp(mYaw, a0, a1, b0, b1, y0, y1, yd, fd, rd);
+            }
         }
 
         private int _I(int aRoll, int aFill, int aYaw)
         {
-            int ret = (aRoll * kSegmentsPlus1Square) + (aFill * kSegmentsPlus1) + aYaw;
+            int ret = (aRoll * mSegmentsPlus1Square) + (aFill * mSegmentsPlus1) + aYaw;
 
             return ret;
         }
@@ -325,9 +395,9 @@ namespace sail
         private bool _IncrementIndex()
         {
             mY++;
-            if (mY >= kSegmentsPlus1) { mY = 0; mF++; }
-            if (mF >= kSegmentsPlus1) { mF = 0; mR++; }
-            if (mR >= kSegments) { return false; }
+            if (mY >= mSegmentsPlus1) { mY = 0; mF++; }
+            if (mF >= mSegmentsPlus1) { mF = 0; mR++; }
+            if (mR >= mSegments) { return false; }
             else { return true; }
         }
 
@@ -338,48 +408,83 @@ namespace sail
             mY = 0;
 
             mRandom = new Random();
-            mSamples = new ImageIlluminationMetrics[kStorage];
+            mEntropy = new float[mStorage];
+            mMaxIntensity = new float[mStorage];
+            mRoll = new float[mStorage];
+            mYaw = new float[mStorage];
         }
         #endregion
 
-        public ImageIlluminationMetrics Get(ref ThreePointSettings arSettings)
+        #region Internal members
+        /// <summary>
+        /// Fills the grid with random metrics in their valid ranges. Used by LightLearnerBenchmark.
+        /// </summary>
+        internal void _Randomize(int aSeed)
         {
-            float r = (arSettings.KeyRoll.Value / kRollFactor);
-            float f = (Utilities.Clamp(arSettings.Fill, ThreePointSettings.kMinFill, ThreePointSettings.kMaxFill) / kFillFactor);
-            float y = (Utilities.Clamp(arSettings.KeyYaw, ThreePointSettings.kMinYaw, ThreePointSettings.kMaxYaw).Value / kYawFactor);
-
-            int r0 = (int)Math.Floor(r);
-            int f0 = (int)Math.Floor(f);
-            int y0 = (int)Math.Floor(y);
-
-            int r1 = (int)Math.Ceiling(r);
-            int f1 = (int)Math.Ceiling(f);
-            int y1 = (int)Math.Ceiling(y);
+            _Init();
 
-            while (r0 >= kSegments)
-            {
-                r0 -= kSegments;
-            }
-            while (r1 >= kSegments)
+            Random random = new Random(aSeed);
+            for (int i = 0; i < mStorage; i++)
             {
-                r1 -= kSegments;
+                mEntropy[i] = (float)random.NextDouble();
+                mMaxIntensity[i] = (float)random.NextDouble();
+                mRoll[i] = (float)random.NextDouble() * ImageIlluminationMetrics.kRollMax;
+                mYaw[i] = MathHelper.Lerp(ImageIlluminationMetrics.kYawMin, ImageIlluminationMetrics.kYawMax, (float)random.NextDouble());
             }
+        }
+        #endregion
 
-            float rd = r - (float)r0;
-            float fd = f - (float)f0;
-            float yd = y - (float)y0;
+        public LightLearner()
+            : this(kSegments)
+        { }
 
-            ImageIlluminationMetrics i0 = ImageIlluminationMetrics.Lerp(ref mSamples[_I(r0, f0, y0)], ref mSamples[_I(r0, f0, y1)], yd);
-            ImageIlluminationMetrics i1 = ImageIlluminationMetrics.Lerp(ref mSamples[_I(r0, f1, y0)], ref mSamples[_I(r0, f1, y1)], yd);
-            ImageIlluminationMetrics j0 = ImageIlluminationMetrics.Lerp(ref mSamples[_I(r1, f0, y0)], ref mSamples[_I(r1, f0, y1)], yd);
-            ImageIlluminationMetrics j1 = ImageIlluminationMetrics.Lerp(ref mSamples[_I(r1, f1, y0)], ref mSamples[_I(r1, f1, y1)], yd);
+        /// <summary>
+        /// Constructs a learner with aSegments segments on each axis. Learned data saved with one
+        /// segment count cannot be loaded with another.
+        /// </summary>
+        public LightLearner(int aSegments)
+        {
+            if (aSegments < 2) { throw new ArgumentOutOfRangeException("aSegments"); }
 
-            ImageIlluminationMetrics k0 = ImageIlluminationMetrics.Lerp(ref i0, ref i1, fd);
-            ImageIlluminationMetrics k1 = ImageIlluminationMetrics.Lerp(ref j0, ref j1, fd);
+            mSegments = aSegments;
+            mSegmentsPlus1 = (mSegments + 1);
+            mSegmentsPlus1Square = (mSegmentsPlus1 * mSegmentsPlus1);
+            mStorage = (mSegments * mSegmentsPlus1Square);
 
-            ImageIlluminationMetrics ret = ImageIlluminationMetrics.Lerp(ref k0, ref k1, rd);
+            float segments = (float)mSegments;
+            float jitterFactor = (segments / 24.0f) * 0.80f;
 
-            return ret;
+            mFillFactor = ThreePointSettings.kMaxFill / segments;
+            mFillJitterScale = mFillFactor * jitterFactor;
+            mFillJitterScaleAdjust = 0.5f * mFillJitterScale;
+
+            mRollFactor = Degree.k360.Value / segments;
+            mRollJitterScale = mRollFactor * jitterFactor;
+            mRollJitterScaleAdjust = 0.5f * mRollJitterScale;
+
+            mYawFactor = ThreePointSettings.kMaxYaw.Value / segments;
+            mYawJitterScale = mYawFactor * jitterFactor;
+            mYawJitterScaleAdjust = 0.5f * mYawJitterScale;
+        }
+
+        /// <summary>
+        /// Number of segments of each axis of the grid.
+        /// </summary>
+        public int Segments { get { return mSegments; } }
+
+        /// <summary>
+        /// If false, Step(List, float) steps characters serially on the calling thread. Useful for
+        /// comparing timings.
+        /// </summary>
+        public static bool bParallel { get { return msbParallel; } set { msbParallel = value; } }
+
+        public ImageIlluminationMetrics Get(ref ThreePointSettings arSettings)
+        {
+            Batch batch = _GetBatch();
+            _GetCoordinates(ref arSettings, out batch.R[0], out batch.F[0], out batch.Y[0]);
+            _Interpolate(batch, 1);
+
+            return batch.Metrics[0];
         }
 
         public void Init(ref ThreePointSettings arSettings)
@@ -388,23 +493,53 @@ namespace sail
             _GetNextSettings(ref arSettings);
         }
 
-
         public void Step(ref ImageIlluminationMetrics arTarget, ref ThreePointSettings arCurrent, ref ThreePointSettings arMotivation, float aTimeStep)
         {
-            ThreePointSettings orig = arCurrent;
+            Batch batch = _GetBatch();
+
+            float r, f, y;
+            _GetCoordinates(ref arCurrent, out r, out f, out y);
+            _SetGradientNeighbours(batch, r, f, y);
+            _GetCoordinates(ref arMotivation, out batch.R[kMotivation], out batch.F[kMotivation], out batch.Y[kMotivation]);
+            _Interpolate(batch, kBatchSize);
+
             ImageIlluminationMetrics targetMetrics = arTarget;
-            ImageIlluminationMetrics curMetrics = Get(ref arCurrent);
-            ImageIlluminationMetrics motMetrics = Get(ref arMotivation);
+            ImageIlluminationMetrics motMetrics = batch.Metrics[kMotivation];
 
-            float rollDelta = kStepSize * aTimeStep * ((kDesiredWeight * _GetErrorGradientRoll(ref targetMetrics, ref arCurrent)) + (kMotWeight * _GetErrorGradientRoll(ref motMetrics, ref arCurrent)));
-            float fillDelta = kStepSize * aTimeStep * ((kDesiredWeight * _GetErrorGradientFill(ref targetMetrics, ref arCurrent)) + (kMotWeight * _GetErrorGradientFill(ref motMetrics, ref arCurrent)));
-            float yawDelta = kStepSize * aTimeStep * ((kDesiredWeight * _GetErrorGradientYaw(ref targetMetrics, ref arCurrent)) + kMotWeight * (_GetErrorGradientYaw(ref motMetrics, ref arCurrent)));
+            float rollDelta = kStepSize * aTimeStep * ((kDesiredWeight * _GetErrorGradient(ref targetMetrics, batch, kRollLow, kRollHigh)) + (kMotWeight * _GetErrorGradient(ref motMetrics, batch, kRollLow, kRollHigh)));
+            float fillDelta = kStepSize * aTimeStep * ((kDesiredWeight * _GetErrorGradient(ref targetMetrics, batch, kFillLow, kFillHigh)) + (kMotWeight * _GetErrorGradient(ref motMetrics, batch, kFillLow, kFillHigh)));
+            float yawDelta = kStepSize * aTimeStep * ((kDesiredWeight * _GetErrorGradient(ref targetMetrics, batch, kYawLow, kYawHigh)) + (kMotWeight * _GetErrorGradient(ref motMetrics, batch, kYawLow, kYawHigh)));
 
             arCurrent.KeyRoll -= (rollDelta * Degree.k180);
             arCurrent.Fill = Utilities.Max(arCurrent.Fill - (fillDelta * ThreePointSettings.kMaxFill), ThreePointSettings.kMinFill);
             arCurrent.KeyYaw = Utilities.Clamp(arCurrent.KeyYaw - (ThreePointSettings.kMaxYaw * yawDelta), ThreePointSettings.kMinYaw, Degree.k180);
         }
 
+        /// <summary>
+        /// Steps each job, on WorkPool if bParallel is true.
+        /// </summary>
+        public static void Step(List<StepJob> aJobs, float aTimeStep)
+        {
+            int count = aJobs.Count;
+            if (count == 0) { return; }
+
+            lock (msJobsLock)
+            {
+                msJobs = aJobs;
+                msTimeStep = aTimeStep;
+
+                try
+                {
+                    if (msbParallel && count > 1) { WorkPool.For(count, msStep); }
+                    else { for (int i = 0; i < count; i++) { _Step(i, 0); } }
+                }
+                finally
+                {
+                    msJobs = null;
+                }
+            }
+        }
+
         public void Save(string aFilename)
         {
             BinaryWriter writer = new BinaryWriter(new FileStream(aFilename, FileMode.Create));
@@ -427,12 +562,37 @@ namespace sail
         public const float kRollTolerance = 15.0f;
         public const float kYawMinimum = 30.0f;
 
-        public bool Tick(ref LightExtractorImage aImage, ref ThreePointSettings arSettings)
+        /// <summary>
+        /// Index of the grid sample trained by the settings of the last Init() or Advance().
+        /// </summary>
+        public int TrainingIndex { get { return _Index; } }
+
+        /// <summary>
+        /// Moves training to the next grid sample and sets arSettings to settings for it. Returns
+        /// false when every sample has been trained.
+        /// </summary>
+        public bool Advance(ref ThreePointSettings arSettings)
         {
-            int kIndex = _Index;
+            if (_IncrementIndex())
+            {
+                _GetNextSettings(ref arSettings);
+                return true;
+            }
+            else { return false; }
+        }
 
-            ImageIlluminationMetrics sample;
-            LightingExtractor.ExtractLighting(ref aImage, out sample);
+        /// <summary>
+        /// Stores aSample, extracted from a frame rendered with aSettings, as grid sample aIndex.
+        /// </summary>
+        /// <remarks>
+        /// Cleanup reads the samples one and two yaw or fill segments below aIndex, so samples
+        /// must be recorded in the order of their indices. Record() does not touch the training
+        /// index, so it can run on another thread than Advance(), as with AsyncLightExtractor.
+        /// </remarks>
+        public void Record(int aIndex, ref ImageIlluminationMetrics aSample, ref ThreePointSettings aSettings)
+        {
+            ImageIlluminationMetrics sample = aSample;
+            ThreePointSettings settings = aSettings;
 
             // Cleanup handles cases where:
             // - the yaw becomes indeterminant because it is too big and the key is behind the object.
@@ -440,12 +600,12 @@ namespace sail
             //   camera mounted.
             // - the fill becomes indeterminant because the yaw is too small.
 #if ENABLE_CLEANUP
-            sample.Roll = (arSettings.KeyRoll / Degree.k360).Value * ImageIlluminationMetrics.kRollMax;
+            sample.Roll = (settings.KeyRoll / Degree.k360).Value * ImageIlluminationMetrics.kRollMax;
 
-            if (arSettings.KeyYaw.Value - (2.0f * kYawFactor) > ThreePointSettings.kMinYaw.Value)
+            if (settings.KeyYaw.Value - (2.0f * mYawFactor) > ThreePointSettings.kMinYaw.Value)
             {
-                ThreePointSettings set0 = new ThreePointSettings(arSettings.KeyRoll, arSettings.Fill, arSettings.KeyYaw - new Degree(2.0f * kYawFactor));
-                ThreePointSettings set1 = new ThreePointSettings(arSettings.KeyRoll, arSettings.Fill, arSettings.KeyYaw - new Degree(1.0f * kYawFactor));
+                ThreePointSettings set0 = new ThreePointSettings(settings.KeyRoll, settings.Fill, settings.KeyYaw - new Degree(2.0f * mYawFactor));
+                ThreePointSettings set1 = new ThreePointSettings(settings.KeyRoll, settings.Fill, settings.KeyYaw - new Degree(1.0f * mYawFactor));
 
                 ImageIlluminationMetrics s0 = Get(ref set0);
                 ImageIlluminationMetrics s1 = Get(ref set1);
@@ -456,10 +616,10 @@ namespace sail
                 }
             }
 
-            if (arSettings.Fill - (2.0f * kFillFactor) > ThreePointSettings.kMinFill)
+            if (settings.Fill - (2.0f * mFillFactor) > ThreePointSettings.kMinFill)
             {
-                ThreePointSettings set0 = new ThreePointSettings(arSettings.KeyRoll, arSettings.Fill - (2.0f * kFillFactor), arSettings.KeyYaw);
-                ThreePointSettings set1 = new ThreePointSettings(arSettings.KeyRoll, arSettings.Fill - (1.0f * kFillFactor), arSettings.KeyYaw);
+                ThreePointSettings set0 = new ThreePointSettings(settings.KeyRoll, settings.Fill - (2.0f * mFillFactor), settings.KeyYaw);
+                ThreePointSettings set1 = new ThreePointSettings(settings.KeyRoll, settings.Fill - (1.0f * mFillFactor), settings.KeyYaw);
 
                 ImageIlluminationMetrics s0 = Get(ref set0);
                 ImageIlluminationMetrics s1 = Get(ref set1);
@@ -471,14 +631,20 @@ namespace sail
             }
 #endif
 
-            mSamples[kIndex] = sample;
+            mEntropy[aIndex] = sample.Entropy;
+            mMaxIntensity[aIndex] = sample.MaxIntensity;
+            mRoll[aIndex] = sample.Roll;
+            mYaw[aIndex] = sample.Yaw;
+        }
 
-            if (_IncrementIndex())
-            {
-                _GetNextSettings(ref arSettings);
-                return true;
-            }
-            else { return false; }
+        public bool Tick(ref LightExtractorImage aImage, ref ThreePointSettings arSettings)
+        {
+            ImageIlluminationMetrics sample;
+            LightingExtractor.ExtractLighting(ref aImage, out sample);
+
+            Record(_Index, ref sample, ref arSettings);
+
+            return Advance(ref arSettings);
         }
     }
 
@@ -0,0 +1,119 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using siat;
+
+namespace sail
+{
+    /// <summary>
+    /// Measures LightLearner.Step() across grid segment counts, for several characters stepped
+    /// serially and on WorkPool.
+    /// </summary>
+    /// <remarks>
+    /// The grid is filled with random metrics, so timings do not depend on learned data. All
+    /// characters of a run share one learner, as characters lit from the same learned model do.
+    /// </remarks>
+    public static class LightLearnerBenchmark
+    {
+        public static readonly int[] kSegmentCounts = new int[] { 6, 12, 24, 48 };
+        public const int kSeed = 1;
+        public const float kTimeStep = (1.0f / 60.0f);
+        public const int kWarmupSteps = 16;
+
+        #region Private members
+        private static List<LightLearner.StepJob> _CreateJobs(LightLearner aLearner, int aCharacters)
+        {
+            Random random = new Random(kSeed);
+            List<LightLearner.StepJob> ret = new List<LightLearner.StepJob>(aCharacters);
+
+            for (int i = 0; i < aCharacters; i++)
+            {
+                LightLearner.StepJob job = new LightLearner.StepJob();
+                job.Learner = aLearner;
+                job.Current = new ThreePointSettings(
+                    new Degree((float)random.NextDouble() * Degree.k360.Value),
+                    (float)random.NextDouble() * ThreePointSettings.kMaxFill,
+                    new Degree((float)random.NextDouble() * ThreePointSettings.kMaxYaw.Value));
+                job.Motivation = new ThreePointSettings(
+                    new Degree((float)random.NextDouble() * Degree.k360.Value),
+                    (float)random.NextDouble() * ThreePointSettings.kMaxFill,
+                    new Degree((float)random.NextDouble() * ThreePointSettings.kMaxYaw.Value));
+                job.Target = aLearner.Get(ref job.Motivation);
+                ret.Add(job);
+            }
+
+            return ret;
+        }
+        #endregion
+
+        /// <summary>
+        /// Steps aCharacters characters aSteps times for each segment count, serially and in
+        /// parallel, and writes the results as CSV lines to aOut.
+        /// </summary>
+        public static void Run(TextWriter aOut, int aCharacters, int aSteps)
+        {
+            bool[] modes = new bool[] { false, true };
+            bool bParallel = LightLearner.bParallel;
+
+            aOut.WriteLine("segments,characters,parallel,threads,steps,total ms,us per character step");
+            try
+            {
+                foreach (int segments in kSegmentCounts)
+                {
+                    LightLearner learner = new LightLearner(segments);
+                    learner._Randomize(kSeed);
+
+                    foreach (bool bMode in modes)
+                    {
+                        LightLearner.bParallel = bMode;
+                        List<LightLearner.StepJob> jobs = _CreateJobs(learner, aCharacters);
+
+                        for (int i = 0; i < kWarmupSteps; i++) { LightLearner.Step(jobs, kTimeStep); }
+
+                        Stopwatch timer = Stopwatch.StartNew();
+                        for (int i = 0; i < aSteps; i++) { LightLearner.Step(jobs, kTimeStep); }
+                        timer.Stop();
+
+                        double ms = timer.Elapsed.TotalMilliseconds;
+                        aOut.WriteLine(
+                            segments.ToString() + "," +
+                            aCharacters.ToString() + "," +
+                            bMode.ToString() + "," +
+                            (bMode ? WorkPool.ThreadCount : 1).ToString() + "," +
+                            aSteps.ToString() + "," +
+                            ms.ToString("F2") + "," +
+                            ((ms * 1000.0) / ((double)aSteps * (double)aCharacters)).ToString("F3"));
+                        aOut.Flush();
+                    }
+                }
+            }
+            finally
+            {
+                LightLearner.bParallel = bParallel;
+            }
+        }
+    }
+}
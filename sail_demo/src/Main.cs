@@ -93,6 +93,26 @@ namespace sail
         public const float kMoveRate = 0.6f;
         public const string kScene = "1930_room\\SIAT_room_0013_lights.dae";
 
+        public const string kBenchmarkArgument = "-benchmark";
+        public const int kBenchmarkDefaultFrames = 1200;
+        public const string kBenchmarkDefaultReport = "frame_benchmark.csv";
+        public const float kBenchmarkLightOrbit = 0.5f;
+        public const int kBenchmarkWarmupFrames = 60;
+
+        public const string kLightingBenchmarkArgument = "-lighting-benchmark";
+        public const string kLightingBenchmarkDefaultReport = "lighting_benchmark.csv";
+        public const string kLightingBenchmarkScopeFile = "lighting_scopes.csv";
+        public const float kLightingBenchmarkFalloffAngle = 0.25f;
+
+        public const string kQueueBenchmarkArgument = "-queue-benchmark";
+        public const int kQueueBenchmarkDefaultFrames = 120;
+        public const string kQueueBenchmarkDefaultReport = "queue_benchmark.csv";
+
+        public const string kLearnerBenchmarkArgument = "-learner-benchmark";
+        public const int kLearnerBenchmarkDefaultCharacters = 8;
+        public const int kLearnerBenchmarkDefaultSteps = 10000;
+        public const string kLearnerBenchmarkDefaultReport = "learner_benchmark.csv";
+
         #region Private members
 #if !EXPERIMENT_VERSION
         private static bool msbDisableSelfShadowing = false;
@@ -109,6 +129,13 @@ namespace sail
 
         private static float mGuiActive = 0.0f;
 
+        private static int msBenchmarkFrames = 0;
+        private static string msBenchmarkReport = kBenchmarkDefaultReport;
+        private static bool msbLightingBenchmark = false;
+        private static int msQueueBenchmarkFrames = 0;
+        private static string msQueueBenchmarkReport = kQueueBenchmarkDefaultReport;
+        private static Vector3[] msBenchmarkLightPositions = null;
+
         private static Siat.GuiElement mGuiElement;
 
         private static SceneNode Model;
@@ -516,6 +543,65 @@ namespace sail
             #endregion
         }
 
+        /// <summary>
+        /// Moves the character through the three model positions with the camera orbiting it once,
+        /// while the point lights orbit their initial positions. Depends only on aFrame.
+        /// </summary>
+        private static void BenchmarkStep(int aFrame)
+        {
+            float t = ((float)aFrame / (float)msBenchmarkFrames);
+
+            if (msBenchmarkLightPositions == null)
+            {
+                msBenchmarkLightPositions = new Vector3[kLights.Length];
+                for (int i = 0; i < kLights.Length; i++)
+                {
+                    if (kLights[i] != null) { msBenchmarkLightPositions[i] = kLights[i].WorldPosition; }
+                }
+            }
+
+            Vector3 position = (t < 0.5f)
+                ? Vector3.Lerp(kModel1, kModel2, 2.0f * t)
+                : Vector3.Lerp(kModel2, kModel3, (2.0f * t) - 1.0f);
+            Model.WorldPosition = position;
+
+            CameraEditingNode camera = Siat.Singleton.ActiveCamera as CameraEditingNode;
+            if (camera != null)
+            {
+                camera.Yaw = -MathHelper.PiOver2 + (MathHelper.TwoPi * t);
+                camera.Target = (position + (Vector3.Up * TargetHeight));
+            }
+
+            for (int i = 0; i < kLights.Length; i++)
+            {
+                if (kLights[i] != null && kLights[i].Light.Type == LightType.Point)
+                {
+                    float angle = (MathHelper.TwoPi * t) + i;
+                    kLights[i].WorldPosition = msBenchmarkLightPositions[i] + kBenchmarkLightOrbit * new Vector3((float)Math.Cos(angle), 0.0f, (float)Math.Sin(angle));
+                }
+            }
+        }
+
+        /// <summary>
+        /// BenchmarkStep() with spot lights narrowed to a tight cone and early-out lighting
+        /// enabled on odd frames, so the straight and early-out techniques draw the same path
+        /// and are compared by their technique scopes in kLightingBenchmarkScopeFile.
+        /// </summary>
+        private static void LightingBenchmarkStep(int aFrame)
+        {
+            BenchmarkStep(aFrame);
+
+            for (int i = 0; i < kLights.Length; i++)
+            {
+                if (kLights[i] != null && kLights[i].Light.Type == LightType.Spot)
+                {
+                    kLights[i].Light.FalloffAngleInRadians = kLightingBenchmarkFalloffAngle;
+                }
+            }
+
+            RenderRoot.bEarlyOutLighting = ((aFrame & 1) != 0);
+        }
+
         private static void _LightHelper(SceneNode e, int i)
         {
             kLights[i] = (LightNode)e;
@@ -616,7 +702,7 @@ namespace sail
             RenderRoot.bDeferredLighting = false;
             RenderRoot.bFilteredShadows = false;
             siat.bStatsEnabled = false;
-            siat.Resize(kFullscreenWidth, kFullscreenHeight, true);
+            if (msBenchmarkFrames == 0) { siat.Resize(kFullscreenWidth, kFullscreenHeight, true); }
 #else
             siat.bEnableSoftwareMouseCursor = true;
             siat.bStatsEnabled = true;
@@ -640,6 +726,27 @@ namespace sail
             DeferredPost.FogHeight = 2.0f;
             DeferredPost.FogDensity = 1.0f;
 #endif
+
+            if (msBenchmarkFrames > 0)
+            {
+                siat.bStatsEnabled = false;
+                if (msbLightingBenchmark)
+                {
+                    RenderRoot.bDeferredLighting = false;
+                    FrameProfiler.bSynchronized = true;
+                    FrameProfiler.BeginCapture(kLightingBenchmarkScopeFile);
+                    FrameBenchmark.Start(kBenchmarkWarmupFrames, msBenchmarkFrames, LightingBenchmarkStep, msBenchmarkReport, true);
+                }
+                else
+                {
+                    FrameBenchmark.Start(kBenchmarkWarmupFrames, msBenchmarkFrames, BenchmarkStep, msBenchmarkReport, true);
+                }
+            }
+            else if (msQueueBenchmarkFrames > 0)
+            {
+                siat.bStatsEnabled = false;
+                RenderQueueBenchmark.Start(RenderQueueBenchmark.kDefaultNodeCounts, kBenchmarkWarmupFrames, msQueueBenchmarkFrames, msQueueBenchmarkReport, true);
+            }
         }
 
         private static void ResizeHandler()
@@ -867,15 +974,65 @@ namespace sail
             siat.bStatsEnabled = true;
 #endif
 
+            if (msBenchmarkFrames > 0 || msQueueBenchmarkFrames > 0)
+            {
+                siat.bNullDevice = !msbLightingBenchmark;
+                siat.FixedTimeStep = TimeSpan.FromSeconds(1.0 / 60.0);
+            }
+
             siat.OnDrawBegin += OnDrawBeingHandler;
             siat.OnLoading += OnLoadHandler;
             siat.OnUpdateBegin += OnUpdateBeginHandler;
             siat.Run();
+
+            FrameProfiler.EndCapture();
         }
         #endregion
 
+        /// <summary>
+        /// With "-benchmark [frames] [report file]", runs FrameBenchmark on the null device
+        /// along a fixed path and exits. "-lighting-benchmark [frames] [report file]" runs the same
+        /// path on the real device with forward lighting and tight spot lights, alternating
+        /// straight and early-out light techniques, and writes synchronized per-technique scope
+        /// times to lighting_scopes.csv. "-queue-benchmark [frames per count] [report file]" runs
+        /// RenderQueueBenchmark on the null device from the start view and exits. With "-learner-benchmark [characters] [steps] [report file]",
+        /// runs LightLearnerBenchmark and exits.
+        /// </summary>
         public static void Main(string[] aArgs)
         {
+            for (int i = 0; i < aArgs.Length; i++)
+            {
+                if (aArgs[i] == kLearnerBenchmarkArgument)
+                {
+                    int characters = kLearnerBenchmarkDefaultCharacters;
+                    int steps = kLearnerBenchmarkDefaultSteps;
+                    string report = kLearnerBenchmarkDefaultReport;
+                    if (i + 1 < aArgs.Length) { characters = int.Parse(aArgs[i + 1]); }
+                    if (i + 2 < aArgs.Length) { steps = int.Parse(aArgs[i + 2]); }
+                    if (i + 3 < aArgs.Length) { report = aArgs[i + 3]; }
+
+                    using (StreamWriter writer = new StreamWriter(report))
+                    {
+                        sail.LightLearnerBenchmark.Run(writer, characters, steps);
+                    }
+                    return;
+                }
+                if (aArgs[i] == kQueueBenchmarkArgument)
+                {
+                    msQueueBenchmarkFrames = kQueueBenchmarkDefaultFrames;
+                    if (i + 1 < aArgs.Length) { msQueueBenchmarkFrames = int.Parse(aArgs[i + 1]); }
+                    if (i + 2 < aArgs.Length) { msQueueBenchmarkReport = aArgs[i + 2]; }
+                }
+                if (aArgs[i] == kBenchmarkArgument || aArgs[i] == kLightingBenchmarkArgument)
+                {
+                    msbLightingBenchmark = (aArgs[i] == kLightingBenchmarkArgument);
+                    msBenchmarkFrames = kBenchmarkDefaultFrames;
+                    msBenchmarkReport = (msbLightingBenchmark) ? kLightingBenchmarkDefaultReport : kBenchmarkDefaultReport;
+                    if (i + 1 < aArgs.Length) { msBenchmarkFrames = int.Parse(aArgs[i + 1]); }
+                    if (i + 2 < aArgs.Length) { msBenchmarkReport = aArgs[i + 2]; }
+                }
+            }
+
 #if !DEBUG
             try
             {
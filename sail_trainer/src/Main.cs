@@ -27,6 +27,7 @@ using Microsoft.Xna.Framework.Graphics;
 using Microsoft.Xna.Framework.Input;
 using System;
 using System.Collections.Generic;
+using System.Diagnostics;
 using System.IO;
 
 using siat;
@@ -49,6 +50,100 @@ namespace sail
         #region Private members
         private static bool mbTraining = false;
         private static bool mbStepping = true;
+        private static bool mbSubmitting = false;
+
+        private static bool msbAsync = true;
+        private static double msExtractInterval = 0.0;
+        private static Stopwatch msFrameTimer = new Stopwatch();
+        private static List<double> msFrameTimes = new List<double>();
+
+        /// <summary>
+        /// Grid sample and settings of a frame submitted to Extractor.
+        /// </summary>
+        private sealed class TrainingSample
+        {
+            public readonly int Index;
+            public sail.ThreePointSettings Settings;
+
+            public TrainingSample(int aIndex, sail.ThreePointSettings aSettings)
+            {
+                Index = aIndex;
+                Settings = aSettings;
+            }
+        }
+
+        // Runs on the extractor's worker thread. Samples arrive in submission order, which is
+        // the order Record() requires.
+        private static void _RecordHandler(object aTag, ref sail.ImageIlluminationMetrics arMetrics)
+        {
+            TrainingSample sample = (TrainingSample)aTag;
+            Learner.Record(sample.Index, ref arMetrics, ref sample.Settings);
+        }
+
+        private static void _TrainAsync()
+        {
+            Extractor.Update();
+
+            if (mbSubmitting)
+            {
+                if (Extractor.Submit(new TrainingSample(Learner.TrainingIndex, ThreePointSettings)))
+                {
+                    mbSubmitting = Learner.Advance(ref ThreePointSettings);
+                }
+            }
+            else if (Extractor.PendingCount == 0)
+            {
+                mbTraining = false;
+            }
+        }
+
+        private static void _TrainSync()
+        {
+            Siat siat = Siat.Singleton;
+            GraphicsDevice graphics = siat.GraphicsDevice;
+            graphics.ResolveBackBuffer(ResolveTexture);
+
+            ResolveTexture.GetData<byte>(ImageData.Data);
+            mbTraining = Learner.Tick(ref ImageData, ref ThreePointSettings);
+        }
+
+        /// <summary>
+        /// Appends the mean, standard deviation, 95th percentile and maximum of the frame times
+        /// of the training run to kJitterReport.
+        /// </summary>
+        private static void _WriteJitterReport()
+        {
+            int count = msFrameTimes.Count;
+            if (count == 0) { return; }
+
+            double[] sorted = msFrameTimes.ToArray();
+            Array.Sort(sorted);
+
+            double mean = 0.0;
+            foreach (double e in sorted) { mean += e; }
+            mean /= count;
+
+            double variance = 0.0;
+            foreach (double e in sorted) { variance += (e - mean) * (e - mean); }
+            variance /= count;
+
+            int p95 = Utilities.Clamp((int)Math.Ceiling(0.95 * count) - 1, 0, count - 1);
+
+            bool bHeader = !File.Exists(kJitterReport);
+            using (StreamWriter writer = new StreamWriter(kJitterReport, true))
+            {
+                if (bHeader) { writer.WriteLine("mode,latency,interval s,frames,mean ms,stddev ms,p95 ms,max ms"); }
+                writer.WriteLine(
+                    (msbAsync ? "async" : "sync") + "," +
+                    (msbAsync ? sail.AsyncLightExtractor.kDefaultLatency : 0).ToString() + "," +
+                    msExtractInterval.ToString("0.000") + "," +
+                    count.ToString() + "," +
+                    mean.ToString("0.000") + "," +
+                    Math.Sqrt(variance).ToString("0.000") + "," +
+                    sorted[p95].ToString("0.000") + "," +
+                    sorted[count - 1].ToString("0.000"));
+            }
+        }
         #endregion
 
         public const int kWidth = 256;
@@ -62,6 +157,9 @@ namespace sail
         public static readonly Vector3 kModelWorldCenter = Vector3.Up * -37.0f;
 
         public const string kLogFile = "sail_trainer.log";
+        public const string kJitterReport = "sail_trainer_jitter.csv";
+        public const string kSyncArgument = "-sync";
+        public const string kExtractIntervalArgument = "-extract-interval";
         public const float kNearPlaneScale = 4.38e-4f;
         public const float kFarPlaneScale = 2.0f;
 
@@ -74,6 +172,7 @@ namespace sail
         public static SceneNode Model;
         public static SceneNodePoser Poser;
         public static ResolveTexture2D ResolveTexture;
+        public static sail.AsyncLightExtractor Extractor;
         public static sail.ImageIlluminationMetrics IdealSettings;
         public static sail.ThreePointSettings MotSettings;
         public static sail.ThreePointSettings ThreePointSettings;
@@ -166,9 +265,20 @@ namespace sail
                 Learner.Init(ref ThreePointSettings);
                 mbTraining = true;
 
-                // Create the texture for resholving the back-buffer;
-                ResolveTexture = new ResolveTexture2D(siat.GraphicsDevice,
-                    ImageData.Width, ImageData.Height, 1, ImageData.Format);
+                if (msbAsync)
+                {
+                    // Extraction and learning run on the extractor's worker thread.
+                    Extractor = new sail.AsyncLightExtractor(siat.GraphicsDevice, sail.AsyncLightExtractor.kDefaultLatency);
+                    Extractor.Interval = msExtractInterval;
+                    Extractor.Extracted += _RecordHandler;
+                    mbSubmitting = true;
+                }
+                else
+                {
+                    // Create the texture for resholving the back-buffer;
+                    ResolveTexture = new ResolveTexture2D(siat.GraphicsDevice,
+                        ImageData.Width, ImageData.Height, 1, ImageData.Format);
+                }
             }
             else
             {
@@ -181,6 +291,12 @@ namespace sail
 
         public static void OnUnloadHandler()
         {
+            if (Extractor != null)
+            {
+                Extractor.Dispose();
+                Extractor = null;
+            }
+
             if (ResolveTexture != null)
             {
                 ResolveTexture.Dispose();
@@ -192,17 +308,18 @@ namespace sail
         {
             if (mbTraining)
             {
-                Siat siat = Siat.Singleton;
-                GraphicsDevice graphics = siat.GraphicsDevice;
-                graphics.ResolveBackBuffer(ResolveTexture);
+                if (msFrameTimer.IsRunning) { msFrameTimes.Add(msFrameTimer.Elapsed.TotalMilliseconds); }
+                msFrameTimer.Reset();
+                msFrameTimer.Start();
 
-                ResolveTexture.GetData<byte>(ImageData.Data);
-                mbTraining = Learner.Tick(ref ImageData, ref ThreePointSettings);
+                if (Extractor != null) { _TrainAsync(); }
+                else { _TrainSync(); }
 
                 if (!mbTraining)
                 {
                     Learner.Save(kModelLightData);
                     ThreePointSettings = MotSettings;
+                    _WriteJitterReport();
                 }
             }
             else if (mbStepping)
@@ -263,9 +380,20 @@ namespace sail
             siat.Run();
         }
 
+        /// <summary>
+        /// With "-sync", trains with synchronous read back and extraction on the render thread.
+        /// With "-extract-interval seconds", submits at most one frame per interval for extraction.
+        /// </summary>
         public static void Main(string[] aArgs)
         {
-
+            for (int i = 0; i < aArgs.Length; i++)
+            {
+                if (aArgs[i] == kSyncArgument) { msbAsync = false; }
+                else if (aArgs[i] == kExtractIntervalArgument && i + 1 < aArgs.Length)
+                {
+                    msExtractInterval = double.Parse(aArgs[i + 1]);
+                }
+            }
 
 #if !DEBUG || CLIENT_USAGE
             try
@@ -29,6 +29,11 @@ namespace siat
 {
     public struct AnimationKeyFrame
     {
+        /// <summary>
+        /// Size in bytes of a key frame.
+        /// </summary>
+        public const int kSizeInBytes = (sizeof(float) * 17);
+
         public AnimationKeyFrame(float aTime, Matrix M)
         {
             Time = aTime;
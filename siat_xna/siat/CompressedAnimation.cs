@@ -0,0 +1,335 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using Microsoft.Xna.Framework;
+using System;
+using System.Collections.Generic;
+
+namespace siat
+{
+    /// <summary>
+    /// A keyframe-reduced, quantized channel of a CompressedAnimation with up to 4 components.
+    /// </summary>
+    /// <remarks>
+    /// Each key is the index of a frame of the animation and Components 16-bit values, which
+    /// map linearly to [Min, Min + Extent].
+    /// </remarks>
+    public sealed class AnimationTrack
+    {
+        public const float kQuantizeScale = 65535.0f;
+        public const float kInverseQuantizeScale = (1.0f / kQuantizeScale);
+
+        #region Private members
+        private static ushort _Quantize(float v, float aMin, float aExtent)
+        {
+            if (aExtent < Utilities.kZeroToleranceFloat) { return 0; }
+
+            float q = ((v - aMin) / aExtent) * kQuantizeScale;
+            return (ushort)Utilities.Clamp((int)(q + 0.5f), 0, ushort.MaxValue);
+        }
+
+        private static float _Component(ref Vector4 v, int i)
+        {
+            switch (i)
+            {
+                case 0: return v.X;
+                case 1: return v.Y;
+                case 2: return v.Z;
+                default: return v.W;
+            }
+        }
+
+        private static void _Lerp(Vector4[] aValues, float[] aTimes, int aBegin, int aEnd, int aIndex, bool abNormalize, out Vector4 v)
+        {
+            float delta = (aTimes[aEnd] - aTimes[aBegin]);
+            float lerp = (delta > Utilities.kZeroToleranceFloat) ? ((aTimes[aIndex] - aTimes[aBegin]) / delta) : 0.0f;
+
+            Vector4.Lerp(ref aValues[aBegin], ref aValues[aEnd], lerp, out v);
+            if (abNormalize) { v.Normalize(); }
+        }
+
+        private static bool _Within(ref Vector4 a, ref Vector4 b, float aTolerance)
+        {
+            return (Math.Abs(a.X - b.X) <= aTolerance &&
+                    Math.Abs(a.Y - b.Y) <= aTolerance &&
+                    Math.Abs(a.Z - b.Z) <= aTolerance &&
+                    Math.Abs(a.W - b.W) <= aTolerance);
+        }
+
+        private static bool _Fits(Vector4[] aValues, float[] aTimes, int aBegin, int aEnd, bool abNormalize, float aTolerance)
+        {
+            for (int i = aBegin + 1; i < aEnd; i++)
+            {
+                Vector4 v;
+                _Lerp(aValues, aTimes, aBegin, aEnd, i, abNormalize, out v);
+                if (!_Within(ref v, ref aValues[i], aTolerance)) { return false; }
+            }
+
+            return true;
+        }
+        #endregion
+
+        public AnimationTrack(int aComponents, ushort[] aFrames, ushort[] aValues, Vector4 aMin, Vector4 aExtent)
+        {
+            Components = aComponents;
+            Frames = aFrames;
+            Values = aValues;
+            Min = aMin;
+            Extent = aExtent;
+        }
+
+        /// <summary>
+        /// Builds a track from one value per frame. Frames that can be linearly interpolated from
+        /// their neighboring keys within aTolerance are removed. If abNormalize is true, interpolated
+        /// values are normalized, as is done for rotation quaternions.
+        /// </summary>
+        public static AnimationTrack Create(Vector4[] aValues, float[] aTimes, int aComponents, bool abNormalize, float aTolerance)
+        {
+            int count = aValues.Length;
+
+            Vector4 min = aValues[0];
+            Vector4 max = aValues[0];
+            bool bConstant = true;
+            for (int i = 1; i < count; i++)
+            {
+                Vector4.Min(ref min, ref aValues[i], out min);
+                Vector4.Max(ref max, ref aValues[i], out max);
+                bConstant = bConstant && _Within(ref aValues[0], ref aValues[i], aTolerance);
+            }
+
+            List<int> keys = new List<int>();
+            keys.Add(0);
+            if (!bConstant)
+            {
+                int begin = 0;
+                while (begin < count - 1)
+                {
+                    int end = begin + 1;
+                    while (end + 1 < count && _Fits(aValues, aTimes, begin, end + 1, abNormalize, aTolerance)) { end++; }
+
+                    keys.Add(end);
+                    begin = end;
+                }
+            }
+
+            Vector4 extent = (max - min);
+            int keyCount = keys.Count;
+            ushort[] frames = new ushort[keyCount];
+            ushort[] values = new ushort[keyCount * aComponents];
+
+            for (int i = 0; i < keyCount; i++)
+            {
+                int frame = keys[i];
+                frames[i] = (ushort)frame;
+
+                for (int j = 0; j < aComponents; j++)
+                {
+                    values[(i * aComponents) + j] = _Quantize(_Component(ref aValues[frame], j), _Component(ref min, j), _Component(ref extent, j));
+                }
+            }
+
+            return new AnimationTrack(aComponents, frames, values, min, extent);
+        }
+
+        /// <summary>
+        /// Returns the index of the last key at or before frame aFrame.
+        /// </summary>
+        public int Find(int aFrame)
+        {
+            int low = 0;
+            int high = Frames.Length - 1;
+
+            while (low < high)
+            {
+                int mid = (low + high + 1) >> 1;
+                if (Frames[mid] <= aFrame) { low = mid; }
+                else { high = mid - 1; }
+            }
+
+            return low;
+        }
+
+        /// <summary>
+        /// Dequantizes the value of key aKey. Components past Components are 0.
+        /// </summary>
+        public void Get(int aKey, out Vector4 v)
+        {
+            int i = (aKey * Components);
+
+            v.X = Min.X + (Extent.X * (Values[i] * kInverseQuantizeScale));
+            v.Y = (Components > 1) ? (Min.Y + (Extent.Y * (Values[i + 1] * kInverseQuantizeScale))) : 0.0f;
+            v.Z = (Components > 2) ? (Min.Z + (Extent.Z * (Values[i + 2] * kInverseQuantizeScale))) : 0.0f;
+            v.W = (Components > 3) ? (Min.W + (Extent.W * (Values[i + 3] * kInverseQuantizeScale))) : 0.0f;
+        }
+
+        /// <summary>
+        /// Size in bytes of the key data of this track.
+        /// </summary>
+        public int MemorySize { get { return (Frames.Length + Values.Length) * sizeof(ushort); } }
+
+        public readonly int Components;
+        public readonly ushort[] Frames;
+        public readonly ushort[] Values;
+        public readonly Vector4 Min;
+        public readonly Vector4 Extent;
+    }
+
+    /// <summary>
+    /// A matrix animation stored as rotation, translation, and scale tracks.
+    /// </summary>
+    /// <remarks>
+    /// Times holds the time of each frame of the source animation, so frame indices, as used by
+    /// AnimationControl, have the same meaning as for AnimationKeyFrame arrays. A frame costs at
+    /// most 30 bytes, and usually much less after keyframe reduction, against 68 bytes for an
+    /// AnimationKeyFrame.
+    /// </remarks>
+    public sealed class CompressedAnimation
+    {
+        #region Private members
+        private void _Sample(AnimationTrack aTrack, int aFrame, float aTime, out Vector4 v)
+        {
+            int key = aTrack.Find(aFrame);
+            aTrack.Get(key, out v);
+
+            if (key + 1 < aTrack.Frames.Length)
+            {
+                float t0 = Times[aTrack.Frames[key]];
+                float t1 = Times[aTrack.Frames[key + 1]];
+                float lerp = (t1 > t0) ? Utilities.Clamp((aTime - t0) / (t1 - t0), 0.0f, 1.0f) : 0.0f;
+
+                Vector4 next;
+                aTrack.Get(key + 1, out next);
+                Vector4.Lerp(ref v, ref next, lerp, out v);
+            }
+        }
+
+        private static void _Compose(ref Vector4 r, ref Vector4 t, ref Vector4 s, out Matrix m)
+        {
+            float x2 = r.X + r.X; float y2 = r.Y + r.Y; float z2 = r.Z + r.Z;
+            float xx = r.X * x2; float yy = r.Y * y2; float zz = r.Z * z2;
+            float xy = r.X * y2; float xz = r.X * z2; float yz = r.Y * z2;
+            float wx = r.W * x2; float wy = r.W * y2; float wz = r.W * z2;
+
+            m.M11 = s.X * (1.0f - (yy + zz)); m.M12 = s.X * (xy + wz); m.M13 = s.X * (xz - wy); m.M14 = 0.0f;
+            m.M21 = s.Y * (xy - wz); m.M22 = s.Y * (1.0f - (xx + zz)); m.M23 = s.Y * (yz + wx); m.M24 = 0.0f;
+            m.M31 = s.Z * (xz + wy); m.M32 = s.Z * (yz - wx); m.M33 = s.Z * (1.0f - (xx + yy)); m.M34 = 0.0f;
+            m.M41 = t.X; m.M42 = t.Y; m.M43 = t.Z; m.M44 = 1.0f;
+        }
+        #endregion
+
+        public CompressedAnimation(float[] aTimes, AnimationTrack aRotation, AnimationTrack aTranslation, AnimationTrack aScale)
+        {
+            Times = aTimes;
+            Rotation = aRotation;
+            Translation = aTranslation;
+            Scale = aScale;
+        }
+
+        /// <summary>
+        /// Compresses aKeyFrames, which must be sorted by time. Returns null if a key frame cannot
+        /// be decomposed into scale, rotation, and translation, for example if it contains shear.
+        /// </summary>
+        /// <param name="aTolerance">Maximum error of a reduced component.</param>
+        public static CompressedAnimation Compress(AnimationKeyFrame[] aKeyFrames, float aTolerance)
+        {
+            int count = aKeyFrames.Length;
+            if (count == 0 || count > ushort.MaxValue) { return null; }
+
+            float[] times = new float[count];
+            Vector4[] rotations = new Vector4[count];
+            Vector4[] translations = new Vector4[count];
+            Vector4[] scales = new Vector4[count];
+
+            for (int i = 0; i < count; i++)
+            {
+                Vector3 s;
+                Quaternion r;
+                Vector3 t;
+                if (!aKeyFrames[i].Key.Decompose(out s, out r, out t)) { return null; }
+
+                // Keep consecutive rotations in the same hemisphere so they interpolate the short way.
+                if (i > 0 && ((r.X * rotations[i - 1].X) + (r.Y * rotations[i - 1].Y) + (r.Z * rotations[i - 1].Z) + (r.W * rotations[i - 1].W)) < 0.0f)
+                {
+                    r = Quaternion.Negate(r);
+                }
+
+                times[i] = aKeyFrames[i].Time;
+                rotations[i] = new Vector4(r.X, r.Y, r.Z, r.W);
+                translations[i] = new Vector4(t, 0.0f);
+                scales[i] = new Vector4(s, 0.0f);
+
+                Matrix m;
+                _Compose(ref rotations[i], ref translations[i], ref scales[i], out m);
+                if (!Utilities.AboutEqual(ref m, ref aKeyFrames[i].Key, Utilities.kLooseToleranceFloat)) { return null; }
+            }
+
+            return new CompressedAnimation(times,
+                AnimationTrack.Create(rotations, times, 4, true, aTolerance),
+                AnimationTrack.Create(translations, times, 3, false, aTolerance),
+                AnimationTrack.Create(scales, times, 3, false, aTolerance));
+        }
+
+        /// <summary>
+        /// Samples the animation at time aTime, which is within frame aFrame and aFrame + 1.
+        /// </summary>
+        public void Sample(int aFrame, float aTime, out Matrix m)
+        {
+            Vector4 r;
+            Vector4 t;
+            Vector4 s;
+
+            _Sample(Rotation, aFrame, aTime, out r);
+            _Sample(Translation, aFrame, aTime, out t);
+            _Sample(Scale, aFrame, aTime, out s);
+
+            float lengthSquared = (r.X * r.X) + (r.Y * r.Y) + (r.Z * r.Z) + (r.W * r.W);
+            if (lengthSquared > Utilities.kZeroToleranceFloat)
+            {
+                float inv = (float)(1.0 / Math.Sqrt(lengthSquared));
+                r.X *= inv; r.Y *= inv; r.Z *= inv; r.W *= inv;
+            }
+
+            _Compose(ref r, ref t, ref s, out m);
+        }
+
+        /// <summary>
+        /// Number of frames of the source animation.
+        /// </summary>
+        public int FrameCount { get { return Times.Length; } }
+
+        /// <summary>
+        /// Size in bytes of the frame times and key data.
+        /// </summary>
+        public int MemorySize
+        {
+            get
+            {
+                return (Times.Length * sizeof(float)) + Rotation.MemorySize + Translation.MemorySize + Scale.MemorySize;
+            }
+        }
+
+        public readonly float[] Times;
+        public readonly AnimationTrack Rotation;
+        public readonly AnimationTrack Translation;
+        public readonly AnimationTrack Scale;
+    }
+}
@@ -0,0 +1,75 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using System;
+
+namespace siat
+{
+    /// <summary>
+    /// Layout of a mesh pack, a single blob holding all mesh parts of a scene.
+    /// </summary>
+    /// <remarks>
+    /// A mesh pack is read with one bulk read and used in place: records are decoded directly from
+    /// the blob and vertex and index data is copied straight from it into GPU buffers, instead of
+    /// being deserialized field by field. All values are little-endian. Offsets are in bytes from
+    /// the start of the blob and every section and vertex or index range starts on a kAlignment
+    /// boundary.
+    ///
+    /// Header, kHeaderSize bytes of int32:
+    ///     magic, version, part count, parts offset, strings offset, declarations offset,
+    ///     indices offset, vertices offset, total size, 3 reserved.
+    ///
+    /// Part records, kPartRecordSize bytes each:
+    ///     int32 id offset, id length (UTF-8), declaration offset, vertex stride, vertex count,
+    ///     vertices offset, vertices size, indices offset, index count, index size (2 or 4),
+    ///     primitive type, primitive count,
+    ///     float32 AABB min xyz, max xyz, bounding sphere center xyz, radius.
+    ///
+    /// Declarations: int32 element count followed by kVertexElementSize bytes per element:
+    ///     int16 stream, int16 offset, uint8 format, method, usage, usage index.
+    /// </remarks>
+    public static class MeshPackFormat
+    {
+        public const int kMagic = 0x4B505453; // "STPK"
+        public const int kVersion = 1;
+        public const int kAlignment = 16;
+
+        public const int kHeaderSize = 48;
+        public const int kPartRecordSize = 88;
+        public const int kVertexElementSize = 8;
+
+        public const int kHeaderMagic = 0;
+        public const int kHeaderVersion = 4;
+        public const int kHeaderPartCount = 8;
+        public const int kHeaderPartsOffset = 12;
+        public const int kHeaderStringsOffset = 16;
+        public const int kHeaderDeclarationsOffset = 20;
+        public const int kHeaderIndicesOffset = 24;
+        public const int kHeaderVerticesOffset = 28;
+        public const int kHeaderTotalSize = 32;
+
+        public static int Align(int aOffset)
+        {
+            return (aOffset + (kAlignment - 1)) & ~(kAlignment - 1);
+        }
+    }
+}
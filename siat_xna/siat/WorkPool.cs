@@ -0,0 +1,262 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using System;
+using System.Threading;
+
+namespace siat
+{
+    /// <summary>
+    /// A work item of WorkPool.For(). aIndex is the index of the item, aThread is the index
+    /// of the thread executing it, from 0 to WorkPool.ThreadCount - 1.
+    /// </summary>
+    public delegate void WorkItem(int aIndex, int aThread);
+
+    /// <summary>
+    /// Fixed pool of worker threads for fork-join parallel loops.
+    /// </summary>
+    /// <remarks>
+    /// Each call to For() splits the index range evenly between the calling thread and the workers.
+    /// A thread consumes its own range from the front. When its range is empty, it steals the back
+    /// half of the largest remaining range of another thread, so uneven work items balance out.
+    ///
+    /// For() is not re-entrant. Calls from within a work item run serially on the calling thread
+    /// with the thread index of that work item. Calls from other threads while For() is executing
+    /// block until it completes.
+    ///
+    /// \warning Work items run concurrently. They must only write to data that is owned by the item
+    ///          or by the thread index passed to the item.
+    /// </remarks>
+    public static class WorkPool
+    {
+        public const int kMaxThreads = 16;
+
+        #region Private members
+        private sealed class Range
+        {
+            public int Begin = 0;
+            public int End = 0;
+        }
+
+        private static readonly object msLock = new object();
+        private static readonly object msForLock = new object();
+        private static Thread[] msWorkers = null;
+        private static AutoResetEvent[] msWake = null;
+        private static ManualResetEvent msDone = new ManualResetEvent(false);
+        private static ManualResetEvent msIdle = new ManualResetEvent(false);
+        private static Range[] msRanges = null;
+        private static int msThreadCount = 1;
+        private static int msRemaining = 0;
+        private static int msActiveWorkers = 0;
+        private static WorkItem msItem = null;
+        private static Exception msException = null;
+
+        [ThreadStatic]
+        private static bool tsbInWork;
+        [ThreadStatic]
+        private static int tsThread;
+
+        private static bool _Pop(int aThread, out int arIndex)
+        {
+            Range r = msRanges[aThread];
+            lock (r)
+            {
+                if (r.Begin < r.End) { arIndex = r.Begin++; return true; }
+            }
+
+            arIndex = -1;
+            return false;
+        }
+
+        private static bool _Steal(int aThread)
+        {
+            int victim = -1;
+            int most = 0;
+
+            for (int i = 0; i < msThreadCount; i++)
+            {
+                if (i == aThread) { continue; }
+
+                int count = (msRanges[i].End - msRanges[i].Begin);
+                if (count > most) { most = count; victim = i; }
+            }
+
+            if (victim < 0) { return false; }
+
+            Range from = msRanges[victim];
+            int begin;
+            int end;
+
+            lock (from)
+            {
+                int count = (from.End - from.Begin);
+                if (count <= 0) { return true; }
+
+                end = from.End;
+                begin = end - ((count + 1) / 2);
+                from.End = begin;
+            }
+
+            // The range of this thread is empty, so no other thread will steal from it
+            // between the two locks.
+            Range to = msRanges[aThread];
+            lock (to)
+            {
+                to.Begin = begin;
+                to.End = end;
+            }
+
+            return true;
+        }
+
+        private static void _Work(int aThread)
+        {
+            tsbInWork = true;
+            tsThread = aThread;
+
+            while (true)
+            {
+                int index;
+                if (_Pop(aThread, out index))
+                {
+                    try
+                    {
+                        msItem(index, aThread);
+                    }
+                    catch (Exception e)
+                    {
+                        lock (msLock) { if (msException == null) { msException = e; } }
+                    }
+
+                    if (Interlocked.Decrement(ref msRemaining) == 0) { msDone.Set(); }
+                }
+                else if (!_Steal(aThread))
+                {
+                    break;
+                }
+            }
+
+            tsbInWork = false;
+        }
+
+        private static void _WorkerMain(object aThread)
+        {
+            int thread = (int)aThread;
+
+            while (true)
+            {
+                msWake[thread].WaitOne();
+                _Work(thread);
+
+                if (Interlocked.Decrement(ref msActiveWorkers) == 0) { msIdle.Set(); }
+            }
+        }
+
+        private static void _Start(int aThreadCount)
+        {
+            msThreadCount = Utilities.Clamp(aThreadCount, 1, kMaxThreads);
+            msRanges = new Range[msThreadCount];
+            msWake = new AutoResetEvent[msThreadCount];
+            msWorkers = new Thread[msThreadCount];
+
+            for (int i = 0; i < msThreadCount; i++)
+            {
+                msRanges[i] = new Range();
+                msWake[i] = new AutoResetEvent(false);
+            }
+
+            // Thread 0 is always the thread that calls For().
+            for (int i = 1; i < msThreadCount; i++)
+            {
+                msWorkers[i] = new Thread(_WorkerMain);
+                msWorkers[i].IsBackground = true;
+                msWorkers[i].Name = "WorkPool " + i.ToString();
+                msWorkers[i].Start(i);
+            }
+        }
+
+        static WorkPool()
+        {
+            _Start(Environment.ProcessorCount);
+        }
+        #endregion
+
+        /// <summary>
+        /// Calls aItem for each index from 0 to aCount - 1 and returns when all calls complete. If any
+        /// call throws, the first exception is rethrown on the calling thread after all calls complete.
+        /// </summary>
+        public static void For(int aCount, WorkItem aItem)
+        {
+            if (aCount <= 0) { return; }
+
+            if (tsbInWork)
+            {
+                for (int i = 0; i < aCount; i++) { aItem(i, tsThread); }
+                return;
+            }
+
+            lock (msForLock)
+            {
+                if (aCount == 1 || msThreadCount == 1)
+                {
+                    for (int i = 0; i < aCount; i++) { aItem(i, 0); }
+                    return;
+                }
+
+                msItem = aItem;
+                msException = null;
+                msRemaining = aCount;
+                msDone.Reset();
+                msIdle.Reset();
+
+                int threads = Utilities.Min(msThreadCount, aCount);
+                for (int i = 0; i < msThreadCount; i++)
+                {
+                    msRanges[i].Begin = (i < threads) ? ((aCount * i) / threads) : 0;
+                    msRanges[i].End = (i < threads) ? ((aCount * (i + 1)) / threads) : 0;
+                }
+
+                msActiveWorkers = (threads - 1);
+                for (int i = 1; i < threads; i++) { msWake[i].Set(); }
+                _Work(0);
+
+                // Workers must be idle before returning, otherwise a late worker could steal
+                // from the ranges of the next call while they are being initialized.
+                msDone.WaitOne();
+                if (threads > 1) { msIdle.WaitOne(); }
+
+                msItem = null;
+                if (msException != null)
+                {
+                    Exception e = msException;
+                    msException = null;
+                    throw new Exception("A work item of WorkPool.For() threw an exception.", e);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Number of threads, including the thread that calls For(), that execute work items.
+        /// </summary>
+        public static int ThreadCount { get { return msThreadCount; } }
+    }
+}
@@ -88,6 +88,35 @@ sampler ShadowSampler = sampler_state
 #	define BUMP
 #endif
 
+// PARTIAL_PRECISION shades color math and the lighting terms at half precision (_pp). Normals,
+// light and eye vectors, bump decoding, the spot cone, positions, distances, depth and shadow
+// comparisons stay float in both modes, so only the dot products are rounded to half. Selected
+// per material by ColladaProcessor.ShaderPrecision.
+#if defined(PARTIAL_PRECISION)
+#	define pfloat half
+#	define pfloat2 half2
+#	define pfloat3 half3
+#	define pfloat4 half4
+#else
+#	define pfloat float
+#	define pfloat2 float2
+#	define pfloat3 float3
+#	define pfloat4 float4
+#endif
+
+// Fused base and light techniques apply ambient, emission and one light in a single opaque pass.
+// They are not generated for ambient or emission textures since the lit vertex output has no
+// free interpolators for their texture coordinates.
+#if !defined(TRANSPARENT) && !defined(AMBIENT_TEXTURE) && !defined(EMISSION_TEXTURE)
+#	define BASE_LIGHT
+#endif
+
+// Early-out light techniques skip the material of pixels a point or spot light does not reach.
+// They are only generated for materials that respond to light.
+#if defined(DIFFUSE) || defined(REFLECTIVE) || defined(SPECULAR)
+#	define EARLY_OUT
+#endif
+
 //-----------------------------------------------------------------------------
 // generated-at-content-build-time constants
 //-----------------------------------------------------------------------------
@@ -479,7 +508,15 @@ void LightTerms(vsIn aIn, float4 aWorld, uniform bool abDirectional, uniform boo
 #	endif	
 }
 
-float Shadow(float4 aShadowTexCoords, float aPixelDepth, uniform bool abFiltered)
+// Shadow map reads of early-out techniques follow a dynamic branch, where tex2Dproj() is not
+// allowed. Shadow maps have a single level, so tex2Dlod() at level 0 reads the same texel.
+float ShadowRead(float4 aShadowTexCoords, uniform bool abLod)
+{
+	if (abLod) { return tex2Dlod(ShadowSampler, float4(aShadowTexCoords.xy / aShadowTexCoords.w, 0, 0)).x; }
+	else { return tex2Dproj(ShadowSampler, aShadowTexCoords).x; }
+}
+
+float Shadow(float4 aShadowTexCoords, float aPixelDepth, uniform bool abFiltered, uniform bool abLod)
 {
 	float ret = 0.0f;
 
@@ -489,10 +526,10 @@ float Shadow(float4 aShadowTexCoords, float aPixelDepth, uniform bool abFiltered
 	if (abFiltered)
 	{
 		float4 shadowDepths;
-		shadowDepths.x = tex2Dproj(ShadowSampler, aShadowTexCoords + float4(noffset, noffset, 0, 0)).x;
-		shadowDepths.y = tex2Dproj(ShadowSampler, aShadowTexCoords + float4( offset, noffset, 0, 0)).x;
-		shadowDepths.z = tex2Dproj(ShadowSampler, aShadowTexCoords + float4(noffset,  offset, 0, 0)).x;
-		shadowDepths.w = tex2Dproj(ShadowSampler, aShadowTexCoords + float4( offset,  offset, 0, 0)).x;
+		shadowDepths.x = ShadowRead(aShadowTexCoords + float4(noffset, noffset, 0, 0), abLod);
+		shadowDepths.y = ShadowRead(aShadowTexCoords + float4( offset, noffset, 0, 0), abLod);
+		shadowDepths.z = ShadowRead(aShadowTexCoords + float4(noffset,  offset, 0, 0), abLod);
+		shadowDepths.w = ShadowRead(aShadowTexCoords + float4( offset,  offset, 0, 0), abLod);
 
 		float4 c = (aPixelDepth <= shadowDepths);
 		
@@ -500,7 +537,7 @@ float Shadow(float4 aShadowTexCoords, float aPixelDepth, uniform bool abFiltered
 	}
 	else
 	{
-		float shadowDepth = tex2Dproj(ShadowSampler, aShadowTexCoords).x;
+		float shadowDepth = ShadowRead(aShadowTexCoords, abLod);
 		
 		if (aPixelDepth <= shadowDepth) { ret = 1.0f; }
 	}
@@ -513,9 +550,9 @@ float Shadow(float4 aShadowTexCoords, float aPixelDepth, uniform bool abFiltered
 // handles (0^n) (n checked at values of 2.2 and 1) differently than my GPU hardware does
 // (Nvidia 9800). The preshader produces 1 for these cases instead of 0. 0 is mathematically
 // correct.
-float4 GammaColor(float4 aColor)
+pfloat4 GammaColor(pfloat4 aColor)
 {
-	float4 ret;
+	pfloat4 ret;
 	ret.r = (aColor.r >= kLooseTolerance) ? pow(aColor.r, Gamma) : 0.0;
 	ret.g = (aColor.g >= kLooseTolerance) ? pow(aColor.g, Gamma) : 0.0;
 	ret.b = (aColor.b >= kLooseTolerance) ? pow(aColor.b, Gamma) : 0.0;
@@ -524,11 +561,31 @@ float4 GammaColor(float4 aColor)
 	return ret;
 }
 
-float4 GammaTextureRead(sampler aSampler, float2 aTexCoords)
+pfloat4 GammaTextureRead(sampler aSampler, float2 aTexCoords)
+{
+	pfloat4 col = tex2D(aSampler, aTexCoords);
+	
+	return pfloat4(pow(col.rgb, (pfloat)Gamma), col.a);
+}
+
+// Material reads of early-out techniques follow dynamic branches, where the gradients tex2D()
+// needs are undefined. Their gradients are taken with Gradients() before the first branch.
+float4 Gradients(float2 aTexCoords)
+{
+	return float4(ddx(aTexCoords), ddy(aTexCoords));
+}
+
+pfloat4 TextureRead(sampler aSampler, float2 aTexCoords, float4 aGradients, uniform bool abGradients)
+{
+	if (abGradients) { return tex2Dgrad(aSampler, aTexCoords, aGradients.xy, aGradients.zw); }
+	else { return tex2D(aSampler, aTexCoords); }
+}
+
+pfloat4 GammaTextureRead(sampler aSampler, float2 aTexCoords, float4 aGradients, uniform bool abGradients)
 {
-	float4 col = tex2D(aSampler, aTexCoords);
+	pfloat4 col = TextureRead(aSampler, aTexCoords, aGradients, abGradients);
 	
-	return float4(pow(col.rgb, Gamma), col.a);
+	return pfloat4(pow(col.rgb, (pfloat)Gamma), col.a);
 }
 
 //-----------------------------------------------------------------------------
@@ -705,27 +762,27 @@ float4 FragmentPicking(vsOutPicking aIn) : COLOR
 
 float4 FragmentBase(vsOutBase aIn) : COLOR
 {
-	float alpha = 1.0f;
+	pfloat alpha = 1.0f;
 
 //---- Get diffuse color.
 #	if defined(DIFFUSE_COLOR)
-		float3 diffuse = GammaColor(DiffuseColor).rgb;
+		pfloat3 diffuse = GammaColor(DiffuseColor).rgb;
 #	elif defined(DIFFUSE_TEXTURE)
-		float3 diffuse = GammaTextureRead(DiffuseSampler, aIn.DiffuseAmbientTexCoords.xy).rgb;
+		pfloat3 diffuse = GammaTextureRead(DiffuseSampler, aIn.DiffuseAmbientTexCoords.xy).rgb;
 #	endif
 
 //---- Get ambient color.
 #	if defined(AMBIENT_COLOR)
-		float3 ambient = GammaColor(AmbientColor).rgb;
+		pfloat3 ambient = GammaColor(AmbientColor).rgb;
 #	elif defined(AMBIENT_TEXTURE)
-		float3 ambient = GammaTextureRead(AmbientSampler, aIn.DiffuseAmbientTexCoords.zw).rgb;
+		pfloat3 ambient = GammaTextureRead(AmbientSampler, aIn.DiffuseAmbientTexCoords.zw).rgb;
 #	endif
 
 //---- Get emission color.
 #	if defined(EMISSION_COLOR)
-		float3 emission = GammaColor(EmissionColor).rgb;
+		pfloat3 emission = GammaColor(EmissionColor).rgb;
 #	elif defined(EMISSION_TEXTURE)
-		float3 emission = GammaTextureRead(EmissionSampler, aIn.EmissionTransparentTexCoords.xy).rgb;
+		pfloat3 emission = GammaTextureRead(EmissionSampler, aIn.EmissionTransparentTexCoords.xy).rgb;
 #	endif
 
 //---- Get transparent color and calculate alpha. Note that transparent color (rgb part)
@@ -733,9 +790,9 @@ float4 FragmentBase(vsOutBase aIn) : COLOR
 //---- that should produce colored transparency, but this cannot be done using the standard
 //---- pipeline. It requires post-processing effects.
 #	if defined(TRANSPARENT_COLOR)
-		float4 transparent = TransparentColor;
+		pfloat4 transparent = TransparentColor;
 #	elif defined(TRANSPARENT_TEXTURE)
-		float4 transparent = tex2D(TransparentSampler, aIn.EmissionTransparentTexCoords.zw);
+		pfloat4 transparent = tex2D(TransparentSampler, aIn.EmissionTransparentTexCoords.zw);
 #	endif
 #	if defined(TRANSPARENT)
 #		if defined(ALPHA_ONE)
@@ -747,9 +804,9 @@ float4 FragmentBase(vsOutBase aIn) : COLOR
 
 //---- Get reflective color and combine with diffuse.
 #	if defined(REFLECTIVE_COLOR)
-		float3 reflective = GammaColor(ReflectiveColor).rgb;
+		pfloat3 reflective = GammaColor(ReflectiveColor).rgb;
 #	elif defined(REFLECTIVE_TEXTURE)
-		float3 reflective = GammaTextureRead(ReflectiveSampler, aIn.ReflectiveTexCoords).rgb;
+		pfloat3 reflective = GammaTextureRead(ReflectiveSampler, aIn.ReflectiveTexCoords).rgb;
 #	endif
 #	if defined(REFLECTIVE_COLOR) || defined(REFLECTIVE_TEXTURE)
 #		if defined(DIFFUSE_COLOR) || defined(DIFFUSE_TEXTURE)
@@ -760,7 +817,7 @@ float4 FragmentBase(vsOutBase aIn) : COLOR
 #	endif
 
 //---- Calculate output color.
-	float3 ret = float3(0, 0, 0);
+	pfloat3 ret = pfloat3(0, 0, 0);
 
 #	if (defined(DIFFUSE) || defined(REFLECTIVE)) && defined(AMBIENT)
 		ret += (diffuse * ambient);
@@ -794,12 +851,12 @@ fsOut FragmentDeferred(vsOutDeferred aIn)
 //---- that should produce colored transparency, but this cannot be done using the standard
 //---- pipeline. It requires post-processing effects.
 #	if defined(TRANSPARENT_COLOR)
-		float4 transparent = TransparentColor;
+		pfloat4 transparent = TransparentColor;
 #	elif defined(TRANSPARENT_TEXTURE)
-		float4 transparent = tex2D(TransparentSampler, aIn.TransparentTexCoords);
+		pfloat4 transparent = tex2D(TransparentSampler, aIn.TransparentTexCoords);
 #	endif
 #	if defined(TRANSPARENT)
-		float alpha = 1.0f;
+		pfloat alpha = 1.0f;
 		
 #		if defined(ALPHA_ONE)
 			alpha = transparent.a * Transparency;
@@ -824,9 +881,9 @@ fsOut FragmentDeferred(vsOutDeferred aIn)
 
 //---- Get reflective color and combine with diffuse.
 #	if defined(REFLECTIVE_COLOR)
-		float3 reflective = GammaColor(ReflectiveColor).rgb;
+		pfloat3 reflective = GammaColor(ReflectiveColor).rgb;
 #	elif defined(REFLECTIVE_TEXTURE)
-		float3 reflective = GammaTextureRead(ReflectiveSampler, aIn.DiffuseReflectiveTexCoords.zw);
+		pfloat3 reflective = GammaTextureRead(ReflectiveSampler, aIn.DiffuseReflectiveTexCoords.zw);
 #	endif
 #	if defined(REFLECTIVE)
 #		if defined(DIFFUSE)
@@ -864,27 +921,21 @@ fsOut FragmentDeferred(vsOutDeferred aIn)
 	return ret;
 }
 
-float4 Fragment(vsOut aIn, uniform bool abPoint, uniform bool abSpot, uniform bool abShadow, uniform bool abShadowFiltered) : COLOR
+// abBase adds ambient and emission, when fused with the base pass (see BASE_LIGHT). abEarlyOut
+// returns before the material is read when the spot cone, shadow range, shadow or facing of the
+// pixel leave nothing to light (see EARLY_OUT). The result is the same either way.
+float4 Fragment(vsOut aIn, uniform bool abPoint, uniform bool abSpot, uniform bool abShadow, uniform bool abShadowFiltered, uniform bool abBase, uniform bool abEarlyOut) : COLOR
 {
-	float alpha = 1.0f;
+	pfloat alpha = 1.0f;
 	
-//---- Get diffuse color.
-#	if defined(DIFFUSE_COLOR)
-		float3 diffuse = GammaColor(DiffuseColor).rgb;
-#	elif defined(DIFFUSE_TEXTURE)
-		float3 diffuse = GammaTextureRead(DiffuseSampler, aIn.DiffuseTransparentTexCoords.xy);
-#	elif defined(DIFFUSE_VERTEX)
-		float3 diffuse = GammaColor(aIn.DiffuseColor).rgb;
-#	endif
-
 //---- Get transparent color and calculate alpha. Note that transparent color (rgb part)
 //---- is read for future compatability. COLLADA exports transparent color in RGB_ZERO mode
 //---- that should produce colored transparency, but this cannot be done using the standard
 //---- pipeline. It requires post-processing effects.
 #	if defined(TRANSPARENT_COLOR)
-		float4 transparent = TransparentColor;
+		pfloat4 transparent = TransparentColor;
 #	elif defined(TRANSPARENT_TEXTURE)
-		float4 transparent = tex2D(TransparentSampler, aIn.DiffuseTransparentTexCoords.zw);
+		pfloat4 transparent = tex2D(TransparentSampler, aIn.DiffuseTransparentTexCoords.zw);
 #	endif
 #	if defined(TRANSPARENT)
 #		if defined(ALPHA_ONE)
@@ -894,11 +945,81 @@ float4 Fragment(vsOut aIn, uniform bool abPoint, uniform bool abSpot, uniform bo
 #		endif	
 #	endif
 
+//---- Take texture coordinate gradients before any early out, see TextureRead.
+	float4 diffuseGradients = 0;
+	float4 reflectiveGradients = 0;
+	float4 specularGradients = 0;
+	float4 bumpGradients = 0;
+	if (abEarlyOut)
+	{
+#		if defined(DIFFUSE_TEXTURE)
+			diffuseGradients = Gradients(aIn.DiffuseTransparentTexCoords.xy);
+#		endif
+#		if defined(REFLECTIVE_TEXTURE)
+			reflectiveGradients = Gradients(aIn.ReflectiveSpecularTexCoords.xy);
+#		endif
+#		if defined(SPECULAR_TEXTURE)
+			specularGradients = Gradients(aIn.ReflectiveSpecularTexCoords.zw);
+#		endif
+#		if defined(BUMP)
+			bumpGradients = Gradients(aIn.BumpTexCoords.xy);
+#		endif
+	}
+
+#	if defined(DIFFUSE) || defined(REFLECTIVE) || defined(SPECULAR)
+	//---- Calculate light vector and attenuation if spot or point light.
+		float3 lv = normalize(aIn.Light.xyz);
+		float distance = 0.0f;
+		float att = 1.0f;
+		if (abSpot || abPoint)
+		{
+			distance = length(aIn.Light.xyz);
+			att = 1.0f / (LightAttenuation.x + (LightAttenuation.y * distance) + (LightAttenuation.z * distance * distance));
+		}
+
+	//---- If a spot light, calculate spot contribution.
+		float visibility = 1.0f;
+		if (abSpot)
+		{
+			float spotDot = -dot(lv, SpotDirection);
+			if (abEarlyOut) { [branch] if (spotDot < SpotFalloffCosAngle) { return float4(0, 0, 0, alpha); } }
+
+			visibility = pow(max(spotDot, 0.0f), max(SpotFalloffExponent, 1e-3));
+			if (spotDot < SpotFalloffCosAngle) { visibility = 0.0f; }
+		}
+
+	//---- If a shadow casting light, calculate shadow contribution. Shadow depths are at most 1,
+	//---- so pixels beyond the range of the light are always in shadow.
+		if (abShadow)
+		{
+			float pixelDepth = ((distance / ShadowFarDepth) - kShadowDepthBias);
+			if (abEarlyOut) { [branch] if (pixelDepth > 1) { return float4(0, 0, 0, alpha); } }
+
+			visibility *= Shadow(aIn.ShadowTexCoords, pixelDepth, abShadowFiltered, abEarlyOut);
+			if (abEarlyOut) { [branch] if (visibility <= 0) { return float4(0, 0, 0, alpha); } }
+		}
+
+	//---- Get normal. Without a bump map, pixels facing away from the light get nothing.
+#		if !defined(BUMP)
+			float3 nv = normalize(aIn.Normal.xyz);
+			if (abEarlyOut) { [branch] if (dot(nv, lv) <= 0) { return float4(0, 0, 0, alpha); } }
+#		endif
+#	endif
+
+//---- Get diffuse color.
+#	if defined(DIFFUSE_COLOR)
+		pfloat3 diffuse = GammaColor(DiffuseColor).rgb;
+#	elif defined(DIFFUSE_TEXTURE)
+		pfloat3 diffuse = GammaTextureRead(DiffuseSampler, aIn.DiffuseTransparentTexCoords.xy, diffuseGradients, abEarlyOut);
+#	elif defined(DIFFUSE_VERTEX)
+		pfloat3 diffuse = GammaColor(aIn.DiffuseColor).rgb;
+#	endif
+
 //---- Get reflective color and combine with diffuse.
 #	if defined(REFLECTIVE_COLOR)
-		float3 reflective = GammaColor(ReflectiveColor).rgb;
+		pfloat3 reflective = GammaColor(ReflectiveColor).rgb;
 #	elif defined(REFLECTIVE_TEXTURE)
-		float3 reflective = GammaTextureRead(ReflectiveSampler, aIn.ReflectiveSpecularTexCoords.xy);
+		pfloat3 reflective = GammaTextureRead(ReflectiveSampler, aIn.ReflectiveSpecularTexCoords.xy, reflectiveGradients, abEarlyOut);
 #	endif
 #	if defined(REFLECTIVE)
 #		if defined(DIFFUSE)
@@ -910,20 +1031,20 @@ float4 Fragment(vsOut aIn, uniform bool abPoint, uniform bool abSpot, uniform bo
 
 //---- Get specular color
 #	if defined(SPECULAR_COLOR)
-		float3 specular = GammaColor(SpecularColor).rgb;
+		pfloat3 specular = GammaColor(SpecularColor).rgb;
 #	elif defined(SPECULAR_TEXTURE)
-		float3 specular = GammaTextureRead(SpecularSampler, aIn.ReflectiveSpecularTexCoords.zw);
+		pfloat3 specular = GammaTextureRead(SpecularSampler, aIn.ReflectiveSpecularTexCoords.zw, specularGradients, abEarlyOut);
 #	endif
 
-//---- Calculate light vectors if necessary.
-#	if defined(DIFFUSE) || defined(REFLECTIVE) || defined(SPECULAR)
-		float3 lv = normalize(aIn.Light.xyz);
-
-#		if defined(BUMP)
-			float4 bump = tex2D(BumpSampler, aIn.BumpTexCoords.xy);
-			float3 nv = normalize((2.0 * bump.rgb) - 1.0);
+//---- Get bump mapped normal if necessary.
+#	if (defined(DIFFUSE) || defined(REFLECTIVE) || defined(SPECULAR)) && defined(BUMP)
+		float4 bump = TextureRead(BumpSampler, aIn.BumpTexCoords.xy, bumpGradients, abEarlyOut);
+#		if defined(BUMP_TEXTURE_XY)
+			// BC3 normal map, x in alpha and y in green (see SiatTextureProcessor).
+			float2 nxy = (2.0 * bump.ag) - 1.0;
+			float3 nv = normalize(float3(nxy, sqrt(saturate(1.0 - dot(nxy, nxy)))));
 #		else
-			float3 nv = normalize(aIn.Normal.xyz);
+			float3 nv = normalize((2.0 * bump.rgb) - 1.0);
 #		endif
 #	endif
 
@@ -934,36 +1055,25 @@ float4 Fragment(vsOut aIn, uniform bool abPoint, uniform bool abSpot, uniform bo
 		
 #		if defined(BLINN)
 			float3 hv = normalize(ev + lv);
-			float4 l = float4(1, max(ndotl, 0.0f), ndotl > 0.0f ? pow(max(dot(hv, nv), 0.0f), max(Shininess, 1e-3)) : 0.0f, 1);
+			pfloat4 l = pfloat4(1, max((pfloat)ndotl, 0), ndotl > 0.0f ? pow((pfloat)max(dot(hv, nv), 0.0f), max((pfloat)Shininess, 1e-3)) : 0, 1);
 #		elif defined(PHONG)
 			float3 rv = (2.0f * ndotl * nv) - lv;
-			float4 l = float4(1, max(ndotl, 0.0f), ndotl > 0.0f ? pow(max(dot(rv, ev), 0.0f), max(Shininess, 1e-3)) : 0.0f, 1); 
+			pfloat4 l = pfloat4(1, max((pfloat)ndotl, 0), ndotl > 0.0f ? pow((pfloat)max(dot(rv, ev), 0.0f), max((pfloat)Shininess, 1e-3)) : 0, 1);
 #		endif
 #	elif defined(DIFFUSE)
-		float4 l = float4(1, max(dot(nv, lv), 0.0f), 0, 1);
+		pfloat4 l = pfloat4(1, max((pfloat)dot(nv, lv), 0), 0, 1);
 #	endif
 
-	float3 ret = float3(0, 0, 0);
-
-#	if defined(DIFFUSE) || defined(REFLECTIVE) || defined(SPECULAR)
-	//---- Calculate attenuation if spot or point light.
-		float distance = 0.0f;
-		float att = 1.0f;
-		if (abSpot || abPoint)
-		{
-			distance = length(aIn.Light.xyz);
-			att = 1.0f / (LightAttenuation.x + (LightAttenuation.y * distance) + (LightAttenuation.z * distance * distance));
-		}
-#	endif
+	pfloat3 ret = pfloat3(0, 0, 0);
 
 //---- Calculate diffuse contribution.
 #	if defined(DIFFUSE)
-		ret += LightDiffuse * diffuse * l.y;
+		ret += (pfloat3)LightDiffuse * diffuse * l.y;
 #	endif
 
 //---- Calculate specular contribution.
 #	if defined(SPECULAR)
-		ret += LightSpecular * specular * l.z;
+		ret += (pfloat3)LightSpecular * specular * l.z;
 #	endif
 
 #	if defined(DIFFUSE) || defined(SPECULAR)
@@ -976,21 +1086,19 @@ float4 Fragment(vsOut aIn, uniform bool abPoint, uniform bool abSpot, uniform bo
 #	endif
 
 #	if defined(DIFFUSE) || defined(REFLECTIVE) || defined(SPECULAR)
-	//---- If a spot light, calculate spot contribution.
-		if (abSpot)
-		{
-			float spotDot = -dot(lv, SpotDirection);
-			float spot = pow(max(spotDot, 0.0f), max(SpotFalloffExponent, 1e-3));
-			if (spotDot < SpotFalloffCosAngle) { spot = 0.0f; }		
-			
-			ret *= spot;
-		}
+		ret *= visibility;
+#	endif
 
-	//---- If a shadow casting light, calculate shadow contribution.	
-		if (abShadow)
+#	if defined(BASE_LIGHT)
+	//---- If fused with the base pass, add ambient and emission.
+		if (abBase)
 		{
-			float pixelDepth = ((distance / ShadowFarDepth) - kShadowDepthBias);
-			ret *= Shadow(aIn.ShadowTexCoords, pixelDepth, abShadowFiltered);
+#			if (defined(DIFFUSE) || defined(REFLECTIVE)) && defined(AMBIENT)
+				ret += (diffuse * GammaColor(AmbientColor).rgb);
+#			endif
+#			if defined(EMISSION)
+				ret += GammaColor(EmissionColor).rgb;
+#			endif
 		}
 #	endif
     
@@ -1050,7 +1158,7 @@ float4 Fragment(vsOut aIn, uniform bool abPoint, uniform bool abSpot, uniform bo
 #define COMMON_OPAQUE_RENDER_STATES _COMMON_OPAQUE_RENDER_STATES_LIT
 #define COMMON_SHADER_DEFINE \
 		VertexShader = compile vs_2_0 Vertex(true, false, false, false); \
-		PixelShader = compile ps_2_0 Fragment(false, false, false, false);
+		PixelShader = compile ps_2_0 Fragment(false, false, false, false, false, false);
 #include "_collada_effect_technique.h"
 
 // Point light technique - applies a point light.
@@ -1060,7 +1168,7 @@ float4 Fragment(vsOut aIn, uniform bool abPoint, uniform bool abSpot, uniform bo
 #define COMMON_OPAQUE_RENDER_STATES _COMMON_OPAQUE_RENDER_STATES_LIT
 #define COMMON_SHADER_DEFINE \
 		VertexShader = compile vs_2_0 Vertex(false, true, false, false); \
-		PixelShader = compile ps_2_0 Fragment(true, false, false, false);
+		PixelShader = compile ps_2_0 Fragment(true, false, false, false, false, false);
 #include "_collada_effect_technique.h"
 
 // Spot light technique - applies a spot light.
@@ -1070,7 +1178,7 @@ float4 Fragment(vsOut aIn, uniform bool abPoint, uniform bool abSpot, uniform bo
 #define COMMON_OPAQUE_RENDER_STATES _COMMON_OPAQUE_RENDER_STATES_LIT
 #define COMMON_SHADER_DEFINE \
 		VertexShader = compile vs_2_0 Vertex(false, false, true, false); \
-		PixelShader = compile ps_2_0 Fragment(false, true, false, false);
+		PixelShader = compile ps_2_0 Fragment(false, true, false, false, false, false);
 #include "_collada_effect_technique.h"
 
 // Spot light with shadow technique - applies a shadowed spot light. Unfiltered edge.
@@ -1080,7 +1188,7 @@ float4 Fragment(vsOut aIn, uniform bool abPoint, uniform bool abSpot, uniform bo
 #define COMMON_OPAQUE_RENDER_STATES _COMMON_OPAQUE_RENDER_STATES_LIT
 #define COMMON_SHADER_DEFINE \
 		VertexShader = compile vs_2_0 Vertex(false, false, true, true); \
-		PixelShader = compile ps_2_0 Fragment(false, true, true, false);
+		PixelShader = compile ps_2_0 Fragment(false, true, true, false, false, false);
 #include "_collada_effect_technique.h"
 
 // Spot light with shadow technique - applies a shadowed spot light. Filters the edge with a box filter.
@@ -1090,9 +1198,104 @@ float4 Fragment(vsOut aIn, uniform bool abPoint, uniform bool abSpot, uniform bo
 #define COMMON_OPAQUE_RENDER_STATES _COMMON_OPAQUE_RENDER_STATES_LIT
 #define COMMON_SHADER_DEFINE \
 		VertexShader = compile vs_3_0 Vertex(false, false, true, true); \
-		PixelShader = compile ps_3_0 Fragment(false, true, true, true);
+		PixelShader = compile ps_3_0 Fragment(false, true, true, true, false, false);
+#include "_collada_effect_technique.h"
+
+// Base and light techniques - apply ambient, emission, and the first light of an opaque object
+// in one pass, in place of siat_RenderBase and one additive light pass. Compiled for shader
+// model 3 to leave room for the extra terms, the engine only uses them on ps_3_0 hardware.
+#if defined(BASE_LIGHT)
+#define _COMMON_OPAQUE_RENDER_STATES_BASE_LIGHT \
+		AlphaBlendEnable = false;
+
+#define TECHNIQUE_NAME siat_RenderBaseDirectionalLight
+#define COMMON_RENDER_STATES _COMMON_RENDER_STATES
+#define COMMON_TRANSPARENT_RENDER_STATES
+#define COMMON_OPAQUE_RENDER_STATES _COMMON_OPAQUE_RENDER_STATES_BASE_LIGHT
+#define COMMON_SHADER_DEFINE \
+		VertexShader = compile vs_3_0 Vertex(true, false, false, false); \
+		PixelShader = compile ps_3_0 Fragment(false, false, false, false, true, false);
+#include "_collada_effect_technique.h"
+
+#define TECHNIQUE_NAME siat_RenderBasePointLight
+#define COMMON_RENDER_STATES _COMMON_RENDER_STATES
+#define COMMON_TRANSPARENT_RENDER_STATES
+#define COMMON_OPAQUE_RENDER_STATES _COMMON_OPAQUE_RENDER_STATES_BASE_LIGHT
+#define COMMON_SHADER_DEFINE \
+		VertexShader = compile vs_3_0 Vertex(false, true, false, false); \
+		PixelShader = compile ps_3_0 Fragment(true, false, false, false, true, false);
+#include "_collada_effect_technique.h"
+
+#define TECHNIQUE_NAME siat_RenderBaseSpotLight
+#define COMMON_RENDER_STATES _COMMON_RENDER_STATES
+#define COMMON_TRANSPARENT_RENDER_STATES
+#define COMMON_OPAQUE_RENDER_STATES _COMMON_OPAQUE_RENDER_STATES_BASE_LIGHT
+#define COMMON_SHADER_DEFINE \
+		VertexShader = compile vs_3_0 Vertex(false, false, true, false); \
+		PixelShader = compile ps_3_0 Fragment(false, true, false, false, true, false);
+#include "_collada_effect_technique.h"
+
+#define TECHNIQUE_NAME siat_RenderBaseSpotLightShadow_Unfiltered
+#define COMMON_RENDER_STATES _COMMON_RENDER_STATES
+#define COMMON_TRANSPARENT_RENDER_STATES
+#define COMMON_OPAQUE_RENDER_STATES _COMMON_OPAQUE_RENDER_STATES_BASE_LIGHT
+#define COMMON_SHADER_DEFINE \
+		VertexShader = compile vs_3_0 Vertex(false, false, true, true); \
+		PixelShader = compile ps_3_0 Fragment(false, true, true, false, true, false);
+#include "_collada_effect_technique.h"
+
+#define TECHNIQUE_NAME siat_RenderBaseSpotLightShadow_Filtered
+#define COMMON_RENDER_STATES _COMMON_RENDER_STATES
+#define COMMON_TRANSPARENT_RENDER_STATES
+#define COMMON_OPAQUE_RENDER_STATES _COMMON_OPAQUE_RENDER_STATES_BASE_LIGHT
+#define COMMON_SHADER_DEFINE \
+		VertexShader = compile vs_3_0 Vertex(false, false, true, true); \
+		PixelShader = compile ps_3_0 Fragment(false, true, true, true, true, false);
+#include "_collada_effect_technique.h"
+#endif
+
+// Early-out light techniques - apply a point, spot, or shadowed spot light like the techniques
+// above, but test the spot cone, shadow range, and shadow first and return before reading the
+// material of pixels the light does not reach. Dynamic branching requires shader model 3, the
+// engine only uses them on ps_3_0 hardware (see RenderRoot.bEarlyOutLighting).
+#if defined(EARLY_OUT)
+#define TECHNIQUE_NAME siat_RenderPointLightEarlyOut
+#define COMMON_RENDER_STATES _COMMON_RENDER_STATES
+#define COMMON_TRANSPARENT_RENDER_STATES _COMMON_TRANSPARENT_RENDER_STATES_LIT
+#define COMMON_OPAQUE_RENDER_STATES _COMMON_OPAQUE_RENDER_STATES_LIT
+#define COMMON_SHADER_DEFINE \
+		VertexShader = compile vs_3_0 Vertex(false, true, false, false); \
+		PixelShader = compile ps_3_0 Fragment(true, false, false, false, false, true);
+#include "_collada_effect_technique.h"
+
+#define TECHNIQUE_NAME siat_RenderSpotLightEarlyOut
+#define COMMON_RENDER_STATES _COMMON_RENDER_STATES
+#define COMMON_TRANSPARENT_RENDER_STATES _COMMON_TRANSPARENT_RENDER_STATES_LIT
+#define COMMON_OPAQUE_RENDER_STATES _COMMON_OPAQUE_RENDER_STATES_LIT
+#define COMMON_SHADER_DEFINE \
+		VertexShader = compile vs_3_0 Vertex(false, false, true, false); \
+		PixelShader = compile ps_3_0 Fragment(false, true, false, false, false, true);
+#include "_collada_effect_technique.h"
+
+#define TECHNIQUE_NAME siat_RenderSpotLightShadowEarlyOut_Unfiltered
+#define COMMON_RENDER_STATES _COMMON_RENDER_STATES
+#define COMMON_TRANSPARENT_RENDER_STATES _COMMON_TRANSPARENT_RENDER_STATES_LIT
+#define COMMON_OPAQUE_RENDER_STATES _COMMON_OPAQUE_RENDER_STATES_LIT
+#define COMMON_SHADER_DEFINE \
+		VertexShader = compile vs_3_0 Vertex(false, false, true, true); \
+		PixelShader = compile ps_3_0 Fragment(false, true, true, false, false, true);
 #include "_collada_effect_technique.h"
 
+#define TECHNIQUE_NAME siat_RenderSpotLightShadowEarlyOut_Filtered
+#define COMMON_RENDER_STATES _COMMON_RENDER_STATES
+#define COMMON_TRANSPARENT_RENDER_STATES _COMMON_TRANSPARENT_RENDER_STATES_LIT
+#define COMMON_OPAQUE_RENDER_STATES _COMMON_OPAQUE_RENDER_STATES_LIT
+#define COMMON_SHADER_DEFINE \
+		VertexShader = compile vs_3_0 Vertex(false, false, true, true); \
+		PixelShader = compile ps_3_0 Fragment(false, true, true, true, false, true);
+#include "_collada_effect_technique.h"
+#endif
+
 // Special technique used for picking. Renders a solid color. If material is transparent,
 // pixel is only rendered if alpha is above a certain threshold.
 technique siat_RenderPicking
@@ -38,9 +38,14 @@ namespace siat.pipeline
     public sealed class AnimationContent
     {
         public AnimationContent(string aId, AnimationKeyFrame[] aKeyFrames)
+            : this(aId, aKeyFrames, null)
+        { }
+
+        public AnimationContent(string aId, AnimationKeyFrame[] aKeyFrames, CompressedAnimation aCompressed)
         {
             Id = aId;
             KeyFrames = aKeyFrames;
+            Compressed = aCompressed;
         }
 
         public override bool Equals(object obj)
@@ -66,6 +71,11 @@ namespace siat.pipeline
 
         public readonly string Id;
         public readonly AnimationKeyFrame[] KeyFrames;
+
+        /// <summary>
+        /// If not null, written in place of KeyFrames.
+        /// </summary>
+        public readonly CompressedAnimation Compressed;
     }
 
     public struct BoundingFrame
@@ -279,6 +289,27 @@ namespace siat.pipeline
             private int mVertexStrideInBytes;
             #endregion
 
+            /// <summary>
+            /// Returns a deep copy of this part with a new id.
+            /// </summary>
+            public Part Clone(string aId)
+            {
+                Part ret = new Part();
+                ret.mbAxisAlignCalculated = mbAxisAlignCalculated;
+                ret.mAxisAlignment = mAxisAlignment;
+                ret.mVertexStrideInBytes = mVertexStrideInBytes;
+                ret.Id = aId;
+                ret.Indices = (int[])Indices.Clone();
+                ret.Effect = Effect;
+                ret.PrimitiveCount = PrimitiveCount;
+                ret.PrimitiveType = PrimitiveType;
+                ret.VertexCount = VertexCount;
+                ret.VertexDeclaration = VertexDeclaration;
+                ret.Vertices = (float[])Vertices.Clone();
+
+                return ret;
+            }
+
             public string Id;
             public int[] Indices;
             public string Effect;
@@ -705,6 +736,12 @@ namespace siat.pipeline
     public sealed class SceneContent
     {
         public List<SceneNodeContent> Nodes = new List<SceneNodeContent>();
+
+        /// <summary>
+        /// If true, all mesh parts of the scene are written as one mesh pack (see siat.MeshPackFormat)
+        /// instead of as individual shared resources.
+        /// </summary>
+        public bool bPackMeshes = false;
     }
     #endregion
 }
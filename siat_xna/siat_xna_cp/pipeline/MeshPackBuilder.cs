@@ -0,0 +1,192 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using Microsoft.Xna.Framework;
+using Microsoft.Xna.Framework.Graphics;
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+
+namespace siat.pipeline
+{
+    /// <summary>
+    /// Builds a mesh pack (see siat.MeshPackFormat) from the mesh parts of a scene.
+    /// </summary>
+    public static class MeshPackBuilder
+    {
+        #region Private members
+        private static void _Pad(BinaryWriter aOut)
+        {
+            while ((aOut.BaseStream.Position % MeshPackFormat.kAlignment) != 0) { aOut.Write((byte)0); }
+        }
+
+        private static int _Position(BinaryWriter aOut)
+        {
+            return (int)aOut.BaseStream.Position;
+        }
+
+        private static bool _SameDeclaration(VertexElement[] a, VertexElement[] b)
+        {
+            if (a.Length != b.Length) { return false; }
+            for (int i = 0; i < a.Length; i++) { if (a[i] != b[i]) { return false; } }
+
+            return true;
+        }
+
+        private static bool _Needs32BitIndices(SiatMeshContent.Part aPart)
+        {
+            foreach (int e in aPart.Indices) { if (e > ushort.MaxValue) { return true; } }
+
+            return false;
+        }
+        #endregion
+
+        public static byte[] Build(List<SiatMeshContent.Part> aParts)
+        {
+            int count = aParts.Count;
+            int[] idOffsets = new int[count];
+            int[] declarationOffsets = new int[count];
+            int[] indexOffsets = new int[count];
+            int[] vertexOffsets = new int[count];
+            Encoding utf8 = Encoding.UTF8;
+
+            // AABB applies the axis alignment of a part to its vertices, so it must be queried
+            // before the vertices are written.
+            BoundingBox[] boxes = new BoundingBox[count];
+            BoundingSphere[] spheres = new BoundingSphere[count];
+            for (int i = 0; i < count; i++)
+            {
+                boxes[i] = aParts[i].AABB;
+                spheres[i] = aParts[i].BoundingSphere;
+            }
+
+            MemoryStream stream = new MemoryStream();
+            BinaryWriter o = new BinaryWriter(stream);
+
+            // Header and part records are written last, once all offsets are known.
+            int partsOffset = MeshPackFormat.kHeaderSize;
+            stream.SetLength(partsOffset + (count * MeshPackFormat.kPartRecordSize));
+            stream.Position = stream.Length;
+            _Pad(o);
+
+            int stringsOffset = _Position(o);
+            for (int i = 0; i < count; i++)
+            {
+                idOffsets[i] = _Position(o);
+                o.Write(utf8.GetBytes(aParts[i].Id));
+            }
+            _Pad(o);
+
+            int declarationsOffset = _Position(o);
+            List<VertexElement[]> declarations = new List<VertexElement[]>();
+            List<int> declarationOffsetsByIndex = new List<int>();
+            for (int i = 0; i < count; i++)
+            {
+                VertexElement[] declaration = aParts[i].VertexDeclaration;
+
+                int index = declarations.FindIndex(delegate(VertexElement[] e) { return _SameDeclaration(e, declaration); });
+                if (index < 0)
+                {
+                    index = declarations.Count;
+                    declarations.Add(declaration);
+                    declarationOffsetsByIndex.Add(_Position(o));
+
+                    o.Write(declaration.Length);
+                    foreach (VertexElement e in declaration)
+                    {
+                        o.Write(e.Stream);
+                        o.Write(e.Offset);
+                        o.Write((byte)e.VertexElementFormat);
+                        o.Write((byte)e.VertexElementMethod);
+                        o.Write((byte)e.VertexElementUsage);
+                        o.Write(e.UsageIndex);
+                    }
+                }
+
+                declarationOffsets[i] = declarationOffsetsByIndex[index];
+            }
+            _Pad(o);
+
+            int indicesOffset = _Position(o);
+            int[] indexSizes = new int[count];
+            for (int i = 0; i < count; i++)
+            {
+                indexOffsets[i] = _Position(o);
+                indexSizes[i] = (_Needs32BitIndices(aParts[i])) ? sizeof(int) : sizeof(ushort);
+
+                if (indexSizes[i] == sizeof(int)) { foreach (int e in aParts[i].Indices) { o.Write(e); } }
+                else { foreach (int e in aParts[i].Indices) { o.Write((ushort)e); } }
+                _Pad(o);
+            }
+
+            int verticesOffset = _Position(o);
+            for (int i = 0; i < count; i++)
+            {
+                vertexOffsets[i] = _Position(o);
+                foreach (float e in aParts[i].Vertices) { o.Write(e); }
+                _Pad(o);
+            }
+
+            int totalSize = _Position(o);
+
+            stream.Position = 0;
+            o.Write(MeshPackFormat.kMagic);
+            o.Write(MeshPackFormat.kVersion);
+            o.Write(count);
+            o.Write(partsOffset);
+            o.Write(stringsOffset);
+            o.Write(declarationsOffset);
+            o.Write(indicesOffset);
+            o.Write(verticesOffset);
+            o.Write(totalSize);
+            o.Write(0); o.Write(0); o.Write(0);
+
+            for (int i = 0; i < count; i++)
+            {
+                SiatMeshContent.Part part = aParts[i];
+                BoundingBox aabb = boxes[i];
+                BoundingSphere sphere = spheres[i];
+
+                o.Write(idOffsets[i]);
+                o.Write(utf8.GetByteCount(part.Id));
+                o.Write(declarationOffsets[i]);
+                o.Write(part.VertexStrideInBytes);
+                o.Write(part.VertexCount);
+                o.Write(vertexOffsets[i]);
+                o.Write(part.Vertices.Length * sizeof(float));
+                o.Write(indexOffsets[i]);
+                o.Write(part.Indices.Length);
+                o.Write(indexSizes[i]);
+                o.Write((int)part.PrimitiveType);
+                o.Write(part.PrimitiveCount);
+                o.Write(aabb.Min.X); o.Write(aabb.Min.Y); o.Write(aabb.Min.Z);
+                o.Write(aabb.Max.X); o.Write(aabb.Max.Y); o.Write(aabb.Max.Z);
+                o.Write(sphere.Center.X); o.Write(sphere.Center.Y); o.Write(sphere.Center.Z);
+                o.Write(sphere.Radius);
+            }
+
+            o.Flush();
+            return stream.ToArray();
+        }
+    }
+}
@@ -0,0 +1,444 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using Microsoft.Xna.Framework;
+using Microsoft.Xna.Framework.Content.Pipeline;
+using Microsoft.Xna.Framework.Content.Pipeline.Graphics;
+using Microsoft.Xna.Framework.Content.Pipeline.Processors;
+using System;
+using System.Collections.Generic;
+using System.ComponentModel;
+using System.IO;
+using System.Security.Cryptography;
+using System.Text;
+
+namespace siat.pipeline
+{
+    /// <summary>
+    /// How a texture is sampled by collada_effect.h, used to pick its compressed format and mip filter.
+    /// </summary>
+    public enum SiatTextureUsage
+    {
+        /// <summary>
+        /// Gamma encoded color (DIFFUSE, AMBIENT, SPECULAR, EMISSION, REFLECTIVE or an RGB_ZERO
+        /// TRANSPARENT texture). BC1 (DXT1) if opaque, otherwise BC3 (DXT5).
+        /// </summary>
+        Color,
+
+        /// <summary>
+        /// An ALPHA_ONE TRANSPARENT texture, alpha tested against OPAQUE_OF_TRANSPARENCY
+        /// (TRANSPARENT_TEXTURE_1_BIT). Mips preserve alpha test coverage. BC1 with 1-bit alpha
+        /// if the source alpha is 1-bit, otherwise BC3.
+        /// </summary>
+        AlphaTest,
+
+        /// <summary>
+        /// A tangent space normal map (BUMP). Stored as BC3 with X in alpha and Y in green, the
+        /// shader reconstructs Z (BUMP_TEXTURE_XY).
+        /// </summary>
+        Normal
+    }
+
+    /// <summary>
+    /// Compresses textures by usage and generates their mip chains offline.
+    /// </summary>
+    /// <remarks>
+    /// Mips are box filtered: color in linear space, normals renormalized, and alpha tested
+    /// textures rescaled per level so that the fraction of texels passing the alpha test matches
+    /// the top level. Without the rescale, alpha tested foliage and fences thin out and vanish
+    /// with distance.
+    /// 
+    /// Results are cached in the intermediate directory keyed by a hash of the source file and
+    /// the processor settings, so unchanged textures skip filtering and compression on later
+    /// builds, including builds that rebuild the scene referencing them.
+    /// 
+    /// Textures that are not 2D (cube and volume maps) are passed to the XNA TextureProcessor.
+    /// </remarks>
+    [ContentProcessor(DisplayName = "Siat XNA Texture Processor")]
+    public sealed class SiatTextureProcessor : ContentProcessor<TextureContent, TextureContent>
+    {
+        public const int kCacheMagic = 0x58545453;
+        public const int kCacheVersion = 1;
+        public const string kCacheDirectory = "siat_texture_cache";
+        public const float kGamma = 2.2f;
+        public const float kAlphaTolerance = 4.0f / 255.0f;
+        public const int kCoverageSearchSteps = 12;
+
+        public const string kUsageParameter = "Usage";
+
+        #region Private members
+        private const int kDxt1 = 1;
+        private const int kDxt5 = 5;
+
+        private SiatTextureUsage mUsage = SiatTextureUsage.Color;
+        private byte mAlphaReference = 127;
+        private bool mbCache = true;
+
+        private static int _NextPowerOfTwo(int a)
+        {
+            int ret = 1;
+            while (ret < a) { ret <<= 1; }
+
+            return ret;
+        }
+
+        private static Vector4 _ToLinear(Vector4 a)
+        {
+            return new Vector4((float)Math.Pow(a.X, kGamma), (float)Math.Pow(a.Y, kGamma), (float)Math.Pow(a.Z, kGamma), a.W);
+        }
+
+        private static Vector4 _FromLinear(Vector4 a)
+        {
+            float e = 1.0f / kGamma;
+            return new Vector4((float)Math.Pow(a.X, e), (float)Math.Pow(a.Y, e), (float)Math.Pow(a.Z, e), a.W);
+        }
+
+        private static Vector4 _DecodeNormal(Vector4 a)
+        {
+            return new Vector4((2.0f * a.X) - 1.0f, (2.0f * a.Y) - 1.0f, (2.0f * a.Z) - 1.0f, a.W);
+        }
+
+        private static Vector4 _EncodeNormal(Vector4 a)
+        {
+            Vector3 n = new Vector3(a.X, a.Y, a.Z);
+            float length = n.Length();
+            n = (length > 0.0f) ? (n / length) : Vector3.UnitZ;
+
+            return new Vector4((0.5f * n.X) + 0.5f, (0.5f * n.Y) + 0.5f, (0.5f * n.Z) + 0.5f, a.W);
+        }
+
+        private PixelBitmapContent<Vector4> _Downsample(PixelBitmapContent<Vector4> aIn)
+        {
+            int width = Math.Max(aIn.Width / 2, 1);
+            int height = Math.Max(aIn.Height / 2, 1);
+            PixelBitmapContent<Vector4> ret = new PixelBitmapContent<Vector4>(width, height);
+
+            for (int y = 0; y < height; y++)
+            {
+                int y0 = Math.Min(2 * y, aIn.Height - 1);
+                int y1 = Math.Min(y0 + 1, aIn.Height - 1);
+
+                for (int x = 0; x < width; x++)
+                {
+                    int x0 = Math.Min(2 * x, aIn.Width - 1);
+                    int x1 = Math.Min(x0 + 1, aIn.Width - 1);
+
+                    Vector4 a = aIn.GetPixel(x0, y0);
+                    Vector4 b = aIn.GetPixel(x1, y0);
+                    Vector4 c = aIn.GetPixel(x0, y1);
+                    Vector4 d = aIn.GetPixel(x1, y1);
+
+                    Vector4 v;
+                    if (mUsage == SiatTextureUsage.Normal)
+                    {
+                        v = 0.25f * (_DecodeNormal(a) + _DecodeNormal(b) + _DecodeNormal(c) + _DecodeNormal(d));
+                        v = _EncodeNormal(v);
+                    }
+                    else
+                    {
+                        v = 0.25f * (_ToLinear(a) + _ToLinear(b) + _ToLinear(c) + _ToLinear(d));
+                        v = _FromLinear(v);
+                    }
+
+                    ret.SetPixel(x, y, v);
+                }
+            }
+
+            return ret;
+        }
+
+        private static float _Coverage(PixelBitmapContent<Vector4> aIn, float aScale, float aReference)
+        {
+            int passed = 0;
+
+            for (int y = 0; y < aIn.Height; y++)
+            {
+                for (int x = 0; x < aIn.Width; x++)
+                {
+                    if ((aIn.GetPixel(x, y).W * aScale) >= aReference) { passed++; }
+                }
+            }
+
+            return ((float)passed / (float)(aIn.Width * aIn.Height));
+        }
+
+        /// <summary>
+        /// Scales the alpha of a level so its alpha test coverage matches aCoverage.
+        /// </summary>
+        private static void _PreserveCoverage(PixelBitmapContent<Vector4> aIn, float aCoverage, float aReference, bool abBinary)
+        {
+            float lo = 0.0f;
+            float hi = 4.0f;
+
+            for (int i = 0; i < kCoverageSearchSteps; i++)
+            {
+                float mid = 0.5f * (lo + hi);
+                if (_Coverage(aIn, mid, aReference) < aCoverage) { lo = mid; }
+                else { hi = mid; }
+            }
+
+            float scale = 0.5f * (lo + hi);
+
+            for (int y = 0; y < aIn.Height; y++)
+            {
+                for (int x = 0; x < aIn.Width; x++)
+                {
+                    Vector4 v = aIn.GetPixel(x, y);
+                    float a = MathHelper.Clamp(v.W * scale, 0.0f, 1.0f);
+                    v.W = (abBinary) ? ((a >= aReference) ? 1.0f : 0.0f) : a;
+                    aIn.SetPixel(x, y, v);
+                }
+            }
+        }
+
+        private static void _AnalyzeAlpha(PixelBitmapContent<Vector4> aIn, out bool arbOpaque, out bool arbBinary)
+        {
+            arbOpaque = true;
+            arbBinary = true;
+
+            for (int y = 0; y < aIn.Height; y++)
+            {
+                for (int x = 0; x < aIn.Width; x++)
+                {
+                    float a = aIn.GetPixel(x, y).W;
+
+                    if (a < (1.0f - kAlphaTolerance))
+                    {
+                        arbOpaque = false;
+                        if (a > kAlphaTolerance) { arbBinary = false; return; }
+                    }
+                }
+            }
+        }
+
+        #region Cache
+        private string _CacheFilename(TextureContent aInput, ContentProcessorContext aContext)
+        {
+            if (!mbCache || aInput.Identity == null || !File.Exists(aInput.Identity.SourceFilename)) { return null; }
+
+            MD5 md5 = MD5.Create();
+            byte[] settings = Encoding.UTF8.GetBytes(kCacheVersion.ToString() + mUsage.ToString() + mAlphaReference.ToString());
+            byte[] source = File.ReadAllBytes(aInput.Identity.SourceFilename);
+
+            md5.TransformBlock(settings, 0, settings.Length, settings, 0);
+            md5.TransformFinalBlock(source, 0, source.Length);
+
+            StringBuilder name = new StringBuilder();
+            foreach (byte b in md5.Hash) { name.Append(b.ToString("x2")); }
+            name.Append(".bin");
+
+            return Path.Combine(Path.Combine(aContext.IntermediateDirectory, kCacheDirectory), name.ToString());
+        }
+
+        private static BitmapContent _NewDxt(int aFormat, int aWidth, int aHeight)
+        {
+            if (aFormat == kDxt1) { return new Dxt1BitmapContent(aWidth, aHeight); }
+            else { return new Dxt5BitmapContent(aWidth, aHeight); }
+        }
+
+        private static Texture2DContent _ReadCache(string aFilename, ContentIdentity aIdentity)
+        {
+            using (BinaryReader reader = new BinaryReader(File.OpenRead(aFilename)))
+            {
+                if (reader.ReadInt32() != kCacheMagic || reader.ReadInt32() != kCacheVersion) { return null; }
+
+                int format = reader.ReadInt32();
+                int count = reader.ReadInt32();
+
+                Texture2DContent ret = new Texture2DContent();
+                ret.Identity = aIdentity;
+
+                for (int i = 0; i < count; i++)
+                {
+                    int width = reader.ReadInt32();
+                    int height = reader.ReadInt32();
+                    BitmapContent level = _NewDxt(format, width, height);
+                    level.SetPixelData(reader.ReadBytes(reader.ReadInt32()));
+                    ret.Mipmaps.Add(level);
+                }
+
+                return ret;
+            }
+        }
+
+        private static void _WriteCache(string aFilename, int aFormat, Texture2DContent aTexture)
+        {
+            Directory.CreateDirectory(Path.GetDirectoryName(aFilename));
+
+            string temp = aFilename + ".tmp";
+            using (BinaryWriter writer = new BinaryWriter(File.Create(temp)))
+            {
+                writer.Write(kCacheMagic);
+                writer.Write(kCacheVersion);
+                writer.Write(aFormat);
+                writer.Write(aTexture.Mipmaps.Count);
+
+                foreach (BitmapContent e in aTexture.Mipmaps)
+                {
+                    byte[] data = e.GetPixelData();
+                    writer.Write(e.Width);
+                    writer.Write(e.Height);
+                    writer.Write(data.Length);
+                    writer.Write(data);
+                }
+            }
+
+            // Parallel builds can produce the same entry, the first one written wins.
+            if (File.Exists(aFilename)) { File.Delete(temp); }
+            else { File.Move(temp, aFilename); }
+        }
+        #endregion
+        #endregion
+
+        public override TextureContent Process(TextureContent aInput, ContentProcessorContext aContext)
+        {
+            if (!(aInput is Texture2DContent))
+            {
+                TextureProcessor fallback = new TextureProcessor();
+                fallback.ColorKeyEnabled = false;
+                fallback.GenerateMipmaps = true;
+                fallback.ResizeToPowerOfTwo = true;
+                fallback.TextureFormat = TextureProcessorOutputFormat.DxtCompressed;
+
+                return fallback.Process(aInput, aContext);
+            }
+
+            string cacheFilename = _CacheFilename(aInput, aContext);
+            if (cacheFilename != null && File.Exists(cacheFilename))
+            {
+                try
+                {
+                    Texture2DContent cached = _ReadCache(cacheFilename, aInput.Identity);
+                    if (cached != null)
+                    {
+                        cached.Name = aInput.Name;
+                        return cached;
+                    }
+                }
+                catch (Exception e)
+                {
+                    aContext.Logger.LogImportantMessage("Texture cache entry \"" + cacheFilename + "\" is unreadable and will be rebuilt: " + e.Message);
+                }
+            }
+
+            #region Top level
+            aInput.ConvertBitmapType(typeof(PixelBitmapContent<Vector4>));
+            PixelBitmapContent<Vector4> top = (PixelBitmapContent<Vector4>)aInput.Faces[0][0];
+
+            int width = _NextPowerOfTwo(top.Width);
+            int height = _NextPowerOfTwo(top.Height);
+            if (width != top.Width || height != top.Height)
+            {
+                PixelBitmapContent<Vector4> resized = new PixelBitmapContent<Vector4>(width, height);
+                BitmapContent.Copy(top, resized);
+                top = resized;
+            }
+            #endregion
+
+            #region Mip chain
+            bool bOpaque;
+            bool bBinaryAlpha;
+            _AnalyzeAlpha(top, out bOpaque, out bBinaryAlpha);
+
+            float reference = (float)mAlphaReference / 255.0f;
+            float coverage = _Coverage(top, 1.0f, reference);
+
+            List<PixelBitmapContent<Vector4>> levels = new List<PixelBitmapContent<Vector4>>();
+            levels.Add(top);
+            while (top.Width > 1 || top.Height > 1)
+            {
+                top = _Downsample(top);
+                if (mUsage == SiatTextureUsage.AlphaTest && !bOpaque)
+                {
+                    _PreserveCoverage(top, coverage, reference, bBinaryAlpha);
+                }
+                levels.Add(top);
+            }
+            #endregion
+
+            #region Compress
+            int format;
+            switch (mUsage)
+            {
+                case SiatTextureUsage.Normal:
+                    format = kDxt5;
+                    foreach (PixelBitmapContent<Vector4> e in levels)
+                    {
+                        for (int y = 0; y < e.Height; y++)
+                        {
+                            for (int x = 0; x < e.Width; x++)
+                            {
+                                Vector4 v = e.GetPixel(x, y);
+                                e.SetPixel(x, y, new Vector4(0.0f, v.Y, 0.0f, v.X));
+                            }
+                        }
+                    }
+                    break;
+                case SiatTextureUsage.AlphaTest:
+                    format = (bOpaque || bBinaryAlpha) ? kDxt1 : kDxt5;
+                    break;
+                default:
+                    format = (bOpaque) ? kDxt1 : kDxt5;
+                    break;
+            }
+
+            Texture2DContent ret = new Texture2DContent();
+            ret.Identity = aInput.Identity;
+            ret.Name = aInput.Name;
+            foreach (PixelBitmapContent<Vector4> e in levels) { ret.Mipmaps.Add(e); }
+            ret.ConvertBitmapType((format == kDxt1) ? typeof(Dxt1BitmapContent) : typeof(Dxt5BitmapContent));
+            #endregion
+
+            if (cacheFilename != null)
+            {
+                try
+                {
+                    _WriteCache(cacheFilename, format, ret);
+                }
+                catch (IOException e)
+                {
+                    aContext.Logger.LogImportantMessage("Texture cache entry \"" + cacheFilename + "\" could not be written: " + e.Message);
+                }
+            }
+
+            return ret;
+        }
+
+        /// <summary>
+        /// Selects compressed format and mip filtering.
+        /// </summary>
+        [DefaultValue(typeof(SiatTextureUsage), "Color")]
+        public SiatTextureUsage Usage { get { return mUsage; } set { mUsage = value; } }
+
+        /// <summary>
+        /// Alpha test reference for AlphaTest textures, matches OPAQUE_OF_TRANSPARENCY in collada_effect_common.h.
+        /// </summary>
+        [DefaultValue(typeof(byte), "127")]
+        public byte AlphaReference { get { return mAlphaReference; } set { mAlphaReference = value; } }
+
+        /// <summary>
+        /// If true, processed textures are cached in the intermediate directory between builds.
+        /// </summary>
+        [DefaultValue(typeof(bool), "true")]
+        public bool Cache { get { return mbCache; } set { mbCache = value; } }
+    }
+}
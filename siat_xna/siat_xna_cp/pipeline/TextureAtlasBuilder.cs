@@ -0,0 +1,227 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using Microsoft.Xna.Framework;
+using Microsoft.Xna.Framework.Content.Pipeline.Graphics;
+using Microsoft.Xna.Framework.Graphics;
+using System;
+using System.Collections.Generic;
+using System.IO;
+
+namespace siat.pipeline
+{
+    /// <summary>
+    /// Packs textures into square atlases with padded borders.
+    /// </summary>
+    /// <remarks>
+    /// Entries are shelf packed tallest first. Each entry is surrounded by Padding texels filled
+    /// to match its address mode: edge texels are extended for clamped axes and the opposite edge
+    /// is repeated for wrapped axes. Filtering and the first few mips then sample the same values
+    /// they would have sampled from the original texture.
+    /// 
+    /// Atlases are written as uncompressed 32-bit TGA files so they can be built by the content
+    /// pipeline like any other texture.
+    /// </remarks>
+    public sealed class TextureAtlasBuilder
+    {
+        public const int kTgaHeaderSize = 18;
+
+        public sealed class Entry
+        {
+            public Entry(PixelBitmapContent<Color> aBitmap, bool abWrapU, bool abWrapV)
+            {
+                Bitmap = aBitmap;
+                bWrapU = abWrapU;
+                bWrapV = abWrapV;
+            }
+
+            public readonly PixelBitmapContent<Color> Bitmap;
+            public readonly bool bWrapU;
+            public readonly bool bWrapV;
+
+            /// <summary>
+            /// Index of the atlas containing this entry, set by Pack().
+            /// </summary>
+            public int Atlas = -1;
+            public int X = 0;
+            public int Y = 0;
+
+            /// <summary>
+            /// Remaps a texture coordinate of the original texture into the atlas.
+            /// </summary>
+            public Vector2 Remap(Vector2 aUV, int aAtlasSize)
+            {
+                float s = 1.0f / (float)aAtlasSize;
+
+                return new Vector2(
+                    ((float)X + (aUV.X * (float)Bitmap.Width)) * s,
+                    ((float)Y + (aUV.Y * (float)Bitmap.Height)) * s);
+            }
+        }
+
+        #region Private members
+        private readonly int mSize;
+        private readonly int mPadding;
+        private List<Entry> mEntries = new List<Entry>();
+        private List<int> mAtlasEntryCounts = new List<int>();
+
+        private static int _Wrap(int a, int aSize, bool abWrap)
+        {
+            if (abWrap) { return ((a % aSize) + aSize) % aSize; }
+            else { return Math.Max(0, Math.Min(a, aSize - 1)); }
+        }
+
+        private static int _Compare(Entry a, Entry b)
+        {
+            return b.Bitmap.Height.CompareTo(a.Bitmap.Height);
+        }
+        #endregion
+
+        public TextureAtlasBuilder(int aSize, int aPadding)
+        {
+            mSize = aSize;
+            mPadding = aPadding;
+        }
+
+        public int AtlasCount { get { return mAtlasEntryCounts.Count; } }
+        public List<Entry> Entries { get { return mEntries; } }
+        public int Padding { get { return mPadding; } }
+        public int Size { get { return mSize; } }
+
+        /// <summary>
+        /// True if a bitmap of the given size fits in an atlas with its padding.
+        /// </summary>
+        public bool Fits(int aWidth, int aHeight)
+        {
+            return ((aWidth + 2 * mPadding) <= mSize && (aHeight + 2 * mPadding) <= mSize);
+        }
+
+        public Entry Add(PixelBitmapContent<Color> aBitmap, bool abWrapU, bool abWrapV)
+        {
+            if (!Fits(aBitmap.Width, aBitmap.Height))
+            {
+                throw new ArgumentOutOfRangeException("aBitmap", "Texture does not fit in an atlas.");
+            }
+
+            Entry ret = new Entry(aBitmap, abWrapU, abWrapV);
+            mEntries.Add(ret);
+
+            return ret;
+        }
+
+        /// <returns>The number of entries placed in atlas aIndex.</returns>
+        public int GetEntryCount(int aIndex)
+        {
+            return mAtlasEntryCounts[aIndex];
+        }
+
+        /// <summary>
+        /// Assigns every entry an atlas and position.
+        /// </summary>
+        public void Pack()
+        {
+            List<Entry> sorted = new List<Entry>(mEntries);
+            sorted.Sort(_Compare);
+
+            mAtlasEntryCounts.Clear();
+
+            int atlas = -1;
+            int x = mSize;
+            int y = 0;
+            int shelfHeight = 0;
+
+            foreach (Entry e in sorted)
+            {
+                int w = e.Bitmap.Width + 2 * mPadding;
+                int h = e.Bitmap.Height + 2 * mPadding;
+
+                if (x + w > mSize)
+                {
+                    x = 0;
+                    y += shelfHeight;
+                    shelfHeight = 0;
+                }
+
+                if (atlas < 0 || y + h > mSize)
+                {
+                    atlas++;
+                    mAtlasEntryCounts.Add(0);
+                    x = 0;
+                    y = 0;
+                    shelfHeight = 0;
+                }
+
+                e.Atlas = atlas;
+                e.X = x + mPadding;
+                e.Y = y + mPadding;
+                mAtlasEntryCounts[atlas]++;
+
+                x += w;
+                shelfHeight = Math.Max(shelfHeight, h);
+            }
+        }
+
+        /// <summary>
+        /// Writes atlas aIndex with its entries and their padding as a 32-bit TGA file.
+        /// </summary>
+        public void Write(int aIndex, string aFilename)
+        {
+            byte[] data = new byte[kTgaHeaderSize + (mSize * mSize * 4)];
+
+            data[2] = 2; // uncompressed true color
+            data[12] = (byte)(mSize & 0xFF);
+            data[13] = (byte)(mSize >> 8);
+            data[14] = (byte)(mSize & 0xFF);
+            data[15] = (byte)(mSize >> 8);
+            data[16] = 32;
+            data[17] = 0x28; // top-left origin, 8 alpha bits
+
+            foreach (Entry e in mEntries)
+            {
+                if (e.Atlas != aIndex) { continue; }
+
+                int width = e.Bitmap.Width;
+                int height = e.Bitmap.Height;
+
+                for (int y = -mPadding; y < height + mPadding; y++)
+                {
+                    int sy = _Wrap(y, height, e.bWrapV);
+                    int o = kTgaHeaderSize + ((((e.Y + y) * mSize) + (e.X - mPadding)) * 4);
+
+                    for (int x = -mPadding; x < width + mPadding; x++)
+                    {
+                        Color c = e.Bitmap.GetPixel(_Wrap(x, width, e.bWrapU), sy);
+
+                        data[o + 0] = c.B;
+                        data[o + 1] = c.G;
+                        data[o + 2] = c.R;
+                        data[o + 3] = c.A;
+                        o += 4;
+                    }
+                }
+            }
+
+            Directory.CreateDirectory(Path.GetDirectoryName(aFilename));
+            File.WriteAllBytes(aFilename, data);
+        }
+    }
+}
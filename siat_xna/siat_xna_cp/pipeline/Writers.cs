@@ -59,7 +59,15 @@ namespace siat.pipeline
         protected override void Write(ContentWriter aOut, AnimationContent aAnimation)
         {
             aOut.Write(aAnimation.Id);
-            aOut.WriteObject(aAnimation.KeyFrames);
+            aOut.Write(aAnimation.Compressed != null);
+            if (aAnimation.Compressed != null)
+            {
+                aOut.WriteObject(aAnimation.Compressed);
+            }
+            else
+            {
+                aOut.WriteObject(aAnimation.KeyFrames);
+            }
         }
 
         public override string GetRuntimeReader(TargetPlatform targetPlatform)
@@ -73,6 +81,41 @@ namespace siat.pipeline
         }
     }
 
+    [ContentTypeWriter]
+    public sealed class CompressedAnimationWriter : ContentTypeWriter<CompressedAnimation>
+    {
+        private static void _WriteTrack(ContentWriter aOut, AnimationTrack aTrack)
+        {
+            aOut.Write(aTrack.Components);
+            aOut.Write(aTrack.Min);
+            aOut.Write(aTrack.Extent);
+
+            aOut.Write(aTrack.Frames.Length);
+            foreach (ushort e in aTrack.Frames) { aOut.Write(e); }
+            foreach (ushort e in aTrack.Values) { aOut.Write(e); }
+        }
+
+        protected override void Write(ContentWriter aOut, CompressedAnimation aAnimation)
+        {
+            aOut.Write(aAnimation.Times.Length);
+            foreach (float e in aAnimation.Times) { aOut.Write(e); }
+
+            _WriteTrack(aOut, aAnimation.Rotation);
+            _WriteTrack(aOut, aAnimation.Translation);
+            _WriteTrack(aOut, aAnimation.Scale);
+        }
+
+        public override string GetRuntimeReader(TargetPlatform targetPlatform)
+        {
+            return "siat.CompressedAnimationReader, siat_xna_engine, Version=1.0.0.0, Culture=neutral";
+        }
+
+        public override string GetRuntimeType(TargetPlatform targetPlatform)
+        {
+            return "siat.CompressedAnimation, siat, Version=1.0.0.0, Culture=neutral";
+        }
+    }
+
     [ContentTypeWriter]
     public sealed class EffectWriter : ContentTypeWriter<SiatEffectContent>
     {
@@ -198,12 +241,51 @@ namespace siat.pipeline
     public sealed class SceneWriter : ContentTypeWriter<SceneContent>
     {
         #region Private members
+        private Dictionary<SiatMeshContent.Part, int> mPackIndices = null;
+
+        private static SiatMeshContent.Part _GetMeshPart(SceneNodeContent aNode)
+        {
+            switch (aNode.Type)
+            {
+                case SceneNodeType.AnimatedMeshPart: return ((AnimatedMeshPartSceneNodeContent)aNode).MeshPart;
+                case SceneNodeType.MeshPart: return ((MeshPartSceneNodeContent)aNode).MeshPart;
+                case SceneNodeType.Sky: return ((SkySceneNodeContent)aNode).MeshPart;
+                default: return null;
+            }
+        }
+
+        private void _WriteMeshPack(ContentWriter aOut, SceneContent aContent)
+        {
+            List<SiatMeshContent.Part> parts = new List<SiatMeshContent.Part>();
+            mPackIndices = new Dictionary<SiatMeshContent.Part, int>();
+
+            foreach (SceneNodeContent e in aContent.Nodes)
+            {
+                SiatMeshContent.Part part = _GetMeshPart(e);
+                if (part != null && !mPackIndices.ContainsKey(part))
+                {
+                    mPackIndices.Add(part, parts.Count);
+                    parts.Add(part);
+                }
+            }
+
+            byte[] pack = MeshPackBuilder.Build(parts);
+            aOut.Write(pack.Length);
+            aOut.Write(pack);
+        }
+
+        private void _WriteMeshPartResource(ContentWriter aOut, SiatMeshContent.Part aPart)
+        {
+            if (mPackIndices != null) { aOut.Write(mPackIndices[aPart]); }
+            else { aOut.WriteSharedResource<SiatMeshContent.Part>(aPart); }
+        }
+
         private void _WriteAnimatedMeshPart(ContentWriter aOut, AnimatedMeshPartSceneNodeContent aNode)
         {
             _WriteSceneNode(aOut, aNode);
             aOut.WriteSharedResource<SiatEffectContent>(aNode.Effect);
             aOut.WriteSharedResource<SiatMaterialContent>(aNode.Material);
-            aOut.WriteSharedResource<SiatMeshContent.Part>(aNode.MeshPart);
+            _WriteMeshPartResource(aOut, aNode.MeshPart);
             aOut.Write(aNode.BindMatrix);
             aOut.WriteObject<Matrix[]>(aNode.InverseBindTransforms);
             aOut.Write(aNode.RootJoint);
@@ -236,7 +318,7 @@ namespace siat.pipeline
             _WriteSceneNode(aOut, aNode);
             aOut.WriteSharedResource<SiatEffectContent>(aNode.Effect);
             aOut.WriteSharedResource<SiatMaterialContent>(aNode.Material);
-            aOut.WriteSharedResource<SiatMeshContent.Part>(aNode.MeshPart);
+            _WriteMeshPartResource(aOut, aNode.MeshPart);
         }
 
         private void _WritePhysics(ContentWriter aOut, PhysicsSceneNodeContent aNode)
@@ -273,7 +355,7 @@ namespace siat.pipeline
             _WriteSceneNode(aOut, aNode);
             aOut.WriteSharedResource<SiatEffectContent>(aNode.Effect);
             aOut.WriteSharedResource<SiatMaterialContent>(aNode.Material);
-            aOut.WriteSharedResource<SiatMeshContent.Part>(aNode.MeshPart);
+            _WriteMeshPartResource(aOut, aNode.MeshPart);
         }
 
         private void _WriteSpotLight(ContentWriter aOut, SpotLightSceneNodeContent aNode)
@@ -290,6 +372,10 @@ namespace siat.pipeline
         #region Protected members
         protected override void Write(ContentWriter aOut, SceneContent aContent)
         {
+            aOut.Write(aContent.bPackMeshes);
+            if (aContent.bPackMeshes) { _WriteMeshPack(aOut, aContent); }
+            else { mPackIndices = null; }
+
             foreach (SceneNodeContent e in aContent.Nodes)
             {
                 switch (e.Type)
@@ -309,6 +395,8 @@ namespace siat.pipeline
                         throw new Exception(Utilities.kShouldNotBeHere);
                 }
             }
+
+            mPackIndices = null;
         }
         #endregion
 
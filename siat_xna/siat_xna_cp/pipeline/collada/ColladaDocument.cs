@@ -120,8 +120,9 @@ namespace siat.pipeline.collada
             ret.CheckCharacters = true;
             ret.ConformanceLevel = ConformanceLevel.Document;
             ret.ProhibitDtd = true;
-            ret.ValidationFlags |= System.Xml.Schema.XmlSchemaValidationFlags.ReportValidationWarnings;
-            ret.ValidationType = ValidationType.Schema;
+            // No schemas are added, so schema validation only added overhead. It also hides
+            // ReadValueChunk(), which ColladaNumberParser uses to stream large arrays.
+            ret.ValidationType = ValidationType.None;
 
             return ret;
         }
@@ -390,6 +391,7 @@ namespace siat.pipeline.collada
             msToLoad.Clear();
             msToResolveIds.Clear();
             msToResolveSids.Clear();
+            ColladaNumberParser.CloseFiles();
         }
 
         public static string CurrentBase { get { return msCurrentBase; } }
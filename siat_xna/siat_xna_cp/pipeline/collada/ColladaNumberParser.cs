@@ -0,0 +1,645 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Xml;
+
+namespace siat.pipeline.collada
+{
+    /// <summary>
+    /// Parses the whitespace separated numbers of COLLADA array elements straight into typed arrays.
+    /// </summary>
+    /// <remarks>
+    /// Text is read in chunks with XmlReader.ReadValueChunk(), so a large element is never held
+    /// as one string, and numbers are parsed from the chunk without a string per token. Tokens
+    /// that the fast path does not handle (INF, NaN, very large exponents, malformed values) are
+    /// passed to XmlConvert, so results and errors match XmlConvert.
+    ///
+    /// Arrays of at least DeferThreshold values can be deferred: the element is skipped at load
+    /// and only its location in the file is kept. Read(Location, ...) decodes it from the file
+    /// on first use. Deferred reads of one file share an open cursor that only moves forward, so
+    /// reads in document order scan the file once. CloseFiles() releases the cursors.
+    /// </remarks>
+    public static class ColladaNumberParser
+    {
+        public const int kChunkSize = (1 << 14);
+        public const int kDefaultDeferThreshold = (1 << 14);
+        public const int kMaxDigits = 18;
+
+        /// <summary>
+        /// Location of a deferred array element in its file.
+        /// </summary>
+        public sealed class Location
+        {
+            public readonly string File;
+            public readonly string Element;
+            public readonly int Line;
+            public readonly int Position;
+
+            public Location(string aFile, string aElement, int aLine, int aPosition)
+            {
+                File = aFile;
+                Element = aElement;
+                Line = aLine;
+                Position = aPosition;
+            }
+        }
+
+        #region Private members
+        private static readonly double[] kPowersOf10 = new double[]
+            {
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+            };
+
+        /// <summary>
+        /// Reads a text file forward, tracking line and position as XmlTextReader counts them.
+        /// </summary>
+        private sealed class FileCursor : IDisposable
+        {
+            private StreamReader mReader;
+            private char[] mBuffer = new char[kChunkSize];
+            private int mBegin = 0;
+            private int mEnd = 0;
+            private bool mbCarriageReturn = false;
+
+            public int Line = 1;
+            public int Position = 1;
+
+            public FileCursor(string aFile)
+            {
+                mReader = new StreamReader(aFile);
+            }
+
+            public void Dispose()
+            {
+                if (mReader != null) { mReader.Close(); mReader = null; }
+            }
+
+            public int Peek()
+            {
+                if (mBegin == mEnd)
+                {
+                    mBegin = 0;
+                    mEnd = mReader.Read(mBuffer, 0, mBuffer.Length);
+                    if (mEnd <= 0) { mEnd = 0; return -1; }
+                }
+
+                return mBuffer[mBegin];
+            }
+
+            public int Read()
+            {
+                int c = Peek();
+                if (c < 0) { return c; }
+                mBegin++;
+
+                if (c == '\r') { Line++; Position = 1; mbCarriageReturn = true; }
+                else if (c == '\n')
+                {
+                    if (!mbCarriageReturn) { Line++; Position = 1; }
+                    mbCarriageReturn = false;
+                }
+                else { Position++; mbCarriageReturn = false; }
+
+                return c;
+            }
+
+            /// <summary>
+            /// Reads up to aCount characters of element content, stopping before the next '<'.
+            /// </summary>
+            public int ReadContent(char[] aBuffer, int aIndex, int aCount)
+            {
+                int ret = 0;
+                while (ret < aCount)
+                {
+                    int c = Peek();
+                    if (c < 0 || c == '<') { break; }
+
+                    aBuffer[aIndex + ret] = (char)Read();
+                    ret++;
+                }
+
+                return ret;
+            }
+
+            public bool IsBefore(int aLine, int aPosition)
+            {
+                return (Line < aLine || (Line == aLine && Position <= aPosition));
+            }
+
+            /// <summary>
+            /// Moves to the content of the element at aLocation. Returns false if the element is
+            /// empty.
+            /// </summary>
+            public bool Seek(Location aLocation)
+            {
+                while (Line < aLocation.Line || (Line == aLocation.Line && Position < aLocation.Position))
+                {
+                    if (Read() < 0) { break; }
+                }
+
+                if (Line != aLocation.Line || Position != aLocation.Position)
+                {
+                    throw new Exception("Could not find <" + aLocation.Element + "> at line " + aLocation.Line.ToString() + ", position " + aLocation.Position.ToString() + " of \"" + aLocation.File + "\".");
+                }
+
+                if (Peek() == '<') { Read(); }
+
+                string name = aLocation.Element;
+                for (int i = 0; i < name.Length; i++)
+                {
+                    if (Read() != name[i])
+                    {
+                        throw new Exception("Expected <" + name + "> at line " + aLocation.Line.ToString() + ", position " + aLocation.Position.ToString() + " of \"" + aLocation.File + "\". The file may have changed since it was loaded.");
+                    }
+                }
+
+                // Skip attributes to the end of the start tag. Attribute values may contain '>'.
+                int quote = -1;
+                int previous = -1;
+                while (true)
+                {
+                    int c = Read();
+                    if (c < 0) { throw new Exception("Unexpected end of \"" + aLocation.File + "\"."); }
+
+                    if (quote >= 0) { if (c == quote) { quote = -1; } }
+                    else if (c == '"' || c == '\'') { quote = c; }
+                    else if (c == '>') { return (previous != '/'); }
+
+                    previous = c;
+                }
+            }
+        }
+
+        /// <summary>
+        /// Splits text read from an XmlReader, a string, or a FileCursor into tokens.
+        /// </summary>
+        private sealed class Scanner
+        {
+            public char[] Buffer = new char[kChunkSize];
+
+            private int mBegin = 0;
+            private int mEnd = 0;
+            private bool mbEnd = false;
+            private XmlReader mReader = null;
+            private string mText = null;
+            private int mTextPosition = 0;
+            private FileCursor mCursor = null;
+
+            private static bool _IsSpace(char c)
+            {
+                return (c == ' ' || c == '\n' || c == '\r' || c == '\t');
+            }
+
+            private int _Fill(int aIndex)
+            {
+                int count = (Buffer.Length - aIndex);
+
+                if (mReader != null) { return mReader.ReadValueChunk(Buffer, aIndex, count); }
+                else if (mText != null)
+                {
+                    count = Math.Min(count, mText.Length - mTextPosition);
+                    mText.CopyTo(mTextPosition, Buffer, aIndex, count);
+                    mTextPosition += count;
+                    return count;
+                }
+                else if (mCursor != null) { return mCursor.ReadContent(Buffer, aIndex, count); }
+                else { return 0; }
+            }
+
+            private bool _Refill()
+            {
+                mBegin = 0;
+                mEnd = 0;
+                if (mbEnd) { return false; }
+
+                int count = _Fill(0);
+                if (count <= 0) { mbEnd = true; return false; }
+                mEnd = count;
+
+                return true;
+            }
+
+            public void Begin(XmlReader aReader)
+            {
+                mBegin = 0;
+                mEnd = 0;
+                mbEnd = false;
+                mReader = null;
+                mText = null;
+                mTextPosition = 0;
+                mCursor = null;
+
+                if (aReader.NodeType != XmlNodeType.Text) { mbEnd = true; }
+                else if (aReader.CanReadValueChunk) { mReader = aReader; }
+                else { mText = aReader.Value; }
+            }
+
+            public void Begin(FileCursor aCursor)
+            {
+                mBegin = 0;
+                mEnd = 0;
+                mbEnd = false;
+                mReader = null;
+                mText = null;
+                mTextPosition = 0;
+                mCursor = aCursor;
+            }
+
+            public void End()
+            {
+                mReader = null;
+                mText = null;
+                mCursor = null;
+            }
+
+            /// <summary>
+            /// Returns false at the end of the text. Otherwise, the next token is
+            /// Buffer[arStart, arStart + arLength).
+            /// </summary>
+            public bool Next(out int arStart, out int arLength)
+            {
+                arStart = 0;
+                arLength = 0;
+
+                while (true)
+                {
+                    while (mBegin < mEnd && _IsSpace(Buffer[mBegin])) { mBegin++; }
+                    if (mBegin < mEnd) { break; }
+                    if (!_Refill()) { return false; }
+                }
+
+                int i = mBegin;
+                while (true)
+                {
+                    while (i < mEnd && !_IsSpace(Buffer[i])) { i++; }
+                    if (i < mEnd || mbEnd) { break; }
+
+                    // The token continues past the chunk, move it to the front and read more.
+                    int length = (i - mBegin);
+                    if (length == Buffer.Length) { throw new Exception("A number token is longer than " + Buffer.Length.ToString() + " characters."); }
+
+                    Array.Copy(Buffer, mBegin, Buffer, 0, length);
+                    mBegin = 0;
+                    mEnd = length;
+                    i = length;
+
+                    int count = _Fill(mEnd);
+                    if (count <= 0) { mbEnd = true; }
+                    else { mEnd += count; }
+                }
+
+                arStart = mBegin;
+                arLength = (i - mBegin);
+                mBegin = i;
+
+                return true;
+            }
+        }
+
+        private static readonly Dictionary<string, FileCursor> msFiles = new Dictionary<string, FileCursor>();
+        private static int msDeferThreshold = kDefaultDeferThreshold;
+
+        [ThreadStatic]
+        private static Scanner tsScanner;
+        [ThreadStatic]
+        private static int[] tsIntBuffer;
+
+        private static Scanner _GetScanner()
+        {
+            if (tsScanner == null) { tsScanner = new Scanner(); }
+            return tsScanner;
+        }
+
+        private static Exception _CountException()
+        {
+            return new Exception("Token count was not expected number.");
+        }
+
+        private static float _ParseFloat(char[] b, int aStart, int aLength)
+        {
+            int i = aStart;
+            int end = (aStart + aLength);
+
+            bool bNegative = (b[i] == '-');
+            if (bNegative || b[i] == '+') { i++; }
+
+            long mantissa = 0;
+            int digits = 0;
+            int exponent = 0;
+            bool bDigits = false;
+
+            for (; i < end; i++)
+            {
+                int d = (b[i] - '0');
+                if (d < 0 || d > 9) { break; }
+
+                bDigits = true;
+                if (digits < kMaxDigits) { mantissa = (mantissa * 10) + d; if (mantissa != 0) { digits++; } }
+                else { exponent++; }
+            }
+
+            if (i < end && b[i] == '.')
+            {
+                for (i++; i < end; i++)
+                {
+                    int d = (b[i] - '0');
+                    if (d < 0 || d > 9) { break; }
+
+                    bDigits = true;
+                    if (digits < kMaxDigits) { mantissa = (mantissa * 10) + d; if (mantissa != 0) { digits++; } exponent--; }
+                }
+            }
+
+            if (!bDigits) { return XmlConvert.ToSingle(new string(b, aStart, aLength)); }
+
+            if (i < end && (b[i] == 'e' || b[i] == 'E'))
+            {
+                i++;
+                bool bNegativeExponent = (i < end && b[i] == '-');
+                if (i < end && (bNegativeExponent || b[i] == '+')) { i++; }
+
+                int e = 0;
+                bool bExponentDigits = false;
+                for (; i < end; i++)
+                {
+                    int d = (b[i] - '0');
+                    if (d < 0 || d > 9) { break; }
+
+                    bExponentDigits = true;
+                    if (e < 100000) { e = (e * 10) + d; }
+                }
+
+                if (!bExponentDigits) { return XmlConvert.ToSingle(new string(b, aStart, aLength)); }
+                exponent += (bNegativeExponent) ? -e : e;
+            }
+
+            if (i != end || exponent < -(kPowersOf10.Length - 1) || exponent > (kPowersOf10.Length - 1))
+            {
+                return XmlConvert.ToSingle(new string(b, aStart, aLength));
+            }
+
+            double v = (double)mantissa;
+            if (exponent < 0) { v /= kPowersOf10[-exponent]; }
+            else if (exponent > 0) { v *= kPowersOf10[exponent]; }
+
+            return (float)((bNegative) ? -v : v);
+        }
+
+        private static long _ParseInteger(char[] b, int aStart, int aLength, bool abSigned)
+        {
+            int i = aStart;
+            int end = (aStart + aLength);
+
+            bool bNegative = (abSigned && b[i] == '-');
+            if (bNegative || b[i] == '+') { i++; }
+            if (i == end || (end - i) > 10) { return long.MinValue; }
+
+            long ret = 0;
+            for (; i < end; i++)
+            {
+                int d = (b[i] - '0');
+                if (d < 0 || d > 9) { return long.MinValue; }
+                ret = (ret * 10) + d;
+            }
+
+            return (bNegative) ? -ret : ret;
+        }
+
+        private static int _ParseInt(char[] b, int aStart, int aLength)
+        {
+            long v = _ParseInteger(b, aStart, aLength, true);
+            if (v < int.MinValue || v > int.MaxValue) { return XmlConvert.ToInt32(new string(b, aStart, aLength)); }
+
+            return (int)v;
+        }
+
+        private static uint _ParseUInt(char[] b, int aStart, int aLength)
+        {
+            long v = _ParseInteger(b, aStart, aLength, false);
+            if (v < uint.MinValue || v > uint.MaxValue) { return XmlConvert.ToUInt32(new string(b, aStart, aLength)); }
+
+            return (uint)v;
+        }
+
+        private static void _Read(Scanner s, float[] arOut)
+        {
+            int count = arOut.Length;
+            int start;
+            int length;
+
+            for (int i = 0; i < count; i++)
+            {
+                if (!s.Next(out start, out length)) { throw _CountException(); }
+                arOut[i] = _ParseFloat(s.Buffer, start, length);
+            }
+
+            if (s.Next(out start, out length)) { throw _CountException(); }
+        }
+
+        private static void _Read(Scanner s, int[] arOut)
+        {
+            int count = arOut.Length;
+            int start;
+            int length;
+
+            for (int i = 0; i < count; i++)
+            {
+                if (!s.Next(out start, out length)) { throw _CountException(); }
+                arOut[i] = _ParseInt(s.Buffer, start, length);
+            }
+
+            if (s.Next(out start, out length)) { throw _CountException(); }
+        }
+
+        private static FileCursor _GetCursor(Location aLocation)
+        {
+            FileCursor ret;
+            if (msFiles.TryGetValue(aLocation.File, out ret) && !ret.IsBefore(aLocation.Line, aLocation.Position))
+            {
+                ret.Dispose();
+                msFiles.Remove(aLocation.File);
+                ret = null;
+            }
+
+            if (ret == null)
+            {
+                ret = new FileCursor(aLocation.File);
+                msFiles.Add(aLocation.File, ret);
+            }
+
+            return ret;
+        }
+        #endregion
+
+        /// <summary>
+        /// Arrays with at least this many values are deferred by Defer(). 0 disables deferring.
+        /// </summary>
+        public static int DeferThreshold { get { return msDeferThreshold; } set { msDeferThreshold = Math.Max(value, 0); } }
+
+        /// <summary>
+        /// Closes the files kept open for deferred reads.
+        /// </summary>
+        public static void CloseFiles()
+        {
+            lock (msFiles)
+            {
+                foreach (FileCursor e in msFiles.Values) { e.Dispose(); }
+                msFiles.Clear();
+            }
+        }
+
+        /// <summary>
+        /// If an array element of aCount values at the current position of aReader should be
+        /// deferred, returns its location. Otherwise returns null.
+        /// </summary>
+        public static Location Defer(XmlReader aReader, uint aCount)
+        {
+            if (msDeferThreshold == 0 || aCount < msDeferThreshold) { return null; }
+
+            aReader.MoveToElement();
+            IXmlLineInfo info = (aReader as IXmlLineInfo);
+            string file = ColladaDocument.CurrentBase;
+
+            if (info == null || !info.HasLineInfo() || file == null || file.Length == 0) { return null; }
+
+            return new Location(file, aReader.Name, info.LineNumber, info.LinePosition);
+        }
+
+        /// <summary>
+        /// Parses the text node at the current position of aReader into arOut. The text must have
+        /// exactly arOut.Length values. If aReader is not on a text node, the text is empty.
+        /// </summary>
+        public static void Read(XmlReader aReader, float[] arOut)
+        {
+            Scanner s = _GetScanner();
+            s.Begin(aReader);
+            try { _Read(s, arOut); }
+            finally { s.End(); }
+        }
+
+        public static void Read(XmlReader aReader, int[] arOut)
+        {
+            Scanner s = _GetScanner();
+            s.Begin(aReader);
+            try { _Read(s, arOut); }
+            finally { s.End(); }
+        }
+
+        public static void Read(XmlReader aReader, uint[] arOut)
+        {
+            Scanner s = _GetScanner();
+            s.Begin(aReader);
+            try
+            {
+                int count = arOut.Length;
+                int start;
+                int length;
+
+                for (int i = 0; i < count; i++)
+                {
+                    if (!s.Next(out start, out length)) { throw _CountException(); }
+                    arOut[i] = _ParseUInt(s.Buffer, start, length);
+                }
+
+                if (s.Next(out start, out length)) { throw _CountException(); }
+            }
+            finally { s.End(); }
+        }
+
+        /// <summary>
+        /// Parses the text node at the current position of aReader into a new array sized to the
+        /// number of values.
+        /// </summary>
+        public static int[] ReadInts(XmlReader aReader)
+        {
+            if (tsIntBuffer == null) { tsIntBuffer = new int[kChunkSize]; }
+
+            Scanner s = _GetScanner();
+            s.Begin(aReader);
+            try
+            {
+                int count = 0;
+                int start;
+                int length;
+
+                while (s.Next(out start, out length))
+                {
+                    if (count == tsIntBuffer.Length) { Array.Resize(ref tsIntBuffer, tsIntBuffer.Length * 2); }
+                    tsIntBuffer[count++] = _ParseInt(s.Buffer, start, length);
+                }
+
+                int[] ret = new int[count];
+                Array.Copy(tsIntBuffer, ret, count);
+
+                return ret;
+            }
+            finally { s.End(); }
+        }
+
+        public static uint[] ReadUInts(XmlReader aReader)
+        {
+            int[] values = ReadInts(aReader);
+            uint[] ret = new uint[values.Length];
+
+            for (int i = 0; i < values.Length; i++)
+            {
+                if (values[i] < 0) { throw new Exception("\"" + values[i].ToString() + "\" is not a valid unsigned integer."); }
+                ret[i] = (uint)values[i];
+            }
+
+            return ret;
+        }
+
+        /// <summary>
+        /// Parses the deferred array element at aLocation into arOut.
+        /// </summary>
+        public static void Read(Location aLocation, float[] arOut)
+        {
+            lock (msFiles)
+            {
+                FileCursor cursor = _GetCursor(aLocation);
+
+                Scanner s = _GetScanner();
+                s.Begin((cursor.Seek(aLocation)) ? cursor : null);
+                try { _Read(s, arOut); }
+                finally { s.End(); }
+            }
+        }
+
+        public static void Read(Location aLocation, int[] arOut)
+        {
+            lock (msFiles)
+            {
+                FileCursor cursor = _GetCursor(aLocation);
+
+                Scanner s = _GetScanner();
+                s.Begin((cursor.Seek(aLocation)) ? cursor : null);
+                try { _Read(s, arOut); }
+                finally { s.End(); }
+            }
+        }
+    }
+}
@@ -119,11 +119,13 @@ namespace siat.pipeline.collada
         public const string kTransparency = "TRANSPARENCY";
 
         public const string kAlphaOne = "ALPHA_ONE";
+        public const string kBumpTextureXY = "BUMP_TEXTURE_XY";
         public const string kRgbZero = "RGB_ZERO";
 
         public const string kAnimated = "ANIMATED";
         public const string kBlinn = "BLINN";
         public const string kPhong = "PHONG";
+        public const string kPartialPrecision = "PARTIAL_PRECISION";
 
         public const string kTexcoordsInput = "Texcoords";
 
@@ -146,12 +148,53 @@ namespace siat.pipeline.collada
         public const string kTextureSemanticPostfix = "Texture";
 
         public const float kBlackTolerance = 0.05f;
+
+        public const string kAtlasDirectory = "siat_atlas";
+        public const int kAtlasPadding = 8;
+        public const int kMaxAtlasedTextureSize = 512;
+        public const float kAtlasTexcoordTolerance = 1e-3f;
         #endregion
 
+        /// <summary>
+        /// Time of one stage of Process(). Tasks of a parallel stage run on up to Threads threads.
+        /// </summary>
+        public struct StageTime
+        {
+            public string Name;
+            public int Tasks;
+            public int Threads;
+            public double WallTime;
+            public double TaskTime;
+
+            /// <summary>
+            /// Fraction of the wall time of the stage's threads spent in tasks, 1 is perfect scaling.
+            /// </summary>
+            public double Efficiency
+            {
+                get
+                {
+                    return (WallTime > 0.0) ? (TaskTime / (WallTime * Threads)) : 1.0;
+                }
+            }
+        }
+
         #region Private members
         private WeakRefContainer<string, JointSceneNodeContent> msJoints = new WeakRefContainer<string, JointSceneNodeContent>(string.Empty);
 
         private bool mbProcessPhysics = false;
+        private bool mbCompressAnimation = true;
+        private bool mbPackMeshes = true;
+        private bool mbProcessTextures = true;
+        private bool mbAtlasTextures = true;
+        private bool mbParallel = true;
+        private int mAtlasCount = 0;
+        private int mAtlasSize = 2048;
+        private Dictionary<SiatEffectContent, List<AtlasChannel>> mAtlasChannels = new Dictionary<SiatEffectContent, List<AtlasChannel>>();
+        private List<AtlasChannel> mEffectChannels = null;
+        private Dictionary<ExternalReference<TextureContent>, string> mTextureSources = new Dictionary<ExternalReference<TextureContent>, string>();
+        private float mAnimationTolerance = 1e-3f;
+        private int mAnimationMemory = 0;
+        private int mUncompressedAnimationMemory = 0;
         private string mBaseName = string.Empty;
         private ColladaContent mContent;
         private ContentProcessorContext mContext = null;
@@ -166,6 +209,12 @@ namespace siat.pipeline.collada
         private uint mTotalTexcoordChannels = 0;
         private Matrix mUpAxisTransform = Matrix.Identity;
         private Dictionary<VertexElement[], VertexElement[]> mVertexDeclarations = new Dictionary<VertexElement[], VertexElement[]>(new PipelineUtilities.VertexDeclarationComparer());
+        private Dictionary<string, SiatMeshContent> mPreparedMeshes = new Dictionary<string, SiatMeshContent>();
+        private List<PendingEffect> mPendingEffects = new List<PendingEffect>();
+        private List<StageTime> mStages = new List<StageTime>();
+        private PrecisionMode mPrecision = PrecisionMode.Auto;
+        private float mPartialPrecisionTolerance = ShadingPrecision.kDefaultTolerance;
+        private List<ShadingPrecision.Report> mPrecisionReports = new List<ShadingPrecision.Report>();
         private static readonly OpaqueDataDictionary mskTextureBuildParameters = new OpaqueDataDictionary();
 
         static ColladaProcessor()
@@ -176,6 +225,222 @@ namespace siat.pipeline.collada
             mskTextureBuildParameters.Add(kTextureFormatParameter, TextureProcessorOutputFormat.DxtCompressed);
         }
 
+        #region Parallel stages
+        private sealed class PendingEffect
+        {
+            public PendingEffect(SiatEffectContent aEffect, CompilerMacro[] aMacros)
+            {
+                Effect = aEffect;
+                Macros = aMacros;
+            }
+
+            public readonly SiatEffectContent Effect;
+            public readonly CompilerMacro[] Macros;
+        }
+
+        private delegate void StageTask(int aIndex);
+
+        private static double _ToMilliseconds(long aTicks)
+        {
+            return ((double)aTicks * 1000.0) / (double)Stopwatch.Frequency;
+        }
+
+        private void _AddStage(string aName, int aTasks, int aThreads, long aWallTicks, long aTaskTicks)
+        {
+            StageTime stage = new StageTime();
+            stage.Name = aName;
+            stage.Tasks = aTasks;
+            stage.Threads = aThreads;
+            stage.WallTime = _ToMilliseconds(aWallTicks);
+            stage.TaskTime = _ToMilliseconds(aTaskTicks);
+
+            mStages.Add(stage);
+        }
+
+        /// <summary>
+        /// Runs aTask for each index from 0 to aCount - 1, on WorkPool if abParallel and
+        /// ParallelProcessing are true, and records the stage time. Returns the exception thrown
+        /// by each task, or null.
+        /// </summary>
+        /// <remarks>
+        /// Tasks must only write to data owned by their index. Exceptions are returned instead of
+        /// thrown so callers can report them in index order, the same as a serial build.
+        /// </remarks>
+        private Exception[] _RunStage(string aName, int aCount, bool abParallel, StageTask aTask)
+        {
+            Exception[] errors = new Exception[aCount];
+            long[] taskTicks = new long[WorkPool.kMaxThreads];
+            long start = Stopwatch.GetTimestamp();
+
+            WorkItem item = delegate(int aIndex, int aThread)
+            {
+                long taskStart = Stopwatch.GetTimestamp();
+                try { aTask(aIndex); }
+                catch (Exception e) { errors[aIndex] = e; }
+                taskTicks[aThread] += (Stopwatch.GetTimestamp() - taskStart);
+            };
+
+            int threads = 1;
+            if (mbParallel && abParallel)
+            {
+                threads = Utilities.Clamp(WorkPool.ThreadCount, 1, Utilities.Max(aCount, 1));
+                WorkPool.For(aCount, item);
+            }
+            else
+            {
+                for (int i = 0; i < aCount; i++) { item(i, 0); }
+            }
+
+            long total = 0;
+            foreach (long e in taskTicks) { total += e; }
+            _AddStage(aName, aCount, threads, Stopwatch.GetTimestamp() - start, total);
+
+            return errors;
+        }
+
+        private static void _ThrowFirst(Exception[] aErrors)
+        {
+            foreach (Exception e in aErrors)
+            {
+                if (e != null) { throw e; }
+            }
+        }
+
+        private struct DeferredEntry : IComparable<DeferredEntry>
+        {
+            public DeferredEntry(ColladaNumberParser.Location aLocation, _ColladaElement aArray)
+            {
+                Location = aLocation;
+                Array = aArray;
+            }
+
+            public ColladaNumberParser.Location Location;
+            public _ColladaElement Array;
+
+            public int CompareTo(DeferredEntry b)
+            {
+                int ret = string.CompareOrdinal(Location.File, b.Location.File);
+                if (ret == 0) { ret = Location.Line.CompareTo(b.Location.Line); }
+                if (ret == 0) { ret = Location.Position.CompareTo(b.Location.Position); }
+
+                return ret;
+            }
+        };
+
+        /// <summary>
+        /// Decodes the deferred arrays of aGeometries serially, in file order.
+        /// </summary>
+        /// <remarks>
+        /// ColladaNumberParser reads a file forward under one lock and reopens it to go back.
+        /// If the arrays were decoded on first use by the parallel Geometry stage they would be
+        /// read out of order, rescanning the file for most arrays while the other tasks wait.
+        /// </remarks>
+        private void _LoadDeferredArrays(List<ColladaGeometry> aGeometries)
+        {
+            List<DeferredEntry> entries = new List<DeferredEntry>();
+            List<ColladaFloatArray> floats = new List<ColladaFloatArray>();
+            List<ColladaIntArray> ints = new List<ColladaIntArray>();
+
+            foreach (ColladaGeometry e in aGeometries)
+            {
+                e.GetAll<ColladaFloatArray>(floats);
+                e.GetAll<ColladaIntArray>(ints);
+            }
+
+            foreach (ColladaFloatArray e in floats)
+            {
+                if (e.bDeferred) { entries.Add(new DeferredEntry(e.DeferredLocation, e)); }
+            }
+            foreach (ColladaIntArray e in ints)
+            {
+                if (e.bDeferred) { entries.Add(new DeferredEntry(e.DeferredLocation, e)); }
+            }
+            entries.Sort();
+
+            // Errors are left for the Geometry stage, which reads the array again on first use
+            // and reports the error against its geometry.
+            _RunStage("Arrays", entries.Count, false, delegate(int i)
+                {
+                    ColladaFloatArray floatArray = entries[i].Array as ColladaFloatArray;
+                    if (floatArray != null) { floatArray.Load(); }
+                    else { ((ColladaIntArray)entries[i].Array).Load(); }
+                });
+        }
+
+        /// <summary>
+        /// Builds the meshes of all geometries instanced by <instance_geometry> in parallel before
+        /// the scene is walked. _GetMesh() takes them from mPreparedMeshes.
+        /// </summary>
+        /// <remarks>
+        /// Only work that depends on nothing but the geometry is done here. Vertex declarations
+        /// are shared by _ShareVertexDeclarations() when a mesh is first used, in scene order, so
+        /// the output is the same as when each mesh is built on first use. A geometry that fails
+        /// here is built again on first use, so its error is reported at the same point.
+        /// </remarks>
+        private void _PrepareMeshes(ColladaVisualScene aScene)
+        {
+            List<ColladaGeometry> geometries = new List<ColladaGeometry>();
+            Dictionary<string, bool> found = new Dictionary<string, bool>();
+
+            aScene.Apply<ColladaInstanceGeometry>(_ColladaElement.ApplyType.RecurseDown, _ColladaElement.ApplyStop.Delegate,
+                delegate(ColladaInstanceGeometry e)
+                {
+                    ColladaGeometry geometry = e.Instance;
+                    string geometryId = mBaseName + geometry.Id;
+
+                    if (geometry.IsMesh && !found.ContainsKey(geometryId) && !mContent.Meshes.ContainsKey(geometryId))
+                    {
+                        found.Add(geometryId, true);
+                        geometries.Add(geometry);
+                    }
+
+                    return false;
+                });
+
+            _LoadDeferredArrays(geometries);
+
+            SiatMeshContent[] meshes = new SiatMeshContent[geometries.Count];
+            Exception[] errors = _RunStage("Geometry", geometries.Count, true, delegate(int i)
+                {
+                    meshes[i] = _ProcessGeometry(geometries[i]);
+                });
+
+            for (int i = 0; i < meshes.Length; i++)
+            {
+                if (errors[i] == null) { mPreparedMeshes[mBaseName + geometries[i].Id] = meshes[i]; }
+            }
+        }
+
+        /// <summary>
+        /// Compiles the unique macro sets of the standard effect queued by
+        /// _ProcessProfileCOMMONEffect().
+        /// </summary>
+        private void _CompileEffects()
+        {
+            int count = mPendingEffects.Count;
+            CompiledEffect[] compiled = new CompiledEffect[count];
+
+            // Serial: the effect compiler is not documented to be safe to call from several
+            // threads at once.
+            Exception[] errors = _RunStage("Effects", count, false, delegate(int i)
+                {
+                    compiled[i] = Effect.CompileEffectFromFile(kStandardEffectFile, mPendingEffects[i].Macros, null, CompilerOptions.None, TargetPlatform.Windows);
+                });
+            _ThrowFirst(errors);
+
+            for (int i = 0; i < count; i++)
+            {
+                if (!compiled[i].Success)
+                {
+                    throw new Exception("Error: standard effect building failed, \"" + compiled[i].ErrorsAndWarnings + "\"");
+                }
+                mPendingEffects[i].Effect.CompiledEffect = compiled[i];
+            }
+
+            mPendingEffects.Clear();
+        }
+        #endregion
+
         #region Controller processing
         private struct IwEntry : IComparable<IwEntry>
         {
@@ -596,8 +861,18 @@ namespace siat.pipeline.collada
                 keyFrames[i].Key = mInverseUpAxisTransform * keyFrames[i].Key * mUpAxisTransform;
             }
 
+            CompressedAnimation compressed = (mbCompressAnimation) ? CompressedAnimation.Compress(keyFrames, mAnimationTolerance) : null;
+            if (mbCompressAnimation && compressed == null)
+            {
+                mContext.Logger.LogImportantMessage("Animation of <node> \"" + aNode.Id + "\" cannot be " +
+                    "decomposed into scale, rotation, and translation and will not be compressed.");
+            }
+
+            mUncompressedAnimationMemory += (int)keyFramesCount * AnimationKeyFrame.kSizeInBytes;
+            mAnimationMemory += (compressed != null) ? compressed.MemorySize : ((int)keyFramesCount * AnimationKeyFrame.kSizeInBytes);
+
             JointSceneNodeContent jointNode = new JointSceneNodeContent(mBaseName + aNode.Id, childrenCount,
-                ref aLocalTransform, new AnimationContent(animationId, keyFrames));
+                ref aLocalTransform, new AnimationContent(animationId, keyFrames, compressed));
 
             msJoints.Add(jointNode.Id, jointNode);
 
@@ -667,6 +942,15 @@ namespace siat.pipeline.collada
             return false;
         }
 
+        /// <summary>
+        /// Linear color used to estimate shading error, white for textures.
+        /// </summary>
+        private Vector3 _GetReferenceColor(_ColladaElement aColor)
+        {
+            if (aColor is ColladaColor) { return ((ColladaColor)aColor).ColorRGB; }
+            else { return Vector3.One; }
+        }
+
         private void _ProcessHLSLEffect(ColladaMaterial aMaterial, BoundEffect aBoundEffect, out SiatEffectContent arEffect, out SiatMaterialContent arMaterial)
         {
             #region Effect
@@ -720,19 +1004,7 @@ namespace siat.pipeline.collada
                         throw new Exception("<image> of texture as defined is not supported.");
                     }
 
-                    string assetName = Utilities.RemoveExtension(image.Location);
-                    string textureLocation = image.Location;
-                    ExternalReference<TextureContent> textureReference = null;
-
-                    if (!mTextureCache.TryGetValue(textureLocation, out textureReference))
-                    {
-                        textureReference = new ExternalReference<TextureContent>(textureLocation, mContent.Identity);
-                        if (mContext != null)
-                        {
-                            textureReference = mContext.BuildAsset<TextureContent, TextureContent>(textureReference, typeof(TextureProcessor).Name, mskTextureBuildParameters, null, null);
-                        }
-                        mTextureCache[textureLocation] = textureReference;
-                    }
+                    ExternalReference<TextureContent> textureReference = _BuildTexture(image.Location, SiatTextureUsage.Color);
 
                     arMaterial.Parameters.Add(new SiatMaterialContent.Parameter(p.Reference,
                         type, textureReference));
@@ -764,13 +1036,16 @@ namespace siat.pipeline.collada
         {
             List<CompilerMacro> macros = new List<CompilerMacro>();
             mTotalTexcoordChannels = 0;
+            mEffectChannels = new List<AtlasChannel>();
             collada.elements.fx.ColladaEffectOfProfileCOMMON effect = aMaterial.Effect.EffectCOMMON;
 
             SiatMaterialContent retMaterial = new SiatMaterialContent();
+            Vector3 referenceDiffuse = Vector3.Zero;
+            Vector3 referenceSpecular = Vector3.Zero;
 
             #region Bump map
             // can only be a texture.
-            _ProcessTexture(aBoundEffect, effect.Bump, kBumpPrefix, macros, kBumpSemanticPrefix, retMaterial);
+            _ProcessTexture(aBoundEffect, effect.Bump, kBumpPrefix, macros, kBumpSemanticPrefix, retMaterial, SiatTextureUsage.Normal);
             #endregion
 
             #region Emission
@@ -805,7 +1080,7 @@ namespace siat.pipeline.collada
             #region Transparency
             if (effect.TransparencyType == TransparencyTypes.AlphaOne)
             {
-                if (!_ProcessTexture(aBoundEffect, effect.Transparent, kTransparentPrefix, macros, kTransparentSemanticPrefix, retMaterial))
+                if (!_ProcessTexture(aBoundEffect, effect.Transparent, kTransparentPrefix, macros, kTransparentSemanticPrefix, retMaterial, SiatTextureUsage.AlphaTest))
                 {
                     Vector4 color = ((ColladaColor)effect.Transparent).ColorRGBA;
                     float transparency = effect.Transparency;
@@ -864,9 +1139,10 @@ namespace siat.pipeline.collada
                 {
                     _ProcessColor(effect.Ambient, kAmbientPrefix, macros, kAmbientSemanticPrefix, retMaterial);
                 }
-                if (!_ProcessTexture(aBoundEffect, effect.Diffuse, kDiffusePrefix, macros, kDiffuseSemanticPrefix, retMaterial))
+                if (_ProcessTexture(aBoundEffect, effect.Diffuse, kDiffusePrefix, macros, kDiffuseSemanticPrefix, retMaterial) ||
+                    _ProcessColor(effect.Diffuse, kDiffusePrefix, macros, kDiffuseSemanticPrefix, retMaterial))
                 {
-                    _ProcessColor(effect.Diffuse, kDiffusePrefix, macros, kDiffuseSemanticPrefix, retMaterial);
+                    referenceDiffuse = _GetReferenceColor(effect.Diffuse);
                 }
                 #endregion
 
@@ -890,6 +1166,7 @@ namespace siat.pipeline.collada
                         {
                             macros.Add(PipelineUtilities.NewMacro(kShininess, kShininessSemantic));
                             retMaterial.Parameters.Add(new SiatMaterialContent.Parameter(kShininessSemantic, ParameterType.kSingle, effect.Shininess));
+                            referenceSpecular = _GetReferenceColor(effect.Specular);
                         }
                     }
                     #endregion
@@ -906,6 +1183,23 @@ namespace siat.pipeline.collada
                     #endregion
                 }
             }
+
+            #region Precision
+            // The estimate runs in every mode so that the report always shows the error partial
+            // precision would have.
+            ShadingPrecision.Report report = new ShadingPrecision.Report();
+            report.Material = aMaterial.Id;
+            report.MaxError = ShadingPrecision.Estimate(referenceDiffuse, referenceSpecular, effect.Shininess, SiatTextureProcessor.kGamma);
+            report.bPartial = (mPrecision == PrecisionMode.Partial) ||
+                (mPrecision == PrecisionMode.Auto && report.MaxError <= mPartialPrecisionTolerance);
+            mPrecisionReports.Add(report);
+
+            if (report.bPartial)
+            {
+                macros.Add(PipelineUtilities.NewMacro(kPartialPrecision, "1"));
+            }
+            #endregion
+
             macros.Add(PipelineUtilities.NewMacro(kTexcoordsChannelCount, mTotalTexcoordChannels.ToString()));
 
             if (abAnimated)
@@ -929,17 +1223,14 @@ namespace siat.pipeline.collada
             }
             else
             {
-                #region Compile effect
-                CompiledEffect compiledEffect = Effect.CompileEffectFromFile(kStandardEffectFile, macros.ToArray(), null, CompilerOptions.None, TargetPlatform.Windows);
-                if (!compiledEffect.Success)
-                {
-                    throw new Exception("Error: standard effect building failed, \"" + compiledEffect.ErrorsAndWarnings + "\"");
-                }
-                retEffect.CompiledEffect = compiledEffect;
-                #endregion
+                // Compiled by _CompileEffects() once the scene has been walked.
+                mPendingEffects.Add(new PendingEffect(retEffect, macros.ToArray()));
                 mEffects[retEffect] = retEffect;
                 arEffect = retEffect;
             }
+
+            if (!mAtlasChannels.ContainsKey(arEffect)) { mAtlasChannels[arEffect] = mEffectChannels; }
+            mEffectChannels = null;
             #endregion
 
             if (mMaterials.ContainsKey(retMaterial))
@@ -953,7 +1244,40 @@ namespace siat.pipeline.collada
             }
         }
 
+        private ExternalReference<TextureContent> _BuildTexture(string aLocation, SiatTextureUsage aUsage)
+        {
+            string key = (mbProcessTextures) ? (aLocation + "#" + aUsage.ToString()) : aLocation;
+            ExternalReference<TextureContent> ret = null;
+
+            if (!mTextureCache.TryGetValue(key, out ret))
+            {
+                ret = new ExternalReference<TextureContent>(aLocation, mContent.Identity);
+                if (mContext != null)
+                {
+                    if (mbProcessTextures)
+                    {
+                        OpaqueDataDictionary parameters = new OpaqueDataDictionary();
+                        parameters.Add(SiatTextureProcessor.kUsageParameter, aUsage);
+                        ret = mContext.BuildAsset<TextureContent, TextureContent>(ret, typeof(SiatTextureProcessor).Name, parameters, null, null);
+                    }
+                    else
+                    {
+                        ret = mContext.BuildAsset<TextureContent, TextureContent>(ret, typeof(TextureProcessor).Name, mskTextureBuildParameters, null, null);
+                    }
+                }
+                mTextureCache[key] = ret;
+                mTextureSources[ret] = aLocation;
+            }
+
+            return ret;
+        }
+
         private bool _ProcessTexture(BoundEffect aBoundEffect, _ColladaElement aElement, string aPrefix, List<CompilerMacro> aMacros, string aSemanticPrefix, SiatMaterialContent aMaterial)
+        {
+            return _ProcessTexture(aBoundEffect, aElement, aPrefix, aMacros, aSemanticPrefix, aMaterial, SiatTextureUsage.Color);
+        }
+
+        private bool _ProcessTexture(BoundEffect aBoundEffect, _ColladaElement aElement, string aPrefix, List<CompilerMacro> aMacros, string aSemanticPrefix, SiatMaterialContent aMaterial, SiatTextureUsage aUsage)
         {
             if (aElement is _ColladaTexture)
             {
@@ -974,18 +1298,16 @@ namespace siat.pipeline.collada
                 }
                 mTotalTexcoordChannels = Utilities.Max(mTotalTexcoordChannels, (texCoordsIndex + 1u));
 
-                string assetName = Utilities.RemoveExtension(image.Location);
-                string textureLocation = image.Location;
-                ExternalReference<TextureContent> textureReference = null;
+                ExternalReference<TextureContent> textureReference = _BuildTexture(image.Location, aUsage);
 
-                if (!mTextureCache.TryGetValue(textureLocation, out textureReference))
+                if (mEffectChannels != null)
                 {
-                    textureReference = new ExternalReference<TextureContent>(textureLocation, mContent.Identity);
-                    if (mContext != null)
-                    {
-                        textureReference = mContext.BuildAsset<TextureContent, TextureContent>(textureReference, typeof(TextureProcessor).Name, mskTextureBuildParameters, null, null);
-                    }
-                    mTextureCache[textureLocation] = textureReference;
+                    mEffectChannels.Add(new AtlasChannel(aSemanticPrefix + kTextureSemanticPostfix, texCoordsIndex, texture.Sampler.WrapS, texture.Sampler.WrapT));
+                }
+
+                if (aUsage == SiatTextureUsage.Normal && mbProcessTextures && mContext != null)
+                {
+                    aMacros.Add(PipelineUtilities.NewMacro(kBumpTextureXY, "1"));
                 }
 
                 aMacros.Add(PipelineUtilities.NewMacro(aPrefix + kTexcoordsPostfix, kTexcoordsInput + texCoordsIndex.ToString()));
@@ -1203,6 +1525,26 @@ namespace siat.pipeline.collada
             return true;
         }
 
+        /// <summary>
+        /// Replaces the vertex declarations of aMesh with equal declarations already in use, so
+        /// parts with the same vertex format share one declaration and can combine.
+        /// </summary>
+        private void _ShareVertexDeclarations(SiatMeshContent aMesh)
+        {
+            foreach (SiatMeshContent.Part e in aMesh.Parts)
+            {
+                VertexElement[] declaration;
+                if (mVertexDeclarations.TryGetValue(e.VertexDeclaration, out declaration))
+                {
+                    e.VertexDeclaration = declaration;
+                }
+                else
+                {
+                    mVertexDeclarations[e.VertexDeclaration] = e.VertexDeclaration;
+                }
+            }
+        }
+
         private void _GetMeshAndMaterials(ColladaNode aNode, out SiatMeshContent arMesh,
             out MaterialsBySymbol arMaterials, out EffectsBySymbol arEffects,
             float[] aBoneIndices, float[] aBoneWeights)
@@ -1224,7 +1566,9 @@ namespace siat.pipeline.collada
 
             if (!mContent.Meshes.ContainsKey(geometryId))
             {
-                mContent.Meshes[geometryId] = _ProcessGeometry(geometry, aBoneIndices, aBoneWeights);
+                SiatMeshContent mesh = _ProcessGeometry(geometry, aBoneIndices, aBoneWeights);
+                _ShareVertexDeclarations(mesh);
+                mContent.Meshes[geometryId] = mesh;
             }
 
             arEffects = effectsBySymbol;
@@ -1239,7 +1583,12 @@ namespace siat.pipeline.collada
 
             if (!mContent.Meshes.ContainsKey(geometryId))
             {
-                mContent.Meshes[geometryId] = _ProcessGeometry(geometry);
+                SiatMeshContent mesh;
+                if (mPreparedMeshes.TryGetValue(geometryId, out mesh)) { mPreparedMeshes.Remove(geometryId); }
+                else { mesh = _ProcessGeometry(geometry); }
+
+                _ShareVertexDeclarations(mesh);
+                mContent.Meshes[geometryId] = mesh;
             }
 
             arMesh = mContent.Meshes[geometryId];
@@ -1430,15 +1779,6 @@ namespace siat.pipeline.collada
                 }
             }
 
-            if (mVertexDeclarations.ContainsKey(arOut.VertexDeclaration))
-            {
-                arOut.VertexDeclaration = mVertexDeclarations[arOut.VertexDeclaration];
-            }
-            else
-            {
-                mVertexDeclarations[arOut.VertexDeclaration] = arOut.VertexDeclaration;
-            }
-
             arOut.VertexStrideInSingles = (int)vertexStrideInSingles;
             #endregion
 
@@ -1556,6 +1896,396 @@ namespace siat.pipeline.collada
         }
         #endregion
 
+        #region Texture atlasing
+        private struct AtlasChannel
+        {
+            public AtlasChannel(string aSemantic, uint aTexcoordsIndex, _ColladaElement.Enums.SamplerWrap aWrapS, _ColladaElement.Enums.SamplerWrap aWrapT)
+            {
+                Semantic = aSemantic;
+                TexcoordsIndex = aTexcoordsIndex;
+                WrapS = aWrapS;
+                WrapT = aWrapT;
+            }
+
+            public string Semantic;
+            public uint TexcoordsIndex;
+            public _ColladaElement.Enums.SamplerWrap WrapS;
+            public _ColladaElement.Enums.SamplerWrap WrapT;
+        }
+
+        private sealed class AtlasCandidate
+        {
+            public int NodeIndex;
+            public AtlasChannel Channel;
+            public int TextureParameter;
+            public string Location;
+        }
+
+        private static bool _IsAtlasWrap(_ColladaElement.Enums.SamplerWrap aWrap)
+        {
+            return (aWrap == _ColladaElement.Enums.SamplerWrap.Clamp || aWrap == _ColladaElement.Enums.SamplerWrap.Wrap);
+        }
+
+        private static bool _IsColorTexture(string aSemantic)
+        {
+            return (aSemantic == kDiffuseSemanticPrefix + kTextureSemanticPostfix ||
+                    aSemantic == kAmbientSemanticPrefix + kTextureSemanticPostfix ||
+                    aSemantic == kEmissionSemanticPrefix + kTextureSemanticPostfix ||
+                    aSemantic == kSpecularSemanticPrefix + kTextureSemanticPostfix ||
+                    aSemantic == kReflectiveSemanticPrefix + kTextureSemanticPostfix);
+        }
+
+        private static int _GetTexcoordsOffset(SiatMeshContent.Part aPart, uint aTexcoordsIndex)
+        {
+            foreach (VertexElement e in aPart.VertexDeclaration)
+            {
+                if (e.VertexElementUsage == VertexElementUsage.TextureCoordinate && e.UsageIndex == aTexcoordsIndex)
+                {
+                    return (e.Offset / sizeof(float));
+                }
+            }
+
+            return -1;
+        }
+
+        private static int _CountDraws(List<SceneNodeContent> aNodes)
+        {
+            int ret = 0;
+            foreach (SceneNodeContent e in aNodes)
+            {
+                if (e is MeshPartSceneNodeContent || e is AnimatedMeshPartSceneNodeContent) { ret++; }
+            }
+
+            return ret;
+        }
+
+        /// <summary>
+        /// Returns true if aNode has a single color texture, sampled with clamp or wrap addressing
+        /// and with texture coordinates in [0, 1] so it can be remapped into an atlas.
+        /// </summary>
+        private bool _GetAtlasCandidate(int aNodeIndex, MeshPartSceneNodeContent aNode, out AtlasCandidate arCandidate)
+        {
+            arCandidate = null;
+
+            List<AtlasChannel> channels;
+            if (!mAtlasChannels.TryGetValue(aNode.Effect, out channels) || channels.Count != 1) { return false; }
+
+            AtlasChannel channel = channels[0];
+            if (!_IsColorTexture(channel.Semantic) || !_IsAtlasWrap(channel.WrapS) || !_IsAtlasWrap(channel.WrapT)) { return false; }
+
+            int textureParameter = -1;
+            for (int i = 0; i < aNode.Material.Parameters.Count; i++)
+            {
+                if (aNode.Material.Parameters[i].Type == ParameterType.kTexture)
+                {
+                    if (textureParameter >= 0) { return false; }
+                    textureParameter = i;
+                }
+            }
+            if (textureParameter < 0 || aNode.Material.Parameters[textureParameter].Semantic != channel.Semantic) { return false; }
+
+            string location;
+            if (!mTextureSources.TryGetValue((ExternalReference<TextureContent>)aNode.Material.Parameters[textureParameter].Value, out location)) { return false; }
+
+            SiatMeshContent.Part part = aNode.MeshPart;
+            int offset = _GetTexcoordsOffset(part, channel.TexcoordsIndex);
+            if (offset < 0) { return false; }
+
+            int stride = part.VertexStrideInSingles;
+            for (int i = 0; i < part.VertexCount; i++)
+            {
+                float u = part.Vertices[(i * stride) + offset + 0];
+                float v = part.Vertices[(i * stride) + offset + 1];
+
+                if (u < -kAtlasTexcoordTolerance || u > 1.0f + kAtlasTexcoordTolerance ||
+                    v < -kAtlasTexcoordTolerance || v > 1.0f + kAtlasTexcoordTolerance)
+                {
+                    return false;
+                }
+            }
+
+            arCandidate = new AtlasCandidate();
+            arCandidate.NodeIndex = aNodeIndex;
+            arCandidate.Channel = channel;
+            arCandidate.TextureParameter = textureParameter;
+            arCandidate.Location = location;
+
+            return true;
+        }
+
+        /// <summary>
+        /// Key of the meshes that could combine if their textures were the same: equal effect,
+        /// equal material except for the texture, and equal primitive type and vertex format.
+        /// Effects are keyed by their index in aEffects, assigned in order of first use. The index
+        /// is found by reference, since SiatEffectContent.Equals() only compares hashes.
+        /// </summary>
+        private static string _GetAtlasGroupKey(MeshPartSceneNodeContent aNode, int aTextureParameter, List<SiatEffectContent> aEffects)
+        {
+            int effect = -1;
+            for (int i = 0; i < aEffects.Count; i++)
+            {
+                if (object.ReferenceEquals(aEffects[i], aNode.Effect)) { effect = i; break; }
+            }
+            if (effect < 0)
+            {
+                effect = aEffects.Count;
+                aEffects.Add(aNode.Effect);
+            }
+
+            SiatMaterialContent material = new SiatMaterialContent();
+            for (int i = 0; i < aNode.Material.Parameters.Count; i++)
+            {
+                SiatMaterialContent.Parameter p = aNode.Material.Parameters[i];
+                material.Parameters.Add((i == aTextureParameter) ? new SiatMaterialContent.Parameter(p.Semantic, p.Type, null) : p);
+            }
+
+            string ret = effect.ToString() + "_" + material.ToString() + "_" + aNode.MeshPart.PrimitiveType.ToString();
+            foreach (VertexElement e in aNode.MeshPart.VertexDeclaration) { ret += "_" + e.ToString(); }
+
+            return ret;
+        }
+
+        private TextureContent _LoadAtlasTexture(string aLocation)
+        {
+            ExternalReference<TextureContent> source = new ExternalReference<TextureContent>(aLocation, mContent.Identity);
+            TextureContent texture = mContext.BuildAndLoadAsset<TextureContent, TextureContent>(source, typeof(PassThroughProcessor).Name);
+
+            if (!(texture is Texture2DContent)) { return null; }
+
+            BitmapContent bitmap = texture.Faces[0][0];
+            if (bitmap.Width > kMaxAtlasedTextureSize || bitmap.Height > kMaxAtlasedTextureSize) { return null; }
+
+            return texture;
+        }
+
+        /// <summary>
+        /// Loads the bitmap of each location of the candidates in aGroups.
+        /// </summary>
+        /// <remarks>
+        /// The content context is not thread-safe, so textures are loaded serially. Converting them
+        /// to PixelBitmapContent, which decompresses DXT sources, is done in parallel.
+        /// </remarks>
+        private Dictionary<string, PixelBitmapContent<Color>> _LoadAtlasBitmaps(Dictionary<string, List<AtlasCandidate>>.ValueCollection aGroups)
+        {
+            List<string> locations = new List<string>();
+            List<TextureContent> textures = new List<TextureContent>();
+            Dictionary<string, PixelBitmapContent<Color>> ret = new Dictionary<string, PixelBitmapContent<Color>>();
+
+            foreach (List<AtlasCandidate> group in aGroups)
+            {
+                foreach (AtlasCandidate e in group)
+                {
+                    if (!ret.ContainsKey(e.Location))
+                    {
+                        ret.Add(e.Location, null);
+                        locations.Add(e.Location);
+                        textures.Add(_LoadAtlasTexture(e.Location));
+                    }
+                }
+            }
+
+            _ThrowFirst(_RunStage("Textures", textures.Count, true, delegate(int i)
+                {
+                    if (textures[i] != null) { textures[i].ConvertBitmapType(typeof(PixelBitmapContent<Color>)); }
+                }));
+
+            for (int i = 0; i < locations.Count; i++)
+            {
+                if (textures[i] != null) { ret[locations[i]] = (PixelBitmapContent<Color>)textures[i].Faces[0][0]; }
+            }
+
+            return ret;
+        }
+
+        private void _RemapToAtlas(int aNodeIndex, AtlasCandidate aCandidate, TextureAtlasBuilder.Entry aEntry, int aAtlasSize, ExternalReference<TextureContent> aAtlas)
+        {
+            MeshPartSceneNodeContent node = (MeshPartSceneNodeContent)mScene.Nodes[aNodeIndex];
+
+            // Parts can be shared by several instances, so the remapped part is a copy.
+            SiatMeshContent.Part part = node.MeshPart.Clone(node.MeshPart.Id + "_atlas" + aNodeIndex.ToString());
+            int offset = _GetTexcoordsOffset(part, aCandidate.Channel.TexcoordsIndex);
+            int stride = part.VertexStrideInSingles;
+
+            for (int i = 0; i < part.VertexCount; i++)
+            {
+                int o = (i * stride) + offset;
+                Vector2 uv = new Vector2(
+                    MathHelper.Clamp(part.Vertices[o + 0], 0.0f, 1.0f),
+                    MathHelper.Clamp(part.Vertices[o + 1], 0.0f, 1.0f));
+                uv = aEntry.Remap(uv, aAtlasSize);
+
+                part.Vertices[o + 0] = uv.X;
+                part.Vertices[o + 1] = uv.Y;
+            }
+
+            SiatMaterialContent material = new SiatMaterialContent();
+            for (int i = 0; i < node.Material.Parameters.Count; i++)
+            {
+                SiatMaterialContent.Parameter p = node.Material.Parameters[i];
+                material.Parameters.Add((i == aCandidate.TextureParameter) ? new SiatMaterialContent.Parameter(p.Semantic, p.Type, aAtlas) : p);
+            }
+
+            if (mMaterials.ContainsKey(material)) { material = mMaterials[material]; }
+            else { mMaterials[material] = material; }
+
+            Matrix world = node.WorldTransform;
+            mScene.Nodes[aNodeIndex] = new MeshPartSceneNodeContent(node.Id, node.ChildrenCount, ref node.LocalTransform, ref world, node.Effect, material, part);
+        }
+
+        /// <summary>
+        /// Combines atlased mesh parts that now share a material, as _AddMeshPartSceneNode does
+        /// while the scene is built.
+        /// </summary>
+        private void _CombineAtlased(Dictionary<int, bool> aAtlased)
+        {
+            List<SceneNodeContent> nodes = mScene.Nodes;
+            int count = nodes.Count;
+
+            #region Find parents
+            int[] parents = new int[count];
+            int[] remaining = new int[count];
+            Stack<int> stack = new Stack<int>();
+
+            for (int i = 0; i < count; i++)
+            {
+                while (stack.Count > 0 && remaining[stack.Peek()] == 0) { stack.Pop(); }
+
+                parents[i] = (stack.Count > 0) ? stack.Peek() : -1;
+                if (stack.Count > 0) { remaining[stack.Peek()]--; }
+
+                remaining[i] = nodes[i].ChildrenCount;
+                stack.Push(i);
+            }
+            #endregion
+
+            List<MeshPartSceneNodeContent> kept = new List<MeshPartSceneNodeContent>();
+            List<SceneNodeContent> result = new List<SceneNodeContent>(count);
+
+            for (int i = 0; i < count; i++)
+            {
+                bool bRemoved = false;
+
+                if (aAtlased.ContainsKey(i) && nodes[i].ChildrenCount == 0)
+                {
+                    MeshPartSceneNodeContent node = (MeshPartSceneNodeContent)nodes[i];
+
+                    foreach (MeshPartSceneNodeContent e in kept)
+                    {
+                        if (_ShouldCombine(e, node) && _CombineMeshPart(e, node))
+                        {
+                            bRemoved = true;
+                            if (parents[i] >= 0) { nodes[parents[i]].ChildrenCount--; }
+                            break;
+                        }
+                    }
+
+                    if (!bRemoved) { kept.Add(node); }
+                }
+
+                if (!bRemoved) { result.Add(nodes[i]); }
+            }
+
+            mScene.Nodes.Clear();
+            mScene.Nodes.AddRange(result);
+        }
+
+        /// <summary>
+        /// Packs the textures of meshes that differ only by texture into atlases, remaps their
+        /// texture coordinates and combines them.
+        /// </summary>
+        /// <remarks>
+        /// Only meshes with a single color texture are atlased. Padding around each texture is
+        /// filled according to the channel's CLAMP or WRAP address mode. Wrapped textures are only
+        /// atlased if they do not tile (texture coordinates within [0, 1]), other address modes
+        /// are left alone.
+        /// </remarks>
+        private void _AtlasTextures()
+        {
+            int drawsBefore = _CountDraws(mScene.Nodes);
+            int atlasedTextures = 0;
+            int atlases = 0;
+
+            #region Group candidates
+            Dictionary<string, List<AtlasCandidate>> groups = new Dictionary<string, List<AtlasCandidate>>();
+            List<SiatEffectContent> effects = new List<SiatEffectContent>();
+
+            for (int i = 0; i < mScene.Nodes.Count; i++)
+            {
+                MeshPartSceneNodeContent node = mScene.Nodes[i] as MeshPartSceneNodeContent;
+                AtlasCandidate candidate;
+
+                if (node != null && _GetAtlasCandidate(i, node, out candidate))
+                {
+                    string key = _GetAtlasGroupKey(node, candidate.TextureParameter, effects);
+
+                    List<AtlasCandidate> group;
+                    if (!groups.TryGetValue(key, out group))
+                    {
+                        group = new List<AtlasCandidate>();
+                        groups.Add(key, group);
+                    }
+                    group.Add(candidate);
+                }
+            }
+            #endregion
+
+            Dictionary<string, PixelBitmapContent<Color>> bitmaps = _LoadAtlasBitmaps(groups.Values);
+            Dictionary<int, bool> atlased = new Dictionary<int, bool>();
+
+            foreach (List<AtlasCandidate> group in groups.Values)
+            {
+                TextureAtlasBuilder builder = new TextureAtlasBuilder(mAtlasSize, kAtlasPadding);
+                Dictionary<string, TextureAtlasBuilder.Entry> entries = new Dictionary<string, TextureAtlasBuilder.Entry>();
+
+                foreach (AtlasCandidate e in group)
+                {
+                    if (!entries.ContainsKey(e.Location))
+                    {
+                        PixelBitmapContent<Color> bitmap = bitmaps[e.Location];
+                        entries.Add(e.Location, (bitmap != null && builder.Fits(bitmap.Width, bitmap.Height))
+                            ? builder.Add(bitmap, e.Channel.WrapS == _ColladaElement.Enums.SamplerWrap.Wrap, e.Channel.WrapT == _ColladaElement.Enums.SamplerWrap.Wrap)
+                            : null);
+                    }
+                }
+
+                if (builder.Entries.Count < 2) { continue; }
+                builder.Pack();
+
+                ExternalReference<TextureContent>[] references = new ExternalReference<TextureContent>[builder.AtlasCount];
+                for (int i = 0; i < builder.AtlasCount; i++)
+                {
+                    // An atlas of one texture would not reduce draws.
+                    if (builder.GetEntryCount(i) < 2) { continue; }
+
+                    string filename = Path.Combine(Path.Combine(mContext.IntermediateDirectory, kAtlasDirectory), mBaseName + "atlas" + mAtlasCount.ToString() + ".tga");
+                    builder.Write(i, filename);
+                    references[i] = _BuildTexture(filename, SiatTextureUsage.Color);
+
+                    mAtlasCount++;
+                    atlases++;
+                    atlasedTextures += builder.GetEntryCount(i);
+                }
+
+                foreach (AtlasCandidate e in group)
+                {
+                    TextureAtlasBuilder.Entry entry = entries[e.Location];
+
+                    if (entry != null && references[entry.Atlas] != null)
+                    {
+                        _RemapToAtlas(e.NodeIndex, e, entry, builder.Size, references[entry.Atlas]);
+                        atlased[e.NodeIndex] = true;
+                    }
+                }
+            }
+
+            if (atlased.Count > 0) { _CombineAtlased(atlased); }
+
+            mContext.Logger.LogImportantMessage("Scene \"" + mBaseName.TrimEnd('_') + "\": " + drawsBefore.ToString() +
+                " mesh part draws before texture atlasing, " + _CountDraws(mScene.Nodes).ToString() + " after (" +
+                atlasedTextures.ToString() + " textures in " + atlases.ToString() + " atlases).");
+        }
+        #endregion
+
         #region Physics processing
         private Vector3[] _Convert(float[] a)
         {
@@ -1956,6 +2686,9 @@ namespace siat.pipeline.collada
             // COLLADA does not necessarily specify a root scene node but
             // Siat XNA requires one for each cell. This treats all child <node>
             // elements of <visual_scene> as children of a root scene node.
+            _PrepareMeshes(visualScene);
+
+            long start = Stopwatch.GetTimestamp();
             int childrenCount = visualScene.GetChildCount<ColladaNode>();
             SceneNodeContent root = new SceneNodeContent(mBaseName + visualScene.Id, childrenCount, ref Utilities.kIdentity);
             mScene.Nodes.Add(root);
@@ -1964,6 +2697,10 @@ namespace siat.pipeline.collada
             {
                 _ProcessNode(n, ref Utilities.kIdentity);
             }
+            mPreparedMeshes.Clear();
+
+            long ticks = (Stopwatch.GetTimestamp() - start);
+            _AddStage("Scene", 1, 1, ticks, ticks);
         }
         #endregion
         #endregion
@@ -2080,6 +2817,7 @@ namespace siat.pipeline.collada
         private void _OptimizeMeshes()
         {
             Dictionary<string, SiatMeshContent.Part> processed = new Dictionary<string, SiatMeshContent.Part>();
+            List<SiatMeshContent.Part> parts = new List<SiatMeshContent.Part>();
 
             foreach (SceneNodeContent e in mScene.Nodes)
             {
@@ -2089,11 +2827,14 @@ namespace siat.pipeline.collada
 
                     if (!processed.ContainsKey(f.MeshPart.Id))
                     {
-                        _Optimize(f.MeshPart);
                         processed.Add(f.MeshPart.Id, f.MeshPart);
+                        parts.Add(f.MeshPart);
                     }
                 }
             }
+
+            // Each part is optimized on its own, so parts can be optimized in parallel.
+            _ThrowFirst(_RunStage("Optimize", parts.Count, true, delegate(int i) { _Optimize(parts[i]); }));
         }
 
         public override SceneContent Process(ColladaCOLLADA aRoot, ContentProcessorContext aContext)
@@ -2101,18 +2842,59 @@ namespace siat.pipeline.collada
             mBaseName = PipelineUtilities.ExtractXnaAssetName(aRoot.SourceFile) + "_";
             mContent = new ColladaContent(aRoot.SourceFile);
             mContext = aContext;
+            mStages.Clear();
+            mPrecisionReports.Clear();
 
-            _ProcessRoot(aRoot);
-            _OptimizeMeshes();
+            try
+            {
+                _ProcessRoot(aRoot);
+                _CompileEffects();
+                if (mbAtlasTextures && mContext != null) { _AtlasTextures(); }
+                _OptimizeMeshes();
+                mScene.bPackMeshes = mbPackMeshes;
 
-            if (mbProcessPhysics)
+                if (mUncompressedAnimationMemory > 0)
+                {
+                    mContext.Logger.LogMessage("Animation key frames: " + mAnimationMemory.ToString() + " bytes, " +
+                        mUncompressedAnimationMemory.ToString() + " bytes uncompressed.");
+                }
+
+                if (mbProcessPhysics)
+                {
+                    long start = Stopwatch.GetTimestamp();
+                    TriangleTree tree = _ProcessPhysics(aRoot);
+                    long ticks = (Stopwatch.GetTimestamp() - start);
+                    _AddStage("Physics", 1, 1, ticks, ticks);
+
+                    if (mScene.Nodes.Count < 1 || mScene.Nodes[0] == null) { throw new ArgumentNullException(); }
+
+                    mScene.Nodes[0].ChildrenCount++;
+                    mScene.Nodes.Insert(1, new PhysicsSceneNodeContent(tree));
+                }
+            }
+            finally
             {
-                TriangleTree tree = _ProcessPhysics(aRoot);
+                // Release the files held open for deferred array reads.
+                ColladaNumberParser.CloseFiles();
+                mPreparedMeshes.Clear();
+                mPendingEffects.Clear();
+            }
 
-                if (mScene.Nodes.Count < 1 || mScene.Nodes[0] == null) { throw new ArgumentNullException(); }
+            if (mContext != null)
+            {
+                foreach (StageTime e in mStages)
+                {
+                    mContext.Logger.LogMessage(e.Name + ": " + e.Tasks.ToString() + " tasks, " +
+                        e.WallTime.ToString("F1") + " ms on " + e.Threads.ToString() + " threads, " +
+                        (e.Efficiency * 100.0).ToString("F0") + "% efficiency.");
+                }
 
-                mScene.Nodes[0].ChildrenCount++;
-                mScene.Nodes.Insert(1, new PhysicsSceneNodeContent(tree));
+                foreach (ShadingPrecision.Report e in mPrecisionReports)
+                {
+                    mContext.Logger.LogMessage("Material \"" + e.Material + "\": " +
+                        (e.bPartial ? "partial" : "full") + " precision, " +
+                        e.MaxError.ToString("E2") + " max error at partial precision.");
+                }
             }
 
             return mScene;
@@ -2123,6 +2905,78 @@ namespace siat.pipeline.collada
         [DefaultValue(typeof(bool), "false")]
         public bool ProcessPhysics { get { return mbProcessPhysics; } set { mbProcessPhysics = value; } }
 
+        /// <summary>
+        /// If true, geometries, standard effects, atlas textures and mesh optimization are
+        /// processed on WorkPool. The output is the same either way.
+        /// </summary>
+        [DefaultValue(typeof(bool), "true")]
+        public bool ParallelProcessing { get { return mbParallel; } set { mbParallel = value; } }
+
+        /// <summary>
+        /// Times of the stages of the last call to Process(), in the order they ran.
+        /// </summary>
+        public List<StageTime> Stages { get { return mStages; } }
+
+        /// <summary>
+        /// Precision of the color and lighting term math of standard effects. Auto uses
+        /// partial precision for materials whose estimated error is within PartialPrecisionTolerance.
+        /// </summary>
+        /// <seealso cref="siat.pipeline.collada.ShadingPrecision"/>
+        [DefaultValue(typeof(PrecisionMode), "Auto")]
+        public PrecisionMode ShaderPrecision { get { return mPrecision; } set { mPrecision = value; } }
+
+        /// <summary>
+        /// Largest linear color error of a material that Auto shades at partial precision.
+        /// </summary>
+        [DefaultValue(typeof(float), "0.003921569")]
+        public float PartialPrecisionTolerance { get { return mPartialPrecisionTolerance; } set { mPartialPrecisionTolerance = value; } }
+
+        /// <summary>
+        /// Precision chosen for each standard effect material by the last call to Process().
+        /// </summary>
+        public List<ShadingPrecision.Report> PrecisionReports { get { return mPrecisionReports; } }
+
+        /// <summary>
+        /// If true, the mesh parts of the scene are written as one mesh pack, which loads with a
+        /// single bulk read, instead of as individual shared resources.
+        /// </summary>
+        [DefaultValue(typeof(bool), "true")]
+        public bool PackMeshes { get { return mbPackMeshes; } set { mbPackMeshes = value; } }
+
+        /// <summary>
+        /// If true, textures are built by SiatTextureProcessor, which picks a compressed format
+        /// and mip filter by how each texture is used. Otherwise the XNA TextureProcessor is used.
+        /// </summary>
+        /// <seealso cref="siat.pipeline.SiatTextureProcessor"/>
+        [DefaultValue(typeof(bool), "true")]
+        public bool ProcessTextures { get { return mbProcessTextures; } set { mbProcessTextures = value; } }
+
+        /// <summary>
+        /// If true, the textures of mesh parts that differ only by their color texture are packed
+        /// into atlases so the parts can be combined into fewer draws.
+        /// </summary>
+        [DefaultValue(typeof(bool), "true")]
+        public bool AtlasTextures { get { return mbAtlasTextures; } set { mbAtlasTextures = value; } }
+
+        /// <summary>
+        /// Width and height in pixels of each texture atlas.
+        /// </summary>
+        [DefaultValue(typeof(int), "2048")]
+        public int AtlasSize { get { return mAtlasSize; } set { mAtlasSize = value; } }
+
+        /// <summary>
+        /// If true, joint animations are stored as keyframe-reduced, quantized rotation,
+        /// translation, and scale tracks.
+        /// </summary>
+        [DefaultValue(typeof(bool), "true")]
+        public bool CompressAnimation { get { return mbCompressAnimation; } set { mbCompressAnimation = value; } }
+
+        /// <summary>
+        /// Maximum error of a rotation, translation, or scale component removed by keyframe reduction.
+        /// </summary>
+        [DefaultValue(typeof(float), "0.001")]
+        public float AnimationTolerance { get { return mAnimationTolerance; } set { mAnimationTolerance = value; } }
+
         /// <summary>
         /// The magnification filter to use if COLLADA specified filter is "None".
         /// </summary>
@@ -0,0 +1,249 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using System;
+using System.Diagnostics;
+using System.IO;
+using System.Threading;
+using siat.pipeline.collada.elements;
+
+namespace siat.pipeline.collada
+{
+    /// <summary>
+    /// Measures the time and peak managed memory of importing and processing a COLLADA file.
+    /// </summary>
+    /// <remarks>
+    /// Each run is done once with deferred arrays disabled and once with them enabled. Peak
+    /// memory is sampled from a background thread, so it is approximate and slightly low, and
+    /// includes a garbage collection first so runs start from the same baseline.
+    /// </remarks>
+    public static class ImportBenchmark
+    {
+        public const int kSampleIntervalInMilliseconds = 1;
+
+        public struct Result
+        {
+            public int DeferThreshold;
+            public int DeferredArrays;
+            public double LoadTime;
+            public double ProcessTime;
+            public long PeakManagedBytes;
+            public long PeakWorkingSetBytes;
+        }
+
+        #region Private members
+        private sealed class MemorySampler
+        {
+            private volatile bool mbDone = false;
+            private long mPeak = 0;
+            private Thread mThread;
+
+            private void _Run()
+            {
+                while (!mbDone)
+                {
+                    Sample();
+                    Thread.Sleep(kSampleIntervalInMilliseconds);
+                }
+            }
+
+            public MemorySampler()
+            {
+                mThread = new Thread(_Run);
+                mThread.IsBackground = true;
+                mThread.Start();
+            }
+
+            public long Peak { get { return Interlocked.Read(ref mPeak); } }
+
+            public void Sample()
+            {
+                long bytes = GC.GetTotalMemory(false);
+
+                long peak = Interlocked.Read(ref mPeak);
+                while (bytes > peak)
+                {
+                    long old = Interlocked.CompareExchange(ref mPeak, bytes, peak);
+                    if (old == peak) { break; }
+                    peak = old;
+                }
+            }
+
+            public void Stop()
+            {
+                mbDone = true;
+                mThread.Join();
+                Sample();
+            }
+        }
+
+        private static int _CountDeferred(ColladaCOLLADA aRoot)
+        {
+            int ret = 0;
+            aRoot.Apply<ColladaFloatArray>(_ColladaElement.ApplyType.RecurseDown, _ColladaElement.ApplyStop.Delegate,
+                delegate(ColladaFloatArray e) { if (e.bDeferred) { ret++; } return false; });
+            aRoot.Apply<ColladaIntArray>(_ColladaElement.ApplyType.RecurseDown, _ColladaElement.ApplyStop.Delegate,
+                delegate(ColladaIntArray e) { if (e.bDeferred) { ret++; } return false; });
+
+            return ret;
+        }
+        #endregion
+
+        /// <summary>
+        /// Loads aFile with ColladaNumberParser.DeferThreshold set to aDeferThreshold and, if
+        /// abProcess is true, runs it through ColladaProcessor with physics enabled.
+        /// </summary>
+        public static Result Run(string aFile, int aDeferThreshold, bool abProcess)
+        {
+            Result ret = new Result();
+            ret.DeferThreshold = aDeferThreshold;
+
+            int oldThreshold = ColladaNumberParser.DeferThreshold;
+            ColladaNumberParser.DeferThreshold = aDeferThreshold;
+
+            GC.Collect();
+            GC.WaitForPendingFinalizers();
+            GC.Collect();
+
+            MemorySampler sampler = new MemorySampler();
+            Stopwatch timer = new Stopwatch();
+            try
+            {
+                ColladaCOLLADA root;
+
+                timer.Start();
+                ColladaDocument.Load(aFile, out root);
+                timer.Stop();
+                ret.LoadTime = timer.Elapsed.TotalMilliseconds;
+                ret.DeferredArrays = _CountDeferred(root);
+
+                if (abProcess)
+                {
+                    ColladaProcessor processor = new ColladaProcessor();
+                    processor.ProcessPhysics = true;
+
+                    timer.Reset();
+                    timer.Start();
+                    processor.Process(root, null);
+                    timer.Stop();
+                    ret.ProcessTime = timer.Elapsed.TotalMilliseconds;
+                }
+            }
+            finally
+            {
+                sampler.Stop();
+                ColladaNumberParser.DeferThreshold = oldThreshold;
+                ColladaDocument.Clear();
+            }
+
+            ret.PeakManagedBytes = sampler.Peak;
+            ret.PeakWorkingSetBytes = Process.GetCurrentProcess().PeakWorkingSet64;
+
+            return ret;
+        }
+
+        /// <summary>
+        /// Runs each file in aFiles aRuns times with deferred arrays disabled and enabled, and
+        /// writes one CSV line per run to aOut.
+        /// </summary>
+        /// <remarks>
+        /// The working set peak is the peak of the process so far, so it only grows from run to
+        /// run. Compare the managed peaks between modes, or run each mode in its own process.
+        /// </remarks>
+        public static void Run(TextWriter aOut, string[] aFiles, int aRuns, bool abProcess)
+        {
+            int[] thresholds = new int[] { 0, ColladaNumberParser.kDefaultDeferThreshold };
+
+            aOut.WriteLine("file,defer threshold,deferred arrays,load ms,process ms,peak managed MB,peak working set MB");
+            foreach (string file in aFiles)
+            {
+                foreach (int threshold in thresholds)
+                {
+                    for (int i = 0; i < aRuns; i++)
+                    {
+                        Result r = Run(file, threshold, abProcess);
+
+                        aOut.WriteLine(
+                            Path.GetFileName(file) + "," +
+                            r.DeferThreshold.ToString() + "," +
+                            r.DeferredArrays.ToString() + "," +
+                            r.LoadTime.ToString("F2") + "," +
+                            r.ProcessTime.ToString("F2") + "," +
+                            (r.PeakManagedBytes / (1024.0 * 1024.0)).ToString("F2") + "," +
+                            (r.PeakWorkingSetBytes / (1024.0 * 1024.0)).ToString("F2"));
+                        aOut.Flush();
+                    }
+                }
+            }
+        }
+
+        /// <summary>
+        /// Processes aFile aRuns times serially and aRuns times on WorkPool, and writes the time of
+        /// each stage of ColladaProcessor.Process() as a CSV line to aOut.
+        /// </summary>
+        /// <remarks>
+        /// Efficiency is the time spent in tasks over the wall time of the threads of the stage.
+        /// Serial stages always report 1.
+        /// </remarks>
+        public static void RunStages(TextWriter aOut, string aFile, int aRuns)
+        {
+            bool[] modes = new bool[] { false, true };
+
+            aOut.WriteLine("file,parallel,run,stage,tasks,threads,wall ms,task ms,efficiency");
+            foreach (bool bParallel in modes)
+            {
+                for (int i = 0; i < aRuns; i++)
+                {
+                    ColladaProcessor processor = new ColladaProcessor();
+                    processor.ProcessPhysics = true;
+                    processor.ParallelProcessing = bParallel;
+
+                    try
+                    {
+                        ColladaCOLLADA root;
+                        ColladaDocument.Load(aFile, out root);
+                        processor.Process(root, null);
+                    }
+                    finally
+                    {
+                        ColladaDocument.Clear();
+                    }
+
+                    foreach (ColladaProcessor.StageTime e in processor.Stages)
+                    {
+                        aOut.WriteLine(
+                            Path.GetFileName(aFile) + "," +
+                            bParallel.ToString() + "," +
+                            i.ToString() + "," +
+                            e.Name + "," +
+                            e.Tasks.ToString() + "," +
+                            e.Threads.ToString() + "," +
+                            e.WallTime.ToString("F2") + "," +
+                            e.TaskTime.ToString("F2") + "," +
+                            e.Efficiency.ToString("F2"));
+                    }
+                    aOut.Flush();
+                }
+            }
+        }
+    }
+}
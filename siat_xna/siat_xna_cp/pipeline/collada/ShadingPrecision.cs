@@ -0,0 +1,143 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using Microsoft.Xna.Framework;
+using Microsoft.Xna.Framework.Graphics.PackedVector;
+using System;
+
+namespace siat.pipeline.collada
+{
+    /// <summary>
+    /// Precision of the color and lighting term math of standard effects.
+    /// </summary>
+    public enum PrecisionMode
+    {
+        Full,
+        Partial,
+        Auto
+    }
+
+    /// <summary>
+    /// Estimates the error of shading a standard effect material with PARTIAL_PRECISION.
+    /// </summary>
+    /// <remarks>
+    /// The diffuse and specular terms of Fragment() in collada_effect.h are evaluated for one
+    /// white light over a grid of reference n.l and n.h (r.e for Phong) values, once in float
+    /// and once with every intermediate rounded to half as the _pp path rounds it. The estimate
+    /// is the largest absolute difference of a linear color channel. Normals, light vectors,
+    /// bump decoding, the spot cone, distances, attenuation and shadows are float in both modes,
+    /// so only their dot products enter the estimate, rounded to half like the reference values.
+    /// </remarks>
+    public static class ShadingPrecision
+    {
+        public const int kReferenceSteps = 64;
+        public const float kDefaultTolerance = (1.0f / 255.0f);
+        public const float kMinimumExponent = 1e-3f;
+
+        /// <summary>
+        /// Precision chosen for one material and its estimated error.
+        /// </summary>
+        public struct Report
+        {
+            public string Material;
+            public float MaxError;
+            public bool bPartial;
+        }
+
+        #region Private members
+        private static float _Half(float a)
+        {
+            return new HalfSingle(a).ToSingle();
+        }
+
+        private static float _Pow(float a, float b)
+        {
+            return (float)Math.Pow(a, b);
+        }
+
+        private static float[] _GammaFull(Vector3 a, float aGamma)
+        {
+            float[] ret = new float[] { a.X, a.Y, a.Z };
+            for (int i = 0; i < ret.Length; i++)
+            {
+                ret[i] = (ret[i] >= Utilities.kLooseToleranceFloat) ? _Pow(ret[i], aGamma) : 0.0f;
+            }
+
+            return ret;
+        }
+
+        private static float[] _GammaHalf(Vector3 a, float aGamma)
+        {
+            float gamma = _Half(aGamma);
+            float[] ret = new float[] { _Half(a.X), _Half(a.Y), _Half(a.Z) };
+            for (int i = 0; i < ret.Length; i++)
+            {
+                ret[i] = (ret[i] >= Utilities.kLooseToleranceFloat) ? _Half(_Pow(ret[i], gamma)) : 0.0f;
+            }
+
+            return ret;
+        }
+        #endregion
+
+        /// <summary>
+        /// Returns the largest error of partial precision against full precision for a material
+        /// with the given linear inputs. Textured colors should be passed as white, the worst case.
+        /// Pass a zero specular color for materials without a specular term.
+        /// </summary>
+        public static float Estimate(Vector3 aDiffuse, Vector3 aSpecular, float aShininess, float aGamma)
+        {
+            float[] diffuseFull = _GammaFull(aDiffuse, aGamma);
+            float[] diffuseHalf = _GammaHalf(aDiffuse, aGamma);
+            float[] specularFull = _GammaFull(aSpecular, aGamma);
+            float[] specularHalf = _GammaHalf(aSpecular, aGamma);
+            float shininessFull = Math.Max(aShininess, kMinimumExponent);
+            float shininessHalf = _Half(shininessFull);
+            bool bSpecular = (specularFull[0] > 0.0f || specularFull[1] > 0.0f || specularFull[2] > 0.0f);
+
+            float ret = 0.0f;
+            for (int i = 0; i <= kReferenceSteps; i++)
+            {
+                float ndotlFull = ((float)i / (float)kReferenceSteps);
+                float ndotlHalf = _Half(ndotlFull);
+
+                for (int j = 0; j <= kReferenceSteps; j++)
+                {
+                    float dotFull = ((float)j / (float)kReferenceSteps);
+                    float specFull = (bSpecular && ndotlFull > 0.0f) ? _Pow(dotFull, shininessFull) : 0.0f;
+                    float specHalf = (bSpecular && ndotlHalf > 0.0f) ? _Half(_Pow(_Half(dotFull), shininessHalf)) : 0.0f;
+
+                    for (int k = 0; k < 3; k++)
+                    {
+                        float full = (diffuseFull[k] * ndotlFull) + (specularFull[k] * specFull);
+                        float half = _Half(_Half(diffuseHalf[k] * ndotlHalf) + _Half(specularHalf[k] * specHalf));
+
+                        ret = Math.Max(ret, Math.Abs(full - half));
+                    }
+
+                    if (!bSpecular) { break; }
+                }
+            }
+
+            return ret;
+        }
+    }
+}
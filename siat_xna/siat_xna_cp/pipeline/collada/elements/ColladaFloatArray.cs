@@ -30,10 +30,15 @@ namespace siat.pipeline.collada.elements
         #region Protected members
         private readonly short mDigits;
         private readonly short mMagnitude;
+
+        protected override void _ReadDeferred(ColladaNumberParser.Location aLocation, float[] arOut)
+        {
+            ColladaNumberParser.Read(aLocation, arOut);
+        }
         #endregion
 
         public ColladaFloatArray(XmlReader aReader)
-            : base(aReader)
+            : base(aReader, true)
         {
             #region Attributes
             _SetOptionalAttribute(aReader, Attributes.kDigits, ref mDigits);
@@ -41,9 +46,12 @@ namespace siat.pipeline.collada.elements
             #endregion        
 
             #region Element value
-            string value = string.Empty;
-            _SetValue(aReader, ref value);
-            Utilities.Tokenize<float>(value, mArray, XmlConvert.ToSingle);
+            if (mDeferred == null)
+            {
+                _NextText(aReader);
+                ColladaNumberParser.Read(aReader, mArray);
+            }
+            _NextElement(aReader);
             #endregion
         }
 
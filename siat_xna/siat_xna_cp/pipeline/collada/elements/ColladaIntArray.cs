@@ -30,10 +30,15 @@ namespace siat.pipeline.collada.elements
         #region Protected members
         private readonly int mMin = Defaults.kIntMinAttribute;
         private readonly int mMax = Defaults.kIntMaxAttribute;
+
+        protected override void _ReadDeferred(ColladaNumberParser.Location aLocation, int[] arOut)
+        {
+            ColladaNumberParser.Read(aLocation, arOut);
+        }
         #endregion
 
         public ColladaIntArray(XmlReader aReader)
-            : base(aReader)
+            : base(aReader, true)
         {
             #region Attributes
             _SetOptionalAttribute(aReader, Attributes.kMinInclusive, ref mMin);
@@ -41,9 +46,12 @@ namespace siat.pipeline.collada.elements
             #endregion        
 
             #region Element value
-            string value = string.Empty;
-            _SetValue(aReader, ref value);
-            Utilities.Tokenize<int>(value, mArray, XmlConvert.ToInt32);
+            if (mDeferred == null)
+            {
+                _NextText(aReader);
+                ColladaNumberParser.Read(aReader, mArray);
+            }
+            _NextElement(aReader);
             #endregion
         }
     }
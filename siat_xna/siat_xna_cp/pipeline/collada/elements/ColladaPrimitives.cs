@@ -34,9 +34,9 @@ namespace siat.pipeline.collada.elements
         public ColladaPrimitives(XmlReader aReader)
         {
             #region Element value
-            string value = "";
-            _SetValue(aReader, ref value);
-            mIndices = Utilities.Tokenize<int>(value, XmlConvert.ToInt32);
+            _NextText(aReader);
+            mIndices = ColladaNumberParser.ReadInts(aReader);
+            _NextElement(aReader);
             #endregion
         }
 
@@ -44,9 +44,9 @@ namespace siat.pipeline.collada.elements
         {
             #region Element value
             mIndices = new int[aExpectedSize];
-            string value = "";
-            _SetValue(aReader, ref value);
-            Utilities.Tokenize<int>(value, mIndices, XmlConvert.ToInt32);
+            _NextText(aReader);
+            ColladaNumberParser.Read(aReader, mIndices);
+            _NextElement(aReader);
             #endregion
         }
 
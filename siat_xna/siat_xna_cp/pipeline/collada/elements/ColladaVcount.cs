@@ -49,9 +49,9 @@ namespace siat.pipeline.collada.elements
         public ColladaVcount(XmlReader aReader)
         {
             #region Element value
-            string value = "";
-            _SetValue(aReader, ref value);
-            mSides = Utilities.Tokenize<uint>(value, XmlConvert.ToUInt32);
+            _NextText(aReader);
+            mSides = ColladaNumberParser.ReadUInts(aReader);
+            _NextElement(aReader);
             _CalculateExpectedPrimitivesCount();
             #endregion
         }
@@ -60,9 +60,9 @@ namespace siat.pipeline.collada.elements
         {
             #region Element value
             mSides = new uint[aExpectedSize];
-            string value = "";
-            _SetValue(aReader, ref value);
-            Utilities.Tokenize<uint>(value, mSides, XmlConvert.ToUInt32);
+            _NextText(aReader);
+            ColladaNumberParser.Read(aReader, mSides);
+            _NextElement(aReader);
             _CalculateExpectedPrimitivesCount();
             #endregion
         }
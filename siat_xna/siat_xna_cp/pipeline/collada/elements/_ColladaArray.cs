@@ -28,22 +28,71 @@ namespace siat.pipeline.collada.elements
     public abstract class _ColladaArray<T> : _ColladaElementWithIdAndName
     {
         #region Protected members
-        protected readonly T[] mArray;
+        protected volatile T[] mArray = null;
         protected readonly uint mCount = 0;
+        protected readonly ColladaNumberParser.Location mDeferred = null;
+
+        /// <summary>
+        /// Decodes the values of a deferred array into arOut.
+        /// </summary>
+        protected virtual void _ReadDeferred(ColladaNumberParser.Location aLocation, T[] arOut)
+        {
+            throw new Exception("<*_array> cannot be deferred.");
+        }
         #endregion
 
         public _ColladaArray(XmlReader aReader)
+            : this(aReader, false)
+        { }
+
+        /// <summary>
+        /// If abAllowDeferred is true and the array is large, the array is not allocated and
+        /// mDeferred is set. The values are decoded with _ReadDeferred() on first access.
+        /// </summary>
+        /// <remarks>
+        /// Meshes are prepared in parallel, so the first access can come from several threads.
+        /// The read is done once under a lock and mArray is only set once it is complete.
+        /// </remarks>
+        protected _ColladaArray(XmlReader aReader, bool abAllowDeferred)
             : base(aReader)
         {
             #region Attributes
             _SetRequiredAttribute(aReader, Attributes.kCount, out mCount);
-            mArray = new T[mCount];
+            if (abAllowDeferred) { mDeferred = ColladaNumberParser.Defer(aReader, mCount); }
+            if (mDeferred == null) { mArray = new T[mCount]; }
             #endregion
         }
 
-        public T[] Array { get { return mArray; }}
+        public T[] Array
+        {
+            get
+            {
+                if (mArray == null) { Load(); }
+
+                return mArray;
+            }
+        }
+
+        /// <summary>
+        /// Decodes the values of a deferred array now instead of on first access.
+        /// </summary>
+        public void Load()
+        {
+            lock (this)
+            {
+                if (mArray == null)
+                {
+                    T[] array = new T[mCount];
+                    _ReadDeferred(mDeferred, array);
+                    mArray = array;
+                }
+            }
+        }
+
+        public bool bDeferred { get { return (mArray == null); } }
+        public ColladaNumberParser.Location DeferredLocation { get { return mDeferred; } }
         public uint Count { get { return mCount; } }
-        public T this[uint i] { get { return mArray[i]; } }
+        public T this[uint i] { get { return Array[i]; } }
 
         public uint ElementCount
         {
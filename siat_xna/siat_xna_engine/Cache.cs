@@ -23,71 +23,81 @@
 using Microsoft.Xna.Framework.Content;
 using System;
 using System.Collections.Generic;
-using System.IO;
 using System.Text;
 using System.Threading;
 
 namespace siat
 {
+    /// <summary>
+    /// Tracks the resident memory of loaded content and unloads the least recently used content
+    /// when the total exceeds MaximumCacheSize.
+    /// </summary>
+    /// <remarks>
+    /// Sizes are the actual resident size of loaded content (GPU buffers and textures), reported
+    /// by the content itself through SetResidentSize() once it has loaded. Content touched during
+    /// the current frame is never purged, even if that leaves the cache over budget.
+    /// 
+    /// Cache must only be accessed from the main thread.
+    /// </remarks>
     public static class Cache
     {
         public const long kDefaultMaximumCacheSize = (1 << 29);
 
         #region Private members
-        private static long msTotalCacheSize = 0u;
-        private static long msMaximumCacheSize = kDefaultMaximumCacheSize;
-        private struct CacheEntry
+        private sealed class Resident
         {
-            public long EstimatedDataSize;
-            public WeakReference Reference;
+            public Resident(ICacheable aItem) { Item = aItem; }
+
+            public readonly ICacheable Item;
+            public long Size = 0;
+            public uint LastUsedTick = 0;
         }
 
-        private static Dictionary<string, CacheEntry> msCacheables = new Dictionary<string, CacheEntry>();
-        internal static LinkedList<ICacheable> msLRU = new LinkedList<ICacheable>();
+        private static long msTotalCacheSize = 0;
+        private static long msMaximumCacheSize = kDefaultMaximumCacheSize;
+
+        private static Dictionary<string, WeakReference> msCacheables = new Dictionary<string, WeakReference>();
+        private static Dictionary<ICacheable, LinkedListNode<Resident>> msResidents = new Dictionary<ICacheable, LinkedListNode<Resident>>();
+        private static LinkedList<Resident> msLRU = new LinkedList<Resident>();
 
         private static void _Purge()
         {
-            if (msLRU.Last != null)
+            uint tick = Siat.Singleton.FrameTick;
+
+            while (msTotalCacheSize > msMaximumCacheSize && msLRU.Last != null && msLRU.Last.Value.LastUsedTick != tick)
             {
-                msLRU.Last.Value.Unload();
-                msLRU.RemoveLast();
+                ICacheable item = msLRU.Last.Value.Item;
+                Remove(item);
+                item.Unload();
             }
         }
 
-        private static void _AddToTotalSize(long aSize)
+        private static LinkedListNode<Resident> _Touch(ICacheable aItem)
         {
-            while ((msTotalCacheSize + aSize) > msMaximumCacheSize)
+            LinkedListNode<Resident> node;
+            if (msResidents.TryGetValue(aItem, out node)) { msLRU.Remove(node); }
+            else
             {
-                _Purge();
+                node = new LinkedListNode<Resident>(new Resident(aItem));
+                msResidents.Add(aItem, node);
             }
 
-            msTotalCacheSize += aSize;
+            node.Value.LastUsedTick = Siat.Singleton.FrameTick;
+            msLRU.AddFirst(node);
+
+            return node;
         }
 
         private static WeakReference _New<T>(string aId)
             where T : ICacheable, new()
         {
-            CacheEntry entry = new CacheEntry();
-
-            if (File.Exists(aId))
-            {
-                FileInfo info = new FileInfo(aId);
-                entry.EstimatedDataSize = info.Length;
-                _AddToTotalSize(entry.EstimatedDataSize);
-            }
-            else
-            {
-                entry.EstimatedDataSize = 0;
-            }
-            
             T obj = new T();
             obj.Filename = aId;
 
-            entry.Reference = new WeakReference(obj);
+            WeakReference ret = new WeakReference(obj);
+            msCacheables[aId] = ret;
 
-            msCacheables[aId] = entry;
-
-            return entry.Reference;
+            return ret;
         }
         #endregion
 
@@ -98,7 +108,7 @@ namespace siat
 
             if (msCacheables.ContainsKey(aId))
             {
-                rf = msCacheables[aId].Reference;
+                rf = msCacheables[aId];
 
                 if (rf.IsAlive) { goto done; }
             }
@@ -114,18 +124,55 @@ namespace siat
 #endif
         }
 
+        /// <summary>
+        /// Sets the resident size in bytes of loaded content and marks it most recently used.
+        /// </summary>
+        /// <remarks>
+        /// Least recently used content is purged if the new total exceeds MaximumCacheSize.
+        /// </remarks>
+        public static void SetResidentSize(ICacheable aItem, long aSize)
+        {
+            LinkedListNode<Resident> node = _Touch(aItem);
+            msTotalCacheSize += (aSize - node.Value.Size);
+            node.Value.Size = aSize;
+
+            _Purge();
+        }
+
+        /// <summary>
+        /// Marks resident content as used this frame. Does nothing if aItem is not resident.
+        /// </summary>
+        public static void Touch(ICacheable aItem)
+        {
+            if (msResidents.ContainsKey(aItem)) { _Touch(aItem); }
+        }
+
+        /// <summary>
+        /// Stops tracking content, usually because it has been unloaded.
+        /// </summary>
+        public static void Remove(ICacheable aItem)
+        {
+            LinkedListNode<Resident> node;
+            if (msResidents.TryGetValue(aItem, out node))
+            {
+                msTotalCacheSize -= node.Value.Size;
+                msLRU.Remove(node);
+                msResidents.Remove(aItem);
+            }
+        }
+
         public static long MaximumCacheSize
         {
             get { return msMaximumCacheSize; }
             set
             {
                 msMaximumCacheSize = value;
-                while (msTotalCacheSize > msMaximumCacheSize)
-                {
-                    _Purge();
-                }
+                _Purge();
             }
         }
+
+        public static int ResidentCount { get { return msResidents.Count; } }
+        public static long TotalCacheSize { get { return msTotalCacheSize; } }
     }
 
     public interface ICacheable
@@ -141,7 +188,6 @@ namespace siat
         private string mFilename = string.Empty;
         private bool mbLoading = false;
         private ContentManager mManager = new ContentManager(Siat.Singleton.Services);
-        private LinkedListNode<ICacheable> mNode = null;
         private T mObject;
 
         private void __HandleLoad(object aObject)
@@ -172,6 +218,7 @@ namespace siat
                             _OnLoadInMainThread();
                         }
                         mbLoading = false;
+                        Cache.SetResidentSize(this, _ResidentSize);
                     }
                 }
 
@@ -193,6 +240,7 @@ namespace siat
                 {
                     _OnLoadInMainThread();
                     mbLoading = false;
+                    Cache.SetResidentSize(this, _ResidentSize);
                 }
             }
         }
@@ -210,13 +258,7 @@ namespace siat
 
         protected void _Tickle()
         {
-            if (mNode != null)
-            {
-                Cache.msLRU.Remove(mNode);
-                mNode = null;
-            }
-
-            mNode = Cache.msLRU.AddFirst(this);
+            Cache.Touch(this);
         }
 
         protected T _WaitForObject
@@ -230,6 +272,11 @@ namespace siat
         protected abstract void _OnLoadInThread();
         protected abstract void _OnLoadInMainThread();
         protected abstract void _OnUnload();
+
+        /// <summary>
+        /// Resident size in bytes of the loaded object, reported to Cache once loading completes.
+        /// </summary>
+        protected abstract long _ResidentSize { get; }
         #endregion
 
         #region Internal members
@@ -243,6 +290,8 @@ namespace siat
 
         public void Unload()
         {
+            Cache.Remove(this);
+
             lock (this)
             {
                 _OnUnload();
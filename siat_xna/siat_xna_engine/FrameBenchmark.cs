@@ -0,0 +1,265 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using System;
+using System.Diagnostics;
+using System.IO;
+using siat.render;
+using siat.scene;
+
+namespace siat
+{
+    /// <summary>
+    /// Measures the CPU cost of the update, pose, and draw stages over a scripted run.
+    /// </summary>
+    /// <remarks>
+    /// For a run that is repeatable between builds:
+    /// - set Siat.bNullDevice before Siat.Run(), so draw calls go to the Direct3D null
+    ///   reference device and only the CPU side of submission is measured;
+    /// - set Siat.FixedTimeStep, so animation and camera smoothing advance by the same amount
+    ///   each frame regardless of frame rate;
+    /// - move the camera and lights in aStep as a function of the frame number only.
+    ///
+    /// A run waits for cell streaming to finish, then runs the warm up frames, then measures.
+    /// The draw and triangle counts of each measured frame are folded into a checksum that
+    /// should be equal between runs of the same content and path.
+    ///
+    /// .NET 2.0 has no allocation counter or GC pause timer. Allocation is measured as the
+    /// growth of GC.GetTotalMemory() over frames in which no collection occurred, and frames
+    /// in which a collection occurred are counted and their frame times reported separately.
+    /// </remarks>
+    public static class FrameBenchmark
+    {
+        public delegate void Step(int aFrame);
+
+        public enum Stage
+        {
+            kUpdate = 0,
+            kPose = 1,
+            kOcclusion = 2,
+            kLightJobs = 3,
+            kDraw = 4,
+            kSort = 5,
+            kSubmit = 6,
+            kFrame = 7,
+            kCount = 8
+        }
+
+        public static readonly string[] kStageNames = new string[]
+            { "update", "pose", "occlusion", "light_jobs", "draw", "sort", "submit", "frame" };
+
+        #region Private members
+        private static bool msbRunning = false;
+        private static bool msbExitWhenDone = false;
+        private static int msFrame = 0;
+        private static int msFrameCount = 0;
+        private static int msWarmupFrames = 0;
+        private static string msReportFile = null;
+        private static Step msStep = null;
+
+        private static double[][] msTimes = null;
+        private static int[] msDraws = null;
+        private static int[] msTriangles = null;
+        private static long[] msAllocated = null;
+        private static int[] msCollections = null;
+        private static long msLastMemory = 0;
+        private static int msLastCollections = 0;
+        private static uint msChecksum = 0;
+
+        private static void _HandleUpdateBegin()
+        {
+            if (msStep != null) { msStep((msWarmupFrames > 0) ? 0 : msFrame); }
+        }
+
+        private static int _CollectionCount()
+        {
+            int ret = 0;
+            for (int i = 0; i <= GC.MaxGeneration; i++) { ret += GC.CollectionCount(i); }
+
+            return ret;
+        }
+
+        private static double _Percentile(double[] aSorted, double aPercentile)
+        {
+            int index = (int)Math.Ceiling(aPercentile * aSorted.Length) - 1;
+            return aSorted[Utilities.Clamp(index, 0, aSorted.Length - 1)];
+        }
+
+        private static void _WriteReport()
+        {
+            using (StreamWriter writer = new StreamWriter(msReportFile, false))
+            {
+                int gcFrames = 0;
+                long allocated = 0;
+                int allocatedFrames = 0;
+                double gcFrameMax = 0.0;
+
+                for (int i = 0; i < msFrameCount; i++)
+                {
+                    if (msCollections[i] > 0)
+                    {
+                        gcFrames++;
+                        gcFrameMax = Math.Max(gcFrameMax, msTimes[(int)Stage.kFrame][i]);
+                    }
+                    else
+                    {
+                        allocated += msAllocated[i];
+                        allocatedFrames++;
+                    }
+                }
+
+                writer.WriteLine("# frames," + msFrameCount.ToString());
+                writer.WriteLine("# checksum," + msChecksum.ToString("x8"));
+                writer.WriteLine("# gc_frames," + gcFrames.ToString());
+                writer.WriteLine("# gc_frame_max_ms," + gcFrameMax.ToString("0.000"));
+                writer.WriteLine("# allocated_bytes_per_frame," + ((allocatedFrames > 0) ? (allocated / allocatedFrames) : 0).ToString());
+
+                double[] sorted = new double[msFrameCount];
+                for (int s = 0; s < (int)Stage.kCount; s++)
+                {
+                    Array.Copy(msTimes[s], sorted, msFrameCount);
+                    Array.Sort(sorted);
+
+                    double total = 0.0;
+                    for (int i = 0; i < msFrameCount; i++) { total += sorted[i]; }
+
+                    writer.WriteLine(string.Format("# {0}_ms (mean/median/p95/max),{1:0.000},{2:0.000},{3:0.000},{4:0.000}",
+                        kStageNames[s], total / msFrameCount, _Percentile(sorted, 0.5), _Percentile(sorted, 0.95), sorted[msFrameCount - 1]));
+                }
+
+                string header = "frame";
+                for (int s = 0; s < (int)Stage.kCount; s++) { header += "," + kStageNames[s] + "_ms"; }
+                writer.WriteLine(header + ",draws,triangles,allocated_bytes,collections");
+
+                for (int i = 0; i < msFrameCount; i++)
+                {
+                    string line = i.ToString();
+                    for (int s = 0; s < (int)Stage.kCount; s++) { line += "," + msTimes[s][i].ToString("0.0000"); }
+                    writer.WriteLine(line + "," + msDraws[i].ToString() + "," + msTriangles[i].ToString() + "," +
+                        ((msCollections[i] > 0) ? "" : msAllocated[i].ToString()) + "," + msCollections[i].ToString());
+                }
+            }
+        }
+
+        private static void _Finish()
+        {
+            Siat.Singleton.OnUpdateBegin -= _HandleUpdateBegin;
+            msbRunning = false;
+            msStep = null;
+
+            if (msReportFile != null) { _WriteReport(); }
+            if (msbExitWhenDone) { Siat.Singleton.Exit(); }
+        }
+        #endregion
+
+        #region Internal members
+        /// <summary>
+        /// Records the frame. Called by Siat.Draw() before the frame stats are reset.
+        /// </summary>
+        internal static void _Frame(double aUpdateTime, double aPoseTime, int aDraws, int aTriangles)
+        {
+            if (!msbRunning) { return; }
+
+            long memory = GC.GetTotalMemory(false);
+            int collections = _CollectionCount();
+
+            if (msWarmupFrames > 0)
+            {
+                if (CellStreamer.PendingCount == 0) { msWarmupFrames--; }
+            }
+            else
+            {
+                int i = msFrame;
+
+                msTimes[(int)Stage.kUpdate][i] = aUpdateTime;
+                msTimes[(int)Stage.kPose][i] = aPoseTime;
+                msTimes[(int)Stage.kOcclusion][i] = OcclusionRasterizer.RasterizeTime;
+                msTimes[(int)Stage.kLightJobs][i] = PoseJobs.CollectTime + PoseJobs.ApplyTime;
+                msTimes[(int)Stage.kDraw][i] = RenderRoot.DrawTime;
+                msTimes[(int)Stage.kSort][i] = RenderQueue.SortTime;
+                msTimes[(int)Stage.kSubmit][i] = RenderQueue.SubmitTime;
+                msTimes[(int)Stage.kFrame][i] = aUpdateTime + aPoseTime + RenderRoot.DrawTime;
+                msDraws[i] = aDraws;
+                msTriangles[i] = aTriangles;
+                msAllocated[i] = memory - msLastMemory;
+                msCollections[i] = collections - msLastCollections;
+
+                msChecksum = (msChecksum * 31u) + (uint)aDraws;
+                msChecksum = (msChecksum * 31u) + (uint)aTriangles;
+
+                msFrame++;
+            }
+
+            msLastMemory = memory;
+            msLastCollections = collections;
+
+            if (msFrame == msFrameCount) { _Finish(); }
+        }
+        #endregion
+
+        /// <summary>
+        /// Starts a run of aFrames measured frames after aWarmupFrames frames. aStep is called at
+        /// the beginning of each update with the measured frame number, 0 during warm up. If
+        /// aReportFile is not null, the summary and per frame samples are written to it as CSV.
+        /// If abExitWhenDone is true, Siat.Exit() is called at the end of the run.
+        /// </summary>
+        public static void Start(int aWarmupFrames, int aFrames, Step aStep, string aReportFile, bool abExitWhenDone)
+        {
+            if (msbRunning) { throw new Exception("A benchmark is already running."); }
+            if (aFrames <= 0) { throw new ArgumentOutOfRangeException("aFrames"); }
+
+            msTimes = new double[(int)Stage.kCount][];
+            for (int i = 0; i < (int)Stage.kCount; i++) { msTimes[i] = new double[aFrames]; }
+            msDraws = new int[aFrames];
+            msTriangles = new int[aFrames];
+            msAllocated = new long[aFrames];
+            msCollections = new int[aFrames];
+
+            msbExitWhenDone = abExitWhenDone;
+            msChecksum = 0;
+            msFrame = 0;
+            msFrameCount = aFrames;
+            msReportFile = aReportFile;
+            msStep = aStep;
+            msWarmupFrames = Math.Max(aWarmupFrames, 1);
+            msLastMemory = GC.GetTotalMemory(false);
+            msLastCollections = _CollectionCount();
+            msbRunning = true;
+
+            Siat.Singleton.OnUpdateBegin += _HandleUpdateBegin;
+        }
+
+        public static bool bRunning { get { return msbRunning; } }
+
+        /// <summary>
+        /// Checksum of the draw and triangle counts of the measured frames so far.
+        /// </summary>
+        public static uint Checksum { get { return msChecksum; } }
+
+        public static int FrameCount { get { return msFrameCount; } }
+
+        /// <summary>
+        /// Returns the time in milliseconds of aStage in measured frame aFrame.
+        /// </summary>
+        public static double GetTime(Stage aStage, int aFrame) { return msTimes[(int)aStage][aFrame]; }
+    }
+}
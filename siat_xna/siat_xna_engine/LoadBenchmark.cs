@@ -0,0 +1,90 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using Microsoft.Xna.Framework.Content;
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using siat.render;
+
+namespace siat
+{
+    /// <summary>
+    /// Measures how long content takes to load.
+    /// </summary>
+    /// <remarks>
+    /// To compare mesh packs against the per-object readers, build the same scene once with
+    /// ColladaProcessor.PackMeshes set to true and once set to false, and run both through Run().
+    /// </remarks>
+    public static class LoadBenchmark
+    {
+        #region Private members
+        private static double _Load<T>(Stopwatch aTimer, string aAsset)
+        {
+            ContentManager manager = new ContentManager(Siat.Singleton.Services);
+            List<MeshPack> packs = new List<MeshPack>();
+
+            aTimer.Reset();
+            aTimer.Start();
+            SceneReader._DeferUploads(packs);
+            try { manager.Load<T>(aAsset); }
+            finally { SceneReader._DeferUploads(null); }
+            foreach (MeshPack e in packs) { e.UploadAll(Siat.Singleton.GraphicsDevice); }
+            aTimer.Stop();
+
+            manager.Unload();
+            manager.Dispose();
+            foreach (MeshPack e in packs)
+            {
+                foreach (IDisposable r in e.Resources) { r.Dispose(); }
+            }
+
+            return aTimer.Elapsed.TotalMilliseconds;
+        }
+        #endregion
+
+        /// <summary>
+        /// Loads aAsset once, then aWarmRuns more times, each time with a new ContentManager.
+        /// Returns the time of the first load and the average time of the other loads in
+        /// milliseconds.
+        /// </summary>
+        /// <remarks>
+        /// The first load is cold only if it is the first load of aAsset by this process. It then
+        /// includes first use of the content readers and, unless the operating system already
+        /// caches the file, reading it from disk.
+        ///
+        /// \warning Each load is unloaded after it is timed, and the GPU resources of its mesh packs,
+        ///          which ContentManager.Unload() does not own, are disposed. Do not run this on an
+        ///          asset that is in use.
+        /// </remarks>
+        public static void Run<T>(string aAsset, int aWarmRuns, out double arColdTime, out double arWarmTime)
+        {
+            Stopwatch timer = new Stopwatch();
+
+            arColdTime = _Load<T>(timer, aAsset);
+            arWarmTime = 0.0;
+
+            for (int i = 0; i < aWarmRuns; i++) { arWarmTime += _Load<T>(timer, aAsset); }
+            if (aWarmRuns > 0) { arWarmTime /= aWarmRuns; }
+        }
+    }
+}
@@ -51,12 +51,50 @@ namespace siat
         protected override Animation Read(ContentReader aIn, Animation aExistingInstance)
         {
             Animation ret = new Animation(aIn.ReadString());
-            ret.KeyFrames = aIn.ReadObject<AnimationKeyFrame[]>();
+            if (aIn.ReadBoolean())
+            {
+                ret.Compressed = aIn.ReadObject<CompressedAnimation>();
+            }
+            else
+            {
+                ret.KeyFrames = aIn.ReadObject<AnimationKeyFrame[]>();
+            }
+            ret._AddToStats();
 
             return ret;
         }
     }
 
+    public sealed class CompressedAnimationReader : ContentTypeReader<CompressedAnimation>
+    {
+        private static AnimationTrack _ReadTrack(ContentReader aIn)
+        {
+            int components = aIn.ReadInt32();
+            Vector4 min = aIn.ReadVector4();
+            Vector4 extent = aIn.ReadVector4();
+
+            ushort[] frames = new ushort[aIn.ReadInt32()];
+            for (int i = 0; i < frames.Length; i++) { frames[i] = aIn.ReadUInt16(); }
+
+            ushort[] values = new ushort[frames.Length * components];
+            for (int i = 0; i < values.Length; i++) { values[i] = aIn.ReadUInt16(); }
+
+            return new AnimationTrack(components, frames, values, min, extent);
+        }
+
+        protected override CompressedAnimation Read(ContentReader aIn, CompressedAnimation aExistingInstance)
+        {
+            float[] times = new float[aIn.ReadInt32()];
+            for (int i = 0; i < times.Length; i++) { times[i] = aIn.ReadSingle(); }
+
+            AnimationTrack rotation = _ReadTrack(aIn);
+            AnimationTrack translation = _ReadTrack(aIn);
+            AnimationTrack scale = _ReadTrack(aIn);
+
+            return new CompressedAnimation(times, rotation, translation, scale);
+        }
+    }
+
     public sealed class EffectReader : ContentTypeReader<SiatEffect>
     {
         protected override SiatEffect Read(ContentReader aIn, SiatEffect aExistingInstance)
@@ -140,13 +178,28 @@ namespace siat
     public sealed class SceneReader : ContentTypeReader<SceneNode>
     {
         #region Private members
+        // Mesh parts of the mesh pack of the scene being read on this thread, or null if the
+        // scene stores mesh parts as shared resources.
+        [ThreadStatic]
+        private static MeshPart[] tsMeshPack;
+
+        // If not null, mesh packs read on this thread are added here instead of being uploaded.
+        [ThreadStatic]
+        private static List<MeshPack> tsDeferredUploads;
+
+        private static void _ReadMeshPartResource(ContentReader aIn, Action<MeshPart> aFixup)
+        {
+            if (tsMeshPack != null) { aFixup(tsMeshPack[aIn.ReadInt32()]); }
+            else { aIn.ReadSharedResource<MeshPart>(aFixup); }
+        }
+
         private SceneNode _ReadAnimatedMeshPart(ContentReader aIn, SceneNode aNode, bool abAlreadyExists)
         {
             AnimatedMeshPartNode ret = (abAlreadyExists) ? (AnimatedMeshPartNode)aNode : new AnimatedMeshPartNode();
 
             aIn.ReadSharedResource<SiatEffect>(delegate(SiatEffect a) { ret.Effect = a; });
             aIn.ReadSharedResource<SiatMaterial>(delegate(SiatMaterial a) { ret.Material = a; });
-            aIn.ReadSharedResource<MeshPart>(delegate(MeshPart a) { ret.MeshPart = a; });
+            _ReadMeshPartResource(aIn, delegate(MeshPart a) { ret.MeshPart = a; });
 
             if (!abAlreadyExists)
             {
@@ -227,7 +280,7 @@ namespace siat
 
             aIn.ReadSharedResource<SiatEffect>(delegate(SiatEffect a) { ret.Effect = a; });
             aIn.ReadSharedResource<SiatMaterial>(delegate(SiatMaterial a) { ret.Material = a; });
-            aIn.ReadSharedResource<MeshPart>(delegate(MeshPart a) { ret.MeshPart = a; });
+            _ReadMeshPartResource(aIn, delegate(MeshPart a) { ret.MeshPart = a; });
 
             return ret;
         }
@@ -338,7 +391,7 @@ namespace siat
 
             aIn.ReadSharedResource<SiatEffect>(delegate(SiatEffect a) { ret.Effect = a; });
             aIn.ReadSharedResource<SiatMaterial>(delegate(SiatMaterial a) { ret.Material = a; });
-            aIn.ReadSharedResource<MeshPart>(delegate(MeshPart a) { ret.MeshPart = a; });
+            _ReadMeshPartResource(aIn, delegate(MeshPart a) { ret.MeshPart = a; });
 
             return ret;
         }
@@ -373,12 +426,42 @@ namespace siat
         }
         #endregion
 
+        #region Internal members
+        /// <summary>
+        /// Defers GPU buffer creation of mesh packs read on the calling thread.
+        /// </summary>
+        /// <param name="aUploads">Receives packs that still need MeshPack.Upload(), or null to upload immediately.</param>
+        internal static void _DeferUploads(List<MeshPack> aUploads)
+        {
+            tsDeferredUploads = aUploads;
+        }
+        #endregion
+
         protected override SceneNode Read(ContentReader aIn, SceneNode aExistingInstance)
         {
-            SceneNode ret = new SceneNode();
-            _ReadSceneNode(aIn, ret);
+            MeshPart[] previousPack = tsMeshPack;
+            tsMeshPack = null;
 
-            return ret;
+            try
+            {
+                if (aIn.ReadBoolean())
+                {
+                    MeshPack pack = new MeshPack(aIn.ReadBytes(aIn.ReadInt32()));
+                    if (tsDeferredUploads != null) { tsDeferredUploads.Add(pack); }
+                    else { pack.UploadAll(Siat.Singleton.GraphicsDevice); }
+
+                    tsMeshPack = pack.Parts;
+                }
+
+                SceneNode ret = new SceneNode();
+                _ReadSceneNode(aIn, ret);
+
+                return ret;
+            }
+            finally
+            {
+                tsMeshPack = previousPack;
+            }
         }
     }
 }
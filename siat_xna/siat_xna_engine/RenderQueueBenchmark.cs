@@ -0,0 +1,167 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using System;
+using System.IO;
+using siat.render;
+using siat.scene;
+
+namespace siat
+{
+    /// <summary>
+    /// Measures the CPU cost of sorting and submitting the render queue against the number of
+    /// queued commands.
+    /// </summary>
+    /// <remarks>
+    /// The commands of each frame are repeated, in order, up to each node count of the run (see
+    /// RenderQueue._ReplicateCount), so the counts share the state changes of the scene in view
+    /// and only the number of commands varies. Counts below the number of commands the scene
+    /// queues by itself measure the scene as-is.
+    ///
+    /// As with FrameBenchmark, set Siat.bNullDevice before Siat.Run() so only the CPU side of
+    /// submission is measured, and keep the camera still, since the commands of each frame
+    /// depend on the view.
+    /// </remarks>
+    public static class RenderQueueBenchmark
+    {
+        public static readonly int[] kDefaultNodeCounts = new int[] { 1000, 2000, 4000, 8000, 16000, 32000, 64000 };
+
+        #region Private members
+        private static bool msbRunning = false;
+        private static bool msbExitWhenDone = false;
+        private static int[] msNodeCounts = null;
+        private static int msCountIndex = 0;
+        private static int msFrame = 0;
+        private static int msFrames = 0;
+        private static int msWarmupFrames = 0;
+        private static string msReportFile = null;
+
+        private static int[] msQueued = null;
+        private static int[] msSubmitted = null;
+        private static int[] msStateChanges = null;
+        private static int[] msStateChangesFiltered = null;
+        private static double[] msSortTimes = null;
+        private static double[] msSubmitTimes = null;
+
+        private static void _WriteReport()
+        {
+            using (StreamWriter writer = new StreamWriter(msReportFile, false))
+            {
+                writer.WriteLine("# frames_per_count," + msFrames.ToString());
+                writer.WriteLine("node_count,queued,submitted,state_changes,state_changes_filtered,sort_ms,submit_ms,submit_us_per_command");
+
+                for (int i = 0; i < msNodeCounts.Length; i++)
+                {
+                    double queued = ((double)msQueued[i] / msFrames);
+                    double submit = (msSubmitTimes[i] / msFrames);
+
+                    writer.WriteLine(string.Format("{0},{1:0},{2:0},{3:0},{4:0},{5:0.0000},{6:0.0000},{7:0.0000}",
+                        msNodeCounts[i],
+                        queued,
+                        (double)msSubmitted[i] / msFrames,
+                        (double)msStateChanges[i] / msFrames,
+                        (double)msStateChangesFiltered[i] / msFrames,
+                        msSortTimes[i] / msFrames,
+                        submit,
+                        (queued > 0.0) ? ((submit * 1000.0) / queued) : 0.0));
+                }
+            }
+        }
+
+        private static void _Finish()
+        {
+            RenderQueue._ReplicateCount = 0;
+            msbRunning = false;
+
+            if (msReportFile != null) { _WriteReport(); }
+            if (msbExitWhenDone) { Siat.Singleton.Exit(); }
+        }
+        #endregion
+
+        #region Internal members
+        /// <summary>
+        /// Records the frame. Called by Siat.Draw() before the frame stats are reset.
+        /// </summary>
+        internal static void _Frame()
+        {
+            if (!msbRunning) { return; }
+
+            if (msWarmupFrames > 0)
+            {
+                if (CellStreamer.PendingCount == 0) { msWarmupFrames--; }
+                return;
+            }
+
+            int i = msCountIndex;
+            msQueued[i] += RenderQueue.QueuedCount;
+            msSubmitted[i] += RenderQueue.SubmittedCount;
+            msStateChanges[i] += RenderQueue.StateChanges;
+            msStateChangesFiltered[i] += RenderQueue.StateChangesFiltered;
+            msSortTimes[i] += RenderQueue.SortTime;
+            msSubmitTimes[i] += RenderQueue.SubmitTime;
+
+            msFrame++;
+            if (msFrame == msFrames)
+            {
+                msFrame = 0;
+                msCountIndex++;
+
+                if (msCountIndex == msNodeCounts.Length) { _Finish(); }
+                else { RenderQueue._ReplicateCount = msNodeCounts[msCountIndex]; }
+            }
+        }
+        #endregion
+
+        /// <summary>
+        /// Starts a run that measures aFrames frames at each count of aNodeCounts, after
+        /// aWarmupFrames frames. The mean of each count is written to aReportFile as CSV.
+        /// If abExitWhenDone is true, Siat.Exit() is called at the end of the run.
+        /// </summary>
+        public static void Start(int[] aNodeCounts, int aWarmupFrames, int aFrames, string aReportFile, bool abExitWhenDone)
+        {
+            if (msbRunning) { throw new Exception("A benchmark is already running."); }
+            if (aNodeCounts == null || aNodeCounts.Length == 0) { throw new ArgumentException("aNodeCounts"); }
+            if (aFrames <= 0) { throw new ArgumentOutOfRangeException("aFrames"); }
+
+            int count = aNodeCounts.Length;
+            msNodeCounts = (int[])aNodeCounts.Clone();
+            msQueued = new int[count];
+            msSubmitted = new int[count];
+            msStateChanges = new int[count];
+            msStateChangesFiltered = new int[count];
+            msSortTimes = new double[count];
+            msSubmitTimes = new double[count];
+
+            msbExitWhenDone = abExitWhenDone;
+            msCountIndex = 0;
+            msFrame = 0;
+            msFrames = aFrames;
+            msReportFile = aReportFile;
+            msWarmupFrames = Math.Max(aWarmupFrames, 1);
+            msbRunning = true;
+
+            RenderQueue._ReplicateCount = msNodeCounts[0];
+        }
+
+        public static bool bRunning { get { return msbRunning; } }
+    }
+}
@@ -88,5 +88,10 @@ namespace siat
         {
             msCount = msStorage;
         }
+
+        /// <summary>
+        /// Number of objects grabbed since the last Reset().
+        /// </summary>
+        public static int Used { get { return (msStorage - msCount); } }
     }
 }
@@ -28,6 +28,7 @@ using Microsoft.Xna.Framework.Graphics;
 using Microsoft.Xna.Framework.Input;
 using System;
 using System.Collections.Generic;
+using System.Diagnostics;
 using siat.render;
 using siat.scene;
 
@@ -128,6 +129,9 @@ namespace siat
         private MeshPart mUnitQuadMeshPart;
         private MeshPart mUnitSphereMeshPart;
         private bool mbDoneLoadInternal = false;
+        private bool mbNullDevice = false;
+        private TimeSpan mFixedTimeStep = TimeSpan.Zero;
+        private TimeSpan mFixedTotalTime = TimeSpan.Zero;
 
         #region GUI output
         private List<GuiElement> mGuiElements = new List<GuiElement>();
@@ -143,6 +147,9 @@ namespace siat
         private int mMinPerOp = int.MaxValue;
         private int mMaxPerOp = int.MinValue;
         internal int mEffectPasses = 0;
+        private Stopwatch mStageTimer = new Stopwatch();
+        private double mUpdateTime = 0.0;
+        private double mPoseTime = 0.0;
 
         private const byte kBackAlpha = 127;
         private Color mConsoleColor = Color.White;
@@ -186,6 +193,8 @@ namespace siat
 
         private void _HandlePreparingDeviceSettings(object aSender, PreparingDeviceSettingsEventArgs e)
         {
+            if (mbNullDevice) { e.GraphicsDeviceInformation.DeviceType = DeviceType.NullReference; }
+
             #region Setup multisampling
 #if ENABLE_MULTISAMPLING
             if (!Deferred.bActive)
@@ -588,15 +597,22 @@ namespace siat
         /// <param name="aDrawTick">Time data for the current draw tick.</param>
         protected override void Draw(GameTime aDrawTick)
         {
-            mCurrentTick = aDrawTick;
+            // With a fixed time step, the tick of the preceding update is kept.
+            if (mFixedTimeStep == TimeSpan.Zero) { mCurrentTick = aDrawTick; }
             RenderState rs = GraphicsDevice.RenderState;
 
             #region Posing
             mFrameTick++;
 
+            mStageTimer.Reset();
+            mStageTimer.Start();
             if (OnPoseBegin != null) OnPoseBegin();
+            OcclusionRasterizer.Rasterize();
             if (mActiveCamera != null) mActiveCamera.StartPose();
+            PoseJobs.Run();
             if (OnPoseEnd != null) OnPoseEnd();
+            mStageTimer.Stop();
+            mPoseTime = mStageTimer.Elapsed.TotalMilliseconds;
             #endregion
 
             RenderRoot.msGraphics = GraphicsDevice;
@@ -625,6 +641,19 @@ namespace siat
                 AddConsoleLine("Min per op: " + string.Format("{0}", mMinPerOp));
                 AddConsoleLine("Max per op: " + string.Format("{0}", mMaxPerOp));
                 AddConsoleLine("Effect passes: " + string.Format("{0}", mEffectPasses));
+                AddConsoleLine("Render nodes: " + string.Format("{0}", RenderRoot.RenderNodeCount));
+                AddConsoleLine("Render queue (cmds/fused/changes/filtered): " + string.Format("{0}/{1}/{2}/{3}", RenderQueue.SubmittedCount, RenderQueue.FusedCount, RenderQueue.StateChanges, RenderQueue.StateChangesFiltered));
+                AddConsoleLine("Effect constants (uploads/filtered/commits/filtered): " + string.Format("{0}/{1}/{2}/{3}", SiatEffect.ConstantUploads, SiatEffect.ConstantsFiltered, SiatEffect.Commits, SiatEffect.CommitsFiltered));
+                AddConsoleLine("Submit ms (total/queue sort/queue submit): " + string.Format("{0:0.000}/{1:0.000}/{2:0.000}", RenderRoot.DrawTime, RenderQueue.SortTime, RenderQueue.SubmitTime));
+                AddConsoleLine("Shadow layers (static/composite/reused): " + string.Format("{0}/{1}/{2}", ShadowMaps.StaticRenderCount, ShadowMaps.CompositeRenderCount, ShadowMaps.ReusedCount));
+                AddConsoleLine("Shadow casters (considered/drawn): " + string.Format("{0}/{1}", ShadowMaps.CastersConsidered, ShadowMaps.CastersDrawn));
+                AddConsoleLine("Light jobs (count/threads/collect ms/apply ms): " + string.Format("{0}/{1}/{2:0.000}/{3:0.000}", PoseJobs.JobCount, WorkPool.ThreadCount, PoseJobs.CollectTime, PoseJobs.ApplyTime));
+                AddConsoleLine("Portal scissor (portals/empty/grown/draws/rejected lights/kpixels in/out): " + string.Format("{0}/{1}/{2}/{3}/{4}/{5}/{6}", PortalScissor.PortalCount, PortalScissor.EmptyCount, PortalScissor.GrownCount, PortalScissor.DrawCount, PortalScissor.RejectedLights, PortalScissor.PixelsInside / 1000, PortalScissor.PixelsOutside / 1000));
+                AddConsoleLine("Animation (samples/sample ms/KB/uncompressed KB): " + string.Format("{0}/{1:0.000}/{2}/{3}", Animation.SampleCount, Animation.SampleTime, Animation.LoadedMemorySize / 1024, Animation.LoadedUncompressedMemorySize / 1024));
+                if (OcclusionRasterizer.Mode != OcclusionMode.Hardware) AddConsoleLine("Software occlusion (occluders/triangles/ms): " + string.Format("{0}/{1}/{2:0.000}", OcclusionRasterizer.OccluderCount, OcclusionRasterizer.TriangleCount, OcclusionRasterizer.RasterizeTime));
+                if (OcclusionRasterizer.Mode == OcclusionMode.Compare) AddConsoleLine("Occlusion compare (tested/hardware/software/both): " + string.Format("{0}/{1}/{2}/{3}", OcclusionRasterizer.ComparedCount, OcclusionRasterizer.HardwareOccludedCount, OcclusionRasterizer.SoftwareOccludedCount, OcclusionRasterizer.BothOccludedCount));
+                if (FrameProfiler.bOverlay) FrameProfiler._AddConsoleLines(this);
+                AddConsoleLine("Streaming (pending/resident KB/upload KB/ms/latency ms/max ms/hitches/blocking): " + string.Format("{0}/{1}/{2}/{3:0.000}/{4:0.0}/{5:0.0}/{6}/{7}", CellStreamer.PendingCount, Cache.TotalCacheSize / 1024, CellStreamer.UploadedBytes / 1024, CellStreamer.TickTime, CellStreamer.AverageLatency, CellStreamer.MaxLatency, CellStreamer.HitchCount, CellStreamer.BlockingLoadCount));
             }
 
             mGuiBatch.Begin(SpriteBlendMode.AlphaBlend, SpriteSortMode.Deferred, SaveStateMode.None);
@@ -692,9 +721,22 @@ namespace siat
 
             _RestoreState();
 
+            FrameBenchmark._Frame(mUpdateTime, mPoseTime, mDrawOpCount, mFacetsCount);
+            RenderQueueBenchmark._Frame();
+
             mFacetsCount = 0;
             mDrawOpCount = 0;
+            mUpdateTime = 0.0;
+            mPoseTime = 0.0;
             mEffectPasses = 0;
+            ShadowMaps._ResetStats();
+            RenderRoot._ResetStats();
+            SiatEffect._ResetStats();
+            PoseJobs._ResetStats();
+            Animation._ResetStats();
+            OcclusionRasterizer._ResetStats();
+            CellStreamer._ResetStats();
+            FrameProfiler._EndFrame();
             mMinPerOp = int.MaxValue;
             mMaxPerOp = int.MinValue;
             mConsole.Clear();
@@ -715,7 +757,18 @@ namespace siat
 
         protected override void Update(GameTime aCurrentUpdateTick)
         {
-            mCurrentTick = aCurrentUpdateTick;
+            mStageTimer.Reset();
+            mStageTimer.Start();
+
+            if (mFixedTimeStep != TimeSpan.Zero)
+            {
+                mFixedTotalTime += mFixedTimeStep;
+                mCurrentTick = new GameTime(aCurrentUpdateTick.TotalRealTime, aCurrentUpdateTick.ElapsedRealTime, mFixedTotalTime, mFixedTimeStep);
+            }
+            else
+            {
+                mCurrentTick = aCurrentUpdateTick;
+            }
 
             mInput.Update();
 
@@ -733,10 +786,14 @@ namespace siat
             #endregion
 
             if (OnUpdateBegin != null) OnUpdateBegin();
+            CellStreamer.Tick();
             if (mActiveCamera != null && mActiveCamera.Cell != null) mActiveCamera.StartUpdate();
             if (OnUpdateEnd != null) OnUpdateEnd();
 
             base.Update(aCurrentUpdateTick);
+
+            mStageTimer.Stop();
+            mUpdateTime = mStageTimer.Elapsed.TotalMilliseconds;
         }
         #endregion
 
@@ -805,6 +862,39 @@ namespace siat
 
         public bool bConsoleEnabled { get { return mbConsoleEnabled; } set { mbConsoleEnabled = value; } }
         public bool bStatsEnabled { get { return mbStatsEnabled; } set { mbStatsEnabled = value; } }
+
+        /// <summary>
+        /// If true, the device is created as the Direct3D null reference device, which accepts
+        /// all calls but draws nothing. Must be set before Run().
+        /// </summary>
+        /// <seealso cref="siat.FrameBenchmark"/>
+        public bool bNullDevice { get { return mbNullDevice; } set { mbNullDevice = value; } }
+
+        /// <summary>
+        /// If not zero, Time advances by exactly this amount each update instead of by the
+        /// measured time, so that runs are repeatable.
+        /// </summary>
+        public TimeSpan FixedTimeStep { get { return mFixedTimeStep; } set { mFixedTimeStep = value; } }
+
+        /// <summary>
+        /// Number of indexed draws this frame.
+        /// </summary>
+        public int DrawOpCount { get { return mDrawOpCount; } }
+
+        /// <summary>
+        /// Number of primitives drawn this frame.
+        /// </summary>
+        public int FacetsCount { get { return mFacetsCount; } }
+
+        /// <summary>
+        /// Time in milliseconds of the last update.
+        /// </summary>
+        public double UpdateTime { get { return mUpdateTime; } }
+
+        /// <summary>
+        /// Time in milliseconds of the pose pass this frame.
+        /// </summary>
+        public double PoseTime { get { return mPoseTime; } }
         public SiatEffect BuiltInEffect { get { return mBuiltInEffect; } }
 
         public bool bEnableSoftwareMouseCursor
@@ -884,6 +974,7 @@ namespace siat
 
         public void DrawIndexedPrimitives()
         {
+            FrameProfiler._Draw(DrawIndexedSettings.PrimitiveCount);
             mDrawOpCount++;
             mMinPerOp = Utilities.Min(mMinPerOp, DrawIndexedSettings.PrimitiveCount);
             mMaxPerOp = Utilities.Max(mMaxPerOp, DrawIndexedSettings.PrimitiveCount);
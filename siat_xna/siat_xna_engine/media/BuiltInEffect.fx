@@ -25,12 +25,24 @@
 //-----------------------------------------------------------------------------
 // standard input constants
 //-----------------------------------------------------------------------------
+float4x4 ProjectionTransform : siat_ProjectionTransform;
 float4 SkinningTransforms[kSkinningMatricesSize] : siat_SkinningTransforms;
 float ShadowFarDepth : siat_ShadowRange;
+texture ShadowTexture : siat_ShadowTexture;
 float4x4 ViewProjectionTransform : siat_ViewProjectionTransform;
 float4x4 ViewTransform : siat_ViewTransform;
 float4x4 WorldTransform : siat_WorldTransform;
 
+sampler ShadowSampler = sampler_state
+{
+	texture = <ShadowTexture>;
+	AddressU = clamp;
+	AddressV = clamp;
+	MinFilter = POINT;
+	MagFilter = POINT;
+	MipFilter = NONE;
+};
+
 //-----------------------------------------------------------------------------
 // inputs outputs
 //-----------------------------------------------------------------------------
@@ -51,6 +63,25 @@ struct vsOut
 	float4 Position : POSITION;
 };
 
+struct vsInQuad
+{
+	float4 Position : POSITION;
+	float2 UV : TEXCOORD0;
+};
+
+struct vsOutComposite
+{
+	float4 Position : POSITION;
+	float2 UV : TEXCOORD0;
+	float2 ViewRay : TEXCOORD1;
+};
+
+struct psOutComposite
+{
+	float4 Color : COLOR;
+	float Depth : DEPTH;
+};
+
 struct vsOutShadow
 {
 	float4 Position : POSITION;
@@ -99,6 +130,18 @@ vsOutShadow VertexAnimatedShadow(vsInAnimated aIn)
 	return output;
 }
 
+// Full screen quad over a shadow map. ViewRay is the light view space ray at z = -1.
+vsOutComposite VertexShadowComposite(vsInQuad aIn)
+{
+	vsOutComposite output;
+	
+	output.Position = float4(aIn.Position.xy, 0, 1);
+	output.UV = float2(aIn.UV.x, 1.0 - aIn.UV.y) + (0.5 * kShadowDelta);
+	output.ViewRay = float2(aIn.Position.x / ProjectionTransform._11, aIn.Position.y / ProjectionTransform._22);
+	
+	return output;
+}
+
 vsOutShadow VertexShadow(vsIn aIn)
 {
 	vsOutShadow output;
@@ -135,6 +178,21 @@ float4 FragmentShadowDepth(vsOutShadow aIn) : COLOR
 	return float4(linearDepth, 0, 0, 0);
 }
 
+// Copies a static shadow layer, reconstructing hardware depth from the stored radial depth
+// so that dynamic casters drawn afterwards are depth tested against static casters.
+psOutComposite FragmentShadowComposite(vsOutComposite aIn)
+{
+	psOutComposite output;
+	
+	float ln = tex2D(ShadowSampler, aIn.UV).r;
+	float z = -(ln * ShadowFarDepth) / length(float3(aIn.ViewRay, -1));
+	
+	output.Color = float4(ln, 0, 0, 0);
+	output.Depth = saturate(((z * ProjectionTransform._33) + ProjectionTransform._43) / -z);
+	
+	return output;
+}
+
 float4 FragmentSimple(vsOut aIn) : COLOR
 {
 	return float4(0, 0, 0, 1);
@@ -172,6 +230,22 @@ technique siat_RenderPortal
 	}
 }
 
+technique siat_RenderShadowComposite
+{
+	pass
+	{
+		AlphaBlendEnable = false;
+		AlphaTestEnable = false;
+		ColorWriteEnable = RED|GREEN|BLUE|ALPHA;
+		CullMode = None;
+		FillMode = Solid;
+		ZWriteEnable = true;
+		
+		VertexShader = compile vs_2_a VertexShadowComposite();
+		PixelShader = compile ps_2_a FragmentShadowComposite();
+	}
+}
+
 technique siat_RenderShadowDepth
 {
 	pass
@@ -23,7 +23,9 @@
 using Microsoft.Xna.Framework;
 using System;
 using System.Collections.Generic;
+using System.Diagnostics;
 using System.Text;
+using System.Threading;
 
 namespace siat.render
 {
@@ -41,9 +43,10 @@ namespace siat.render
         {
             if (aAnimation != null && (mbPlay || mbDirty))
             {
+                int frameCount = aAnimation.FrameCount;
                 bool bOk = (mStartIndex >= 0 &&
                             mStartIndex < mEndIndex &&
-                            mEndIndex < aAnimation.KeyFrames.Length);
+                            mEndIndex < frameCount);
                 
                 mCurrentIndex = Utilities.Clamp(mCurrentIndex, mStartIndex, mEndIndex);
 
@@ -51,7 +54,7 @@ namespace siat.render
 
                 if (bOk && mbDirty)
                 {
-                    mStartTime = (currentTime - aAnimation.KeyFrames[mCurrentIndex].Time);
+                    mStartTime = (currentTime - aAnimation.GetTime(mCurrentIndex));
                     mbDirty = false;
                 }
 
@@ -59,26 +62,25 @@ namespace siat.render
 
                 if (bOk)
                 {
-                    while (relTime > aAnimation.KeyFrames[mCurrentIndex + 1].Time)
+                    while (relTime > aAnimation.GetTime(mCurrentIndex + 1))
                     {
                         mCurrentIndex++;
 
                         if (mCurrentIndex >= mEndIndex)
                         {
                             mCurrentIndex = mStartIndex;
-                            mStartTime += (aAnimation.KeyFrames[mEndIndex].Time - aAnimation.KeyFrames[mStartIndex].Time);
+                            mStartTime += (aAnimation.GetTime(mEndIndex) - aAnimation.GetTime(mStartIndex));
                             relTime = (currentTime - mStartTime);
                         }
                     }
 
-                    float lerp = Utilities.Clamp((relTime - aAnimation.KeyFrames[mCurrentIndex].Time) / (aAnimation.KeyFrames[mCurrentIndex + 1].Time - aAnimation.KeyFrames[mCurrentIndex].Time), 0.0f, 1.0f);
-                    Matrix.Lerp(ref aAnimation.KeyFrames[mCurrentIndex].Key, ref aAnimation.KeyFrames[mCurrentIndex + 1].Key, lerp, out m);
+                    aAnimation._Sample(mCurrentIndex, relTime, out m);
 
                     return true;
                 }
-                else if (aAnimation.KeyFrames.Length > 0)
+                else if (frameCount > 0)
                 {
-                    m = aAnimation.KeyFrames[0].Key;
+                    aAnimation._Sample(0, aAnimation.GetTime(0), out m);
                     return true;
                 }
             }
@@ -93,10 +95,82 @@ namespace siat.render
         public bool bPlay { get { return mbPlay; } set { if (value != mbPlay) { mbPlay = value; mCurrentIndex = mStartIndex; mbDirty = true; } } }
     }
 
-    public sealed class Animation
+    /// <summary>
+    /// The animation of a single joint, either as matrix key frames or as a CompressedAnimation.
+    /// </summary>
+    /// <remarks>
+    /// Animations are disposed when the content that loaded them is unloaded, which removes them
+    /// from LoadedMemorySize and LoadedUncompressedMemorySize.
+    /// </remarks>
+    public sealed class Animation : IDisposable
     {
         #region Private members
         private AnimationKeyFrame[] mKeyFrames = new AnimationKeyFrame[0];
+        private CompressedAnimation mCompressed = null;
+        private int mStatsMemory = 0;
+        private int mStatsUncompressedMemory = 0;
+
+        private static Stopwatch msTimer = new Stopwatch();
+        private static int msPassDepth = 0;
+        private static int msSampleCount = 0;
+        private static int msMemory = 0;
+        private static int msUncompressedMemory = 0;
+        #endregion
+
+        #region Internal members
+        internal void _Sample(int aFrame, float aTime, out Matrix m)
+        {
+            if (mCompressed != null)
+            {
+                mCompressed.Sample(aFrame, aTime, out m);
+            }
+            else if (aFrame + 1 < mKeyFrames.Length)
+            {
+                float t0 = mKeyFrames[aFrame].Time;
+                float t1 = mKeyFrames[aFrame + 1].Time;
+                float lerp = (t1 > t0) ? Utilities.Clamp((aTime - t0) / (t1 - t0), 0.0f, 1.0f) : 0.0f;
+                Matrix.Lerp(ref mKeyFrames[aFrame].Key, ref mKeyFrames[aFrame + 1].Key, lerp, out m);
+            }
+            else
+            {
+                m = mKeyFrames[aFrame].Key;
+            }
+
+            msSampleCount++;
+        }
+
+        /// <summary>
+        /// Begins timing the update of a joint hierarchy, which samples the animation of each of
+        /// its joints. Nested calls are timed by the outermost pair.
+        /// </summary>
+        internal static void _BeginPass()
+        {
+            if (msPassDepth++ == 0) { msTimer.Start(); }
+        }
+
+        internal static void _EndPass()
+        {
+            if (--msPassDepth == 0) { msTimer.Stop(); }
+        }
+
+        /// <summary>
+        /// Adds the memory of a loaded animation to MemorySize and UncompressedMemorySize. Can be
+        /// called from content loading threads.
+        /// </summary>
+        internal void _AddToStats()
+        {
+            mStatsMemory = MemorySize;
+            mStatsUncompressedMemory = FrameCount * AnimationKeyFrame.kSizeInBytes;
+
+            Interlocked.Add(ref msMemory, mStatsMemory);
+            Interlocked.Add(ref msUncompressedMemory, mStatsUncompressedMemory);
+        }
+
+        internal static void _ResetStats()
+        {
+            msSampleCount = 0;
+            msTimer.Reset();
+        }
         #endregion
 
         public Animation(string aId)
@@ -106,6 +180,59 @@ namespace siat.render
 
         public readonly string Id;
 
+        /// <summary>
+        /// Removes this animation from the loaded memory stats. Called by ContentManager.Unload().
+        /// </summary>
+        public void Dispose()
+        {
+            Interlocked.Add(ref msMemory, -mStatsMemory);
+            Interlocked.Add(ref msUncompressedMemory, -mStatsUncompressedMemory);
+
+            mStatsMemory = 0;
+            mStatsUncompressedMemory = 0;
+        }
+
+        public int FrameCount { get { return (mCompressed != null) ? mCompressed.FrameCount : mKeyFrames.Length; } }
+
+        public float GetTime(int aFrame)
+        {
+            return (mCompressed != null) ? mCompressed.Times[aFrame] : mKeyFrames[aFrame].Time;
+        }
+
         public AnimationKeyFrame[] KeyFrames { get { return mKeyFrames; } set { mKeyFrames = value; } }
+
+        /// <summary>
+        /// If not null, the animation is sampled from this instead of KeyFrames.
+        /// </summary>
+        public CompressedAnimation Compressed { get { return mCompressed; } set { mCompressed = value; } }
+
+        /// <summary>
+        /// Size in bytes of the key frame data of this animation.
+        /// </summary>
+        public int MemorySize
+        {
+            get { return (mCompressed != null) ? mCompressed.MemorySize : (mKeyFrames.Length * AnimationKeyFrame.kSizeInBytes); }
+        }
+
+        /// <summary>
+        /// Number of joint animations sampled this frame.
+        /// </summary>
+        public static int SampleCount { get { return msSampleCount; } }
+
+        /// <summary>
+        /// Time in milliseconds spent updating animated joint hierarchies this frame, which includes
+        /// sampling their animations and updating their transforms.
+        /// </summary>
+        public static double SampleTime { get { return msTimer.Elapsed.TotalMilliseconds; } }
+
+        /// <summary>
+        /// Total size in bytes of the key frame data of all loaded animations.
+        /// </summary>
+        public static int LoadedMemorySize { get { return msMemory; } }
+
+        /// <summary>
+        /// Total size in bytes all loaded animations would take as AnimationKeyFrame arrays.
+        /// </summary>
+        public static int LoadedUncompressedMemorySize { get { return msUncompressedMemory; } }
     }
 }
@@ -46,9 +46,26 @@ namespace siat.render
             kSpotlightMask,
             kSpotlightShadow,
             kSpotlightShadowMask,
+            kReducedGeometry,
+            kReducedDirectional,
+            kReducedPoint,
+            kReducedSpotlight,
+            kUpsample,
             kVertex
         }
 
+        /// <summary>
+        /// Controls how LightNode.Resolution is applied. kFull lights everything at full
+        /// resolution as a reference, kSplit lights reduced resolution lights at full resolution
+        /// on the left half of the screen and reduced on the right half for comparison.
+        /// </summary>
+        public enum ResolutionMode
+        {
+            kPerLight,
+            kFull,
+            kSplit
+        }
+
         #region Shader source
         #region Common
         public const string kGlobals =
@@ -84,7 +101,9 @@ namespace siat.render
             SpotDirection = 9,
             SpotFalloffCosAngle = 10,
             SpotFalloffExponent = 11,
-            Range2 = 12
+            Range2 = 12,
+            ReducedResolution = 13,
+            FullResolution = 14
         }
 
         public const string kFragmentPre = 
@@ -182,6 +201,72 @@ namespace siat.render
 
                 ret *= spot;
             ";
+
+        // Reduced resolution lights accumulate the diffuse and specular light terms separately
+        // into two targets. Surface colors are applied when upsampling. Lights are not masked
+        // with the stencil buffer, so range and spot cone are rejected in the shader.
+        public const string kReducedFragmentPre =
+            kGlobals +
+
+            @"
+                float3 LightAttenuation : register(c0);
+                float3 LightDiffuse : register(c1);
+                float3 LightSpecular : register(c2);
+                float3 LightV : register(c3);
+                float3 SpotDirection : register(c9);
+                float SpotFalloffCosAngle : register(c10);
+                float SpotFalloffExponent : register(c11);
+                float Range2 : register(c12);
+
+                texture ReducedTexture0 : register(t0);
+                texture ReducedTexture1 : register(t1);
+
+                sampler ReducedSampler0 : register(s0) = sampler_state { texture = <ReducedTexture0>; };
+                sampler ReducedSampler1 : register(s1) = sampler_state { texture = <ReducedTexture1>; };
+
+                struct psReducedOut
+                {
+                    float4 Diffuse : COLOR0;
+                    float4 Specular : COLOR1;
+                };
+
+                psReducedOut Fragment(vsOut aIn)
+                {
+                    float4 pixelEyePositionShininess = tex2Dproj(ReducedSampler0, aIn.TextureLookup);
+                    float3 pixelEyePosition = pixelEyePositionShininess.rgb;
+                    float3 pixelEyeNormal = tex2Dproj(ReducedSampler1, aIn.TextureLookup).rgb;
+            ";
+
+        public const string kReducedNonDirectionalPre =
+            kReducedFragmentPre +
+
+            @"
+                float3 lv = (LightV - pixelEyePosition);
+                float d2 = dot(lv, lv);
+                float distance = sqrt(d2);
+                lv = normalize(lv);
+
+                float ndotl = dot(pixelEyeNormal, lv);
+
+                float3 ev = normalize(-pixelEyePosition);
+                float3 rv = (2.0f * ndotl * pixelEyeNormal) - lv;
+
+                float att = 1.0f / (LightAttenuation.x + (LightAttenuation.y * distance) + (LightAttenuation.z * distance * distance));
+                if (d2 > Range2) { att = 0.0f; }
+
+                float idiff = max(ndotl, 0.0f);
+                float ispec = (ndotl > 0.0f) ? pow(max(dot(ev, rv), 0.0f), max(pixelEyePositionShininess.a, 1e-3)) : 0.0f;
+            ";
+
+        public const string kReducedPost =
+            @"
+                psReducedOut ret;
+                ret.Diffuse = float4(LightDiffuse * (idiff * att), 0);
+                ret.Specular = float4(LightSpecular * (ispec * att), 0);
+
+                return ret;
+                }
+            ";
         #endregion
 
         public static readonly string[] kSources = new string[]
@@ -343,6 +428,138 @@ namespace siat.render
                     }
                 ",
 
+                // Reduced geometry
+                kGlobals +
+                @"
+                    float4 FullResolution : register(c14);
+
+                    texture MrtTexture1 : register(t1);
+                    texture MrtTexture2 : register(t2);
+                    texture MrtTexture3 : register(t3);
+
+                    sampler MrtSampler1 : register(s1) = sampler_state { texture = <MrtTexture1>; };
+                    sampler MrtSampler2 : register(s2) = sampler_state { texture = <MrtTexture2>; };
+                    sampler MrtSampler3 : register(s3) = sampler_state { texture = <MrtTexture3>; };
+
+                    struct psGeometryOut
+                    {
+                        float4 EyePositionShininess : COLOR0;
+                        float4 EyeNormal : COLOR1;
+                    };
+
+                    psGeometryOut Fragment(vsOut aIn)
+                    {
+                        // Point sample a single full resolution texel of the block, averaging
+                        // positions or normals would invent geometry at edges.
+                        float2 uv = (aIn.TextureLookup.xy / aIn.TextureLookup.w) - (0.5f * FullResolution.zw);
+
+                        psGeometryOut ret;
+                        ret.EyePositionShininess = float4(tex2D(MrtSampler2, uv).rgb, tex2D(MrtSampler1, uv).a);
+                        ret.EyeNormal = float4(tex2D(MrtSampler3, uv).rgb, 0);
+
+                        return ret;
+                    }
+                ",
+
+                // Reduced directional
+                kReducedFragmentPre +
+                @"
+                    float3 lv = normalize(-LightV);
+                    float ndotl = dot(pixelEyeNormal, lv);
+
+                    float3 ev = normalize(-pixelEyePosition);
+                    float3 rv = (2.0f * ndotl * pixelEyeNormal) - lv;
+
+                    float att = 1.0f;
+                    float idiff = max(ndotl, 0.0f);
+                    float ispec = (ndotl > 0.0f) ? pow(max(dot(ev, rv), 0.0f), max(pixelEyePositionShininess.a, 1e-3)) : 0.0f;
+                " + kReducedPost,
+
+                // Reduced point
+                kReducedNonDirectionalPre + kReducedPost,
+
+                // Reduced spot
+                kReducedNonDirectionalPre +
+                @"
+                    float spotDot = -dot(lv, SpotDirection);
+                    float spot = pow(max(spotDot, 0.0f), max(SpotFalloffExponent, 1e-3));
+                    if (spotDot < SpotFalloffCosAngle) { spot = 0.0f; }
+
+                    att *= spot;
+                " + kReducedPost,
+
+                // Upsample
+                kGlobals +
+                @"
+                    static const float kDepthSharpness = 16.0f;
+                    static const float kNormalPower = 16.0f;
+                    static const float kMinimumWeight = 1e-4;
+
+                    float4 ReducedResolution : register(c13);
+
+                    texture MrtTexture0 : register(t0);
+                    texture MrtTexture1 : register(t1);
+                    texture MrtTexture2 : register(t2);
+                    texture MrtTexture3 : register(t3);
+                    texture ReducedTexture0 : register(t4);
+                    texture ReducedTexture1 : register(t5);
+                    texture ReducedDiffuse : register(t6);
+                    texture ReducedSpecular : register(t7);
+
+                    sampler MrtSampler0 : register(s0) = sampler_state { texture = <MrtTexture0>; };
+                    sampler MrtSampler1 : register(s1) = sampler_state { texture = <MrtTexture1>; };
+                    sampler MrtSampler2 : register(s2) = sampler_state { texture = <MrtTexture2>; };
+                    sampler MrtSampler3 : register(s3) = sampler_state { texture = <MrtTexture3>; };
+                    sampler ReducedSampler0 : register(s4) = sampler_state { texture = <ReducedTexture0>; };
+                    sampler ReducedSampler1 : register(s5) = sampler_state { texture = <ReducedTexture1>; };
+                    sampler ReducedDiffuseSampler : register(s6) = sampler_state { texture = <ReducedDiffuse>; };
+                    sampler ReducedSpecularSampler : register(s7) = sampler_state { texture = <ReducedSpecular>; };
+
+                    // Bilinear weight scaled by how well the reduced texel's depth and normal
+                    // match the full resolution pixel, so light does not bleed across edges.
+                    void Tap(float2 aUv, float aBilinear, float3 aEyePosition, float3 aEyeNormal,
+                        inout float3 arDiffuse, inout float3 arSpecular, inout float arTotal)
+                    {
+                        float3 position = tex2D(ReducedSampler0, aUv).rgb;
+                        float3 normal = tex2D(ReducedSampler1, aUv).rgb;
+
+                        float depth = abs(position.z - aEyePosition.z) / max(abs(aEyePosition.z), kLooseTolerance);
+                        float geometry = saturate(1.0f - (depth * kDepthSharpness)) * pow(saturate(dot(normal, aEyeNormal)), kNormalPower);
+                        float weight = aBilinear * (geometry + kMinimumWeight);
+
+                        arDiffuse += tex2D(ReducedDiffuseSampler, aUv).rgb * weight;
+                        arSpecular += tex2D(ReducedSpecularSampler, aUv).rgb * weight;
+                        arTotal += weight;
+                    }
+
+                    float4 Fragment(vsOut aIn) : COLOR
+                    {
+                        float2 uv = (aIn.TextureLookup.xy / aIn.TextureLookup.w);
+
+                        float3 pixelDiffuse = tex2D(MrtSampler0, uv).rgb;
+                        float3 pixelSpecular = tex2D(MrtSampler1, uv).rgb;
+                        float3 pixelEyePosition = tex2D(MrtSampler2, uv).rgb;
+                        float3 pixelEyeNormal = tex2D(MrtSampler3, uv).rgb;
+
+                        float2 texel = (uv * ReducedResolution.xy) - 0.5f;
+                        float2 f = frac(texel);
+                        float2 base = ((texel - f) + 0.5f) * ReducedResolution.zw;
+                        float2 dx = float2(ReducedResolution.z, 0);
+                        float2 dy = float2(0, ReducedResolution.w);
+
+                        float3 diffuse = float3(0, 0, 0);
+                        float3 specular = float3(0, 0, 0);
+                        float total = 0.0f;
+
+                        Tap(base,           (1.0f - f.x) * (1.0f - f.y), pixelEyePosition, pixelEyeNormal, diffuse, specular, total);
+                        Tap(base + dx,      (       f.x) * (1.0f - f.y), pixelEyePosition, pixelEyeNormal, diffuse, specular, total);
+                        Tap(base + dy,      (1.0f - f.x) * (       f.y), pixelEyePosition, pixelEyeNormal, diffuse, specular, total);
+                        Tap(base + dx + dy, (       f.x) * (       f.y), pixelEyePosition, pixelEyeNormal, diffuse, specular, total);
+
+                        return float4(((pixelDiffuse * diffuse) + (pixelSpecular * specular)) / total, 0);
+                    }
+                ",
+
                 // Vertex
                 kGlobals +
                 @"
@@ -382,26 +599,63 @@ namespace siat.render
               SurfaceFormat.HalfVector4, // RGB: eye-position
               SurfaceFormat.HalfVector4 }; // RGB: eye-normal
 
+        public static readonly ShaderProfile[] kShaderProfiles = new ShaderProfile[]
+            {
+                ShaderProfile.PS_2_0, // Directional
+                ShaderProfile.PS_2_0, // DirectionalMask
+                ShaderProfile.PS_2_0, // Point
+                ShaderProfile.PS_2_0, // PointMask
+                ShaderProfile.PS_2_0, // Spotlight
+                ShaderProfile.PS_2_0, // SpotlightMask
+                ShaderProfile.PS_2_0, // SpotlightShadow
+                ShaderProfile.PS_2_0, // SpotlightShadowMask
+                ShaderProfile.PS_2_0, // ReducedGeometry
+                ShaderProfile.PS_2_0, // ReducedDirectional
+                ShaderProfile.PS_2_0, // ReducedPoint
+                ShaderProfile.PS_2_0, // ReducedSpotlight
+                ShaderProfile.PS_3_0 // Upsample
+            };
+
+        public const int kReducedCount = 4;
+        public static readonly SurfaceFormat[] kReducedFormats = new SurfaceFormat[]
+            { SurfaceFormat.HalfVector4, // RGB: eye-position, A: shininess
+              SurfaceFormat.HalfVector4, // RGB: eye-normal
+              SurfaceFormat.HalfVector4, // RGB: diffuse light
+              SurfaceFormat.HalfVector4 }; // RGB: specular light
+
         #region Private members
         private static readonly CompiledShader[] msShadersC = new CompiledShader[kSources.Length];
         private static PixelShader[] msPixelShaders = new PixelShader[kSources.Length - 1];
         internal static VertexShader msVertexShader = null;
 
+        // The Upsample pass is ps_3_0, which D3D9 only pairs with a vs_3_0 vertex shader.
+        private static readonly CompiledShader msUpsampleVertexShaderC;
+        private static VertexShader msUpsampleVertexShader = null;
+        private static bool msbReducedSupported = false;
+
         static Deferred()
         {
             int count = kSources.Length - 1;
             for (int i = 0; i < count; i++)
             {
-                msShadersC[i] = ShaderCompiler.CompileFromSource(kSources[i], null, null, CompilerOptions.None, "Fragment", ShaderProfile.PS_2_0, TargetPlatform.Windows);
+                msShadersC[i] = ShaderCompiler.CompileFromSource(kSources[i], null, null, CompilerOptions.None, "Fragment", kShaderProfiles[i], TargetPlatform.Windows);
             }
 
             msShadersC[count] = ShaderCompiler.CompileFromSource(kSources[count], null, null, CompilerOptions.None, "Vertex", ShaderProfile.VS_2_0, TargetPlatform.Windows);
+            msUpsampleVertexShaderC = ShaderCompiler.CompileFromSource(kSources[count], null, null, CompilerOptions.None, "Vertex", ShaderProfile.VS_3_0, TargetPlatform.Windows);
         }
 
         private static bool msbActive = false;
         private static bool msbLoaded = false;
         private static RenderTarget2D[] msTargets = new RenderTarget2D[kCount];
         
+        private static ResolutionMode msResolutionMode = ResolutionMode.kPerLight;
+        private static RenderTarget2D[][] msReducedTargets = new RenderTarget2D[][] { null, new RenderTarget2D[kReducedCount], new RenderTarget2D[kReducedCount] };
+        private static List<LightNode>[] msReducedLights = new List<LightNode>[] { null, new List<LightNode>(), new List<LightNode>() };
+        private static List<PortalRect>[] msReducedRects = new List<PortalRect>[] { null, new List<PortalRect>(), new List<PortalRect>() };
+        private static readonly int msReducedLightsScope = FrameProfiler.GetScopeId("Reduced lights");
+        private static readonly int msLightUpsampleScope = FrameProfiler.GetScopeId("Light upsample");
+
         private static int msOldQuality = 0;
         private static MultiSampleType msOldType = MultiSampleType.NonMaskable;
 
@@ -485,7 +739,27 @@ namespace siat.render
             rs.StencilWriteMask = (int)RenderRoot.StencilMasks.kDeferredMask;
         }
 
-        private static void _Light(LightNode aNode, int aReferenceStencil)
+        private static void _SetPart(MeshPart aPart)
+        {
+            Siat siat = Siat.Singleton;
+            GraphicsDevice gd = siat.GraphicsDevice;
+
+            gd.VertexDeclaration = aPart.VertexDeclaration;
+            gd.Indices = aPart.Indices;
+            gd.Vertices[0].SetSource(aPart.Vertices, 0, aPart.VertexStride);
+            siat.DrawIndexedSettings.PrimitiveType = aPart.PrimitiveType;
+            siat.DrawIndexedSettings.BaseVertex = 0;
+            siat.DrawIndexedSettings.MinVertexIndex = 0;
+            siat.DrawIndexedSettings.NumberOfVertices = aPart.VertexCount;
+            siat.DrawIndexedSettings.StartIndex = 0;
+            siat.DrawIndexedSettings.PrimitiveCount = aPart.PrimitiveCount;
+        }
+
+        /// <summary>
+        /// Sets the transform and light constants of aNode and binds its light volume for
+        /// drawing into a target of size aWidth x aHeight.
+        /// </summary>
+        private static void _SetLight(LightNode aNode, float aWidth, float aHeight)
         {
             Siat siat = Siat.Singleton;
             GraphicsDevice gd = siat.GraphicsDevice;
@@ -505,8 +779,8 @@ namespace siat.render
             Matrix wvp = scale * aNode.WorldTransform * Shared.InfiniteViewProjectionTransform;
             gd.SetVertexShaderConstant(0, Matrix.Transpose(wvp));
             gd.SetVertexShaderConstant(4, new Vector2(
-                1.0f + (float)(1.0 / gd.PresentationParameters.BackBufferWidth),
-                1.0f + (float)(1.0 / gd.PresentationParameters.BackBufferHeight)));
+                1.0f + (float)(1.0 / aWidth),
+                1.0f + (float)(1.0 / aHeight)));
 
             gd.SetPixelShaderConstant((int)kRegisters.LightAttenuation, aNode.Light.LightAttenuation);
             gd.SetPixelShaderConstant((int)kRegisters.LightDiffuse, aNode.Light.LightDiffuse);
@@ -515,7 +789,7 @@ namespace siat.render
             gd.SetPixelShaderConstant((int)kRegisters.Range2, new Vector4(aNode.Range * aNode.Range));
             if (bShadows)
             {
-                Texture2D tex = aNode.ShadowRenderTarget.Target.GetTexture();
+                Texture2D tex = aNode.ShadowTexture;
                 gd.Textures[kCount] = tex;
                 gd.SetPixelShaderConstant((int)kRegisters.ShadowFarDepth, new Vector4(aNode.Range));
 
@@ -530,16 +804,16 @@ namespace siat.render
                 gd.SetPixelShaderConstant((int)kRegisters.SpotFalloffExponent, new Vector4(aNode.Light.FalloffExponent));
             }
 
-            MeshPart part = (aNode.Light.Type == LightType.Spot) ? siat.UnitFrustumMeshPart : siat.UnitSphereMeshPart;
+            _SetPart((aNode.Light.Type == LightType.Spot) ? siat.UnitFrustumMeshPart : siat.UnitSphereMeshPart);
+        }
 
-            gd.Indices = part.Indices;
-            gd.Vertices[0].SetSource(part.Vertices, 0, part.VertexStride);
-            siat.DrawIndexedSettings.PrimitiveType = part.PrimitiveType;
-            siat.DrawIndexedSettings.BaseVertex = 0;
-            siat.DrawIndexedSettings.MinVertexIndex = 0;
-            siat.DrawIndexedSettings.NumberOfVertices = part.VertexCount;
-            siat.DrawIndexedSettings.StartIndex = 0;
-            siat.DrawIndexedSettings.PrimitiveCount = part.PrimitiveCount;
+        private static void _Light(LightNode aNode, int aReferenceStencil)
+        {
+            Siat siat = Siat.Singleton;
+            GraphicsDevice gd = siat.GraphicsDevice;
+
+            bool bShadows = aNode.bCastShadow;
+            _SetLight(aNode, gd.PresentationParameters.BackBufferWidth, gd.PresentationParameters.BackBufferHeight);
 
             #region Masking pass
 #if !DISABLE_MASKING
@@ -567,8 +841,212 @@ namespace siat.render
             siat.DrawIndexedPrimitives();
             #endregion
         }
+
+        #region Reduced resolution lights
+        private const int kReducedGeometry0 = 0;
+        private const int kReducedGeometry1 = 1;
+        private const int kReducedDiffuse = 2;
+        private const int kReducedSpecular = 3;
+
+        private static LightResolution _GetResolution(LightNode aNode)
+        {
+            // The shadow mask pass depends on the full resolution stencil buffer. The upsample
+            // pass needs shader model 3.0.
+            if (msResolutionMode == ResolutionMode.kFull || aNode.bCastShadow || !msbReducedSupported) { return LightResolution.Full; }
+            else { return aNode.Resolution; }
+        }
+
+        private static RenderTarget2D[] _GetReducedTargets(LightResolution aResolution)
+        {
+            RenderTarget2D[] ret = msReducedTargets[(int)aResolution];
+
+            if (ret[0] == null)
+            {
+                GraphicsDevice gd = Siat.Singleton.GraphicsDevice;
+                int scale = (1 << (int)aResolution);
+                int width = (gd.PresentationParameters.BackBufferWidth + scale - 1) / scale;
+                int height = (gd.PresentationParameters.BackBufferHeight + scale - 1) / scale;
+
+                for (int i = 0; i < kReducedCount; i++)
+                {
+                    ret[i] = new RenderTarget2D(gd, width, height, 1, kReducedFormats[i], RenderTargetUsage.PlatformContents);
+                }
+            }
+
+            return ret;
+        }
+
+        private static Rectangle _GetSplitRectangle(bool abRight)
+        {
+            GraphicsDevice gd = Siat.Singleton.GraphicsDevice;
+            int width = gd.PresentationParameters.BackBufferWidth;
+            int height = gd.PresentationParameters.BackBufferHeight;
+            int half = (width / 2);
+
+            return (abRight) ? new Rectangle(half, 0, width - half, height) : new Rectangle(0, 0, half, height);
+        }
+
+        private static void _SetSplitScissor(bool abRight)
+        {
+            GraphicsDevice gd = Siat.Singleton.GraphicsDevice;
+            gd.ScissorRectangle = _GetSplitRectangle(abRight);
+            gd.RenderState.ScissorTestEnable = true;
+        }
+
+        /// <summary>
+        /// Returns true if the volume of aNode is entirely in front of aRect, so it cannot light
+        /// anything seen through the portal of aRect.
+        /// </summary>
+        private static bool _InFrontOfPortal(LightNode aNode, PortalRect aRect)
+        {
+            if (aRect == null || aNode.Light.Type == LightType.Directional) { return false; }
+
+            float depth = -Vector3.Transform(aNode.WorldPosition, Shared.ViewTransform).Z;
+
+            return (depth + aNode.Range < aRect.MinDepth);
+        }
+
+        private static void _SetFullScreenQuad(float aWidth, float aHeight)
+        {
+            GraphicsDevice gd = Siat.Singleton.GraphicsDevice;
+
+            gd.SetVertexShaderConstant(0, Matrix.Identity);
+            gd.SetVertexShaderConstant(4, new Vector4(1.0f + (1.0f / aWidth), 1.0f + (1.0f / aHeight), 1.0f, 1.0f));
+            _SetPart(Siat.Singleton.UnitQuadMeshPart);
+        }
+
+        /// <summary>
+        /// Lights the reduced resolution lights of aResolution and composites them into the
+        /// current render target.
+        /// </summary>
+        /// <remarks>
+        /// The eye position, shininess and normal of the G-buffer are point sampled down to the
+        /// reduced size. Light volumes then accumulate diffuse and specular light into two reduced
+        /// targets, which are bilaterally upsampled, multiplied by the surface colors and added to
+        /// the full resolution target.
+        /// </remarks>
+        private static void _RenderReduced(LightResolution aResolution)
+        {
+            List<LightNode> lights = msReducedLights[(int)aResolution];
+            List<PortalRect> rects = msReducedRects[(int)aResolution];
+            int count = lights.Count;
+            if (count == 0) { return; }
+
+            Siat siat = Siat.Singleton;
+            GraphicsDevice gd = siat.GraphicsDevice;
+            RenderState rs = gd.RenderState;
+
+            float bbwidth = gd.PresentationParameters.BackBufferWidth;
+            float bbheight = gd.PresentationParameters.BackBufferHeight;
+            RenderTarget2D target = (RenderTarget2D)gd.GetRenderTarget(0);
+            RenderTarget2D[] targets = _GetReducedTargets(aResolution);
+            float width = targets[0].Width;
+            float height = targets[0].Height;
+            int scale = (1 << (int)aResolution);
+            Rectangle bounds = new Rectangle(0, 0, targets[0].Width, targets[0].Height);
+
+            FrameProfiler._Begin(msReducedLightsScope);
+            #region Downsample
+            gd.SetRenderTarget(0, targets[kReducedGeometry0]);
+            gd.SetRenderTarget(1, targets[kReducedGeometry1]);
+            for (int i = 0; i < kCount; i++) { gd.Textures[i] = msTargets[i].GetTexture(); }
+
+            rs.AlphaBlendEnable = false;
+            rs.ColorWriteChannels = ColorWriteChannels.All;
+            rs.ColorWriteChannels1 = ColorWriteChannels.All;
+            rs.CullMode = Utilities.kBackFaceCulling;
+            rs.StencilEnable = false;
+
+            gd.SetPixelShaderConstant((int)kRegisters.FullResolution, new Vector4(bbwidth, bbheight, 1.0f / bbwidth, 1.0f / bbheight));
+            _SetFullScreenQuad(width, height);
+            gd.PixelShader = msPixelShaders[(int)Shaders.kReducedGeometry];
+            siat.DrawIndexedPrimitives();
+            #endregion
+
+            #region Light pass
+            gd.SetRenderTarget(0, targets[kReducedDiffuse]);
+            gd.SetRenderTarget(1, targets[kReducedSpecular]);
+            gd.Clear(ClearOptions.Target, Color.Black, 1.0f, Siat.kDefaultReferenceStencil);
+
+            for (int i = 0; i < kCount; i++) { gd.Textures[i] = null; }
+            gd.Textures[0] = targets[kReducedGeometry0].GetTexture();
+            gd.Textures[1] = targets[kReducedGeometry1].GetTexture();
+
+            rs.AlphaBlendEnable = true;
+            rs.SourceBlend = Blend.One;
+            rs.DestinationBlend = Blend.One;
+            rs.CullMode = Utilities.kFrontFaceCulling;
+
+            for (int i = 0; i < count; i++)
+            {
+                LightNode light = lights[i];
+                if (rects[i] != null) { if (!PortalScissor._Apply(rects[i], scale, bounds)) { continue; } }
+                else { rs.ScissorTestEnable = false; }
+
+                _SetLight(light, width, height);
+
+                if (light.Light.Type == LightType.Directional) { gd.PixelShader = msPixelShaders[(int)Shaders.kReducedDirectional]; }
+                else if (light.Light.Type == LightType.Point) { gd.PixelShader = msPixelShaders[(int)Shaders.kReducedPoint]; }
+                else { gd.PixelShader = msPixelShaders[(int)Shaders.kReducedSpotlight]; }
+
+                siat.DrawIndexedPrimitives();
+            }
+            PortalScissor._End();
+            lights.Clear();
+            rects.Clear();
+
+            gd.SetRenderTarget(1, null);
+            gd.SetRenderTarget(0, target);
+            #endregion
+            FrameProfiler._End();
+
+            FrameProfiler._Begin(msLightUpsampleScope);
+            #region Upsample
+            for (int i = 0; i < kCount; i++) { gd.Textures[i] = msTargets[i].GetTexture(); }
+            for (int i = 0; i < kReducedCount; i++) { gd.Textures[kCount + i] = targets[i].GetTexture(); }
+            for (int i = kCount; i < kCount + kReducedCount; i++)
+            {
+                gd.SamplerStates[i].AddressU = TextureAddressMode.Clamp;
+                gd.SamplerStates[i].AddressV = TextureAddressMode.Clamp;
+                gd.SamplerStates[i].MagFilter = TextureFilter.Point;
+                gd.SamplerStates[i].MinFilter = TextureFilter.Point;
+                gd.SamplerStates[i].MipFilter = TextureFilter.None;
+            }
+
+            rs.ColorWriteChannels = ColorWriteChannels.Red | ColorWriteChannels.Green | ColorWriteChannels.Blue;
+            rs.CullMode = Utilities.kBackFaceCulling;
+            rs.ReferenceStencil = Siat.kDefaultStencilMask;
+            rs.StencilEnable = true;
+            rs.StencilFunction = CompareFunction.NotEqual;
+            rs.StencilMask = (int)RenderRoot.StencilMasks.kNoDeferred;
+            rs.StencilPass = StencilOperation.Keep;
+            if (msResolutionMode == ResolutionMode.kSplit) { _SetSplitScissor(true); }
+
+            gd.SetPixelShaderConstant((int)kRegisters.ReducedResolution, new Vector4(width, height, 1.0f / width, 1.0f / height));
+            _SetFullScreenQuad(bbwidth, bbheight);
+            gd.VertexShader = msUpsampleVertexShader;
+            gd.PixelShader = msPixelShaders[(int)Shaders.kUpsample];
+            siat.DrawIndexedPrimitives();
+            gd.VertexShader = msVertexShader;
+
+            rs.ColorWriteChannels = ColorWriteChannels.All;
+            rs.ScissorTestEnable = false;
+            for (int i = 0; i < kCount + kReducedCount; i++) { gd.Textures[i] = null; }
+            #endregion
+            FrameProfiler._End();
+        }
+        #endregion
         #endregion
 
+        /// <summary>
+        /// How per-light resolutions are applied, see ResolutionMode.
+        /// </summary>
+        public static ResolutionMode LightResolutionMode
+        {
+            get { return msResolutionMode; }
+            set { msResolutionMode = value; }
+        }
+
         public static bool bActive { get { return msbActive; } }
 
         public static void Activate()
@@ -638,12 +1116,17 @@ namespace siat.render
                 #endregion
 
                 #region Shaders
+                GraphicsDeviceCapabilities caps = gd.GraphicsDeviceCapabilities;
+                msbReducedSupported = (caps.PixelShaderVersion.Major >= 3 && caps.VertexShaderVersion.Major >= 3);
+
                 int count = msShadersC.Length - 1;
                 for (int i = 0; i < count; i++)
                 {
+                    if (kShaderProfiles[i] == ShaderProfile.PS_3_0 && !msbReducedSupported) { continue; }
                     msPixelShaders[i] = new PixelShader(gd, msShadersC[i].GetShaderCode());
                 }
                 msVertexShader = new VertexShader(gd, msShadersC[count].GetShaderCode());
+                if (msbReducedSupported) { msUpsampleVertexShader = new VertexShader(gd, msUpsampleVertexShaderC.GetShaderCode()); }
                 #endregion
 
                 msbLoaded = true;
@@ -667,15 +1150,21 @@ namespace siat.render
 
                 #region Shaders
                 msVertexShader.Dispose(); msVertexShader = null;
+                if (msUpsampleVertexShader != null) { msUpsampleVertexShader.Dispose(); msUpsampleVertexShader = null; }
                 int count = msPixelShaders.Length;
                 for (int i = 0; i < count; i++)
                 {
-                    msPixelShaders[i].Dispose(); msPixelShaders[i] = null;
+                    if (msPixelShaders[i] != null) { msPixelShaders[i].Dispose(); msPixelShaders[i] = null; }
                 }
                 #endregion
 
                 #region Render targets
                 for (int i = kCount - 1; i >= 0; i--) { msTargets[i].Dispose(); msTargets[i] = null; }
+                foreach (RenderTarget2D[] e in msReducedTargets)
+                {
+                    if (e == null || e[0] == null) { continue; }
+                    for (int i = kReducedCount - 1; i >= 0; i--) { e[i].Dispose(); e[i] = null; }
+                }
                 #endregion
 
                 msbLoaded = false;
@@ -709,16 +1198,58 @@ namespace siat.render
             gd.Clear(ClearOptions.Target, Color.Blue, 1.0f, Siat.kDefaultReferenceStencil);
         }
 
-        public static void RenderLights(List<LightNode> aLights)
+        /// <summary>
+        /// Draws the light volumes of aLights. aRects holds, for each light, the rect of the portal
+        /// the light was posed through, or null, see PortalScissor.
+        /// </summary>
+        /// <remarks>
+        /// Both the mask and light passes of a light seen through a portal are scissored to the
+        /// rect of that portal. Lights whose volume is entirely in front of the portal are skipped.
+        /// </remarks>
+        public static void RenderLights(List<LightNode> aLights, List<PortalRect> aRects)
         {
             GraphicsDevice gd = Siat.Singleton.GraphicsDevice;
             RenderState rs = gd.RenderState;
+            Rectangle full = new Rectangle(0, 0, gd.PresentationParameters.BackBufferWidth, gd.PresentationParameters.BackBufferHeight);
 
             _CommonLight();
             int count = aLights.Count;
-            for (int i = 0; i < count; i++) { _Light(aLights[i], i+1); }
+            for (int i = 0; i < count; i++)
+            {
+                LightNode light = aLights[i];
+                PortalRect rect = aRects[i];
+                if (_InFrontOfPortal(light, rect)) { PortalScissor._RejectLight(); continue; }
+
+                LightResolution resolution = _GetResolution(light);
+
+                if (resolution == LightResolution.Full)
+                {
+                    if (rect == null) { _Light(light, i+1); }
+                    else if (PortalScissor._Apply(rect, 1, full))
+                    {
+                        _Light(light, i+1);
+                        rs.ScissorTestEnable = false;
+                    }
+                }
+                else
+                {
+                    msReducedLights[(int)resolution].Add(light);
+                    msReducedRects[(int)resolution].Add(rect);
+                    if (msResolutionMode == ResolutionMode.kSplit)
+                    {
+                        if (rect == null) { _SetSplitScissor(false); }
+                        else if (!PortalScissor._Apply(rect, 1, _GetSplitRectangle(false))) { continue; }
+
+                        _Light(light, i+1);
+                        rs.ScissorTestEnable = false;
+                    }
+                }
+            }
             for (int i = 0; i < kCount + 1; i++) { gd.Textures[i] = null; }
 
+            _RenderReduced(LightResolution.Half);
+            _RenderReduced(LightResolution.Quarter);
+
             rs.DepthBufferEnable = true;
             rs.StencilEnable = false;
             rs.StencilMask = Siat.kDefaultStencilMask;
@@ -0,0 +1,341 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using Microsoft.Xna.Framework.Graphics;
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+
+namespace siat.render
+{
+    /// <summary>
+    /// Per frame breakdown of draw submission by technique.
+    /// </summary>
+    /// <remarks>
+    /// Work is charged to scopes. Each technique id (see RenderRoot.GetTechniqueId()) is a scope,
+    /// begun when RenderRoot.RenderOperations.EffectTechnique or the RenderQueue applies the
+    /// technique. Work that does not go through effect techniques (deferred lights, post
+    /// processing) is charged to named scopes. Anything else is charged to the "(other)" scope.
+    ///
+    /// For each scope, the profiler records draws, triangles, effect passes, and the CPU time
+    /// spent between the begin and end of the scope, exclusive of nested scopes. Frame totals of
+    /// effect, material, and technique switches are also recorded. Recording is a few array
+    /// writes and one Stopwatch.GetTimestamp() per scope change, so it can be left enabled.
+    ///
+    /// XNA provides no GPU timers, so the time of a scope is the time to submit it. If
+    /// bSynchronized is true, the GPU is drained at each scope change so that the time of a
+    /// scope also includes its execution. This stalls the pipeline and is for profiling only.
+    /// </remarks>
+    public static class FrameProfiler
+    {
+        public const int kMaxDepth = 16;
+        public const int kOtherScope = 0;
+        public const int kOverlayLines = 8;
+        public const string kOtherScopeName = "(other)";
+
+        #region Private members
+        private static bool msbEnabled = true;
+        private static bool msbOverlay = false;
+        private static bool msbSynchronized = false;
+
+        private static List<string> msScopeNames = new List<string>();
+        private static int[] msTechniqueScopes = new int[0];
+
+        private static int[] msDraws = new int[0];
+        private static int[] msTriangles = new int[0];
+        private static int[] msPasses = new int[0];
+        private static long[] msTicks = new long[0];
+
+        private static int[] msStack = new int[kMaxDepth];
+        private static int msDepth = 0;
+        private static long msLastTimestamp = 0;
+
+        private static int msEffectSwitches = 0;
+        private static int msMaterialSwitches = 0;
+        private static int msTechniqueSwitches = 0;
+        private static int msLastTechnique = -1;
+        private static int msFrame = 0;
+
+        private static OcclusionQuery msSyncQuery = null;
+        private static StreamWriter msCapture = null;
+        private static int[] msSorted = new int[0];
+
+        static FrameProfiler()
+        {
+            GetScopeId(kOtherScopeName);
+        }
+
+        private static void _Grow(int aCount)
+        {
+            if (msDraws.Length >= aCount) { return; }
+
+            int count = Math.Max(aCount, msDraws.Length * 2);
+            Array.Resize(ref msDraws, count);
+            Array.Resize(ref msTriangles, count);
+            Array.Resize(ref msPasses, count);
+            Array.Resize(ref msTicks, count);
+        }
+
+        private static int _Current
+        {
+            get
+            {
+                return (msDepth > 0) ? msStack[Math.Min(msDepth, kMaxDepth) - 1] : kOtherScope;
+            }
+        }
+
+        /// <summary>
+        /// Charges the time since the last scope change to the current scope, or to kOtherScope
+        /// outside of any scope.
+        /// </summary>
+        private static void _Charge()
+        {
+            if (msbSynchronized) { _Synchronize(); }
+
+            long timestamp = Stopwatch.GetTimestamp();
+            if (msLastTimestamp != 0) { msTicks[_Current] += (timestamp - msLastTimestamp); }
+            msLastTimestamp = timestamp;
+        }
+
+        private static void _Synchronize()
+        {
+            GraphicsDevice gd = Siat.Singleton.GraphicsDevice;
+
+            if (msSyncQuery == null || msSyncQuery.GraphicsDevice != gd)
+            {
+                if (!gd.GraphicsDeviceCapabilities.DeviceCapabilities.SupportsOcclusionQueries) { return; }
+                msSyncQuery = new OcclusionQuery(gd);
+            }
+
+            // A query completes only after all commands before it are done.
+            msSyncQuery.Begin();
+            msSyncQuery.End();
+            while (!msSyncQuery.IsComplete) { }
+        }
+
+        private static double _ToMilliseconds(long aTicks)
+        {
+            return ((double)aTicks * 1000.0) / (double)Stopwatch.Frequency;
+        }
+
+        private static void _WriteCapture()
+        {
+            int count = msScopeNames.Count;
+            for (int i = 0; i < count; i++)
+            {
+                if (msDraws[i] == 0 && msPasses[i] == 0 && msTicks[i] == 0) { continue; }
+
+                msCapture.WriteLine(string.Format("{0},{1},{2},{3},{4},{5:0.0000},{6},{7},{8}",
+                    msFrame, msScopeNames[i], msDraws[i], msTriangles[i], msPasses[i], _ToMilliseconds(msTicks[i]),
+                    msEffectSwitches, msMaterialSwitches, msTechniqueSwitches));
+            }
+        }
+        #endregion
+
+        #region Internal members
+        internal static void _Begin(int aScope)
+        {
+            if (!msbEnabled) { return; }
+
+            _Charge();
+            if (msDepth < kMaxDepth) { msStack[msDepth] = aScope; }
+            msDepth++;
+        }
+
+        internal static void _BeginTechnique(int aTechnique)
+        {
+            if (!msbEnabled) { return; }
+
+            if (aTechnique != msLastTechnique)
+            {
+                msLastTechnique = aTechnique;
+                msTechniqueSwitches++;
+            }
+            _Begin(GetTechniqueScopeId(aTechnique));
+        }
+
+        internal static void _End()
+        {
+            if (!msbEnabled) { return; }
+
+            _Charge();
+            if (msDepth > 0) { msDepth--; }
+        }
+
+        internal static void _Draw(int aPrimitiveCount)
+        {
+            int scope = _Current;
+            msDraws[scope]++;
+            msTriangles[scope] += aPrimitiveCount;
+        }
+
+        internal static void _EffectSwitch() { msEffectSwitches++; }
+        internal static void _MaterialSwitch() { msMaterialSwitches++; }
+        internal static void _Pass() { msPasses[_Current]++; }
+
+        /// <summary>
+        /// Adds the scopes that took the most time this frame to the console.
+        /// </summary>
+        internal static void _AddConsoleLines(Siat aSiat)
+        {
+            int count = msScopeNames.Count;
+            if (msSorted.Length < count) { msSorted = new int[count]; }
+            for (int i = 0; i < count; i++) { msSorted[i] = i; }
+
+            // Partial selection sort, only the first kOverlayLines are shown.
+            for (int i = 0; i < count && i < kOverlayLines; i++)
+            {
+                for (int j = i + 1; j < count; j++)
+                {
+                    if (msTicks[msSorted[j]] > msTicks[msSorted[i]]) { Utilities.Swap(ref msSorted[i], ref msSorted[j]); }
+                }
+            }
+
+            aSiat.AddConsoleLine("Profile (effect/material/technique switches): " + string.Format("{0}/{1}/{2}", msEffectSwitches, msMaterialSwitches, msTechniqueSwitches));
+            for (int i = 0; i < count && i < kOverlayLines; i++)
+            {
+                int s = msSorted[i];
+                if (msTicks[s] == 0 && msDraws[s] == 0) { break; }
+
+                aSiat.AddConsoleLine("  " + msScopeNames[s] + " (draws/triangles/passes/ms): " + string.Format("{0}/{1}/{2}/{3:0.000}", msDraws[s], msTriangles[s], msPasses[s], _ToMilliseconds(msTicks[s])));
+            }
+        }
+
+        /// <summary>
+        /// Writes the frame to the capture file, if any, and clears it.
+        /// </summary>
+        internal static void _EndFrame()
+        {
+            if (msbEnabled) { _Charge(); }
+            if (msCapture != null) { _WriteCapture(); }
+
+            int count = msScopeNames.Count;
+            Array.Clear(msDraws, 0, count);
+            Array.Clear(msTriangles, 0, count);
+            Array.Clear(msPasses, 0, count);
+            Array.Clear(msTicks, 0, count);
+
+            msDepth = 0;
+            msEffectSwitches = 0;
+            msMaterialSwitches = 0;
+            msTechniqueSwitches = 0;
+            msLastTechnique = -1;
+            msFrame++;
+        }
+        #endregion
+
+        /// <summary>
+        /// Returns the id of the named scope, adding it if it does not exist.
+        /// </summary>
+        public static int GetScopeId(string aName)
+        {
+            int count = msScopeNames.Count;
+            for (int i = 0; i < count; i++)
+            {
+                if (msScopeNames[i] == aName)
+                {
+                    return i;
+                }
+            }
+
+            msScopeNames.Add(aName);
+            _Grow(msScopeNames.Count);
+
+            return (msScopeNames.Count - 1);
+        }
+
+        public static string GetScopeName(int aId)
+        {
+            return msScopeNames[aId];
+        }
+
+        /// <summary>
+        /// Returns the scope id of a technique id.
+        /// </summary>
+        public static int GetTechniqueScopeId(int aTechnique)
+        {
+            if (aTechnique >= msTechniqueScopes.Length)
+            {
+                int oldCount = msTechniqueScopes.Length;
+                Array.Resize(ref msTechniqueScopes, Math.Max(RenderRoot.TechniqueCount, aTechnique + 1));
+                for (int i = oldCount; i < msTechniqueScopes.Length; i++) { msTechniqueScopes[i] = -1; }
+            }
+
+            if (msTechniqueScopes[aTechnique] < 0)
+            {
+                msTechniqueScopes[aTechnique] = GetScopeId(RenderRoot.GetTechniqueSemantic(aTechnique));
+            }
+
+            return msTechniqueScopes[aTechnique];
+        }
+
+        public static int ScopeCount { get { return msScopeNames.Count; } }
+
+        /// <summary>
+        /// Begins writing one CSV row per scope per frame to aFilename, replacing any
+        /// capture in progress.
+        /// </summary>
+        public static void BeginCapture(string aFilename)
+        {
+            EndCapture();
+
+            msCapture = new StreamWriter(aFilename, false);
+            msCapture.WriteLine("frame,scope,draws,triangles,passes,ms,effect_switches,material_switches,technique_switches");
+        }
+
+        public static void EndCapture()
+        {
+            if (msCapture != null)
+            {
+                msCapture.Close();
+                msCapture = null;
+            }
+        }
+
+        public static bool bCapturing { get { return (msCapture != null); } }
+
+        /// <summary>
+        /// If false, scope times and switches are not recorded. Draws are always recorded.
+        /// </summary>
+        public static bool bEnabled { get { return msbEnabled; } set { msbEnabled = value; msDepth = 0; msLastTimestamp = 0; } }
+
+        /// <summary>
+        /// If true, the most expensive scopes of each frame are shown with the stats.
+        /// </summary>
+        public static bool bOverlay { get { return msbOverlay; } set { msbOverlay = value; } }
+
+        /// <summary>
+        /// If true, the GPU is drained at each scope change so times include GPU execution.
+        /// </summary>
+        public static bool bSynchronized { get { return msbSynchronized; } set { msbSynchronized = value; } }
+
+        public static int GetDraws(int aScope) { return msDraws[aScope]; }
+        public static int GetTriangles(int aScope) { return msTriangles[aScope]; }
+        public static int GetPasses(int aScope) { return msPasses[aScope]; }
+        public static double GetTime(int aScope) { return _ToMilliseconds(msTicks[aScope]); }
+
+        public static int EffectSwitches { get { return msEffectSwitches; } }
+        public static int MaterialSwitches { get { return msMaterialSwitches; } }
+        public static int TechniqueSwitches { get { return msTechniqueSwitches; } }
+    }
+}
@@ -32,6 +32,17 @@ namespace siat.render
         Spot
     }
 
+    /// <summary>
+    /// Resolution at which a deferred light is accumulated. Reduced resolutions are
+    /// bilaterally upsampled into the full resolution light buffer.
+    /// </summary>
+    public enum LightResolution
+    {
+        Full,
+        Half,
+        Quarter
+    }
+
     // Joe: the instanceable light data used by LightNode. I currently do not take advantage
     //      of this instancing but may in the future.
     public sealed class Light
@@ -0,0 +1,237 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using Microsoft.Xna.Framework;
+using Microsoft.Xna.Framework.Graphics;
+using System;
+using System.Collections.Generic;
+using System.Text;
+
+namespace siat.render
+{
+    /// <summary>
+    /// Decodes the mesh parts of a mesh pack (see siat.MeshPackFormat) and creates their GPU buffers.
+    /// </summary>
+    /// <remarks>
+    /// Construction only decodes records, so it is safe on a loading thread. Buffers are created by
+    /// Upload(), which can be rationed to a byte budget per call so a streamed cell spreads its GPU
+    /// resource creation across frames. Until a part is uploaded its Vertices and Indices are null.
+    /// 
+    /// Vertex and index ranges are copied from the pack into GPU buffers without intermediate arrays.
+    /// Buffers are created with BufferUsage.None, as the content pipeline does, so
+    /// OccluderMesh.FromMeshPart() can read them back. The pack data is released once every part has
+    /// been uploaded.
+    ///
+    /// ContentManager.Unload() only disposes objects read through ContentReader.ReadObject(), so it
+    /// does not dispose the buffers and declarations created here. They are listed in Resources and
+    /// must be disposed by the owner of the pack.
+    /// </remarks>
+    public sealed class MeshPack
+    {
+        #region Private members
+        private struct Record
+        {
+            public int DeclarationOffset;
+            public int VerticesOffset;
+            public int VerticesSize;
+            public int IndicesOffset;
+            public int IndexCount;
+            public int IndexSize;
+        }
+
+        private byte[] mData;
+        private Dictionary<int, VertexDeclaration> mDeclarations = new Dictionary<int, VertexDeclaration>();
+        private List<IDisposable> mResources = new List<IDisposable>();
+        private int mNextUpload = 0;
+        private readonly MeshPart[] mParts;
+        private readonly Record[] mRecords;
+        private readonly long mSize;
+
+        private static int _Int(byte[] aData, int aOffset)
+        {
+            return BitConverter.ToInt32(aData, aOffset);
+        }
+
+        private static float _Float(byte[] aData, int aOffset)
+        {
+            return BitConverter.ToSingle(aData, aOffset);
+        }
+
+        private static VertexDeclaration _Declaration(GraphicsDevice aDevice, byte[] aData, int aOffset)
+        {
+            int count = _Int(aData, aOffset);
+            VertexElement[] elements = new VertexElement[count];
+
+            int o = aOffset + sizeof(int);
+            for (int i = 0; i < count; i++)
+            {
+                elements[i] = new VertexElement(
+                    BitConverter.ToInt16(aData, o + 0),
+                    BitConverter.ToInt16(aData, o + 2),
+                    (VertexElementFormat)aData[o + 4],
+                    (VertexElementMethod)aData[o + 5],
+                    (VertexElementUsage)aData[o + 6],
+                    aData[o + 7]);
+
+                o += MeshPackFormat.kVertexElementSize;
+            }
+
+            return new VertexDeclaration(aDevice, elements);
+        }
+
+        private int _Upload(GraphicsDevice aDevice, int aIndex)
+        {
+            Record r = mRecords[aIndex];
+            MeshPart part = mParts[aIndex];
+
+            VertexDeclaration declaration;
+            if (!mDeclarations.TryGetValue(r.DeclarationOffset, out declaration))
+            {
+                declaration = _Declaration(aDevice, mData, r.DeclarationOffset);
+                mDeclarations.Add(r.DeclarationOffset, declaration);
+                mResources.Add(declaration);
+            }
+            part.VertexDeclaration = declaration;
+
+            int indicesSize = r.IndexCount * r.IndexSize;
+            part.Indices = new IndexBuffer(aDevice, indicesSize, BufferUsage.None,
+                (r.IndexSize == sizeof(int)) ? IndexElementSize.ThirtyTwoBits : IndexElementSize.SixteenBits);
+            part.Indices.SetData<byte>(mData, r.IndicesOffset, indicesSize);
+            mResources.Add(part.Indices);
+
+            part.Vertices = new VertexBuffer(aDevice, r.VerticesSize, BufferUsage.None);
+            part.Vertices.SetData<byte>(mData, r.VerticesOffset, r.VerticesSize);
+            mResources.Add(part.Vertices);
+
+            return (indicesSize + r.VerticesSize);
+        }
+        #endregion
+
+        public MeshPack(byte[] aData)
+        {
+            if (aData.Length < MeshPackFormat.kHeaderSize || _Int(aData, MeshPackFormat.kHeaderMagic) != MeshPackFormat.kMagic)
+            {
+                throw new Exception("Data is not a mesh pack.");
+            }
+
+            int version = _Int(aData, MeshPackFormat.kHeaderVersion);
+            if (version != MeshPackFormat.kVersion)
+            {
+                throw new Exception("Mesh pack version " + version.ToString() + " is not supported, " +
+                    "expected version " + MeshPackFormat.kVersion.ToString() + ". Rebuild the content.");
+            }
+
+            if (_Int(aData, MeshPackFormat.kHeaderTotalSize) != aData.Length)
+            {
+                throw new Exception("Mesh pack is truncated.");
+            }
+
+            int count = _Int(aData, MeshPackFormat.kHeaderPartCount);
+            int partsOffset = _Int(aData, MeshPackFormat.kHeaderPartsOffset);
+
+            mData = aData;
+            mParts = new MeshPart[count];
+            mRecords = new Record[count];
+            mSize = 0;
+
+            for (int i = 0; i < count; i++)
+            {
+                int o = partsOffset + (i * MeshPackFormat.kPartRecordSize);
+
+                Record r = new Record();
+                r.DeclarationOffset = _Int(aData, o + 8);
+                r.VerticesOffset = _Int(aData, o + 20);
+                r.VerticesSize = _Int(aData, o + 24);
+                r.IndicesOffset = _Int(aData, o + 28);
+                r.IndexCount = _Int(aData, o + 32);
+                r.IndexSize = _Int(aData, o + 36);
+                mRecords[i] = r;
+                mSize += (r.VerticesSize + (r.IndexCount * r.IndexSize));
+
+                MeshPart part = new MeshPart(Encoding.UTF8.GetString(aData, _Int(aData, o + 0), _Int(aData, o + 4)));
+                part.PrimitiveType = (PrimitiveType)_Int(aData, o + 40);
+                part.PrimitiveCount = _Int(aData, o + 44);
+                part.AABB = new BoundingBox(
+                    new Vector3(_Float(aData, o + 48), _Float(aData, o + 52), _Float(aData, o + 56)),
+                    new Vector3(_Float(aData, o + 60), _Float(aData, o + 64), _Float(aData, o + 68)));
+                part.BoundingSphere = new BoundingSphere(
+                    new Vector3(_Float(aData, o + 72), _Float(aData, o + 76), _Float(aData, o + 80)),
+                    _Float(aData, o + 84));
+                part.VertexCount = _Int(aData, o + 16);
+                part.VertexStride = _Int(aData, o + 12);
+
+                mParts[i] = part;
+            }
+        }
+
+        /// <summary>
+        /// True once GPU buffers have been created for every part.
+        /// </summary>
+        public bool bUploaded { get { return (mNextUpload == mParts.Length); } }
+
+        public MeshPart[] Parts { get { return mParts; } }
+
+        /// <summary>
+        /// Vertex declarations and buffers created so far by Upload(). Not disposed with the content
+        /// that read the pack.
+        /// </summary>
+        public List<IDisposable> Resources { get { return mResources; } }
+
+        /// <summary>
+        /// Total size in bytes of the vertex and index data of all parts.
+        /// </summary>
+        public long Size { get { return mSize; } }
+
+        /// <summary>
+        /// Creates buffers for parts not yet uploaded until aBudget bytes have been copied.
+        /// </summary>
+        /// <returns>The number of bytes uploaded.</returns>
+        /// <remarks>
+        /// At least one part is uploaded per call if any remain, so a part larger than the budget
+        /// still makes progress.
+        /// </remarks>
+        public int Upload(GraphicsDevice aDevice, int aBudget)
+        {
+            int ret = 0;
+            int count = mParts.Length;
+
+            while (mNextUpload < count && (ret == 0 || ret < aBudget))
+            {
+                ret += _Upload(aDevice, mNextUpload);
+                mNextUpload++;
+            }
+
+            if (mNextUpload == count)
+            {
+                mData = null;
+                mDeclarations = null;
+            }
+
+            return ret;
+        }
+
+        public void UploadAll(GraphicsDevice aDevice)
+        {
+            Upload(aDevice, int.MaxValue);
+        }
+    }
+}
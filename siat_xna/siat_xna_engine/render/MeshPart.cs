@@ -39,6 +39,7 @@ namespace siat.render
         }
 
         public readonly string Id;
+        public readonly int SortId = RenderQueue.GrabSortId();
         public IndexBuffer Indices;
         public BoundingBox AABB;
         public BoundingSphere BoundingSphere;
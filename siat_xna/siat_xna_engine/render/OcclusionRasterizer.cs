@@ -0,0 +1,634 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using Microsoft.Xna.Framework;
+using Microsoft.Xna.Framework.Graphics;
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+
+namespace siat.render
+{
+    /// <summary>
+    /// Selects how OcclusionKdTree decides that a node is occluded.
+    /// </summary>
+    public enum OcclusionMode
+    {
+        Hardware, // Hardware occlusion queries, with results from a previous frame.
+        Software, // OcclusionRasterizer, with results from the current frame.
+        Compare // Hardware queries cull, both are tested and counted.
+    }
+
+    /// <summary>
+    /// Positions and triangle list indices of an occluder, drawn by OcclusionRasterizer.
+    /// </summary>
+    /// <remarks>
+    /// Occluders should be simple, closed and fully inside the geometry they represent, so that they
+    /// never occlude something the real geometry would not.
+    /// </remarks>
+    public sealed class OccluderMesh
+    {
+        public OccluderMesh(Vector3[] aPositions, int[] aIndices)
+        {
+            if ((aIndices.Length % 3) != 0) { throw new ArgumentException("aIndices must be a triangle list."); }
+
+            Positions = aPositions;
+            Indices = aIndices;
+        }
+
+        public readonly Vector3[] Positions;
+        public readonly int[] Indices;
+
+        public int TriangleCount { get { return (Indices.Length / 3); } }
+
+        /// <summary>
+        /// Reads the positions and indices of aPart back from its vertex and index buffers.
+        /// </summary>
+        /// <remarks>
+        /// The buffers of aPart must be readable, which is true for mesh parts loaded by the content
+        /// pipeline but not for buffers created with BufferUsage.WriteOnly.
+        /// </remarks>
+        public static OccluderMesh FromMeshPart(MeshPart aPart)
+        {
+            if (aPart.PrimitiveType != PrimitiveType.TriangleList) { throw new Exception("Occluder mesh part \"" + aPart.Id + "\" is not a triangle list."); }
+
+            int offset = -1;
+            VertexElement[] elements = aPart.VertexDeclaration.GetVertexElements();
+            foreach (VertexElement e in elements)
+            {
+                if (e.VertexElementUsage == VertexElementUsage.Position && e.UsageIndex == 0 && e.VertexElementFormat == VertexElementFormat.Vector3)
+                {
+                    offset = e.Offset;
+                    break;
+                }
+            }
+
+            if (offset < 0) { throw new Exception("Occluder mesh part \"" + aPart.Id + "\" has no Vector3 position element."); }
+
+            Vector3[] positions = new Vector3[aPart.VertexCount];
+            aPart.Vertices.GetData<Vector3>(offset, positions, 0, aPart.VertexCount, aPart.VertexStride);
+
+            int indexCount = (aPart.PrimitiveCount * 3);
+            int[] indices = new int[indexCount];
+
+            if (aPart.Indices.IndexElementSize == IndexElementSize.SixteenBits)
+            {
+                short[] shortIndices = new short[indexCount];
+                aPart.Indices.GetData<short>(shortIndices, 0, indexCount);
+                for (int i = 0; i < indexCount; i++) { indices[i] = (ushort)shortIndices[i]; }
+            }
+            else
+            {
+                aPart.Indices.GetData<int>(indices, 0, indexCount);
+            }
+
+            return new OccluderMesh(positions, indices);
+        }
+    }
+
+    /// <summary>
+    /// Software depth rasterizer of occluders and hierarchical-Z occlusion test.
+    /// </summary>
+    /// <remarks>
+    /// Each frame, before the pose, the occluders registered during the update are drawn into a
+    /// low resolution depth buffer from the active camera:
+    /// - triangles are transformed, set up and binned into screen tiles in parallel, per occluder,
+    ///   with each WorkPool thread writing to its own bins.
+    /// - tiles are rasterized in parallel, each tile reading the bins of all threads. Depth is a
+    ///   minimum, so the result does not depend on the order of triangles.
+    /// - a pyramid is built in which each texel holds the farthest depth of the 2x2 texels below.
+    ///
+    /// IsOccluded() then tests a world space box against the pyramid level at which the screen
+    /// rectangle of the box covers at most 2x2 texels. Unlike hardware queries, the result is
+    /// for the current frame.
+    ///
+    /// Only pixels whose centers are inside a triangle are written, and triangles that cross the
+    /// near plane are dropped rather than clipped, so the buffer never holds depth an occluder
+    /// does not cover.
+    /// </remarks>
+    public static class OcclusionRasterizer
+    {
+        public const int kDefaultWidth = 320;
+        public const int kDefaultHeight = 192;
+        public const int kTileSize = 32;
+
+        #region Private members
+        private struct Occluder
+        {
+            public OccluderMesh Mesh;
+            public Matrix World;
+            public BoundingBox AABB;
+        }
+
+        /// <summary>
+        /// A triangle in screen space. Inside is where all edge functions A * x + B * y + C are >= 0,
+        /// depth is ZA * x + ZB * y + ZC.
+        /// </summary>
+        private struct Tri
+        {
+            public float A0, B0, C0;
+            public float A1, B1, C1;
+            public float A2, B2, C2;
+            public float ZA, ZB, ZC;
+            public int MinX, MinY, MaxX, MaxY;
+        }
+
+        private sealed class Bins
+        {
+            public Vector3[] Screen = new Vector3[0];
+            public bool[] bBehind = new bool[0];
+            public Tri[] Tris = new Tri[256];
+            public int TriCount = 0;
+            public List<int>[] Tiles = new List<int>[0];
+
+            public void Reset(int aTileCount)
+            {
+                if (Tiles.Length != aTileCount)
+                {
+                    Tiles = new List<int>[aTileCount];
+                    for (int i = 0; i < aTileCount; i++) { Tiles[i] = new List<int>(); }
+                }
+                else
+                {
+                    for (int i = 0; i < aTileCount; i++) { Tiles[i].Clear(); }
+                }
+
+                TriCount = 0;
+            }
+        }
+
+        private static OcclusionMode msMode = OcclusionMode.Hardware;
+        private static List<Occluder> msOccluders = new List<Occluder>();
+        private static List<Occluder> msVisibleOccluders = new List<Occluder>();
+        private static Bins[] msBins = new Bins[WorkPool.kMaxThreads];
+
+        private static int msWidth = 0;
+        private static int msHeight = 0;
+        private static int msTilesX = 0;
+        private static int msTilesY = 0;
+        private static float[][] msLevels = new float[0][];
+        private static int[] msLevelWidths = new int[0];
+        private static int[] msLevelHeights = new int[0];
+        private static Matrix msViewProjection = Matrix.Identity;
+        private static bool msbValid = false;
+
+        private static WorkItem msSetup = _Setup;
+        private static WorkItem msRasterize = _RasterizeTile;
+        private static Stopwatch msTimer = new Stopwatch();
+        private static int msOccluderCount = 0;
+        private static int msTriangleCount = 0;
+        private static double msRasterizeTime = 0.0;
+        private static int msComparedCount = 0;
+        private static int msHardwareOccludedCount = 0;
+        private static int msSoftwareOccludedCount = 0;
+        private static int msBothOccludedCount = 0;
+
+        private static void _Setup(int aIndex, int aThread)
+        {
+            Occluder occluder = msVisibleOccluders[aIndex];
+            Bins bins = msBins[aThread];
+
+            Matrix wvp = (occluder.World * msViewProjection);
+            Vector3[] positions = occluder.Mesh.Positions;
+            int[] indices = occluder.Mesh.Indices;
+            int vertexCount = positions.Length;
+            float width = (float)msWidth;
+            float height = (float)msHeight;
+
+            if (bins.Screen.Length < vertexCount)
+            {
+                bins.Screen = new Vector3[vertexCount];
+                bins.bBehind = new bool[vertexCount];
+            }
+
+            for (int i = 0; i < vertexCount; i++)
+            {
+                Vector4 c;
+                Vector4 p = new Vector4(positions[i], 1.0f);
+                Vector4.Transform(ref p, ref wvp, out c);
+
+                bins.bBehind[i] = (c.Z < 0.0f);
+                if (!bins.bBehind[i])
+                {
+                    float iw = 1.0f / c.W;
+                    bins.Screen[i] = new Vector3(
+                        ((c.X * iw * 0.5f) + 0.5f) * width,
+                        (0.5f - (c.Y * iw * 0.5f)) * height,
+                        c.Z * iw);
+                }
+            }
+
+            int indexCount = indices.Length;
+            for (int i = 0; i < indexCount; i += 3)
+            {
+                int i0 = indices[i + 0];
+                int i1 = indices[i + 1];
+                int i2 = indices[i + 2];
+
+                if (bins.bBehind[i0] || bins.bBehind[i1] || bins.bBehind[i2]) { continue; }
+
+                _Bin(bins, ref bins.Screen[i0], ref bins.Screen[i1], ref bins.Screen[i2]);
+            }
+        }
+
+        private static void _Bin(Bins aBins, ref Vector3 v0, ref Vector3 v1, ref Vector3 v2)
+        {
+            float area = ((v1.X - v0.X) * (v2.Y - v0.Y)) - ((v2.X - v0.X) * (v1.Y - v0.Y));
+            if (Utilities.AboutZero(area)) { return; }
+
+            // Occluders are double sided, flip clockwise triangles to keep the inside positive.
+            Vector3 p0 = v0;
+            Vector3 p1 = (area > 0.0f) ? v1 : v2;
+            Vector3 p2 = (area > 0.0f) ? v2 : v1;
+            area = Math.Abs(area);
+
+            Tri t;
+            t.MinX = Utilities.Max((int)Math.Floor(Utilities.Min(p0.X, p1.X, p2.X)), 0);
+            t.MinY = Utilities.Max((int)Math.Floor(Utilities.Min(p0.Y, p1.Y, p2.Y)), 0);
+            t.MaxX = Utilities.Min((int)Math.Floor(Utilities.Max(p0.X, p1.X, p2.X)), msWidth - 1);
+            t.MaxY = Utilities.Min((int)Math.Floor(Utilities.Max(p0.Y, p1.Y, p2.Y)), msHeight - 1);
+
+            if (t.MinX > t.MaxX || t.MinY > t.MaxY) { return; }
+
+            t.A0 = (p0.Y - p1.Y); t.B0 = (p1.X - p0.X); t.C0 = (p0.X * p1.Y) - (p1.X * p0.Y);
+            t.A1 = (p1.Y - p2.Y); t.B1 = (p2.X - p1.X); t.C1 = (p1.X * p2.Y) - (p2.X * p1.Y);
+            t.A2 = (p2.Y - p0.Y); t.B2 = (p0.X - p2.X); t.C2 = (p2.X * p0.Y) - (p0.X * p2.Y);
+
+            float invArea = 1.0f / area;
+            t.ZA = (((p1.Z - p0.Z) * (p2.Y - p0.Y)) - ((p2.Z - p0.Z) * (p1.Y - p0.Y))) * invArea;
+            t.ZB = (((p2.Z - p0.Z) * (p1.X - p0.X)) - ((p1.Z - p0.Z) * (p2.X - p0.X))) * invArea;
+            t.ZC = p0.Z - (t.ZA * p0.X) - (t.ZB * p0.Y);
+
+            if (aBins.TriCount == aBins.Tris.Length) { Array.Resize(ref aBins.Tris, aBins.TriCount * 2); }
+            int index = aBins.TriCount++;
+            aBins.Tris[index] = t;
+
+            int tx0 = (t.MinX / kTileSize);
+            int tx1 = (t.MaxX / kTileSize);
+            int ty0 = (t.MinY / kTileSize);
+            int ty1 = (t.MaxY / kTileSize);
+
+            for (int y = ty0; y <= ty1; y++)
+            {
+                for (int x = tx0; x <= tx1; x++)
+                {
+                    aBins.Tiles[(y * msTilesX) + x].Add(index);
+                }
+            }
+        }
+
+        private static void _RasterizeTile(int aIndex, int aThread)
+        {
+            float[] depth = msLevels[0];
+
+            int x0 = ((aIndex % msTilesX) * kTileSize);
+            int y0 = ((aIndex / msTilesX) * kTileSize);
+            int x1 = Utilities.Min(x0 + kTileSize, msWidth) - 1;
+            int y1 = Utilities.Min(y0 + kTileSize, msHeight) - 1;
+
+            for (int y = y0; y <= y1; y++)
+            {
+                int row = (y * msWidth);
+                for (int x = x0; x <= x1; x++) { depth[row + x] = 1.0f; }
+            }
+
+            int threads = WorkPool.ThreadCount;
+            for (int i = 0; i < threads; i++)
+            {
+                Bins bins = msBins[i];
+                List<int> tile = bins.Tiles[aIndex];
+                int count = tile.Count;
+
+                for (int j = 0; j < count; j++)
+                {
+                    _Rasterize(ref bins.Tris[tile[j]], depth, x0, y0, x1, y1);
+                }
+            }
+        }
+
+        private static void _Edge(float a, float r, ref float rLo, ref float rHi)
+        {
+            // a * x + r >= 0
+            if (a > 0.0f) { rLo = Utilities.Max(rLo, -r / a); }
+            else if (a < 0.0f) { rHi = Utilities.Min(rHi, -r / a); }
+            else if (r < 0.0f) { rHi = float.MinValue; }
+        }
+
+        /// <summary>
+        /// Draws aTri into the rectangle (x0, y0) - (x1, y1) of aDepth, one span per row.
+        /// </summary>
+        /// <remarks>
+        /// The span of each row is solved from the three edge functions at the row's pixel
+        /// centers, so the inner loop only steps depth and keeps the minimum.
+        /// </remarks>
+        private static void _Rasterize(ref Tri t, float[] aDepth, int x0, int y0, int x1, int y1)
+        {
+            int rowBegin = Utilities.Max(t.MinY, y0);
+            int rowEnd = Utilities.Min(t.MaxY, y1);
+            int colBegin = Utilities.Max(t.MinX, x0);
+            int colEnd = Utilities.Min(t.MaxX, x1);
+
+            for (int y = rowBegin; y <= rowEnd; y++)
+            {
+                float py = ((float)y + 0.5f);
+                float lo = ((float)colBegin + 0.5f);
+                float hi = ((float)colEnd + 0.5f);
+
+                _Edge(t.A0, (t.B0 * py) + t.C0, ref lo, ref hi);
+                _Edge(t.A1, (t.B1 * py) + t.C1, ref lo, ref hi);
+                _Edge(t.A2, (t.B2 * py) + t.C2, ref lo, ref hi);
+
+                if (lo > hi) { continue; }
+
+                int begin = Utilities.Max((int)Math.Ceiling(lo - 0.5f), colBegin);
+                int end = Utilities.Min((int)Math.Floor(hi - 0.5f), colEnd);
+
+                float z = (t.ZA * ((float)begin + 0.5f)) + (t.ZB * py) + t.ZC;
+                int index = (y * msWidth) + begin;
+                int last = (y * msWidth) + end;
+
+                for (; index <= last; index++)
+                {
+                    if (z < aDepth[index]) { aDepth[index] = z; }
+                    z += t.ZA;
+                }
+            }
+        }
+
+        private static void _BuildPyramid()
+        {
+            int levelCount = msLevels.Length;
+            for (int level = 1; level < levelCount; level++)
+            {
+                float[] src = msLevels[level - 1];
+                float[] dst = msLevels[level];
+                int srcWidth = msLevelWidths[level - 1];
+                int srcHeight = msLevelHeights[level - 1];
+                int width = msLevelWidths[level];
+                int height = msLevelHeights[level];
+
+                for (int y = 0; y < height; y++)
+                {
+                    int sy0 = (2 * y) * srcWidth;
+                    int sy1 = Utilities.Min((2 * y) + 1, srcHeight - 1) * srcWidth;
+
+                    for (int x = 0; x < width; x++)
+                    {
+                        int sx0 = (2 * x);
+                        int sx1 = Utilities.Min((2 * x) + 1, srcWidth - 1);
+
+                        float a = Utilities.Max(src[sy0 + sx0], src[sy0 + sx1]);
+                        float b = Utilities.Max(src[sy1 + sx0], src[sy1 + sx1]);
+                        dst[(y * width) + x] = Utilities.Max(a, b);
+                    }
+                }
+            }
+        }
+
+        static OcclusionRasterizer()
+        {
+            for (int i = 0; i < msBins.Length; i++) { msBins[i] = new Bins(); }
+            Resize(kDefaultWidth, kDefaultHeight);
+        }
+        #endregion
+
+        #region Internal members
+        /// <summary>
+        /// Registers an occluder for the next Rasterize(). Called during the update.
+        /// </summary>
+        internal static void _AddOccluder(OccluderMesh aMesh, ref Matrix aWorld, ref BoundingBox aWorldAABB)
+        {
+            if (msMode == OcclusionMode.Hardware) { return; }
+
+            Occluder occluder;
+            occluder.Mesh = aMesh;
+            occluder.World = aWorld;
+            occluder.AABB = aWorldAABB;
+
+            msOccluders.Add(occluder);
+        }
+
+        /// <summary>
+        /// Records the hardware and software results for a node in OcclusionMode.Compare.
+        /// </summary>
+        internal static void _Compare(bool abHardwareOccluded, bool abSoftwareOccluded)
+        {
+            msComparedCount++;
+            if (abHardwareOccluded) { msHardwareOccludedCount++; }
+            if (abSoftwareOccluded) { msSoftwareOccludedCount++; }
+            if (abHardwareOccluded && abSoftwareOccluded) { msBothOccludedCount++; }
+        }
+
+        internal static void _ResetStats()
+        {
+            msOccluderCount = 0;
+            msTriangleCount = 0;
+            msRasterizeTime = 0.0;
+            msComparedCount = 0;
+            msHardwareOccludedCount = 0;
+            msSoftwareOccludedCount = 0;
+            msBothOccludedCount = 0;
+        }
+        #endregion
+
+        /// <summary>
+        /// Draws the occluders registered during the last update from the active camera and builds
+        /// the depth pyramid. Called by Siat each frame before the pose.
+        /// </summary>
+        public static void Rasterize()
+        {
+            msbValid = false;
+            if (msMode == OcclusionMode.Hardware) { msOccluders.Clear(); return; }
+
+            msTimer.Reset();
+            msTimer.Start();
+
+            msViewProjection = Shared.ViewProjectionTransform;
+
+            msVisibleOccluders.Clear();
+            int count = msOccluders.Count;
+            for (int i = 0; i < count; i++)
+            {
+                Occluder occluder = msOccluders[i];
+                if (Shared.ActiveWorldFrustum.Contains(ref occluder.AABB) != ContainmentType.Disjoint)
+                {
+                    msVisibleOccluders.Add(occluder);
+                }
+            }
+            msOccluders.Clear();
+
+            int tileCount = (msTilesX * msTilesY);
+            int threads = WorkPool.ThreadCount;
+            for (int i = 0; i < threads; i++) { msBins[i].Reset(tileCount); }
+
+            WorkPool.For(msVisibleOccluders.Count, msSetup);
+            WorkPool.For(tileCount, msRasterize);
+            _BuildPyramid();
+
+            for (int i = 0; i < threads; i++) { msTriangleCount += msBins[i].TriCount; }
+            msOccluderCount += msVisibleOccluders.Count;
+            msVisibleOccluders.Clear();
+            msbValid = true;
+
+            msTimer.Stop();
+            msRasterizeTime += msTimer.Elapsed.TotalMilliseconds;
+        }
+
+        /// <summary>
+        /// Returns true if aWorldAABB is hidden behind the occluders drawn by the last Rasterize().
+        /// </summary>
+        /// <remarks>
+        /// This only reads the depth pyramid, so it can be called from multiple threads at the same
+        /// time. Boxes that cross the near plane or are outside the screen are never occluded.
+        /// </remarks>
+        public static bool IsOccluded(ref BoundingBox aWorldAABB)
+        {
+            if (!msbValid) { return false; }
+
+            float minX = float.MaxValue;
+            float minY = float.MaxValue;
+            float maxX = float.MinValue;
+            float maxY = float.MinValue;
+            float minZ = float.MaxValue;
+
+            for (int i = 0; i < 8; i++)
+            {
+                Vector4 p = new Vector4(
+                    ((i & 1) != 0) ? aWorldAABB.Max.X : aWorldAABB.Min.X,
+                    ((i & 2) != 0) ? aWorldAABB.Max.Y : aWorldAABB.Min.Y,
+                    ((i & 4) != 0) ? aWorldAABB.Max.Z : aWorldAABB.Min.Z,
+                    1.0f);
+
+                Vector4 c;
+                Vector4.Transform(ref p, ref msViewProjection, out c);
+                if (c.Z < 0.0f) { return false; }
+
+                float iw = 1.0f / c.W;
+                float x = ((c.X * iw * 0.5f) + 0.5f) * msWidth;
+                float y = (0.5f - (c.Y * iw * 0.5f)) * msHeight;
+
+                minX = Utilities.Min(minX, x);
+                minY = Utilities.Min(minY, y);
+                maxX = Utilities.Max(maxX, x);
+                maxY = Utilities.Max(maxY, y);
+                minZ = Utilities.Min(minZ, c.Z * iw);
+            }
+
+            int x0 = Utilities.Max((int)Math.Floor(minX), 0);
+            int y0 = Utilities.Max((int)Math.Floor(minY), 0);
+            int x1 = Utilities.Min((int)Math.Floor(maxX), msWidth - 1);
+            int y1 = Utilities.Min((int)Math.Floor(maxY), msHeight - 1);
+
+            if (x0 > x1 || y0 > y1) { return false; }
+
+            int level = 0;
+            int lastLevel = (msLevels.Length - 1);
+            while (level < lastLevel && (((x1 >> level) - (x0 >> level)) > 1 || ((y1 >> level) - (y0 >> level)) > 1)) { level++; }
+
+            float[] depth = msLevels[level];
+            int width = msLevelWidths[level];
+            int tx1 = (x1 >> level);
+            int ty1 = (y1 >> level);
+
+            for (int y = (y0 >> level); y <= ty1; y++)
+            {
+                for (int x = (x0 >> level); x <= tx1; x++)
+                {
+                    if (minZ <= depth[(y * width) + x]) { return false; }
+                }
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// Sets the resolution of the occluder depth buffer.
+        /// </summary>
+        public static void Resize(int aWidth, int aHeight)
+        {
+            if (aWidth <= 0 || aHeight <= 0) { throw new ArgumentOutOfRangeException("Occlusion buffer dimensions must be > 0."); }
+
+            msWidth = aWidth;
+            msHeight = aHeight;
+            msTilesX = ((aWidth + kTileSize - 1) / kTileSize);
+            msTilesY = ((aHeight + kTileSize - 1) / kTileSize);
+
+            List<float[]> levels = new List<float[]>();
+            List<int> widths = new List<int>();
+            List<int> heights = new List<int>();
+
+            int width = aWidth;
+            int height = aHeight;
+            while (true)
+            {
+                levels.Add(new float[width * height]);
+                widths.Add(width);
+                heights.Add(height);
+
+                if (width == 1 && height == 1) { break; }
+                width = Utilities.Max((width + 1) / 2, 1);
+                height = Utilities.Max((height + 1) / 2, 1);
+            }
+
+            msLevels = levels.ToArray();
+            msLevelWidths = widths.ToArray();
+            msLevelHeights = heights.ToArray();
+            msbValid = false;
+        }
+
+        /// <summary>
+        /// Copies the occluder depth buffer into aTexture, which must be SurfaceFormat.Single and
+        /// Width x Height.
+        /// </summary>
+        public static void Get(Texture2D aTexture)
+        {
+            if (aTexture.Width != msWidth || aTexture.Height != msHeight) { throw new ArgumentException("Dimensions of aTexture are not equal to occlusion buffer dimensions."); }
+            if (aTexture.Format != SurfaceFormat.Single) { throw new ArgumentException("Format of aTexture is not SurfaceFormat.Single."); }
+
+            aTexture.SetData<float>(msLevels[0]);
+        }
+
+        public static OcclusionMode Mode { get { return msMode; } set { msMode = value; msbValid = false; } }
+        public static int Width { get { return msWidth; } }
+        public static int Height { get { return msHeight; } }
+
+        /// <summary>
+        /// Number of occluders and triangles drawn this frame.
+        /// </summary>
+        public static int OccluderCount { get { return msOccluderCount; } }
+        public static int TriangleCount { get { return msTriangleCount; } }
+
+        /// <summary>
+        /// Time in milliseconds spent in Rasterize() this frame.
+        /// </summary>
+        public static double RasterizeTime { get { return msRasterizeTime; } }
+
+        /// <summary>
+        /// In OcclusionMode.Compare, the number of kd-tree nodes tested this frame and the number
+        /// found occluded by hardware queries, by the software rasterizer, and by both.
+        /// </summary>
+        public static int ComparedCount { get { return msComparedCount; } }
+        public static int HardwareOccludedCount { get { return msHardwareOccludedCount; } }
+        public static int SoftwareOccludedCount { get { return msSoftwareOccludedCount; } }
+        public static int BothOccludedCount { get { return msBothOccludedCount; } }
+    }
+}
@@ -0,0 +1,384 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using Microsoft.Xna.Framework;
+using Microsoft.Xna.Framework.Graphics;
+using System;
+using System.Collections.Generic;
+
+namespace siat.render
+{
+    /// <summary>
+    /// Screen rectangle and view depth range through which the cell behind a portal is seen.
+    /// </summary>
+    /// <remarks>
+    /// Rectangles are in pixels of the back buffer, with Right and Bottom exclusive. Instances are
+    /// pooled by PortalScissor and are only valid until the end of the frame they were posed in.
+    /// </remarks>
+    public sealed class PortalRect
+    {
+        public int Left;
+        public int Top;
+        public int Right;
+        public int Bottom;
+
+        /// <summary>
+        /// View depth range of the clipped portal polygon. Everything seen through the portal
+        /// is at least MinDepth from the camera.
+        /// </summary>
+        public float MinDepth;
+        public float MaxDepth;
+
+        public int Width { get { return (Right - Left); } }
+        public int Height { get { return (Bottom - Top); } }
+        public int Area { get { return (Width * Height); } }
+        public bool bEmpty { get { return (Right <= Left || Bottom <= Top); } }
+    }
+
+    /// <summary>
+    /// Restricts the draws of objects seen through portals to the screen rectangle of the portal.
+    /// </summary>
+    /// <remarks>
+    /// During the camera pose, each PortalNode projects its clipped polygon to a PortalRect,
+    /// intersected with the rect of the portal it was seen through, and makes it active while the
+    /// cell behind it is posed. Base, lit, deferred and transparent draws record the active rect
+    /// and set it as the scissor rectangle when they are drawn. Deferred light volumes record the
+    /// rect of the pose that added them, see Deferred.RenderLights().
+    ///
+    /// A cell is posed once per frame, with the rect of the first portal it is seen through. Its
+    /// draws all refer to that one rect. When the cell is reached through another portal, the rect
+    /// is grown in place to the union of both with _Grow(), so everything recorded for the cell is
+    /// drawn through either portal. See Cell.FrustumPose().
+    ///
+    /// Pixel counts are by area: each scissored draw adds the area of its rect to PixelsInside and
+    /// the rest of its target to PixelsOutside. They are upper bounds of the pixels shaded and of
+    /// the pixels a draw could have touched outside of its portal.
+    /// </remarks>
+    public static class PortalScissor
+    {
+        #region Private members
+        private static List<PortalRect> msRects = new List<PortalRect>();
+        private static int msUsed = 0;
+        private static PortalRect msActive = null;
+        private static PortalRect msApplied = null;
+        private static bool msbEnabled = true;
+
+        private static int msPortalCount = 0;
+        private static int msEmptyCount = 0;
+        private static int msGrownCount = 0;
+        private static int msDrawCount = 0;
+        private static int msRejectedLights = 0;
+        private static long msPixelsInside = 0;
+        private static long msPixelsOutside = 0;
+
+        private static PortalRect _Grab()
+        {
+            if (msUsed == msRects.Count) { msRects.Add(new PortalRect()); }
+
+            return msRects[msUsed++];
+        }
+
+        private static void _Count(int aInside, int aTotal)
+        {
+            msDrawCount++;
+            msPixelsInside += aInside;
+            msPixelsOutside += (aTotal - aInside);
+        }
+        #endregion
+
+        #region Internal members
+        /// <summary>
+        /// Projects the world positions of a clipped portal polygon, intersects the result with
+        /// the active rect and makes it active. Returns false, without changing the active rect,
+        /// if the portal covers no pixels.
+        /// </summary>
+        /// <remarks>
+        /// aWorldPositions must already be clipped to the active world frustum, so all positions
+        /// are in front of the near plane.
+        /// </remarks>
+        internal static bool _Push(Vector3[] aWorldPositions)
+        {
+            if (!msbEnabled) { return true; }
+
+            GraphicsDevice gd = Siat.Singleton.GraphicsDevice;
+            float width = gd.PresentationParameters.BackBufferWidth;
+            float height = gd.PresentationParameters.BackBufferHeight;
+            Matrix viewProjection = Shared.ViewProjectionTransform;
+
+            float minX = float.MaxValue;
+            float minY = float.MaxValue;
+            float maxX = float.MinValue;
+            float maxY = float.MinValue;
+            float minDepth = float.MaxValue;
+            float maxDepth = float.MinValue;
+
+            int count = aWorldPositions.Length;
+            for (int i = 0; i < count; i++)
+            {
+                Vector4 p = Vector4.Transform(aWorldPositions[i], viewProjection);
+                float x = (0.5f + 0.5f * (p.X / p.W)) * width;
+                float y = (0.5f - 0.5f * (p.Y / p.W)) * height;
+
+                minX = Math.Min(minX, x); maxX = Math.Max(maxX, x);
+                minY = Math.Min(minY, y); maxY = Math.Max(maxY, y);
+                minDepth = Math.Min(minDepth, p.W); maxDepth = Math.Max(maxDepth, p.W);
+            }
+
+            PortalRect rect = _Grab();
+            rect.Left = Math.Max((int)Math.Floor(minX), 0);
+            rect.Top = Math.Max((int)Math.Floor(minY), 0);
+            rect.Right = Math.Min((int)Math.Ceiling(maxX), (int)width);
+            rect.Bottom = Math.Min((int)Math.Ceiling(maxY), (int)height);
+            rect.MinDepth = minDepth;
+            rect.MaxDepth = maxDepth;
+
+            if (msActive != null)
+            {
+                rect.Left = Math.Max(rect.Left, msActive.Left);
+                rect.Top = Math.Max(rect.Top, msActive.Top);
+                rect.Right = Math.Min(rect.Right, msActive.Right);
+                rect.Bottom = Math.Min(rect.Bottom, msActive.Bottom);
+            }
+
+            if (rect.bEmpty)
+            {
+                msUsed--;
+                msEmptyCount++;
+                return false;
+            }
+
+            msPortalCount++;
+            msActive = rect;
+
+            return true;
+        }
+
+        /// <summary>
+        /// Restores the rect that was active before the matching _Push().
+        /// </summary>
+        internal static void _Pop(PortalRect aPrevious)
+        {
+            msActive = aPrevious;
+        }
+
+        /// <summary>
+        /// Grows aRect to also cover aOther. A null aOther, a cell seen directly, grows aRect to
+        /// the whole back buffer and the full depth range. Returns true if aRect changed.
+        /// </summary>
+        /// <remarks>
+        /// aRect is modified in place so all draws, light jobs and deferred lights that recorded
+        /// it are drawn through the grown rect.
+        /// </remarks>
+        internal static bool _Grow(PortalRect aRect, PortalRect aOther)
+        {
+            int left, top, right, bottom;
+            float minDepth, maxDepth;
+
+            if (aOther == null)
+            {
+                GraphicsDevice gd = Siat.Singleton.GraphicsDevice;
+                left = 0;
+                top = 0;
+                right = gd.PresentationParameters.BackBufferWidth;
+                bottom = gd.PresentationParameters.BackBufferHeight;
+                minDepth = 0.0f;
+                maxDepth = float.MaxValue;
+            }
+            else
+            {
+                left = Math.Min(aRect.Left, aOther.Left);
+                top = Math.Min(aRect.Top, aOther.Top);
+                right = Math.Max(aRect.Right, aOther.Right);
+                bottom = Math.Max(aRect.Bottom, aOther.Bottom);
+                minDepth = Math.Min(aRect.MinDepth, aOther.MinDepth);
+                maxDepth = Math.Max(aRect.MaxDepth, aOther.MaxDepth);
+            }
+
+            if (left == aRect.Left && top == aRect.Top && right == aRect.Right && bottom == aRect.Bottom &&
+                minDepth == aRect.MinDepth && maxDepth == aRect.MaxDepth)
+            {
+                return false;
+            }
+
+            aRect.Left = left;
+            aRect.Top = top;
+            aRect.Right = right;
+            aRect.Bottom = bottom;
+            aRect.MinDepth = minDepth;
+            aRect.MaxDepth = maxDepth;
+            msGrownCount++;
+
+            return true;
+        }
+
+        /// <summary>
+        /// Returns true if everything inside aOther is also inside aRect. A null aRect covers
+        /// everything, a null aOther is only covered by a null aRect.
+        /// </summary>
+        internal static bool _Covers(PortalRect aRect, PortalRect aOther)
+        {
+            if (aRect == null) { return true; }
+            if (aOther == null) { return false; }
+
+            return (aRect.Left <= aOther.Left && aRect.Top <= aOther.Top &&
+                aRect.Right >= aOther.Right && aRect.Bottom >= aOther.Bottom);
+        }
+
+        /// <summary>
+        /// The rect of the portal the current pose is seen through, null if seen directly.
+        /// Set directly by PoseJobs while applying jobs recorded under a portal.
+        /// </summary>
+        internal static PortalRect _Active { get { return msActive; } set { msActive = value; } }
+
+        /// <summary>
+        /// Sets aRect as the scissor rectangle of the back buffer, or disables the scissor test
+        /// if aRect is null. Redundant changes are skipped. Returns true if the state changed.
+        /// </summary>
+        internal static bool _Apply(PortalRect aRect)
+        {
+            GraphicsDevice gd = Siat.Singleton.GraphicsDevice;
+
+            if (aRect != null)
+            {
+                _Count(aRect.Area, gd.PresentationParameters.BackBufferWidth * gd.PresentationParameters.BackBufferHeight);
+            }
+
+            if (aRect == msApplied) { return false; }
+
+            if (aRect != null)
+            {
+                gd.ScissorRectangle = new Rectangle(aRect.Left, aRect.Top, aRect.Width, aRect.Height);
+                gd.RenderState.ScissorTestEnable = true;
+            }
+            else
+            {
+                gd.RenderState.ScissorTestEnable = false;
+            }
+            msApplied = aRect;
+
+            return true;
+        }
+
+        /// <summary>
+        /// Sets aRect, scaled down by aScale and intersected with aBounds, as the scissor rectangle.
+        /// Used for targets other than the back buffer, and with the split screen rectangles of
+        /// Deferred. Returns false, without changing state, if the intersection is empty.
+        /// </summary>
+        internal static bool _Apply(PortalRect aRect, int aScale, Rectangle aBounds)
+        {
+            int left = Math.Max(aRect.Left / aScale, aBounds.Left);
+            int top = Math.Max(aRect.Top / aScale, aBounds.Top);
+            int right = Math.Min((aRect.Right + aScale - 1) / aScale, aBounds.Right);
+            int bottom = Math.Min((aRect.Bottom + aScale - 1) / aScale, aBounds.Bottom);
+
+            if (right <= left || bottom <= top) { return false; }
+
+            GraphicsDevice gd = Siat.Singleton.GraphicsDevice;
+            gd.ScissorRectangle = new Rectangle(left, top, right - left, bottom - top);
+            gd.RenderState.ScissorTestEnable = true;
+            msApplied = null;
+            _Count((right - left) * (bottom - top), aBounds.Width * aBounds.Height);
+
+            return true;
+        }
+
+        /// <summary>
+        /// Disables the scissor test after a sequence of _Apply() calls.
+        /// </summary>
+        internal static void _End()
+        {
+            Siat.Singleton.GraphicsDevice.RenderState.ScissorTestEnable = false;
+            msApplied = null;
+        }
+
+        internal static void _RejectLight()
+        {
+            msRejectedLights++;
+        }
+
+        /// <summary>
+        /// Releases all rects of the frame. Called by RenderRoot after drawing.
+        /// </summary>
+        internal static void _Reset()
+        {
+            msUsed = 0;
+            msActive = null;
+            msApplied = null;
+        }
+
+        internal static void _ResetStats()
+        {
+            msPortalCount = 0;
+            msEmptyCount = 0;
+            msGrownCount = 0;
+            msDrawCount = 0;
+            msRejectedLights = 0;
+            msPixelsInside = 0;
+            msPixelsOutside = 0;
+        }
+        #endregion
+
+        /// <summary>
+        /// If false, portals do not restrict drawing and PortalNode only reduces the frustum.
+        /// Useful for comparing timings.
+        /// </summary>
+        public static bool bEnabled { get { return msbEnabled; } set { msbEnabled = value; } }
+
+        /// <summary>
+        /// Number of portal rects posed this frame.
+        /// </summary>
+        public static int PortalCount { get { return msPortalCount; } }
+
+        /// <summary>
+        /// Number of visible portals this frame whose rect was empty, so the cell behind them
+        /// was not posed.
+        /// </summary>
+        public static int EmptyCount { get { return msEmptyCount; } }
+
+        /// <summary>
+        /// Number of times this frame a cell was reached through another portal and its rect was
+        /// grown to cover it.
+        /// </summary>
+        public static int GrownCount { get { return msGrownCount; } }
+
+        /// <summary>
+        /// Number of draws this frame restricted to a portal rect.
+        /// </summary>
+        public static int DrawCount { get { return msDrawCount; } }
+
+        /// <summary>
+        /// Number of deferred light volumes this frame skipped because they were entirely in front
+        /// of the portal they were seen through.
+        /// </summary>
+        public static int RejectedLights { get { return msRejectedLights; } }
+
+        /// <summary>
+        /// Pixels inside portal rects covered by scissored draws this frame.
+        /// </summary>
+        public static long PixelsInside { get { return msPixelsInside; } }
+
+        /// <summary>
+        /// Pixels outside portal rects excluded from scissored draws this frame.
+        /// </summary>
+        public static long PixelsOutside { get { return msPixelsOutside; } }
+    }
+}
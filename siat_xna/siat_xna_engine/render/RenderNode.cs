@@ -95,6 +95,8 @@ namespace siat.render
             {
                 ResetPool<RenderNode>.Reset();
             }
+
+            public static int Used { get { return ResetPool<RenderNode>.Used; } }
         }
 
         private void _Reset()
@@ -205,6 +207,11 @@ namespace siat.render
             }
         }
 
+        /// <summary>
+        /// Number of RenderNodes, across all trees, adopted since the last reset.
+        /// </summary>
+        public static int PoolCount { get { return RenderPool.Used; } }
+
         public void Render() { mDelegate(this, mInstance); }
         public static RenderNode SpawnRoot() { return new RenderNode(); }
 
@@ -0,0 +1,600 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using Microsoft.Xna.Framework;
+using Microsoft.Xna.Framework.Graphics;
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using System.Threading;
+using siat.scene;
+
+namespace siat.render
+{
+    /// <summary>
+    /// Flat, sort key based queue of opaque draw commands.
+    /// </summary>
+    /// <remarks>
+    /// The opaque passes submit the bulk of the draws each frame. Instead of building a RenderNode
+    /// tree for them, each draw is stored as a command in an array that is reused every frame, along
+    /// with a 64-bit sort key. The keys are radix sorted once per frame and the commands are then
+    /// submitted in key order, skipping any state that is equal to the state of the previous command.
+    ///
+    /// Key layout, from most to least significant bits:
+    /// <code>
+    /// pass (2) | technique (8) | effect (12) | light (8) | material (12) | mesh (10) | depth (12)
+    /// </code>
+    /// Effect, light, material, and mesh fields are the low bits of a sort id assigned to each
+    /// object at construction (see GrabSortId()). Two objects can share the same bits, which only
+    /// costs an extra state change, since redundant state filtering compares the objects themselves.
+    ///
+    /// Base commands added with _AddBase() can absorb one light command of the same object added
+    /// later with _AddLit(). The base command is switched to a technique that draws the base and
+    /// the light together, and the light command is moved to a pass that is never drawn. Of the
+    /// lights of an object, directional lights are preferred, then shadowed spot, spot, and point.
+    ///
+    /// Each command also records the PortalRect active when it was added. The rect is not part of
+    /// the key; it is applied as the scissor rectangle during submission, like any other state.
+    /// </remarks>
+    public static class RenderQueue
+    {
+        public enum Pass
+        {
+            kBaseDeferred = 0,
+            kBaseOpaque = 1,
+            kLitOpaque = 2
+        }
+
+        public const int kInitialCapacity = 4096;
+
+        #region Private members
+        private const ulong kFoldedPass = 3;
+        private const int kPassShift = 62;
+        private const int kTechniqueShift = 54;
+        private const int kEffectShift = 42;
+        private const int kLightShift = 34;
+        private const int kMaterialShift = 22;
+        private const int kMeshShift = 12;
+
+        private const ulong kTechniqueMask = 0xFF;
+        private const ulong kEffectMask = 0xFFF;
+        private const ulong kLightMask = 0xFF;
+        private const ulong kMaterialMask = 0xFFF;
+        private const ulong kMeshMask = 0x3FF;
+        private const uint kDepthMask = 0xFFF;
+
+        private const int kRadixBits = 8;
+        private const int kRadixSize = (1 << kRadixBits);
+        private const int kRadixPasses = (64 / kRadixBits);
+
+        private struct Command
+        {
+            public SiatEffect Effect;
+            public int Technique;
+            public MatrixWrapper ViewProjection;
+            public LightNode Light;
+            public bool bCastShadow;
+            public SiatMaterial Material;
+            public MeshPart Mesh;
+            public Vector4[] Skinning;
+            public Matrix3Wrapper ITWorld;
+            public MatrixWrapper World;
+            public PortalRect Scissor;
+            public float Sort;
+        }
+
+        private struct Fusable
+        {
+            public int Base;
+            public int Lit;
+            public int Priority;
+        }
+
+        [StructLayout(LayoutKind.Explicit)]
+        private struct FloatBits
+        {
+            [FieldOffset(0)]
+            public float Float;
+            [FieldOffset(0)]
+            public uint Bits;
+        }
+
+        private static int msSortIdCounter = 0;
+
+        private static Command[] msCommands = new Command[kInitialCapacity];
+        private static ulong[] msKeys = new ulong[kInitialCapacity];
+        private static ulong[] msScratchKeys = new ulong[kInitialCapacity];
+        private static int[] msIndices = new int[kInitialCapacity];
+        private static int[] msScratchIndices = new int[kInitialCapacity];
+        private static int[] msRadixCounts = new int[kRadixSize];
+        private static int msCount = 0;
+        private static bool msbSorted = false;
+        private static int msSubmitted = 0;
+        private static Dictionary<MatrixWrapper, Fusable> msFusable = new Dictionary<MatrixWrapper, Fusable>();
+        private static int msFused = 0;
+        private static int msReplicateCount = 0;
+        private static int msQueued = 0;
+
+        private static Stopwatch msTimer = new Stopwatch();
+        private static int msStateChanges = 0;
+        private static int msStateChangesFiltered = 0;
+        private static double msSortTime = 0.0;
+        private static double msSubmitTime = 0.0;
+
+        private static void _Grow()
+        {
+            int capacity = msCommands.Length * 2;
+
+            Array.Resize<Command>(ref msCommands, capacity);
+            Array.Resize<ulong>(ref msKeys, capacity);
+            msScratchKeys = new ulong[capacity];
+            msIndices = new int[capacity];
+            msScratchIndices = new int[capacity];
+        }
+
+        /// <summary>
+        /// Quantizes a non-negative sort value to 12 bits.
+        /// </summary>
+        /// <remarks>
+        /// The bits of a positive IEEE float are ordered the same as the float, so the exponent and
+        /// top mantissa bits give a monotonic, logarithmic quantization without needing a known range.
+        /// </remarks>
+        private static ulong _QuantizeDepth(float aSort)
+        {
+            if (aSort <= 0.0f) { return 0; }
+
+            FloatBits f = new FloatBits();
+            f.Float = aSort;
+
+            return (ulong)((f.Bits >> 19) & kDepthMask);
+        }
+
+        private static ulong _Key(ulong aPass, ref Command c)
+        {
+            ulong key = (aPass << kPassShift);
+            key |= ((ulong)c.Technique & kTechniqueMask) << kTechniqueShift;
+            key |= ((ulong)c.Effect.SortId & kEffectMask) << kEffectShift;
+            if (c.Light != null) { key |= ((ulong)c.Light.SortId & kLightMask) << kLightShift; }
+            if (c.Material != null) { key |= ((ulong)c.Material.SortId & kMaterialMask) << kMaterialShift; }
+            key |= ((ulong)c.Mesh.SortId & kMeshMask) << kMeshShift;
+            key |= _QuantizeDepth(c.Sort);
+
+            return key;
+        }
+
+        private static int _LightPriority(LightNode aLight, bool abCastShadow)
+        {
+            switch (aLight.Light.Type)
+            {
+                case LightType.Directional: return 3;
+                case LightType.Spot: return (abCastShadow) ? 2 : 1;
+                default: return 0;
+            }
+        }
+
+        /// <summary>
+        /// Least significant digit radix sort of the keys. Passes over digits that are equal
+        /// for all keys are skipped, which is common for the high bits.
+        /// </summary>
+        private static void _Sort()
+        {
+            if (msReplicateCount > msCount) { _Replicate(); }
+            msQueued += msCount;
+
+            msTimer.Reset();
+            msTimer.Start();
+
+            for (int i = 0; i < msCount; i++) { msIndices[i] = i; }
+
+            ulong[] keys = msKeys;
+            ulong[] scratchKeys = msScratchKeys;
+            int[] indices = msIndices;
+            int[] scratchIndices = msScratchIndices;
+
+            for (int pass = 0; pass < kRadixPasses; pass++)
+            {
+                int shift = (pass * kRadixBits);
+
+                Array.Clear(msRadixCounts, 0, kRadixSize);
+                for (int i = 0; i < msCount; i++) { msRadixCounts[(int)((keys[i] >> shift) & (kRadixSize - 1))]++; }
+
+                if (msRadixCounts[(int)((keys[0] >> shift) & (kRadixSize - 1))] == msCount) { continue; }
+
+                int total = 0;
+                for (int i = 0; i < kRadixSize; i++)
+                {
+                    int count = msRadixCounts[i];
+                    msRadixCounts[i] = total;
+                    total += count;
+                }
+
+                for (int i = 0; i < msCount; i++)
+                {
+                    int digit = (int)((keys[i] >> shift) & (kRadixSize - 1));
+                    int index = msRadixCounts[digit]++;
+
+                    scratchKeys[index] = keys[i];
+                    scratchIndices[index] = indices[i];
+                }
+
+                ulong[] tk = keys; keys = scratchKeys; scratchKeys = tk;
+                int[] ti = indices; indices = scratchIndices; scratchIndices = ti;
+            }
+
+            msKeys = keys;
+            msScratchKeys = scratchKeys;
+            msIndices = indices;
+            msScratchIndices = scratchIndices;
+            msbSorted = true;
+
+            msTimer.Stop();
+            msSortTime += msTimer.Elapsed.TotalMilliseconds;
+        }
+
+        /// <summary>
+        /// Repeats the commands of this frame, in order, until there are msReplicateCount. Copies
+        /// keep their keys, so each pass grows in proportion and folded lights stay folded.
+        /// </summary>
+        private static void _Replicate()
+        {
+            int count = msCount;
+            if (count == 0) { return; }
+
+            while (msCommands.Length < msReplicateCount) { _Grow(); }
+
+            for (int i = count; i < msReplicateCount; i++)
+            {
+                msCommands[i] = msCommands[i % count];
+                msKeys[i] = msKeys[i % count];
+            }
+
+            msCount = msReplicateCount;
+        }
+
+        private static void _SetEffect(ref Command c)
+        {
+            SiatEffect effect = c.Effect;
+            if (RenderRoot.msActiveEffect != effect) { FrameProfiler._EffectSwitch(); }
+            RenderRoot.msActiveEffect = effect;
+
+            if (effect[RenderRoot.BuiltInParameters.siat_Gamma] != null)
+            {
+                effect.Set(RenderRoot.BuiltInParameters.siat_Gamma, RenderRoot.Gamma);
+            }
+
+            if (c.ViewProjection != null)
+            {
+                effect.Set(RenderRoot.BuiltInParameters.siat_ViewProjectionTransform, c.ViewProjection.Matrix);
+            }
+            else
+            {
+                effect.Set(RenderRoot.BuiltInParameters.siat_InverseViewTransform, Shared.InverseViewTransform);
+                effect.Set(RenderRoot.BuiltInParameters.siat_ViewTransform, Shared.ViewTransform);
+                effect.Set(RenderRoot.BuiltInParameters.siat_ViewProjectionTransform, Shared.ViewProjectionTransform);
+            }
+
+            effect.CurrentTechnique = c.Technique;
+        }
+
+        /// <summary>
+        /// Submits sorted commands [aBegin, aEnd), which all share the active effect and technique,
+        /// within a single effect pass.
+        /// </summary>
+        private static void _Submit(int aBegin, int aEnd)
+        {
+            Siat siat = Siat.Singleton;
+            GraphicsDevice gd = siat.GraphicsDevice;
+            SiatEffect effect = RenderRoot.msActiveEffect;
+
+            LightNode light = null;
+            SiatMaterial material = null;
+            MeshPart mesh = null;
+            VertexDeclaration declaration = null;
+            Vector4[] skinning = null;
+
+            for (int i = aBegin; i < aEnd; i++)
+            {
+                int index = msIndices[i];
+
+                if (PortalScissor._Apply(msCommands[index].Scissor)) { msStateChanges++; }
+                else if (msCommands[index].Scissor != null) { msStateChangesFiltered++; }
+
+                if (msCommands[index].Light != light)
+                {
+                    light = msCommands[index].Light;
+                    if (light != null)
+                    {
+                        RenderRoot.RenderOperations._SetLight(light, msCommands[index].bCastShadow);
+                        msStateChanges++;
+                    }
+                }
+                else if (light != null) { msStateChangesFiltered++; }
+
+                if (msCommands[index].Material != material)
+                {
+                    material = msCommands[index].Material;
+                    if (material != null) { material.SetToEffect(effect); FrameProfiler._MaterialSwitch(); }
+                    msStateChanges++;
+                }
+                else if (material != null) { msStateChangesFiltered++; }
+
+                if (msCommands[index].Mesh.VertexDeclaration != declaration)
+                {
+                    declaration = msCommands[index].Mesh.VertexDeclaration;
+                    gd.VertexDeclaration = declaration;
+                    msStateChanges++;
+                }
+                else { msStateChangesFiltered++; }
+
+                if (msCommands[index].Mesh != mesh)
+                {
+                    mesh = msCommands[index].Mesh;
+
+                    gd.Indices = mesh.Indices;
+                    gd.Vertices[0].SetSource(mesh.Vertices, 0, mesh.VertexStride);
+                    siat.DrawIndexedSettings.PrimitiveType = mesh.PrimitiveType;
+                    siat.DrawIndexedSettings.BaseVertex = 0;
+                    siat.DrawIndexedSettings.MinVertexIndex = 0;
+                    siat.DrawIndexedSettings.NumberOfVertices = mesh.VertexCount;
+                    siat.DrawIndexedSettings.StartIndex = 0;
+                    siat.DrawIndexedSettings.PrimitiveCount = mesh.PrimitiveCount;
+                    msStateChanges++;
+                }
+                else { msStateChangesFiltered++; }
+
+                if (msCommands[index].Skinning != null)
+                {
+                    if (msCommands[index].Skinning != skinning)
+                    {
+                        skinning = msCommands[index].Skinning;
+                        effect.Set(RenderRoot.BuiltInParameters.siat_SkinningTransforms, skinning);
+                        msStateChanges++;
+                    }
+                    else { msStateChangesFiltered++; }
+                }
+
+                if (msCommands[index].ITWorld != null)
+                {
+                    effect.Set(RenderRoot.BuiltInParameters.siat_InverseTransposeWorldTransform, msCommands[index].ITWorld.Matrix.ToMatrix());
+                }
+
+                effect.Set(RenderRoot.BuiltInParameters.siat_WorldTransform, msCommands[index].World.Matrix);
+                effect.CommitChanges();
+                siat.DrawIndexedPrimitives();
+            }
+
+            msSubmitted += (aEnd - aBegin);
+        }
+        #endregion
+
+        #region Internal members
+        internal static void _Add(Pass aPass, SiatEffect aEffect, object aTechnique, MatrixWrapper aViewProjection, LightNode aLight, bool abCastShadow, SiatMaterial aMaterial, MeshPart aMeshPart, Vector4[] aSkinning, Matrix3Wrapper aITWorld, MatrixWrapper aWorld, float aSort)
+        {
+            if (msCount == msCommands.Length) { _Grow(); }
+
+            msCommands[msCount].Effect = aEffect;
+            msCommands[msCount].Technique = (int)aTechnique;
+            msCommands[msCount].ViewProjection = aViewProjection;
+            msCommands[msCount].Light = aLight;
+            msCommands[msCount].bCastShadow = abCastShadow;
+            msCommands[msCount].Material = aMaterial;
+            msCommands[msCount].Mesh = aMeshPart;
+            msCommands[msCount].Skinning = aSkinning;
+            msCommands[msCount].ITWorld = aITWorld;
+            msCommands[msCount].World = aWorld;
+            msCommands[msCount].Scissor = PortalScissor._Active;
+            msCommands[msCount].Sort = aSort;
+            msKeys[msCount] = _Key((ulong)aPass, ref msCommands[msCount]);
+            msCount++;
+            msbSorted = false;
+        }
+
+        /// <summary>
+        /// Adds a Pass.kBaseOpaque command that can absorb a light command of the same aWorld.
+        /// </summary>
+        internal static void _AddBase(SiatEffect aEffect, object aTechnique, MatrixWrapper aViewProjection, SiatMaterial aMaterial, MeshPart aMeshPart, Vector4[] aSkinning, MatrixWrapper aWorld, float aSort)
+        {
+            Fusable f;
+            f.Base = msCount;
+            f.Lit = -1;
+            f.Priority = -1;
+
+            _Add(Pass.kBaseOpaque, aEffect, aTechnique, aViewProjection, null, false, aMaterial, aMeshPart, aSkinning, null, aWorld, aSort);
+            msFusable[aWorld] = f;
+        }
+
+        /// <summary>
+        /// Adds a Pass.kLitOpaque command. If aBaseTechnique is not null and a base command of aWorld
+        /// was added with _AddBase(), the light may instead be drawn by the base command with
+        /// aBaseTechnique.
+        /// </summary>
+        internal static void _AddLit(SiatEffect aEffect, object aTechnique, object aBaseTechnique, LightNode aLight, bool abCastShadow, SiatMaterial aMaterial, MeshPart aMeshPart, Vector4[] aSkinning, Matrix3Wrapper aITWorld, MatrixWrapper aWorld, float aSort)
+        {
+            int lit = msCount;
+            _Add(Pass.kLitOpaque, aEffect, aTechnique, null, aLight, abCastShadow, aMaterial, aMeshPart, aSkinning, aITWorld, aWorld, aSort);
+
+            if (aBaseTechnique == null) { return; }
+
+            Fusable f;
+            if (!msFusable.TryGetValue(aWorld, out f)) { return; }
+            if (msCommands[f.Base].Effect != aEffect || msCommands[f.Base].Mesh != aMeshPart) { return; }
+            if (msCommands[f.Base].Scissor != msCommands[lit].Scissor) { return; }
+
+            int priority = _LightPriority(aLight, abCastShadow);
+            if (priority <= f.Priority) { return; }
+
+            // Give the previously absorbed light its own pass back.
+            if (f.Lit >= 0) { msKeys[f.Lit] = _Key((ulong)Pass.kLitOpaque, ref msCommands[f.Lit]); }
+            else { msFused++; }
+
+            msCommands[f.Base].Technique = (int)aBaseTechnique;
+            msCommands[f.Base].ViewProjection = null;
+            msCommands[f.Base].Light = aLight;
+            msCommands[f.Base].bCastShadow = abCastShadow;
+            msCommands[f.Base].ITWorld = aITWorld;
+            msKeys[f.Base] = _Key((ulong)Pass.kBaseOpaque, ref msCommands[f.Base]);
+            msKeys[lit] = _Key(kFoldedPass, ref msCommands[lit]);
+
+            f.Lit = lit;
+            f.Priority = priority;
+            msFusable[aWorld] = f;
+        }
+
+        /// <summary>
+        /// Draws all commands of aPass.
+        /// </summary>
+        internal static void _Draw(Pass aPass)
+        {
+            if (msCount == 0) { return; }
+            if (!msbSorted) { _Sort(); }
+
+            msTimer.Reset();
+            msTimer.Start();
+
+            Siat siat = Siat.Singleton;
+            ulong pass = (ulong)aPass;
+
+            int i = 0;
+            while (i < msCount && (msKeys[i] >> kPassShift) < pass) { i++; }
+
+            while (i < msCount && (msKeys[i] >> kPassShift) == pass)
+            {
+                int begin = i;
+                SiatEffect effect = msCommands[msIndices[begin]].Effect;
+                int technique = msCommands[msIndices[begin]].Technique;
+                MatrixWrapper viewProjection = msCommands[msIndices[begin]].ViewProjection;
+
+                for (i = begin + 1; i < msCount; i++)
+                {
+                    int index = msIndices[i];
+
+                    if ((msKeys[i] >> kPassShift) != pass ||
+                        msCommands[index].Effect != effect ||
+                        msCommands[index].Technique != technique ||
+                        msCommands[index].ViewProjection != viewProjection)
+                    {
+                        break;
+                    }
+                }
+
+                _SetEffect(ref msCommands[msIndices[begin]]);
+                msStateChanges++;
+
+                FrameProfiler._BeginTechnique(technique);
+                effect.Begin();
+                {
+                    EffectPassCollection passes = effect.Passes;
+                    int count = passes.Count;
+                    for (int j = 0; j < count; j++)
+                    {
+                        siat.mEffectPasses++;
+                        FrameProfiler._Pass();
+                        passes[j].Begin();
+                        _Submit(begin, i);
+                        passes[j].End();
+                    }
+                }
+                effect.End();
+                FrameProfiler._End();
+            }
+            PortalScissor._End();
+
+            msTimer.Stop();
+            msSubmitTime += msTimer.Elapsed.TotalMilliseconds;
+        }
+
+        /// <summary>
+        /// Empties the queue. References are cleared so the queue does not keep unloaded
+        /// content alive.
+        /// </summary>
+        internal static void _Reset()
+        {
+            Array.Clear(msCommands, 0, msCount);
+            msFusable.Clear();
+            msCount = 0;
+            msbSorted = false;
+        }
+
+        /// <summary>
+        /// If greater than the number of commands added in a frame, the commands are repeated
+        /// up to this count before sorting. Used by RenderQueueBenchmark, 0 otherwise.
+        /// </summary>
+        internal static int _ReplicateCount { get { return msReplicateCount; } set { msReplicateCount = value; } }
+
+        internal static void _ResetStats()
+        {
+            msQueued = 0;
+            msSubmitted = 0;
+            msFused = 0;
+            msStateChanges = 0;
+            msStateChangesFiltered = 0;
+            msSortTime = 0.0;
+            msSubmitTime = 0.0;
+        }
+        #endregion
+
+        /// <summary>
+        /// Returns a new sort id. Called once for each effect, material, mesh, and light at construction.
+        /// </summary>
+        public static int GrabSortId()
+        {
+            return Interlocked.Increment(ref msSortIdCounter);
+        }
+
+        /// <summary>
+        /// Number of commands sorted this frame, including folded light commands that are not drawn.
+        /// </summary>
+        public static int QueuedCount { get { return msQueued; } }
+
+        /// <summary>
+        /// Number of commands submitted this frame, including once for each pass of multi-pass techniques.
+        /// </summary>
+        public static int SubmittedCount { get { return msSubmitted; } }
+
+        /// <summary>
+        /// Number of opaque objects this frame whose base pass also drew one of their lights.
+        /// </summary>
+        public static int FusedCount { get { return msFused; } }
+
+        /// <summary>
+        /// Number of state changes applied during submission this frame.
+        /// </summary>
+        public static int StateChanges { get { return msStateChanges; } }
+
+        /// <summary>
+        /// Number of state changes skipped during submission this frame because the state was
+        /// equal to the state of the previous command.
+        /// </summary>
+        public static int StateChangesFiltered { get { return msStateChangesFiltered; } }
+
+        /// <summary>
+        /// Time in milliseconds spent sorting the queue this frame.
+        /// </summary>
+        public static double SortTime { get { return msSortTime; } }
+
+        /// <summary>
+        /// Time in milliseconds spent submitting the queue to the device this frame.
+        /// </summary>
+        public static double SubmitTime { get { return msSubmitTime; } }
+    }
+}
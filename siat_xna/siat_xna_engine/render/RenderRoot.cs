@@ -27,6 +27,7 @@ using Microsoft.Xna.Framework;
 using Microsoft.Xna.Framework.Graphics;
 using System;
 using System.Collections.Generic;
+using System.Diagnostics;
 using System.Text;
 
 namespace siat.render
@@ -78,34 +79,51 @@ namespace siat.render
         internal static RenderState msRenderState = null;
 
         internal static List<LightNode> msDeferredLightList = new List<LightNode>();
+        internal static List<PortalRect> msDeferredLightRects = new List<PortalRect>();
 
+        internal static RenderNode msRenderShadowStatic = RenderNode.SpawnRoot();
         internal static RenderNode msRenderShadow = RenderNode.SpawnRoot();
         internal static RenderNode msRenderPicking = RenderNode.SpawnRoot();
-        internal static RenderNode msRenderBaseDeferred = RenderNode.SpawnRoot();
-        internal static RenderNode msRenderBaseOpaque = RenderNode.SpawnRoot();
         internal static RenderNode msRenderOcclusionQueries = RenderNode.SpawnRoot();
         internal static RenderNode msRenderDeferred = RenderNode.SpawnRoot();
-        internal static RenderNode msRenderLitOpaque = RenderNode.SpawnRoot();
         internal static RenderNode msRenderTransparent = RenderNode.SpawnRoot();
         internal static RenderNode msRenderSky = RenderNode.SpawnRoot();
 
         private static List<string> msParameterTable = new List<string>();
         private static List<string> msTechniqueTable = new List<string>();
+
+        private static Stopwatch msDrawTimer = new Stopwatch();
+        private static int msRenderNodeCount = 0;
+        private static double msDrawTime = 0.0;
+        private static bool msbFusedLighting = true;
+        private static bool msbEarlyOutLighting = true;
+
+        private static readonly int msDeferredLightsScope = FrameProfiler.GetScopeId("Deferred lights");
+        private static readonly int msPostScope = FrameProfiler.GetScopeId("Post");
         #endregion
 
         #region Internal members
         internal static void _ResetTrees()
         {
             msDeferredLightList.Clear();
+            msDeferredLightRects.Clear();
+            msRenderShadowStatic.Reset();
             msRenderShadow.Reset();
             msRenderPicking.Reset();
-            msRenderBaseDeferred.Reset();
-            msRenderBaseOpaque.Reset();
             msRenderOcclusionQueries.Reset();
             msRenderDeferred.Reset();
-            msRenderLitOpaque.Reset();
             msRenderSky.Reset();
             msRenderTransparent.Reset();
+            RenderQueue._Reset();
+            PortalScissor._Reset();
+        }
+
+        internal static void _ResetStats()
+        {
+            msRenderNodeCount = 0;
+            msDrawTime = 0.0;
+            RenderQueue._ResetStats();
+            PortalScissor._ResetStats();
         }
         #endregion
 
@@ -220,17 +238,25 @@ namespace siat.render
         public static class BuiltInTechniques
         {
             public static readonly object siat_RenderBase;
+            public static readonly object siat_RenderBaseDirectionalLight;
+            public static readonly object siat_RenderBasePointLight;
+            public static readonly object siat_RenderBaseSpotLight;
+            public static object siat_RenderBaseSpotLightShadow;
             public static readonly object siat_RenderDeferred;
             public static readonly object siat_RenderDirectionalLight;
             public static readonly object siat_RenderOcclusionQuery;
             public static readonly object siat_RenderPicking;
             public static readonly object siat_RenderPointLight;
+            public static readonly object siat_RenderPointLightEarlyOut;
             public static readonly object siat_RenderPortal;
+            public static readonly object siat_RenderShadowComposite;
             public static readonly object siat_RenderShadowDepth;
             public static readonly object siat_RenderAnimatedShadowDepth;
             public static readonly object siat_RenderSolid;
             public static readonly object siat_RenderSpotLight;
+            public static readonly object siat_RenderSpotLightEarlyOut;
             public static object siat_RenderSpotLightShadow;
+            public static object siat_RenderSpotLightShadowEarlyOut;
             public static readonly object siat_RenderWireframe;
 
             public static readonly object[] kBaseTechniques;
@@ -241,19 +267,33 @@ namespace siat.render
                 bool bPS3 = (Siat.Singleton.GraphicsDevice.GraphicsDeviceCapabilities.PixelShaderVersion.Major >= 3);
 
                 siat_RenderBase = RenderRoot.GetTechniqueId("siat_RenderBase");
+                siat_RenderBaseDirectionalLight = RenderRoot.GetTechniqueId("siat_RenderBaseDirectionalLight");
+                siat_RenderBasePointLight = RenderRoot.GetTechniqueId("siat_RenderBasePointLight");
+                siat_RenderBaseSpotLight = RenderRoot.GetTechniqueId("siat_RenderBaseSpotLight");
+                siat_RenderBaseSpotLightShadow = (bPS3) ? RenderRoot.GetTechniqueId("siat_RenderBaseSpotLightShadow_Filtered") : RenderRoot.GetTechniqueId("siat_RenderBaseSpotLightShadow_Unfiltered");
                 siat_RenderDeferred = RenderRoot.GetTechniqueId("siat_RenderDeferred");
                 siat_RenderDirectionalLight = RenderRoot.GetTechniqueId("siat_RenderDirectionalLight");
                 siat_RenderOcclusionQuery = RenderRoot.GetTechniqueId("siat_RenderOcclusionQuery");
                 siat_RenderPicking = RenderRoot.GetTechniqueId("siat_RenderPicking");
                 siat_RenderPointLight = RenderRoot.GetTechniqueId("siat_RenderPointLight");
+                siat_RenderPointLightEarlyOut = RenderRoot.GetTechniqueId("siat_RenderPointLightEarlyOut");
                 siat_RenderPortal = RenderRoot.GetTechniqueId("siat_RenderPortal");
+                siat_RenderShadowComposite = RenderRoot.GetTechniqueId("siat_RenderShadowComposite");
                 siat_RenderShadowDepth = RenderRoot.GetTechniqueId("siat_RenderShadowDepth");
                 siat_RenderAnimatedShadowDepth = RenderRoot.GetTechniqueId("siat_RenderAnimatedShadowDepth");
                 siat_RenderSolid = RenderRoot.GetTechniqueId("siat_RenderSolid");
                 siat_RenderSpotLight = RenderRoot.GetTechniqueId("siat_RenderSpotLight");
+                siat_RenderSpotLightEarlyOut = RenderRoot.GetTechniqueId("siat_RenderSpotLightEarlyOut");
                 siat_RenderSpotLightShadow = (bPS3) ? RenderRoot.GetTechniqueId("siat_RenderSpotLightShadow_Filtered") : RenderRoot.GetTechniqueId("siat_RenderSpotLightShadow_Unfiltered"); 
+                siat_RenderSpotLightShadowEarlyOut = (bPS3) ? RenderRoot.GetTechniqueId("siat_RenderSpotLightShadowEarlyOut_Filtered") : RenderRoot.GetTechniqueId("siat_RenderSpotLightShadowEarlyOut_Unfiltered");
                 siat_RenderWireframe = RenderRoot.GetTechniqueId("siat_RenderWireframe");
 
+                // Fused base and light techniques are compiled for shader model 3.
+                msbFusedLighting = msbFusedLighting && bPS3;
+
+                // Early-out light techniques depend on dynamic branching.
+                msbEarlyOutLighting = msbEarlyOutLighting && bPS3;
+
                 kBaseTechniques = new object[] 
                     { siat_RenderBase };
 
@@ -272,7 +312,12 @@ namespace siat.render
 
         public static void Draw()
         {
+            msDrawTimer.Reset();
+            msDrawTimer.Start();
+            msRenderNodeCount = RenderNode.PoolCount;
+
             DepthStencilBuffer defaultBuffer = msGraphics.DepthStencilBuffer;
+            msRenderShadowStatic.RenderChildrenAndReset();
             msRenderShadow.RenderChildrenAndReset();
             msGraphics.DepthStencilBuffer = defaultBuffer;
 
@@ -282,9 +327,12 @@ namespace siat.render
                 msRenderDeferred.RenderChildrenAndReset();
 
                 DeferredPost.Begin();
-                msRenderBaseDeferred.RenderChildrenAndReset();
-                Deferred.RenderLights(msDeferredLightList);
+                RenderQueue._Draw(RenderQueue.Pass.kBaseDeferred);
+                FrameProfiler._Begin(msDeferredLightsScope);
+                Deferred.RenderLights(msDeferredLightList, msDeferredLightRects);
+                FrameProfiler._End();
                 msDeferredLightList.Clear();
+                msDeferredLightRects.Clear();
             }
             else
             {
@@ -293,16 +341,33 @@ namespace siat.render
                 //msGraphics.Clear(ClearOptions.DepthBuffer | ClearOptions.Stencil | ClearOptions.Target, msClearColor, 1.0f, Siat.kDefaultReferenceStencil);
             }
 
-            msRenderBaseOpaque.RenderChildrenAndReset();
+            RenderQueue._Draw(RenderQueue.Pass.kBaseOpaque);
             msRenderOcclusionQueries.RenderChildrenAndReset();
-            msRenderLitOpaque.RenderChildrenAndReset();
+            RenderQueue._Draw(RenderQueue.Pass.kLitOpaque);
             msRenderSky.RenderChildrenAndReset();
             msRenderTransparent.RenderChildrenAndReset();
+            RenderQueue._Reset();
+            PortalScissor._Reset();
 
+            FrameProfiler._Begin(msPostScope);
             if (Deferred.bActive) { DeferredPost.End(); }
             else { ForwardPost.End(); }
+            FrameProfiler._End();
+
+            msDrawTimer.Stop();
+            msDrawTime += msDrawTimer.Elapsed.TotalMilliseconds;
         }
 
+        /// <summary>
+        /// Number of RenderNodes posed this frame.
+        /// </summary>
+        public static int RenderNodeCount { get { return msRenderNodeCount; } }
+
+        /// <summary>
+        /// Time in milliseconds spent in Draw() this frame, including render queue submission.
+        /// </summary>
+        public static double DrawTime { get { return msDrawTime; } }
+
         public static bool bDeferredLighting
         {
             get { return Deferred.bActive; }
@@ -324,15 +389,42 @@ namespace siat.render
             {
                 bool bPS3 = (Siat.Singleton.GraphicsDevice.GraphicsDeviceCapabilities.PixelShaderVersion.Major >= 3);
 
-                if (bPS3)
+                if (bPS3 && value)
                 {
-                    if (value) { BuiltInTechniques.siat_RenderSpotLightShadow = RenderRoot.GetTechniqueId("siat_RenderSpotLightShadow_Filtered"); }
-                    else { BuiltInTechniques.siat_RenderSpotLightShadow = RenderRoot.GetTechniqueId("siat_RenderSpotLightShadow_Unfiltered"); }
+                    BuiltInTechniques.siat_RenderSpotLightShadow = RenderRoot.GetTechniqueId("siat_RenderSpotLightShadow_Filtered");
+                    BuiltInTechniques.siat_RenderSpotLightShadowEarlyOut = RenderRoot.GetTechniqueId("siat_RenderSpotLightShadowEarlyOut_Filtered");
+                    BuiltInTechniques.siat_RenderBaseSpotLightShadow = RenderRoot.GetTechniqueId("siat_RenderBaseSpotLightShadow_Filtered");
+                }
+                else
+                {
+                    BuiltInTechniques.siat_RenderSpotLightShadow = RenderRoot.GetTechniqueId("siat_RenderSpotLightShadow_Unfiltered");
+                    BuiltInTechniques.siat_RenderSpotLightShadowEarlyOut = RenderRoot.GetTechniqueId("siat_RenderSpotLightShadowEarlyOut_Unfiltered");
+                    BuiltInTechniques.siat_RenderBaseSpotLightShadow = RenderRoot.GetTechniqueId("siat_RenderBaseSpotLightShadow_Unfiltered");
                 }
-                else { BuiltInTechniques.siat_RenderSpotLightShadow = RenderRoot.GetTechniqueId("siat_RenderSpotLightShadow_Unfiltered"); }
             }
         }
 
+        /// <summary>
+        /// If true, the ambient and emission of an opaque object are drawn in the same pass as its
+        /// first light, when its effect has siat_RenderBase*Light techniques. Requires ps_3_0.
+        /// </summary>
+        public static bool bFusedLighting
+        {
+            get { return msbFusedLighting; }
+            set { msbFusedLighting = value && (Siat.Singleton.GraphicsDevice.GraphicsDeviceCapabilities.PixelShaderVersion.Major >= 3); }
+        }
+
+        /// <summary>
+        /// If true, point and spot lights are drawn with siat_Render*EarlyOut techniques, when the
+        /// effect has them. These test the spot cone, shadow range and shadow before reading the
+        /// material and skip it for pixels the light does not reach. Requires ps_3_0.
+        /// </summary>
+        public static bool bEarlyOutLighting
+        {
+            get { return msbEarlyOutLighting; }
+            set { msbEarlyOutLighting = value && (Siat.Singleton.GraphicsDevice.GraphicsDeviceCapabilities.PixelShaderVersion.Major >= 3); }
+        }
+
         public static Color Pick()
         {
             msGraphics.Clear(ClearOptions.DepthBuffer | ClearOptions.Stencil | ClearOptions.Target, Siat.kPickClearColor, 1.0f, Siat.kDefaultReferenceStencil);
@@ -420,7 +512,48 @@ namespace siat.render
             private static float _SortForOpaque(float aViewDepth) { return -aViewDepth; }
             private static float _SortForTransparent(float aViewDepth) { return aViewDepth; }
 
-            private static void _GetLightDelegateAndTechnique(object aObject, out RenderNodeDelegate arDelegate, out object arTechnique, bool abCastShadow)
+            private static object _GetLightTechnique(SiatEffect aEffect, LightNode aLight, bool abCastShadow)
+            {
+                switch (aLight.Light.Type)
+                {
+                    case LightType.Spot: return _GetEarlyOutTechnique(aEffect, (abCastShadow) ? BuiltInTechniques.siat_RenderSpotLightShadow : BuiltInTechniques.siat_RenderSpotLight);
+                    case LightType.Point: return _GetEarlyOutTechnique(aEffect, BuiltInTechniques.siat_RenderPointLight);
+                    default: return BuiltInTechniques.siat_RenderDirectionalLight;
+                }
+            }
+
+            /// <summary>
+            /// Returns the early-out variant of point or spot light technique aTechnique, if enabled
+            /// and aEffect has it, or aTechnique.
+            /// </summary>
+            private static object _GetEarlyOutTechnique(SiatEffect aEffect, object aTechnique)
+            {
+                if (!msbEarlyOutLighting) { return aTechnique; }
+
+                object technique;
+                if (aTechnique == BuiltInTechniques.siat_RenderPointLight) { technique = BuiltInTechniques.siat_RenderPointLightEarlyOut; }
+                else if (aTechnique == BuiltInTechniques.siat_RenderSpotLight) { technique = BuiltInTechniques.siat_RenderSpotLightEarlyOut; }
+                else { technique = BuiltInTechniques.siat_RenderSpotLightShadowEarlyOut; }
+
+                return (aEffect.GetTechnique(technique) != null) ? technique : aTechnique;
+            }
+
+            private static object _GetBaseLightTechnique(SiatEffect aEffect, LightNode aLight, bool abCastShadow)
+            {
+                if (!msbFusedLighting) { return null; }
+
+                object technique;
+                switch (aLight.Light.Type)
+                {
+                    case LightType.Spot: technique = (abCastShadow) ? BuiltInTechniques.siat_RenderBaseSpotLightShadow : BuiltInTechniques.siat_RenderBaseSpotLight; break;
+                    case LightType.Point: technique = BuiltInTechniques.siat_RenderBasePointLight; break;
+                    default: technique = BuiltInTechniques.siat_RenderBaseDirectionalLight; break;
+                }
+
+                return (aEffect.GetTechnique(technique) != null) ? technique : null;
+            }
+
+            private static void _GetLightDelegateAndTechnique(SiatEffect aEffect, object aObject, out RenderNodeDelegate arDelegate, out object arTechnique, bool abCastShadow)
             {
                 LightNode lightNode = (LightNode)aObject;
 
@@ -428,11 +561,11 @@ namespace siat.render
                 {
                     case LightType.Spot:
                         arDelegate = (abCastShadow) ? RenderOperations.SpotLightShadow : RenderOperations.SpotLight;
-                        arTechnique = (abCastShadow) ? BuiltInTechniques.siat_RenderSpotLightShadow : BuiltInTechniques.siat_RenderSpotLight;
+                        arTechnique = _GetEarlyOutTechnique(aEffect, (abCastShadow) ? BuiltInTechniques.siat_RenderSpotLightShadow : BuiltInTechniques.siat_RenderSpotLight);
                         break;
                     case LightType.Point:
                         arDelegate = RenderOperations.PointLight;
-                        arTechnique = BuiltInTechniques.siat_RenderPointLight;
+                        arTechnique = _GetEarlyOutTechnique(aEffect, BuiltInTechniques.siat_RenderPointLight);
                         break;
                     default:
                         arDelegate = RenderOperations.DirectionalLight;
@@ -442,23 +575,17 @@ namespace siat.render
             }
 
             #region Base
-            private static void _MeshPartBaseOpaque(RenderNode aRoot, MatrixWrapper aWorld, Vector4[] aSkinning, float aOpaqueSort, MeshPart aMeshPart, SiatMaterial aMaterial, SiatEffect aEffect)
+            private static void _MeshPartBaseOpaque(RenderQueue.Pass aPass, MatrixWrapper aWorld, Vector4[] aSkinning, float aOpaqueSort, MeshPart aMeshPart, SiatMaterial aMaterial, SiatEffect aEffect)
             {
-                RenderNode node = aRoot;
-                node = node.AdoptAndUpdateSort(RenderOperations.Effect, aEffect, aOpaqueSort);
-                node = node.Adopt(RenderOperations.ViewProjectionTransform, Shared.ViewProjectionTransformWrapped);
-                node = node.Adopt(RenderOperations.EffectTechnique, BuiltInTechniques.siat_RenderBase);
-                node = node.AdoptAndUpdateSort(RenderOperations.VertexDeclaration, aMeshPart.VertexDeclaration, aOpaqueSort);
-                if (aMaterial != null) { node = node.AdoptAndUpdateSort(RenderOperations.Material, aMaterial, aOpaqueSort); }
-                node = node.AdoptAndUpdateSort(RenderOperations.Mesh, aMeshPart, aOpaqueSort);
-                if (aSkinning != null)
+                if (aPass == RenderQueue.Pass.kBaseOpaque)
                 {
-                    node = node.AdoptSorted(RenderOperations.SkinningTransforms, aSkinning, aOpaqueSort);
-                    node = node.AdoptFront(RenderOperations.WorldTransformAndDrawIndexed, aWorld);
+                    RenderQueue._AddBase(aEffect, BuiltInTechniques.siat_RenderBase, Shared.ViewProjectionTransformWrapped,
+                        aMaterial, aMeshPart, aSkinning, aWorld, aOpaqueSort);
                 }
                 else
                 {
-                    node = node.AdoptSorted(RenderOperations.WorldTransformAndDrawIndexed, aWorld, aOpaqueSort);
+                    RenderQueue._Add(aPass, aEffect, BuiltInTechniques.siat_RenderBase, Shared.ViewProjectionTransformWrapped,
+                        null, false, aMaterial, aMeshPart, aSkinning, null, aWorld, aOpaqueSort);
                 }
             }
 
@@ -476,6 +603,7 @@ namespace siat.render
                 if (aMaterial != null) { node = node.AdoptAndUpdateSort(RenderOperations.Material, aMaterial, aOpaqueSort); }
                 node = node.AdoptAndUpdateSort(RenderOperations.Mesh, aMeshPart, aOpaqueSort);
                 if (aSkinning != null) { node.AdoptAndUpdateSort(RenderOperations.SkinningTransforms, aSkinning, aOpaqueSort); }
+                if (PortalScissor._Active != null) { node = node.AdoptAndUpdateSort(RenderOperations.Scissor, PortalScissor._Active, aOpaqueSort); }
 
                 if (aITWorld != null)
                 {
@@ -498,6 +626,7 @@ namespace siat.render
                 if (aMaterial != null) { node = node.Adopt(RenderOperations.Material, aMaterial); }
                 node = node.Adopt(RenderOperations.Mesh, aMeshPart);
                 if (aSkinning != null) { node = node.Adopt(RenderOperations.SkinningTransforms, aSkinning); }
+                if (PortalScissor._Active != null) { node = node.Adopt(RenderOperations.Scissor, PortalScissor._Active); }
                 node = node.AdoptFront(RenderOperations.WorldTransformAndDrawIndexed, aWorld);
             }
 
@@ -518,17 +647,17 @@ namespace siat.render
                         if (abIncludeInDeferred)
                         {
                             _MeshPartDeferred(aWorld, aITWorld, aSkinning, _SortForOpaque(aViewDepth), aMeshPart, aMaterial, aEffect, RenderOperations.StencilDeferred);
-                            if (aEffect.NeedsBasePass) { _MeshPartBaseOpaque(msRenderBaseDeferred, aWorld, aSkinning, _SortForOpaque(aViewDepth), aMeshPart, aMaterial, aEffect); }
+                            if (aEffect.NeedsBasePass) { _MeshPartBaseOpaque(RenderQueue.Pass.kBaseDeferred, aWorld, aSkinning, _SortForOpaque(aViewDepth), aMeshPart, aMaterial, aEffect); }
                         }
                         else
                         {
                             _MeshPartDeferred(aWorld, aITWorld, aSkinning, _SortForOpaque(aViewDepth), aMeshPart, aMaterial, aEffect, RenderOperations.StencilNoDeferred);
-                            _MeshPartBaseOpaque(msRenderBaseOpaque, aWorld, aSkinning, _SortForOpaque(aViewDepth), aMeshPart, aMaterial, aEffect);
+                            _MeshPartBaseOpaque(RenderQueue.Pass.kBaseOpaque, aWorld, aSkinning, _SortForOpaque(aViewDepth), aMeshPart, aMaterial, aEffect);
                         }
                     }
                     else
                     {
-                        _MeshPartBaseOpaque(msRenderBaseOpaque, aWorld, aSkinning, _SortForOpaque(aViewDepth), aMeshPart, aMaterial, aEffect);
+                        _MeshPartBaseOpaque(RenderQueue.Pass.kBaseOpaque, aWorld, aSkinning, _SortForOpaque(aViewDepth), aMeshPart, aMaterial, aEffect);
                     }
                 }
             }
@@ -541,7 +670,7 @@ namespace siat.render
 
                 RenderNodeDelegate lightDelegate;
                 object technique;
-                _GetLightDelegateAndTechnique(aObject, out lightDelegate, out technique, abCastShadow);
+                _GetLightDelegateAndTechnique(aEffect, aObject, out lightDelegate, out technique, abCastShadow);
 
                 node = node.AdoptSorted(RenderOperations.Effect, aEffect, aTransparentSort);
                 node = node.AdoptSorted(RenderOperations.SetStandardEffectTransforms, Utilities.kDummy, 1.0f);
@@ -552,27 +681,16 @@ namespace siat.render
                 node = node.Adopt(RenderOperations.Mesh, aMeshPart);
                 if (aSkinning != null) { node = node.AdoptFront(RenderOperations.SkinningTransforms, aSkinning); }
                 if (aITWorld != null) { node = node.AdoptFront(RenderOperations.InverseTransposeWorldTransform, aITWorld); }
+                if (PortalScissor._Active != null) { node = node.AdoptFront(RenderOperations.Scissor, PortalScissor._Active); }
                 node = node.AdoptFront(RenderOperations.WorldTransformAndDrawIndexed, aWorld);
             }
 
             private static void _MeshPartLitOpaque(MatrixWrapper aWorld, Matrix3Wrapper aITWorld, Vector4[] aSkinning, float aOpaqueSort, MeshPart aMeshPart, SiatMaterial aMaterial, SiatEffect aEffect, object aObject, bool abCastShadow)
             {
-                RenderNode node = msRenderLitOpaque;
-
-                RenderNodeDelegate lightDelegate;
-                object technique;
-                _GetLightDelegateAndTechnique(aObject, out lightDelegate, out technique, abCastShadow);
+                LightNode light = (LightNode)aObject;
 
-                node = node.Adopt(RenderOperations.Effect, aEffect);
-                node = node.Adopt(RenderOperations.SetStandardEffectTransforms, Utilities.kDummy);
-                node = node.Adopt(RenderOperations.EffectTechnique, technique);
-                node = node.Adopt(RenderOperations.VertexDeclaration, aMeshPart.VertexDeclaration);
-                node = node.Adopt(lightDelegate, aObject);
-                if (aMaterial != null) { node = node.Adopt(RenderOperations.Material, aMaterial); }
-                node = node.Adopt(RenderOperations.Mesh, aMeshPart);
-                if (aSkinning != null) { node = node.AdoptFront(RenderOperations.SkinningTransforms, aSkinning); }
-                if (aITWorld != null) { node = node.AdoptFront(RenderOperations.InverseTransposeWorldTransform, aITWorld); }
-                node = node.AdoptFront(RenderOperations.WorldTransformAndDrawIndexed, aWorld);
+                RenderQueue._AddLit(aEffect, _GetLightTechnique(aEffect, light, abCastShadow), _GetBaseLightTechnique(aEffect, light, abCastShadow),
+                    light, abCastShadow, aMaterial, aMeshPart, aSkinning, aITWorld, aWorld, aOpaqueSort);
             }
 
             private static void _MeshPartLit(MatrixWrapper aWorld, Matrix3Wrapper aITWorld, Vector4[] aSkinning, float aViewDepth, MeshPart aMeshPart, SiatMaterial aMaterial, SiatEffect aEffect, object aObject, bool abCastShadow, bool abIncludeInDeferred)
@@ -598,9 +716,7 @@ namespace siat.render
             {
                 LightNode lightNode = (LightNode)aObject;
 
-                RenderNode node = msRenderShadow;
-                node = node.Adopt(RenderOperations.Effect, msSiat.BuiltInEffect);
-                node = node.Adopt(RenderOperations.RenderTargetAndClear, lightNode.ShadowRenderTarget);
+                RenderNode node = (aSkinning == null) ? _ShadowStatic(lightNode) : _ShadowComposite(lightNode);
                 node = node.Adopt(RenderOperations.ViewTransform, lightNode.ShadowViewWrapped);
                 node = node.Adopt(RenderOperations.ViewProjectionTransform, lightNode.ShadowViewProjectionWrapped);
                 node = node.Adopt(RenderOperations.ShadowRangeParameter, lightNode.RangeBoxed);
@@ -611,6 +727,25 @@ namespace siat.render
                 node = node.AdoptSorted(RenderOperations.WorldTransformAndDrawIndexed, aWorld, aOpaqueSort);
             }
 
+            private static RenderNode _ShadowComposite(LightNode aLight)
+            {
+                RenderNode node = msRenderShadow;
+                node = node.Adopt(RenderOperations.Effect, msSiat.BuiltInEffect);
+                node = node.Adopt(RenderOperations.RenderTargetAndClear, aLight.ShadowRenderTarget);
+                node = node.Adopt(RenderOperations.ShadowStaticComposite, aLight);
+
+                return node;
+            }
+
+            private static RenderNode _ShadowStatic(LightNode aLight)
+            {
+                RenderNode node = msRenderShadowStatic;
+                node = node.Adopt(RenderOperations.Effect, msSiat.BuiltInEffect);
+                node = node.Adopt(RenderOperations.RenderTargetAndClear, aLight.StaticShadowRenderTarget);
+
+                return node;
+            }
+
             private static void _Picking(MatrixWrapper aWorld, Vector4[] aSkinning, float aOpaqueSort, MeshPart aMeshPart, SiatMaterial aMaterial, SiatEffect aEffect, object aPickColorBoxed)
             {
                 RenderNode node = msRenderPicking;
@@ -661,6 +796,24 @@ namespace siat.render
                 _MeshPartShadow(aWorld, null, BuiltInTechniques.siat_RenderShadowDepth, _SortForOpaque(aViewDepth), aMeshPart, aObject);
             }
 
+            /// <summary>
+            /// Poses a copy of the static shadow layer of aLight into its final shadow map.
+            /// Animated casters posed with AnimatedMeshPartShadow() are drawn over this copy.
+            /// </summary>
+            public static void ShadowComposite(LightNode aLight)
+            {
+                _ShadowComposite(aLight);
+            }
+
+            /// <summary>
+            /// Poses a clear of the static shadow layer of aLight. Casters posed with
+            /// MeshPartShadow() are drawn into this layer.
+            /// </summary>
+            public static void ShadowStatic(LightNode aLight)
+            {
+                _ShadowStatic(aLight);
+            }
+
             public static void OcclusionQuery(MatrixWrapper aWorld, OcclusionQuery aOcclusionQuery)
             {
                 RenderNode node;
@@ -722,13 +875,8 @@ namespace siat.render
             {
                 float sort = _SortForOpaque(Vector3.Transform(aWorld.Matrix.Translation, Shared.ViewTransform).Z);
 
-                RenderNode node = msRenderBaseOpaque;
-                node = node.AdoptAndUpdateSort(RenderOperations.Effect, msSiat.BuiltInEffect, sort);
-                node = node.Adopt(RenderOperations.ViewProjectionTransform, Shared.ViewProjectionTransformWrapped);
-                node = node.Adopt(RenderOperations.EffectTechnique, BuiltInTechniques.siat_RenderWireframe);
-                node = node.Adopt(RenderOperations.VertexDeclaration, aMeshPart.VertexDeclaration);
-                node = node.Adopt(RenderOperations.Mesh, aMeshPart);
-                node = node.Adopt(RenderOperations.WorldTransformAndDrawIndexed, aWorld);
+                RenderQueue._Add(RenderQueue.Pass.kBaseOpaque, msSiat.BuiltInEffect, BuiltInTechniques.siat_RenderWireframe, Shared.ViewProjectionTransformWrapped,
+                    null, false, null, aMeshPart, null, null, aWorld, sort);
             }
 
             public static void WireframeBox(MatrixWrapper aWorld)
@@ -745,23 +893,57 @@ namespace siat.render
         public static class RenderOperations
         {
             #region Private members
+            private static void _SetDirectionalLight(LightNode aLight)
+            {
+                Light light = aLight.Light;
+                msActiveEffect.Set(BuiltInParameters.siat_LightDiffuse, light.LightDiffuse);
+                msActiveEffect.Set(BuiltInParameters.siat_LightPositionOrDirection, aLight.WorldLightDirection);
+                msActiveEffect.Set(BuiltInParameters.siat_LightSpecular, light.LightSpecular);
+            }
+
+            private static void _SetPointLight(LightNode aLight)
+            {
+                Light light = aLight.Light;
+                msActiveEffect.Set(BuiltInParameters.siat_LightAttenuation, light.LightAttenuation);
+                msActiveEffect.Set(BuiltInParameters.siat_LightDiffuse, light.LightDiffuse);
+                msActiveEffect.Set(BuiltInParameters.siat_LightPositionOrDirection, aLight.WorldPosition);
+                msActiveEffect.Set(BuiltInParameters.siat_LightSpecular, light.LightSpecular);
+            }
+
+            private static void _SetSpotLight(LightNode aLight)
+            {
+                Light light = aLight.Light;
+                msActiveEffect.Set(BuiltInParameters.siat_LightAttenuation, light.LightAttenuation);
+                msActiveEffect.Set(BuiltInParameters.siat_LightDiffuse, light.LightDiffuse);
+                msActiveEffect.Set(BuiltInParameters.siat_LightPositionOrDirection, aLight.WorldPosition);
+                msActiveEffect.Set(BuiltInParameters.siat_LightSpecular, light.LightSpecular);
+                msActiveEffect.Set(BuiltInParameters.siat_SpotCutoffCosHalfAngle, light.FalloffCosHalfAngle);
+                msActiveEffect.Set(BuiltInParameters.siat_SpotDirection, aLight.WorldLightDirection);
+                msActiveEffect.Set(BuiltInParameters.siat_SpotFalloffExponent, light.FalloffExponent);
+            }
+
+            private static void _SetSpotLightShadow(LightNode aLight)
+            {
+                _SetSpotLight(aLight);
+                msActiveEffect.Set(BuiltInParameters.siat_ShadowRange, aLight.Range);
+                msActiveEffect.Set(BuiltInParameters.siat_ShadowTexture, aLight.ShadowTexture);
+                msActiveEffect.Set(BuiltInParameters.siat_ShadowTransform, aLight.ShadowViewProjection * ShadowMaps.kShadowTransformPost);
+            }
+
             private static void _DirectionalLight(RenderNode aNode, object aInstance)
             {
-                LightNode lightNode = (LightNode)aInstance;
-                Light light = lightNode.Light;
-                msActiveEffect[BuiltInParameters.siat_LightDiffuse].SetValue(light.LightDiffuse);
-                msActiveEffect[BuiltInParameters.siat_LightPositionOrDirection].SetValue(lightNode.WorldLightDirection);
-                msActiveEffect[BuiltInParameters.siat_LightSpecular].SetValue(light.LightSpecular);
+                _SetDirectionalLight((LightNode)aInstance);
 
                 aNode.RenderChildren();
             }
 
             private static void _Effect(RenderNode aNode, object aInstance)
             {
+                if (msActiveEffect != aInstance) { FrameProfiler._EffectSwitch(); }
                 msActiveEffect = (SiatEffect)aInstance;
                 if (msActiveEffect[BuiltInParameters.siat_Gamma] != null)
                 {
-                    msActiveEffect[BuiltInParameters.siat_Gamma].SetValue(Gamma);
+                    msActiveEffect.Set(BuiltInParameters.siat_Gamma, Gamma);
                 }
                 aNode.RenderChildren();
             }
@@ -769,6 +951,7 @@ namespace siat.render
             private static void _EffectTechnique(RenderNode aNode, object aInstance)
             {
                 Siat siat = Siat.Singleton;
+                FrameProfiler._BeginTechnique((int)aInstance);
                 msActiveEffect.CurrentTechnique = (int)aInstance;
                 msActiveEffect.Begin();
                 {
@@ -777,6 +960,7 @@ namespace siat.render
                     for (int i = 0; i < count; i++)
                     {
                         siat.mEffectPasses++;
+                        FrameProfiler._Pass();
                         passes[i].Begin();
                         {
                             aNode.RenderChildren();
@@ -785,12 +969,14 @@ namespace siat.render
                     }
                 }
                 msActiveEffect.End();
+                FrameProfiler._End();
             }
 
             private static void _Material(RenderNode aNode, object aInstance)
             {
                 SiatMaterial material = (SiatMaterial)aInstance;
                 material.SetToEffect(msActiveEffect);
+                FrameProfiler._MaterialSwitch();
 
                 aNode.RenderChildren();
             }
@@ -825,13 +1011,7 @@ namespace siat.render
 
             private static void _PointLight(RenderNode aNode, object aInstance)
             {
-                LightNode lightNode = (LightNode)aInstance;
-                Light light = lightNode.Light;
-
-                msActiveEffect[BuiltInParameters.siat_LightAttenuation].SetValue(light.LightAttenuation);
-                msActiveEffect[BuiltInParameters.siat_LightDiffuse].SetValue(light.LightDiffuse);
-                msActiveEffect[BuiltInParameters.siat_LightPositionOrDirection].SetValue(lightNode.WorldPosition);
-                msActiveEffect[BuiltInParameters.siat_LightSpecular].SetValue(light.LightSpecular);
+                _SetPointLight((LightNode)aInstance);
 
                 aNode.RenderChildren();
             }
@@ -839,7 +1019,7 @@ namespace siat.render
             private static void _InverseTransposeWorldTransform(RenderNode aNode, object aInstance)
             {
                 Matrix3Wrapper inverseTransposeWorld = (Matrix3Wrapper)aInstance;
-                msActiveEffect[BuiltInParameters.siat_InverseTransposeWorldTransform].SetValue(inverseTransposeWorld.Matrix.ToMatrix());
+                msActiveEffect.Set(BuiltInParameters.siat_InverseTransposeWorldTransform, inverseTransposeWorld.Matrix.ToMatrix());
 
                 aNode.RenderChildren();
             }
@@ -847,7 +1027,7 @@ namespace siat.render
             private static void _PickColor(RenderNode aNode, object aInstance)
             {
                 Color pickColor = (Color)aInstance;
-                msActiveEffect[BuiltInParameters.siat_PickingColor].SetValue(pickColor.ToVector4());
+                msActiveEffect.Set(BuiltInParameters.siat_PickingColor, pickColor.ToVector4());
 
                 aNode.RenderChildren();
             }
@@ -865,63 +1045,85 @@ namespace siat.render
             private static void _ShadowRangeParameter(RenderNode aNode, object aInstance)
             {
                 float range = (float)aInstance;
-                msActiveEffect[BuiltInParameters.siat_ShadowRange].SetValue(range);
+                msActiveEffect.Set(BuiltInParameters.siat_ShadowRange, range);
 
                 aNode.RenderChildren();
             }
 
-            private static void _SkinningTransforms(RenderNode aNode, object aInstance)
+            private static void _ShadowStaticComposite(RenderNode aNode, object aInstance)
             {
-                Vector4[] skinning = (Vector4[])aInstance;
-                EffectParameter param = msActiveEffect[BuiltInParameters.siat_SkinningTransforms];
+                LightNode lightNode = (LightNode)aInstance;
+                MeshPart part = msSiat.UnitQuadMeshPart;
 
-                param.SetValue(skinning);
+                msActiveEffect.Set(BuiltInParameters.siat_ProjectionTransform, lightNode.ShadowProjection);
+                msActiveEffect.Set(BuiltInParameters.siat_ShadowRange, lightNode.Range);
+                msActiveEffect.Set(BuiltInParameters.siat_ShadowTexture, lightNode.StaticShadowRenderTarget.Target.GetTexture());
+
+                msGraphics.VertexDeclaration = part.VertexDeclaration;
+                msGraphics.Indices = part.Indices;
+                msGraphics.Vertices[0].SetSource(part.Vertices, 0, part.VertexStride);
+                msSiat.DrawIndexedSettings.PrimitiveType = part.PrimitiveType;
+                msSiat.DrawIndexedSettings.BaseVertex = 0;
+                msSiat.DrawIndexedSettings.MinVertexIndex = 0;
+                msSiat.DrawIndexedSettings.NumberOfVertices = part.VertexCount;
+                msSiat.DrawIndexedSettings.StartIndex = 0;
+                msSiat.DrawIndexedSettings.PrimitiveCount = part.PrimitiveCount;
+
+                FrameProfiler._BeginTechnique((int)BuiltInTechniques.siat_RenderShadowComposite);
+                msActiveEffect.CurrentTechnique = (int)BuiltInTechniques.siat_RenderShadowComposite;
+                msActiveEffect.Begin();
+                {
+                    EffectPassCollection passes = msActiveEffect.Passes;
+                    int count = passes.Count;
+                    for (int i = 0; i < count; i++)
+                    {
+                        msSiat.mEffectPasses++;
+                        FrameProfiler._Pass();
+                        passes[i].Begin();
+                        msSiat.DrawIndexedPrimitives();
+                        passes[i].End();
+                    }
+                }
+                msActiveEffect.End();
+                FrameProfiler._End();
 
                 aNode.RenderChildren();
             }
 
-            private static void _SpotLight(RenderNode aNode, object aInstance)
+            private static void _Scissor(RenderNode aNode, object aInstance)
             {
-                LightNode lightNode = (LightNode)aInstance;
-                Light light = lightNode.Light;
+                PortalScissor._Apply((PortalRect)aInstance);
+                aNode.RenderChildren();
+                PortalScissor._Apply(null);
+            }
 
-                msActiveEffect[BuiltInParameters.siat_LightAttenuation].SetValue(light.LightAttenuation);
-                msActiveEffect[BuiltInParameters.siat_LightDiffuse].SetValue(light.LightDiffuse);
-                msActiveEffect[BuiltInParameters.siat_LightPositionOrDirection].SetValue(lightNode.WorldPosition);
-                msActiveEffect[BuiltInParameters.siat_LightSpecular].SetValue(light.LightSpecular);
-                msActiveEffect[BuiltInParameters.siat_SpotCutoffCosHalfAngle].SetValue(light.FalloffCosHalfAngle);
-                msActiveEffect[BuiltInParameters.siat_SpotDirection].SetValue(lightNode.WorldLightDirection);
-                msActiveEffect[BuiltInParameters.siat_SpotFalloffExponent].SetValue(light.FalloffExponent);
+            private static void _SkinningTransforms(RenderNode aNode, object aInstance)
+            {
+                Vector4[] skinning = (Vector4[])aInstance;
+                msActiveEffect.Set(BuiltInParameters.siat_SkinningTransforms, skinning);
 
                 aNode.RenderChildren();
             }
 
-            private static void _SpotLightShadow(RenderNode aNode, object aInstance)
+            private static void _SpotLight(RenderNode aNode, object aInstance)
             {
-                LightNode lightNode = (LightNode)aInstance;
-                Light light = lightNode.Light;
+                _SetSpotLight((LightNode)aInstance);
 
-                Texture2D texture = lightNode.ShadowRenderTarget.Target.GetTexture();
+                aNode.RenderChildren();
+            }
 
-                msActiveEffect[BuiltInParameters.siat_LightAttenuation].SetValue(light.LightAttenuation);
-                msActiveEffect[BuiltInParameters.siat_LightDiffuse].SetValue(light.LightDiffuse);
-                msActiveEffect[BuiltInParameters.siat_LightPositionOrDirection].SetValue(lightNode.WorldPosition);
-                msActiveEffect[BuiltInParameters.siat_LightSpecular].SetValue(light.LightSpecular);
-                msActiveEffect[BuiltInParameters.siat_ShadowRange].SetValue(lightNode.Range);
-                msActiveEffect[BuiltInParameters.siat_ShadowTexture].SetValue(texture);
-                msActiveEffect[BuiltInParameters.siat_ShadowTransform].SetValue(lightNode.ShadowViewProjection * ShadowMaps.kShadowTransformPost);
-                msActiveEffect[BuiltInParameters.siat_SpotDirection].SetValue(lightNode.WorldLightDirection);
-                msActiveEffect[BuiltInParameters.siat_SpotCutoffCosHalfAngle].SetValue(light.FalloffCosHalfAngle);
-                msActiveEffect[BuiltInParameters.siat_SpotFalloffExponent].SetValue(light.FalloffExponent);
+            private static void _SpotLightShadow(RenderNode aNode, object aInstance)
+            {
+                _SetSpotLightShadow((LightNode)aInstance);
 
                 aNode.RenderChildren();
             }
 
             private static void _StandardEffectTransforms(RenderNode aNode, object aInstance)
             {
-                msActiveEffect[BuiltInParameters.siat_InverseViewTransform].SetValue(Shared.InverseViewTransform);
-                msActiveEffect[BuiltInParameters.siat_ViewTransform].SetValue(Shared.ViewTransform);
-                msActiveEffect[BuiltInParameters.siat_ViewProjectionTransform].SetValue(Shared.ViewProjectionTransform);
+                msActiveEffect.Set(BuiltInParameters.siat_InverseViewTransform, Shared.InverseViewTransform);
+                msActiveEffect.Set(BuiltInParameters.siat_ViewTransform, Shared.ViewTransform);
+                msActiveEffect.Set(BuiltInParameters.siat_ViewProjectionTransform, Shared.ViewProjectionTransform);
 
                 aNode.RenderChildren();
             }
@@ -966,7 +1168,7 @@ namespace siat.render
             private static void _ViewTransform(RenderNode aNode, object aInstance)
             {
                 MatrixWrapper view = (MatrixWrapper)aInstance;
-                msActiveEffect[BuiltInParameters.siat_ViewTransform].SetValue(view.Matrix);
+                msActiveEffect.Set(BuiltInParameters.siat_ViewTransform, view.Matrix);
 
                 aNode.RenderChildren();
             }
@@ -974,7 +1176,7 @@ namespace siat.render
             private static void _ViewProjectionTransform(RenderNode aNode, object aInstance)
             {
                 MatrixWrapper viewProjection = (MatrixWrapper)aInstance;
-                msActiveEffect[BuiltInParameters.siat_ViewProjectionTransform].SetValue(viewProjection.Matrix);
+                msActiveEffect.Set(BuiltInParameters.siat_ViewProjectionTransform, viewProjection.Matrix);
 
                 aNode.RenderChildren();
             }
@@ -982,7 +1184,7 @@ namespace siat.render
             private static void _WorldTransform(RenderNode aNode, object aInstance)
             {
                 MatrixWrapper world = (MatrixWrapper)aInstance;
-                msActiveEffect[BuiltInParameters.siat_WorldTransform].SetValue(world.Matrix);
+                msActiveEffect.Set(BuiltInParameters.siat_WorldTransform, world.Matrix);
 
                 aNode.RenderChildren();
             }
@@ -990,7 +1192,7 @@ namespace siat.render
             private static void _WorldTransformAndDrawIndexed(RenderNode aNode, object aInstance)
             {
                 MatrixWrapper world = (MatrixWrapper)aInstance;
-                msActiveEffect[BuiltInParameters.siat_WorldTransform].SetValue(world.Matrix);
+                msActiveEffect.Set(BuiltInParameters.siat_WorldTransform, world.Matrix);
                 msActiveEffect.CommitChanges();
                 msSiat.DrawIndexedPrimitives();
 
@@ -998,6 +1200,25 @@ namespace siat.render
             }
             #endregion
 
+            #region Internal members
+            /// <summary>
+            /// Sets the parameters of aLight to the active effect. Equivalent to the light
+            /// render operations, for use outside of a RenderNode tree.
+            /// </summary>
+            internal static void _SetLight(LightNode aLight, bool abCastShadow)
+            {
+                switch (aLight.Light.Type)
+                {
+                    case LightType.Spot:
+                        if (abCastShadow) { _SetSpotLightShadow(aLight); }
+                        else { _SetSpotLight(aLight); }
+                        break;
+                    case LightType.Point: _SetPointLight(aLight); break;
+                    default: _SetDirectionalLight(aLight); break;
+                }
+            }
+            #endregion
+
             public static RenderNodeDelegate DirectionalLight = _DirectionalLight;
             public static RenderNodeDelegate Effect = _Effect;
             public static RenderNodeDelegate EffectTechnique = _EffectTechnique;
@@ -1009,8 +1230,10 @@ namespace siat.render
             public static RenderNodeDelegate PickColor = _PickColor;
             public static RenderNodeDelegate PointLight = _PointLight;
             public static RenderNodeDelegate RenderTargetAndClear = _RenderTargetAndClear;
+            public static RenderNodeDelegate Scissor = _Scissor;
             public static RenderNodeDelegate SetStandardEffectTransforms = _StandardEffectTransforms;
             public static RenderNodeDelegate ShadowRangeParameter = _ShadowRangeParameter;
+            public static RenderNodeDelegate ShadowStaticComposite = _ShadowStaticComposite;
             public static RenderNodeDelegate SkinningTransforms = _SkinningTransforms;
             public static RenderNodeDelegate SpotLight = _SpotLight;
             public static RenderNodeDelegate SpotLightShadow = _SpotLightShadow;
@@ -28,6 +28,15 @@ using System.Text;
 
 namespace siat.render
 {
+    /// <summary>
+    /// Pool of shadow map render targets for shadow casting spot lights.
+    /// </summary>
+    /// <remarks>
+    /// Each slot has two targets. The static target holds only the depths of casters that are
+    /// not animated and is re-rendered only when one of those casters (or the light) changes. The
+    /// final target is the static target composited with animated casters, and is only used when
+    /// animated casters are within the light volume.
+    /// </remarks>
     public static class ShadowMaps
     {
         public const int kShadowMapDimension = 512;
@@ -44,9 +53,28 @@ namespace siat.render
         private static bool msbLoaded = false;
         private static DepthStencilBuffer msDepthStencilBuffer = null;
         private static RenderRoot.RenderTargetPackage[] msTargets = new RenderRoot.RenderTargetPackage[kCount];
+        private static RenderRoot.RenderTargetPackage[] msStaticTargets = new RenderRoot.RenderTargetPackage[kCount];
         private static List<int> msFreeList = new List<int>(kCount);
         #endregion
 
+        #region Internal members
+        internal static int msStaticRenderCount = 0;
+        internal static int msCompositeRenderCount = 0;
+        internal static int msReusedCount = 0;
+        internal static int msCastersConsidered = 0;
+        internal static int msCastersDrawn = 0;
+        internal static bool msbReceiverCulling = true;
+
+        internal static void _ResetStats()
+        {
+            msStaticRenderCount = 0;
+            msCompositeRenderCount = 0;
+            msReusedCount = 0;
+            msCastersConsidered = 0;
+            msCastersDrawn = 0;
+        }
+        #endregion
+
         static ShadowMaps()
         {
             for (int i = 0; i < kCount; i++) { msFreeList.Add(i); }
@@ -66,6 +94,10 @@ namespace siat.render
                         new RenderTarget2D(siat.GraphicsDevice,
                         kShadowMapDimension, kShadowMapDimension, 1, SurfaceFormat.Single,
                         RenderTargetUsage.PlatformContents), msDepthStencilBuffer, Color.White);
+                    msStaticTargets[i] = new RenderRoot.RenderTargetPackage(0,
+                        new RenderTarget2D(siat.GraphicsDevice,
+                        kShadowMapDimension, kShadowMapDimension, 1, SurfaceFormat.Single,
+                        RenderTargetUsage.PlatformContents), msDepthStencilBuffer, Color.White);
                 }
 
                 msbLoaded = true;
@@ -76,6 +108,7 @@ namespace siat.render
         {
             if (msbLoaded)
             {
+                for (int i = kCount - 1; i >= 0; i--) { msStaticTargets[i].Dispose(); msStaticTargets[i] = null; }
                 for (int i = kCount - 1; i >= 0; i--) { msTargets[i].Dispose(); msTargets[i] = null; }
                 msDepthStencilBuffer.Dispose(); msDepthStencilBuffer = null;
                 msbLoaded = false;
@@ -98,6 +131,42 @@ namespace siat.render
         }
 
         public static RenderRoot.RenderTargetPackage Get(int i) { return msTargets[i]; }
+        public static RenderRoot.RenderTargetPackage GetStatic(int i) { return msStaticTargets[i]; }
+
+        /// <summary>
+        /// Number of static shadow layers re-rendered this frame.
+        /// </summary>
+        public static int StaticRenderCount { get { return msStaticRenderCount; } }
+
+        /// <summary>
+        /// Number of static layers composited with animated casters this frame.
+        /// </summary>
+        public static int CompositeRenderCount { get { return msCompositeRenderCount; } }
+
+        /// <summary>
+        /// Number of shadow casting lights this frame whose shadow map was reused as-is.
+        /// </summary>
+        public static int ReusedCount { get { return msReusedCount; } }
+
+        /// <summary>
+        /// Number of shadow casters gathered by all shadow casting lights this frame.
+        /// </summary>
+        public static int CastersConsidered { get { return msCastersConsidered; } }
+
+        /// <summary>
+        /// Number of shadow casters posed into shadow depth passes this frame.
+        /// </summary>
+        public static int CastersDrawn { get { return msCastersDrawn; } }
+
+        /// <summary>
+        /// If true, dynamic casters that cannot shadow a receiver visible to the camera are not
+        /// drawn into shadow maps. Static casters are always drawn into the cached static layer.
+        /// </summary>
+        public static bool bReceiverCulling
+        {
+            get { return msbReceiverCulling; }
+            set { msbReceiverCulling = value; }
+        }
 
         public static void Release(int i)
         {
@@ -63,6 +63,12 @@ namespace siat.render
     /// of Effect parameters and techniques by name, which is used to allow parameters to be universally
     /// accessible by index. Parameters for base and lightable passes have constant indices as defined
     /// in RenderRoot.BuiltInParameters, RenderRoot.BuiltInTechniques, 
+    /// 
+    /// Parameters should be set with Set(), not through the EffectParameter. At load, each float
+    /// scalar, vector and matrix parameter is given a slot in a contiguous block that shadows the
+    /// values last uploaded to the effect, laid out in the parameter order of the compiled effect.
+    /// Set() only uploads values that differ from the shadow copy and CommitChanges() only commits
+    /// if something was uploaded since the last commit.
     /// </remarks>
     /// 
     /// \sa siat.render.RenderRoot.BuiltInParameters
@@ -76,12 +82,88 @@ namespace siat.render
 
         #region Private members
         private readonly string mId;
+        private readonly int mSortId = RenderQueue.GrabSortId();
         private EffectPassCollection mActivePasses = null;
         private int mActiveTechnique;
         private Effect mEffect;
         private SiatEffectFlags mFlags = SiatEffectFlags.None;
         private EffectParameter[] mParameterTable = new EffectParameter[0];
         private EffectTechnique[] mTechniqueTable = new EffectTechnique[0];
+        private float[] mConstants = new float[0];
+        private int[] mConstantOffsets = new int[0];
+        private int[] mConstantSizes = new int[0];
+        private Texture[] mTextures = new Texture[0];
+        private bool mbUncommitted = false;
+
+        private static int msConstantUploads = 0;
+        private static int msConstantsFiltered = 0;
+        private static int msCommits = 0;
+        private static int msCommitsFiltered = 0;
+
+        /// <summary>
+        /// Returns the offset of the shadow copy of parameter aId in mConstants if the parameter
+        /// is exactly aSize floats, otherwise -1 and the value is always uploaded.
+        /// </summary>
+        private int _GetOffset(int aId, int aSize)
+        {
+            if (aId < mConstantOffsets.Length && mConstantSizes[aId] == aSize) { return mConstantOffsets[aId]; }
+            else { return -1; }
+        }
+
+        private bool _Update(int aOffset, float a)
+        {
+            if (aOffset < 0) { return true; }
+            if (mConstants[aOffset] == a) { return false; }
+
+            mConstants[aOffset] = a;
+            return true;
+        }
+
+        private bool _Update(int aOffset, float a, float b, float c, float d, int aCount)
+        {
+            if (aOffset < 0) { return true; }
+
+            float[] v = mConstants;
+            if (v[aOffset] == a &&
+                v[aOffset + 1] == b &&
+                (aCount < 3 || v[aOffset + 2] == c) &&
+                (aCount < 4 || v[aOffset + 3] == d))
+            {
+                return false;
+            }
+
+            v[aOffset] = a; v[aOffset + 1] = b;
+            if (aCount > 2) { v[aOffset + 2] = c; }
+            if (aCount > 3) { v[aOffset + 3] = d; }
+            return true;
+        }
+
+        private bool _Update(int aOffset, ref Matrix m)
+        {
+            if (aOffset < 0) { return true; }
+
+            float[] v = mConstants;
+            int i = aOffset;
+            if (v[i +  0] == m.M11 && v[i +  1] == m.M12 && v[i +  2] == m.M13 && v[i +  3] == m.M14 &&
+                v[i +  4] == m.M21 && v[i +  5] == m.M22 && v[i +  6] == m.M23 && v[i +  7] == m.M24 &&
+                v[i +  8] == m.M31 && v[i +  9] == m.M32 && v[i + 10] == m.M33 && v[i + 11] == m.M34 &&
+                v[i + 12] == m.M41 && v[i + 13] == m.M42 && v[i + 14] == m.M43 && v[i + 15] == m.M44)
+            {
+                return false;
+            }
+
+            v[i +  0] = m.M11; v[i +  1] = m.M12; v[i +  2] = m.M13; v[i +  3] = m.M14;
+            v[i +  4] = m.M21; v[i +  5] = m.M22; v[i +  6] = m.M23; v[i +  7] = m.M24;
+            v[i +  8] = m.M31; v[i +  9] = m.M32; v[i + 10] = m.M33; v[i + 11] = m.M34;
+            v[i + 12] = m.M41; v[i + 13] = m.M42; v[i + 14] = m.M43; v[i + 15] = m.M44;
+            return true;
+        }
+
+        private void _Uploaded()
+        {
+            mbUncommitted = true;
+            msConstantUploads++;
+        }
 
         private void _SetFlags()
         {
@@ -232,6 +314,37 @@ namespace siat.render
 
                 mParameterTable[id] = param;
             }
+
+            #region Constant block
+            int tableCount = mParameterTable.Length;
+            mConstantOffsets = new int[tableCount];
+            mConstantSizes = new int[tableCount];
+            mTextures = new Texture[tableCount];
+
+            int total = 0;
+            for (int i = 0; i < count; i++)
+            {
+                EffectParameter param = parameters[i];
+                int id = RenderRoot.GetParameterId(param.Semantic);
+
+                if (mParameterTable[id] == param &&
+                    param.ParameterType == EffectParameterType.Single &&
+                    param.Elements.Count == 0 &&
+                    (param.ParameterClass == EffectParameterClass.Scalar ||
+                     param.ParameterClass == EffectParameterClass.Vector ||
+                     param.ParameterClass == EffectParameterClass.MatrixRows ||
+                     param.ParameterClass == EffectParameterClass.MatrixColumns))
+                {
+                    mConstantOffsets[id] = total;
+                    mConstantSizes[id] = (param.RowCount * param.ColumnCount);
+                    total += mConstantSizes[id];
+                }
+            }
+
+            // NaN never compares equal, so the first Set() of each parameter always uploads.
+            mConstants = new float[total];
+            for (int i = 0; i < total; i++) { mConstants[i] = float.NaN; }
+            #endregion
         }
 
         private void _UpdateTechniqueTable()
@@ -288,10 +401,29 @@ namespace siat.render
         }
 
         public void Begin() { mEffect.Begin(); }
-        public void CommitChanges() { mEffect.CommitChanges(); }
+
+        /// <summary>
+        /// Commits parameters set during an effect pass. Does nothing if no parameter was uploaded
+        /// since the last commit.
+        /// </summary>
+        public void CommitChanges()
+        {
+            if (mbUncommitted)
+            {
+                mEffect.CommitChanges();
+                mbUncommitted = false;
+                msCommits++;
+            }
+            else
+            {
+                msCommitsFiltered++;
+            }
+        }
+
         public void Dispose() { mEffect.Dispose(); }
         public void End() { mEffect.End(); }
         public string Id { get { return mId; } }
+        public int SortId { get { return mSortId; } }
         public bool IsAnimatedBase { get { return ((mFlags & SiatEffectFlags.IsAnimatedBase) != 0); } }
         public bool IsAnimatedLightable { get { return ((mFlags & SiatEffectFlags.IsAnimatedLightable) != 0); } }
         public bool IsStandardBase { get { return ((mFlags & SiatEffectFlags.IsStandardBase) != 0); } }
@@ -345,6 +477,89 @@ namespace siat.render
             }
         }
 
+        #region Set
+        public void Set(int aId, float aValue)
+        {
+            if (_Update(_GetOffset(aId, 1), aValue)) { mParameterTable[aId].SetValue(aValue); _Uploaded(); }
+            else { msConstantsFiltered++; }
+        }
+
+        public void Set(int aId, Vector2 aValue)
+        {
+            if (_Update(_GetOffset(aId, 2), aValue.X, aValue.Y, 0.0f, 0.0f, 2)) { mParameterTable[aId].SetValue(aValue); _Uploaded(); }
+            else { msConstantsFiltered++; }
+        }
+
+        public void Set(int aId, Vector3 aValue)
+        {
+            if (_Update(_GetOffset(aId, 3), aValue.X, aValue.Y, aValue.Z, 0.0f, 3)) { mParameterTable[aId].SetValue(aValue); _Uploaded(); }
+            else { msConstantsFiltered++; }
+        }
+
+        public void Set(int aId, Vector4 aValue)
+        {
+            if (_Update(_GetOffset(aId, 4), aValue.X, aValue.Y, aValue.Z, aValue.W, 4)) { mParameterTable[aId].SetValue(aValue); _Uploaded(); }
+            else { msConstantsFiltered++; }
+        }
+
+        public void Set(int aId, Matrix aValue)
+        {
+            if (_Update(_GetOffset(aId, 16), ref aValue)) { mParameterTable[aId].SetValue(aValue); _Uploaded(); }
+            else { msConstantsFiltered++; }
+        }
+
+        public void Set(int aId, Texture aValue)
+        {
+            if (aId >= mTextures.Length || mTextures[aId] != aValue)
+            {
+                if (aId < mTextures.Length) { mTextures[aId] = aValue; }
+                mParameterTable[aId].SetValue(aValue);
+                _Uploaded();
+            }
+            else
+            {
+                msConstantsFiltered++;
+            }
+        }
+
+        /// <summary>
+        /// Arrays are always uploaded, their contents may have changed in place.
+        /// </summary>
+        public void Set(int aId, Vector4[] aValue)
+        {
+            mParameterTable[aId].SetValue(aValue);
+            _Uploaded();
+        }
+        #endregion
+
+        /// <summary>
+        /// Number of parameter values uploaded to effects this frame.
+        /// </summary>
+        public static int ConstantUploads { get { return msConstantUploads; } }
+
+        /// <summary>
+        /// Number of parameter sets skipped this frame because the effect already had the value.
+        /// </summary>
+        public static int ConstantsFiltered { get { return msConstantsFiltered; } }
+
+        /// <summary>
+        /// Number of CommitChanges() calls this frame that reached the effect.
+        /// </summary>
+        public static int Commits { get { return msCommits; } }
+
+        /// <summary>
+        /// Number of CommitChanges() calls this frame skipped because nothing was uploaded.
+        /// </summary>
+        public static int CommitsFiltered { get { return msCommitsFiltered; } }
+
+        internal static void _ResetStats()
+        {
+            msConstantUploads = 0;
+            msConstantsFiltered = 0;
+            msCommits = 0;
+            msCommitsFiltered = 0;
+        }
+
         public EffectParameter this[int i]
         {
             get
@@ -68,7 +68,7 @@ namespace siat.render
 
         public void SetToEffect(SiatEffect aEffect)
         {
-            aEffect[mId].SetValue(mValue);
+            aEffect.Set(mId, mValue);
         }
     }
 
@@ -78,9 +78,11 @@ namespace siat.render
             : base(aSemantic, aValue)
         { }
 
+        public Texture Value { get { return mValue; } }
+
         public void SetToEffect(SiatEffect aEffect)
         {
-            aEffect[mId].SetValue(mValue);
+            aEffect.Set(mId, mValue);
         }
     }
 
@@ -92,7 +94,7 @@ namespace siat.render
 
         public void SetToEffect(SiatEffect aEffect)
         {
-            aEffect[mId].SetValue(mValue);
+            aEffect.Set(mId, mValue);
         }
     }
 
@@ -104,7 +106,7 @@ namespace siat.render
 
         public void SetToEffect(SiatEffect aEffect)
         {
-            aEffect[mId].SetValue(mValue);
+            aEffect.Set(mId, mValue);
         }
     }
 
@@ -116,7 +118,7 @@ namespace siat.render
 
         public void SetToEffect(SiatEffect aEffect)
         {
-            aEffect[mId].SetValue(mValue);
+            aEffect.Set(mId, mValue);
         }
     }
 
@@ -128,7 +130,7 @@ namespace siat.render
 
         public void SetToEffect(SiatEffect aEffect)
         {
-            aEffect[mId].SetValue(mValue);
+            aEffect.Set(mId, mValue);
         }
     }
     #endregion
@@ -140,8 +142,11 @@ namespace siat.render
     {
         #region Private members
         private List<IMaterialParameter> mParameters = new List<IMaterialParameter>();
+        private readonly int mSortId = RenderQueue.GrabSortId();
         #endregion
 
+        public int SortId { get { return mSortId; } }
+
         public void AddParameter(string aSemantic, float aValue)
         {
             mParameters.Add(new MaterialParameterSingle(aSemantic, aValue));
@@ -185,6 +190,19 @@ namespace siat.render
             }
         }
 
+        /// <summary>
+        /// Adds the textures referenced by this material to aTextures.
+        /// </summary>
+        public void GetTextures(List<Texture> aTextures)
+        {
+            int count = mParameters.Count;
+            for (int i = 0; i < count; i++)
+            {
+                MaterialParameterTexture p = mParameters[i] as MaterialParameterTexture;
+                if (p != null && p.Value != null) { aTextures.Add(p.Value); }
+            }
+        }
+
         public void SetToEffect(SiatEffect aEffect)
         {
             int count = mParameters.Count;
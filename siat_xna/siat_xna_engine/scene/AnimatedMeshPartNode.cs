@@ -41,6 +41,8 @@ namespace siat.scene
         private AnimationControl mAnimationControl = new AnimationControl();
         private Matrix mBind = Matrix.Identity;
         protected Matrix[] mInvBinds = new Matrix[0];
+        protected Matrix[] mJointBinds = new Matrix[0];
+        protected bool mbBindsDirty = true;
         protected JointNode[] mJoints = new JointNode[0];
         protected string[] mJointIds = new string[0];
         protected bool mbJointsDirty = false;
@@ -85,6 +87,8 @@ namespace siat.scene
             return bDirty;
         }
 
+        public override bool bDynamicShadowCaster { get { return true; } }
+
         public override void ShadowingPose(LightNode aLight)
         {
             if (mEffect.IsAnimatedLightable)
@@ -143,8 +147,19 @@ namespace siat.scene
                 mbJointsDirty = false;
             }
 
+            if (mbBindsDirty)
+            {
+                int count = mInvBinds.Length;
+                Array.Resize<Matrix>(ref mJointBinds, count);
+                for (int i = 0; i < count; i++) { Matrix.Multiply(ref mBind, ref mInvBinds[i], out mJointBinds[i]); }
+
+                mbBindsDirty = false;
+            }
+
             if (mRootJoint != null && mRootJoint.bDirty)
             {
+                // Writes the rows of each joint's transform directly as the columns of the
+                // float4x3 skinning palette.
                 int count = mJoints.Length;
                 for (int i = 0; i < count; i++)
                 {
@@ -152,11 +167,13 @@ namespace siat.scene
 
                     if (mJoints[i] != null)
                     {
-                        Matrix transform = mBind * mInvBinds[i] * mJoints[i].WorldTransform;
+                        Matrix world = mJoints[i].WorldTransform;
+                        Matrix transform;
+                        Matrix.Multiply(ref mJointBinds[i], ref world, out transform);
 
-                        mSkinning[entryIndex + 0] = new Vector4(transform.M11, transform.M21, transform.M31, transform.M41);
-                        mSkinning[entryIndex + 1] = new Vector4(transform.M12, transform.M22, transform.M32, transform.M42);
-                        mSkinning[entryIndex + 2] = new Vector4(transform.M13, transform.M23, transform.M33, transform.M43);
+                        mSkinning[entryIndex + 0].X = transform.M11; mSkinning[entryIndex + 0].Y = transform.M21; mSkinning[entryIndex + 0].Z = transform.M31; mSkinning[entryIndex + 0].W = transform.M41;
+                        mSkinning[entryIndex + 1].X = transform.M12; mSkinning[entryIndex + 1].Y = transform.M22; mSkinning[entryIndex + 1].Z = transform.M32; mSkinning[entryIndex + 1].W = transform.M42;
+                        mSkinning[entryIndex + 2].X = transform.M13; mSkinning[entryIndex + 2].Y = transform.M23; mSkinning[entryIndex + 2].Z = transform.M33; mSkinning[entryIndex + 2].W = transform.M43;
                     }
                     else
                     {
@@ -170,7 +187,7 @@ namespace siat.scene
             if (mRootIndex >= 0)
             {
                 Matrix m = mWorldWrapped.Matrix;
-                mWorldWrapped.Matrix = mBind * mInvBinds[mRootIndex] * mRootJoint.WorldTransform * m;
+                mWorldWrapped.Matrix = mJointBinds[mRootIndex] * mRootJoint.WorldTransform * m;
                 base.PostUpdate(aCell, abChanged);
                 mWorldWrapped.Matrix = m;
             }
@@ -194,8 +211,8 @@ namespace siat.scene
         public AnimatedMeshPartNode(string aId) : base(aId) {}
 
         public AnimationControl AnimationControl { get { return mAnimationControl; } }
-        public Matrix BindTransform { get { return mBind; } set { mBind = value; } }
-        public Matrix[] InvJointBindTransforms { get { return mInvBinds; } set { mInvBinds = value; } }
+        public Matrix BindTransform { get { return mBind; } set { mBind = value; mbBindsDirty = true; } }
+        public Matrix[] InvJointBindTransforms { get { return mInvBinds; } set { mInvBinds = value; mbBindsDirty = true; } }
         public string[] JointIds { get { return mJointIds; } set { mJointIds = value; mbJointsDirty = true; } }
         public string RootJointId { get { return mRootJointId; } set { mRootJointId = value; mbJointsDirty = true; } }
     }
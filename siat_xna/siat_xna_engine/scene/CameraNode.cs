@@ -117,6 +117,7 @@ namespace siat.scene
                 float near, far;
                 Utilities.ExtractNearFar(ref mProjection, out near, out far);
                 Update(null, ref Utilities.kIdentity, false);
+                CellStreamer._Request(mCell, 0.0f);
                 mCell.Update(ref Utilities.kIdentity);
             }
         }
@@ -25,13 +25,27 @@ using SiatRlt = System.Int32;
 
 using Microsoft.Xna.Framework;
 using Microsoft.Xna.Framework.Content;
+using Microsoft.Xna.Framework.Graphics;
 using System;
 using System.Collections.Generic;
+using System.Diagnostics;
 using System.Threading;
 using siat.render;
 
 namespace siat.scene
 {
+    /// <summary>
+    /// Streaming state of a Cell, see siat.scene.CellStreamer.
+    /// </summary>
+    internal enum CellState
+    {
+        Unloaded,
+        Queued,
+        Decoding,
+        Decoded,
+        Resident
+    }
+
     /// <summary>
     /// An axis-aligned bounding region of space that subdivides the world.
     /// </summary>
@@ -45,7 +59,8 @@ namespace siat.scene
     /// specified in a COLLADA .dae file.
     /// 
     /// Cells are not only a way of visibly dividing the world. They also have their own XNA ContentManager.
-    /// Cells load and unload content automatically in a separate thread to the main thread as needed.
+    /// Cells load and unload content automatically in a separate thread to the main thread as needed,
+    /// see siat.scene.CellStreamer.
     /// As a result, content loaded by a Cell (such as a siat.render.SiatEffect object) should not be used
     /// by other Cells. If content must cross Cell boundaries (such as the geometry of a main character avatar),
     /// this needs to be specially handled by the client application. One possibility is to use the global 
@@ -72,113 +87,273 @@ namespace siat.scene
     /// <code>
     /// Cell cell = Cell.GetCell("my_cell_file.dae");
     /// 
-    /// // WaitForRootSceneNode is a blocking call while RootSceneNode is threaded and may return null.
+    /// // WaitForRootSceneNode is a blocking call while RootSceneNode is streamed and may return null.
     /// // SceneNode root = cell.RootSceneNode;
     /// SceneNode root = cell.WaitForRootSceneNode;
     /// </code>
-    public sealed class Cell : IPoseable
+    public sealed class Cell : IPoseable, ICacheable
     {
         public const int kKdTreeDepth = OcclusionKdTree.kMaximumDepth; 
 
         #region Private members
         private static Dictionary<string, Cell> msCells = new Dictionary<string, Cell>();
 
-        private bool mbLoading = false;
         private ContentManager mContent = new ContentManager(Siat.Singleton.Services, Utilities.kMediaRoot);
         private readonly string mFilename;
         private Matrix mCellToWorldTransform = Matrix.Identity;
         private Matrix mInverseCellToWorldTransform = Matrix.Identity;
         private uint mLastPickFrameTick = 0;
         private uint mLastPoseFrameTick = 0;
+        private PortalRect mPoseRect = null;
+        private readonly List<PortalNode> mPosedPortals = new List<PortalNode>();
         private uint mLastUpdateFrameTick = 0;
         private OcclusionKdTree mKdTree;
         private SceneNode mRootSceneNode;
         private BoundingBox mWorldBounding = new BoundingBox();
 
+        private Exception mDecodeException = null;
+        private List<MeshPack> mPendingPacks = null;
+        private List<IDisposable> mResources = new List<IDisposable>();
+        private SceneNode mPendingRoot = null;
+        private uint mLastRequestFrameTick = 0;
+        private long mResidentSize = 0;
+
         private void _HandleLoadMainThread()
         {
             mKdTree = new OcclusionKdTree(kKdTreeDepth);
-            mRootSceneNode.Update(this, ref Utilities.kIdentity, true);
+
+            // A cell reloaded after eviction keeps the transform it was last updated with, and
+            // Update() only refreshes world transforms when that transform changes.
+            mRootSceneNode.Update(this, ref mCellToWorldTransform, true);
             mKdTree.Build();
             mWorldBounding = mKdTree.RootAABB;
         }
 
-        #region HandleLoad
-        private void __HandleLoad(object aObject)
+        private static long _TextureSize(Texture aTexture)
         {
-            lock (this)
+            long texels;
+            Texture2D t2 = aTexture as Texture2D;
+            TextureCube tc = aTexture as TextureCube;
+            Texture3D t3 = aTexture as Texture3D;
+            SurfaceFormat format;
+
+            if (t2 != null) { texels = (long)t2.Width * (long)t2.Height; format = t2.Format; }
+            else if (tc != null) { texels = 6L * (long)tc.Size * (long)tc.Size; format = tc.Format; }
+            else if (t3 != null) { texels = (long)t3.Width * (long)t3.Height * (long)t3.Depth; format = t3.Format; }
+            else { return 0; }
+
+            long size;
+            switch (format)
             {
-                if (mRootSceneNode == null) { mRootSceneNode = mContent.Load<SceneNode>(mFilename); }
+                case SurfaceFormat.Dxt1: size = texels / 2; break;
+                case SurfaceFormat.Dxt2: // fall-through
+                case SurfaceFormat.Dxt3: // fall-through
+                case SurfaceFormat.Dxt4: // fall-through
+                case SurfaceFormat.Dxt5: // fall-through
+                case SurfaceFormat.Alpha8: // fall-through
+                case SurfaceFormat.Luminance8: size = texels; break;
+                case SurfaceFormat.Bgr565: // fall-through
+                case SurfaceFormat.Bgra5551: // fall-through
+                case SurfaceFormat.Bgra4444: // fall-through
+                case SurfaceFormat.HalfSingle: // fall-through
+                case SurfaceFormat.Luminance16: size = texels * 2; break;
+                case SurfaceFormat.HalfVector4: // fall-through
+                case SurfaceFormat.Vector2: size = texels * 8; break;
+                case SurfaceFormat.Vector4: size = texels * 16; break;
+                default: size = texels * 4; break;
             }
+
+            // A full mip chain adds one third.
+            if (aTexture.LevelCount > 1) { size += (size / 3); }
+
+            return size;
         }
-        private WaitCallback _HandleLoad;
-        #endregion
 
-        private void _Load()
+        private long _CalculateResidentSize()
         {
-            lock (this)
+            long ret = 0;
+
+            List<MeshPartNode> nodes = new List<MeshPartNode>();
+            mRootSceneNode.GetAll<MeshPartNode>(nodes);
+
+            Dictionary<object, bool> counted = new Dictionary<object, bool>();
+            List<Texture> textures = new List<Texture>();
+
+            foreach (MeshPartNode e in nodes)
             {
-                if (mRootSceneNode == null)
+                MeshPart part = e.MeshPart;
+                if (part != null && !counted.ContainsKey(part))
                 {
-                    if (!mbLoading)
-                    {
-                        mbLoading = ThreadPool.QueueUserWorkItem(_HandleLoad);
-                    }
+                    counted.Add(part, true);
+                    if (part.Vertices != null) { ret += part.Vertices.SizeInBytes; }
+                    if (part.Indices != null) { ret += part.Indices.SizeInBytes; }
                 }
-                else if (mKdTree == null)
+
+                SiatMaterial material = e.Material;
+                if (material != null && !counted.ContainsKey(material))
                 {
-                    _HandleLoadMainThread();
-                    mbLoading = false;
+                    counted.Add(material, true);
+                    material.GetTextures(textures);
                 }
             }
-        }
 
-        private SceneNode _LoadImmediate()
-        {
-            lock (this)
+            foreach (Texture e in textures)
             {
-                if (mRootSceneNode == null)
+                if (!counted.ContainsKey(e))
                 {
-                    if (!mbLoading)
-                    {
-                        mbLoading = true;
-                        {
-                            mRootSceneNode = mContent.Load<SceneNode>(mFilename);
-                            _HandleLoadMainThread();
-                        }
-                        mbLoading = false;
-                    }
+                    counted.Add(e, true);
+                    ret += _TextureSize(e);
                 }
-
-                return mRootSceneNode;
             }
+
+            return ret;
         }
 
         private void _Unload()
         {
+            CellStreamer._Cancel(this);
+
+            // A cell still being decoded or uploaded is left to finish; it activates as normal.
+            if (_State != CellState.Resident) { return; }
+
+            Cache.Remove(this);
+
             lock (this)
             {
-                if (mKdTree != null)
+                mKdTree = null;
+                mRootSceneNode = null;
+                mContent.Unload();
+                _DisposeResources();
+                mResidentSize = 0;
+                _State = CellState.Unloaded;
+            }
+        }
+
+        /// <summary>
+        /// Disposes the mesh pack buffers and declarations of this cell, which mContent.Unload()
+        /// does not (see MeshPack).
+        /// </summary>
+        private void _DisposeResources()
+        {
+            foreach (IDisposable e in mResources) { e.Dispose(); }
+            mResources.Clear();
+        }
+
+        private Cell(string aFilename)
+        {
+            mFilename = aFilename;
+        }
+        #endregion
+
+        #region Internal members
+        internal float _Priority = float.MaxValue;
+        internal long _RequestTimestamp = 0;
+        internal CellState _State = CellState.Unloaded;
+
+        /// <summary>
+        /// Records a request at aDistance from the camera this frame and keeps a resident cell in the cache.
+        /// </summary>
+        internal void _Touch(float aDistance)
+        {
+            uint tick = Siat.Singleton.FrameTick;
+
+            if (mLastRequestFrameTick != tick)
+            {
+                mLastRequestFrameTick = tick;
+                _Priority = aDistance;
+                if (_State == CellState.Resident) { Cache.Touch(this); }
+            }
+            else
+            {
+                _Priority = Math.Min(_Priority, aDistance);
+            }
+        }
+
+        /// <summary>
+        /// Deserializes the cell into a pending root without creating mesh buffers. Runs on the
+        /// streaming thread, or on the main thread for a blocking load.
+        /// </summary>
+        internal void _Decode()
+        {
+            List<MeshPack> packs = new List<MeshPack>();
+
+            SceneReader._DeferUploads(packs);
+            try
+            {
+                mPendingRoot = mContent.Load<SceneNode>(mFilename);
+                mPendingPacks = packs;
+            }
+            catch (Exception e)
+            {
+                mDecodeException = e;
+            }
+            finally
+            {
+                SceneReader._DeferUploads(null);
+            }
+        }
+
+        internal bool _bUploaded
+        {
+            get
+            {
+                if (mPendingPacks != null)
                 {
-                    mKdTree = null;
+                    foreach (MeshPack e in mPendingPacks) { if (!e.bUploaded) { return false; } }
                 }
 
-                if (mRootSceneNode != null)
+                return true;
+            }
+        }
+
+        internal int _Upload(GraphicsDevice aDevice, int aBudget)
+        {
+            int ret = 0;
+
+            if (mPendingPacks != null)
+            {
+                foreach (MeshPack e in mPendingPacks)
                 {
-                    mContent.Unload();
-                    mRootSceneNode = null;
+                    if (ret >= aBudget) { break; }
+                    ret += e.Upload(aDevice, aBudget - ret);
                 }
             }
+
+            return ret;
         }
 
-        private Cell(string aFilename)
+        internal void _Activate()
         {
-            mFilename = aFilename;
-            _HandleLoad = __HandleLoad;
+            if (mDecodeException != null)
+            {
+                Exception e = mDecodeException;
+                mDecodeException = null;
+                mPendingRoot = null;
+                mPendingPacks = null;
+                mContent.Unload();
+                _State = CellState.Unloaded;
+
+                throw new Exception("Failed loading cell \"" + mFilename + "\".", e);
+            }
+
+            lock (this)
+            {
+                if (mPendingPacks != null)
+                {
+                    foreach (MeshPack e in mPendingPacks) { mResources.AddRange(e.Resources); }
+                }
+
+                mRootSceneNode = mPendingRoot;
+                mPendingRoot = null;
+                mPendingPacks = null;
+                _HandleLoadMainThread();
+                _State = CellState.Resident;
+            }
+
+            mResidentSize = _CalculateResidentSize();
+            Cache.SetResidentSize(this, mResidentSize);
         }
-        #endregion
 
-        #region Internal members
         internal void Add(PoseableNode aNode)
         {
             if (mKdTree != null) mKdTree.Add(aNode);
@@ -231,14 +406,31 @@ namespace siat.scene
         public SceneNode RootSceneNode { get { lock (this) { return mRootSceneNode; } } }
         public BoundingBox WorldBounding { get { return mWorldBounding; } }
 
+        /// <summary>
+        /// Resident size in bytes of the mesh buffers and textures of this cell, or 0 if not loaded.
+        /// </summary>
+        public long ResidentSize { get { return mResidentSize; } }
+
         public SceneNode WaitForRootSceneNode
         {
             get
             {
-                return _LoadImmediate();
+                CellStreamer._LoadImmediate(this);
+                return RootSceneNode;
             }
         }
 
+        string ICacheable.Filename
+        {
+            get { return mFilename; }
+            set { throw new Exception("The filename of a Cell cannot be changed."); }
+        }
+
+        void ICacheable.Unload()
+        {
+            _Unload();
+        }
+
         public void Pick(ref Ray aWorldRay)
         {
             Siat siat = Siat.Singleton;
@@ -277,20 +469,55 @@ namespace siat.scene
         public int TotalQueriesIssued { get { if (mKdTree != null) { return mKdTree.TotalQueriesIssued; } else { return 0; } } }
 #endif
 
+        /// <summary>
+        /// Records the portals of this cell posed this frame, so they can be walked again by
+        /// FrustumPose() if the cell is reached through another portal.
+        /// </summary>
+        internal void _AddPosedPortal(PortalNode aPortal)
+        {
+            if (!mPosedPortals.Contains(aPortal)) { mPosedPortals.Add(aPortal); }
+        }
+
+        /// <summary>
+        /// Poses the contents of the cell once per frame.
+        /// </summary>
+        /// <remarks>
+        /// Everything posed records the active PortalRect, the rect of the first portal the cell is
+        /// seen through. When the cell is reached again through another portal, that rect is grown
+        /// to cover the new one, so the draws already recorded are not scissored away where the
+        /// cell is seen through the second portal. The portals of the cell are then walked again,
+        /// so the rects of the cells behind them grow too. Objects are not posed again, so an
+        /// object outside the frustum of the first portal is still not drawn.
+        /// </remarks>
         public void FrustumPose(IPoseable aPoseable)
         {
             Siat siat = Siat.Singleton;
             uint currentTick = siat.FrameTick;
+            PortalRect active = PortalScissor._Active;
 
             if (currentTick != mLastPoseFrameTick)
             {
                 mLastPoseFrameTick = currentTick;
+                mPoseRect = active;
+                mPosedPortals.Clear();
 
                 if (mKdTree != null)
                 {
                     mKdTree.FrustumPose(this);
                 }
             }
+            else if (mPoseRect != null && PortalScissor._Grow(mPoseRect, active))
+            {
+                PortalScissor._Active = mPoseRect;
+                int count = mPosedPortals.Count;
+                for (int i = 0; i < count; i++)
+                {
+                    mPosedPortals[i].FrustumPose(this);
+                }
+                PortalScissor._Active = active;
+            }
+
+            Debug.Assert(PortalScissor._Covers(mPoseRect, active));
         }
 
         public bool LightingPose(LightNode aLight)
@@ -304,6 +531,11 @@ namespace siat.scene
             LightingPose(aLight);
         }
 
+        internal void _CollectLighting(LightPoseJob aJob)
+        {
+            if (mKdTree != null) { mKdTree._CollectLighting(aJob); }
+        }
+
         public void Update(ref Matrix aCellToWorldTransform)
         {
             Siat siat = Siat.Singleton;
@@ -322,8 +554,6 @@ namespace siat.scene
                     bUpdateWorld = true;
                 }
 
-                _Load();
-
                 lock (this)
                 {
                     if (mRootSceneNode != null)
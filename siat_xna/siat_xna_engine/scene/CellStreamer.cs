@@ -0,0 +1,292 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Threading;
+
+namespace siat.scene
+{
+    /// <summary>
+    /// Streams cells in the background and activates them on the main thread.
+    /// </summary>
+    /// <remarks>
+    /// Cells are requested every frame with a distance from the camera: the active camera's cell at
+    /// distance 0 and cells beyond a PortalNode at the camera's distance to the portal. Requests
+    /// within PrefetchDistance queue the cell. A single worker thread decodes queued cells nearest
+    /// first, doing file I/O and deserialization without holding any lock the main thread waits on.
+    /// 
+    /// Tick() runs on the main thread once per frame. It creates the GPU buffers of decoded cells
+    /// (see siat.render.MeshPack) until UploadBudget bytes have been uploaded, then activates fully
+    /// uploaded cells by building their kd-tree. Textures and effects are still created by their XNA
+    /// readers on the worker thread, as they were before streaming, since those readers cannot be
+    /// deferred.
+    /// 
+    /// Resident cells are accounted to siat.Cache by their resident size and touched while requested,
+    /// so cells no longer near the camera are purged least recently used first. Purging a cell
+    /// disposes its textures through its ContentManager and its mesh pack buffers itself, so the
+    /// resident size the cache bounds is freed on eviction.
+    /// 
+    /// Stats: Latency is measured from a cell's first request to its activation. A hitch is counted
+    /// for every frame in which main thread streaming work exceeds HitchThreshold milliseconds and
+    /// for every blocking load (Cell.WaitForRootSceneNode on a cell that is not resident). Latency and
+    /// hitch counters accumulate over the session, TickTime and UploadedBytes are per frame.
+    /// </remarks>
+    public static class CellStreamer
+    {
+        public const float kDefaultPrefetchDistance = 100.0f;
+        public const int kDefaultUploadBudget = (1 << 21);
+        public const double kDefaultHitchThreshold = 8.0;
+
+        #region Private members
+        private static readonly object msLock = new object();
+        private static List<Cell> msQueue = new List<Cell>();
+        private static List<Cell> msDecoded = new List<Cell>();
+        private static AutoResetEvent msWake = new AutoResetEvent(false);
+        private static Thread msWorker = null;
+
+        private static List<Cell> msUploading = new List<Cell>();
+
+        private static float msPrefetchDistance = kDefaultPrefetchDistance;
+        private static int msUploadBudget = kDefaultUploadBudget;
+        private static double msHitchThreshold = kDefaultHitchThreshold;
+
+        private static int msActivatedCount = 0;
+        private static int msBlockingLoadCount = 0;
+        private static int msHitchCount = 0;
+        private static double msLastLatency = 0.0;
+        private static double msMaxLatency = 0.0;
+        private static double msTotalLatency = 0.0;
+        private static long msUploadedBytes = 0;
+        private static double msTickTime = 0.0;
+
+        private static double _Milliseconds(long aTicks)
+        {
+            return ((double)aTicks * 1000.0) / (double)Stopwatch.Frequency;
+        }
+
+        private static void _WorkerMain()
+        {
+            while (true)
+            {
+                msWake.WaitOne();
+
+                while (true)
+                {
+                    Cell cell = null;
+
+                    lock (msLock)
+                    {
+                        int count = msQueue.Count;
+                        int best = -1;
+                        for (int i = 0; i < count; i++)
+                        {
+                            if (best < 0 || msQueue[i]._Priority < msQueue[best]._Priority) { best = i; }
+                        }
+
+                        if (best < 0) { break; }
+
+                        cell = msQueue[best];
+                        msQueue.RemoveAt(best);
+                        cell._State = CellState.Decoding;
+                    }
+
+                    cell._Decode();
+
+                    lock (msLock)
+                    {
+                        cell._State = CellState.Decoded;
+                        msDecoded.Add(cell);
+                        Monitor.PulseAll(msLock);
+                    }
+                }
+            }
+        }
+
+        private static void _Activate(Cell aCell)
+        {
+            aCell._Activate();
+
+            double latency = _Milliseconds(Stopwatch.GetTimestamp() - aCell._RequestTimestamp);
+            msActivatedCount++;
+            msLastLatency = latency;
+            msMaxLatency = Math.Max(msMaxLatency, latency);
+            msTotalLatency += latency;
+        }
+        #endregion
+
+        #region Internal members
+        internal static void _Request(Cell aCell, float aDistance)
+        {
+            aCell._Touch(aDistance);
+
+            if (aCell._State == CellState.Unloaded && aDistance <= msPrefetchDistance)
+            {
+                aCell._RequestTimestamp = Stopwatch.GetTimestamp();
+
+                lock (msLock)
+                {
+                    aCell._State = CellState.Queued;
+                    msQueue.Add(aCell);
+                }
+
+                if (msWorker == null)
+                {
+                    msWorker = new Thread(_WorkerMain);
+                    msWorker.Name = "siat cell streamer";
+                    msWorker.IsBackground = true;
+                    msWorker.Priority = ThreadPriority.BelowNormal;
+                    msWorker.Start();
+                }
+
+                msWake.Set();
+            }
+        }
+
+        internal static void _LoadImmediate(Cell aCell)
+        {
+            if (aCell._State == CellState.Resident) { return; }
+
+            bool bDecode = false;
+            long start = Stopwatch.GetTimestamp();
+
+            lock (msLock)
+            {
+                if (aCell._State == CellState.Unloaded || aCell._State == CellState.Queued)
+                {
+                    if (aCell._State == CellState.Unloaded) { aCell._RequestTimestamp = start; }
+                    else { msQueue.Remove(aCell); }
+
+                    aCell._State = CellState.Decoding;
+                    bDecode = true;
+                }
+                else
+                {
+                    while (aCell._State == CellState.Decoding) { Monitor.Wait(msLock); }
+                    msDecoded.Remove(aCell);
+                }
+            }
+
+            if (bDecode) { aCell._Decode(); }
+            msUploading.Remove(aCell);
+
+            msUploadedBytes += aCell._Upload(Siat.Singleton.GraphicsDevice, int.MaxValue);
+            _Activate(aCell);
+
+            msBlockingLoadCount++;
+            msHitchCount++;
+            msTickTime += _Milliseconds(Stopwatch.GetTimestamp() - start);
+        }
+
+        internal static void _Cancel(Cell aCell)
+        {
+            lock (msLock)
+            {
+                if (aCell._State == CellState.Queued)
+                {
+                    msQueue.Remove(aCell);
+                    aCell._State = CellState.Unloaded;
+                }
+            }
+        }
+
+        internal static void _ResetStats()
+        {
+            msUploadedBytes = 0;
+            msTickTime = 0.0;
+        }
+        #endregion
+
+        /// <summary>
+        /// Uploads and activates decoded cells. Called once per frame by Siat before the scene updates.
+        /// </summary>
+        public static void Tick()
+        {
+            long start = Stopwatch.GetTimestamp();
+
+            lock (msLock)
+            {
+                msUploading.AddRange(msDecoded);
+                msDecoded.Clear();
+            }
+
+            int budget = msUploadBudget;
+            while (msUploading.Count > 0 && budget > 0)
+            {
+                Cell cell = msUploading[0];
+                int uploaded = cell._Upload(Siat.Singleton.GraphicsDevice, budget);
+                budget -= uploaded;
+                msUploadedBytes += uploaded;
+
+                if (cell._bUploaded)
+                {
+                    msUploading.RemoveAt(0);
+                    _Activate(cell);
+                }
+            }
+
+            double time = _Milliseconds(Stopwatch.GetTimestamp() - start);
+            msTickTime += time;
+            if (time > msHitchThreshold) { msHitchCount++; }
+        }
+
+        /// <summary>
+        /// Average latency in milliseconds from request to activation over all cells streamed.
+        /// </summary>
+        public static double AverageLatency { get { return (msActivatedCount > 0) ? (msTotalLatency / msActivatedCount) : 0.0; } }
+
+        public static int BlockingLoadCount { get { return msBlockingLoadCount; } }
+        public static int HitchCount { get { return msHitchCount; } }
+        public static double HitchThreshold { get { return msHitchThreshold; } set { msHitchThreshold = value; } }
+        public static double LastLatency { get { return msLastLatency; } }
+        public static double MaxLatency { get { return msMaxLatency; } }
+
+        public static int PendingCount
+        {
+            get
+            {
+                lock (msLock)
+                {
+                    return (msQueue.Count + msDecoded.Count + msUploading.Count);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Cells requested at a distance greater than this from the camera are not loaded.
+        /// </summary>
+        public static float PrefetchDistance { get { return msPrefetchDistance; } set { msPrefetchDistance = value; } }
+
+        /// <summary>
+        /// Main thread time in milliseconds spent on streaming this frame.
+        /// </summary>
+        public static double TickTime { get { return msTickTime; } }
+
+        /// <summary>
+        /// Maximum bytes of GPU buffers created per frame by Tick().
+        /// </summary>
+        public static int UploadBudget { get { return msUploadBudget; } set { msUploadBudget = value; } }
+
+        public static long UploadedBytes { get { return msUploadedBytes; } }
+    }
+}
@@ -60,11 +60,20 @@ namespace siat.scene
 
             base.PreUpdate(aCell, ref aParentWorld, abParentChanged);
 
+            if ((mFlags & SceneNodeFlags.IgnoreParent) != 0) { Animation._BeginPass(); }
+
             if (mAnimationControl != null && mAnimationControl.Tick(mAnimation, ref mLocal))
             {
                 mFlags |= SceneNodeFlags.LocalDirty;
             }
         }
+
+        protected override void PostUpdate(Cell aCell, bool abChanged)
+        {
+            base.PostUpdate(aCell, abChanged);
+
+            if ((mFlags & SceneNodeFlags.IgnoreParent) != 0) { Animation._EndPass(); }
+        }
         #endregion
 
         public JointNode() : base() { }
@@ -44,6 +44,18 @@ namespace siat.scene
         #region Protected members
         protected bool mbCastShadow = false;
         protected bool mbShadowsDirty = false;
+        protected bool mbDynamicShadowLayer = false;
+        protected LightResolution mResolution = LightResolution.Full;
+        protected List<PoseableNode> mStaticCasters = new List<PoseableNode>();
+        protected List<PoseableNode> mDynamicCasters = new List<PoseableNode>();
+        protected List<PoseableNode> mLastStaticCasters = new List<PoseableNode>();
+        protected List<PoseableNode> mLastDynamicCasters = new List<PoseableNode>();
+        protected List<ShadowBounds> mReceivers = new List<ShadowBounds>();
+        protected ShadowBounds mReceiverUnion = ShadowBounds.kEmpty;
+        protected uint mCasterStatsTick = 0;
+        protected int mCastersConsidered = 0;
+        protected int mCastersDrawn = 0;
+        protected readonly int mSortId = RenderQueue.GrabSortId();
         protected Light mLight = new Light();
         protected float mRange = Utilities.kMaxLightRange;
         protected int mShadowRenderTarget = -1;
@@ -54,6 +66,128 @@ namespace siat.scene
         protected Frustum mShadowWorldFrustum = new Frustum(Vector3.Zero, 6);
         protected Vector3 mWorldLightDirection = Vector3.Forward;
 
+        /// <summary>
+        /// Bounds in the post-projective space of the shadow frustum. Rays from the light are
+        /// parallel to the depth axis in this space, so a caster can only shadow a receiver if
+        /// their rectangles overlap and the caster begins in front of the receiver's far depth.
+        /// </summary>
+        protected struct ShadowBounds
+        {
+            public static readonly ShadowBounds kEmpty = new ShadowBounds(float.MaxValue, float.MaxValue, float.MinValue, float.MinValue, float.MaxValue, float.MinValue);
+            public static readonly ShadowBounds kFull = new ShadowBounds(-1.0f, -1.0f, 1.0f, 1.0f, 0.0f, float.MaxValue);
+
+            public ShadowBounds(float aMinX, float aMinY, float aMaxX, float aMaxY, float aMinDepth, float aMaxDepth)
+            {
+                MinX = aMinX; MinY = aMinY; MaxX = aMaxX; MaxY = aMaxY;
+                MinDepth = aMinDepth; MaxDepth = aMaxDepth;
+            }
+
+            public float MinX;
+            public float MinY;
+            public float MaxX;
+            public float MaxY;
+            public float MinDepth;
+            public float MaxDepth;
+
+            public bool Shadows(ref ShadowBounds aReceiver)
+            {
+                return (MinX <= aReceiver.MaxX && aReceiver.MinX <= MaxX &&
+                        MinY <= aReceiver.MaxY && aReceiver.MinY <= MaxY &&
+                        MinDepth <= aReceiver.MaxDepth);
+            }
+
+            public void Merge(ref ShadowBounds b)
+            {
+                MinX = Math.Min(MinX, b.MinX); MinY = Math.Min(MinY, b.MinY);
+                MaxX = Math.Max(MaxX, b.MaxX); MaxY = Math.Max(MaxY, b.MaxY);
+                MinDepth = Math.Min(MinDepth, b.MinDepth); MaxDepth = Math.Max(MaxDepth, b.MaxDepth);
+            }
+        }
+
+        /// <summary>
+        /// From this count on, receivers are only tested through their union.
+        /// </summary>
+        protected const int kMaxShadowReceivers = 64;
+
+        // Only used on the posing thread.
+        private static readonly Vector3[] msCorners = new Vector3[BoundingBox.CornerCount];
+
+        /// <summary>
+        /// Projects aAABB into the shadow frustum. Depth is the distance along the light
+        /// direction. Bounds that reach behind the light are conservatively the full frustum.
+        /// </summary>
+        protected void _GetShadowBounds(ref BoundingBox aAABB, out ShadowBounds arOut)
+        {
+            arOut = ShadowBounds.kEmpty;
+            aAABB.GetCorners(msCorners);
+
+            for (int i = 0; i < BoundingBox.CornerCount; i++)
+            {
+                Vector4 p = Vector4.Transform(msCorners[i], mShadowViewProjectionWrapped.Matrix);
+                if (p.W < Utilities.kLooseToleranceFloat) { arOut = ShadowBounds.kFull; return; }
+
+                float x = (p.X / p.W);
+                float y = (p.Y / p.W);
+
+                arOut.MinX = Math.Min(arOut.MinX, x); arOut.MaxX = Math.Max(arOut.MaxX, x);
+                arOut.MinY = Math.Min(arOut.MinY, y); arOut.MaxY = Math.Max(arOut.MaxY, y);
+                arOut.MinDepth = Math.Min(arOut.MinDepth, p.W); arOut.MaxDepth = Math.Max(arOut.MaxDepth, p.W);
+            }
+        }
+
+        /// <summary>
+        /// Returns true if the shadow of aCaster can fall on a receiver added with _AddShadowReceiver().
+        /// </summary>
+        protected bool _ShadowsReceiver(PoseableNode aCaster)
+        {
+            BoundingBox aabb = aCaster.AABB;
+            ShadowBounds bounds;
+            _GetShadowBounds(ref aabb, out bounds);
+
+            if (!bounds.Shadows(ref mReceiverUnion)) { return false; }
+
+            int count = mReceivers.Count;
+            if (count >= kMaxShadowReceivers) { return true; }
+
+            for (int i = 0; i < count; i++)
+            {
+                ShadowBounds receiver = mReceivers[i];
+                if (bounds.Shadows(ref receiver)) { return true; }
+            }
+
+            return false;
+        }
+
+        /// <summary>
+        /// Removes the casters of aCasters that cannot shadow a visible receiver.
+        /// </summary>
+        protected void _CullCasters(List<PoseableNode> aCasters)
+        {
+            int count = aCasters.Count;
+            int kept = 0;
+
+            for (int i = 0; i < count; i++)
+            {
+                PoseableNode caster = aCasters[i];
+                if (_ShadowsReceiver(caster)) { aCasters[kept++] = caster; }
+            }
+
+            aCasters.RemoveRange(kept, count - kept);
+        }
+
+        protected static bool _SameCasters(List<PoseableNode> a, List<PoseableNode> b)
+        {
+            int count = a.Count;
+            if (count != b.Count) { return false; }
+
+            for (int i = 0; i < count; i++)
+            {
+                if (a[i] != b[i]) { return false; }
+            }
+
+            return true;
+        }
+
         protected void _PoseDirectionalPoint(IPoseable aPoseable)
         {
             #region Find intersecting planes
@@ -73,7 +207,7 @@ namespace siat.scene
             #endregion
 
             Shared.ActiveShadowPlanes = null;
-            aPoseable.LightingPose(this);
+            _Pose(aPoseable);
         }
 
         protected void _PoseSpot(IPoseable aPoseable)
@@ -89,7 +223,123 @@ namespace siat.scene
                 Shared.ActiveLightPlanes = Shared.ActiveWorldFrustum.Planes;
             }
 
-            mbShadowsDirty = aPoseable.LightingPose(this);
+            _Pose(aPoseable);
+        }
+
+        /// <summary>
+        /// Poses the entries of aPoseable lit by this light with the active light and shadow planes.
+        /// </summary>
+        /// <remarks>
+        /// Cells are not traversed immediately. Instead, a job is recorded that is run, along with
+        /// the jobs of all other lights, by PoseJobs.Run() at the end of the pose.
+        /// </remarks>
+        protected void _Pose(IPoseable aPoseable)
+        {
+            Cell cell = aPoseable as Cell;
+
+            if (cell != null)
+            {
+                PoseJobs._Add(this, cell);
+            }
+            else
+            {
+                mStaticCasters.Clear();
+                mDynamicCasters.Clear();
+                _ClearShadowReceivers();
+                aPoseable.LightingPose(this);
+
+                if (mbCastShadow) { _PoseShadowCasters(); }
+            }
+        }
+
+        /// <summary>
+        /// Decides which layers of the shadow map of this light need to be redrawn this frame and
+        /// poses the casters of those layers.
+        /// </summary>
+        /// <remarks>
+        /// Casters gathered during LightingPose() are split into static casters, which are drawn into
+        /// a cached layer that is only redrawn when the light or one of its static casters changes,
+        /// and dynamic casters, which are drawn over a copy of the static layer whenever any of them
+        /// changes or the set of dynamic casters changes. If nothing changed, the shadow map from
+        /// the previous frame is reused as-is.
+        /// 
+        /// With ShadowMaps.bReceiverCulling, dynamic casters whose shadow cannot reach a receiver
+        /// visible to the camera are dropped first. Static casters are not culled, since the visible
+        /// receivers change with the camera and the cached static layer would be redrawn with them.
+        /// </remarks>
+        protected void _PoseShadowCasters()
+        {
+            int considered = mStaticCasters.Count + mDynamicCasters.Count;
+            if (ShadowMaps.msbReceiverCulling) { _CullCasters(mDynamicCasters); }
+
+            int staticCount = mStaticCasters.Count;
+            int dynamicCount = mDynamicCasters.Count;
+            int drawn = 0;
+
+            bool bStaticDirty = mbShadowsDirty || !_SameCasters(mStaticCasters, mLastStaticCasters);
+            for (int i = 0; i < staticCount && !bStaticDirty; i++) { bStaticDirty = mStaticCasters[i].bMyShadowRequiresUpdate; }
+
+            bool bDynamicDirty = bStaticDirty || !mbDynamicShadowLayer || !_SameCasters(mDynamicCasters, mLastDynamicCasters);
+            for (int i = 0; i < dynamicCount && !bDynamicDirty; i++) { bDynamicDirty = mDynamicCasters[i].bMyShadowRequiresUpdate; }
+
+            bool bReused = true;
+
+            if (bStaticDirty)
+            {
+                RenderRoot.PoseOperations.ShadowStatic(this);
+                for (int i = 0; i < staticCount; i++) { mStaticCasters[i].ShadowingPose(this); }
+                ShadowMaps.msStaticRenderCount++;
+                drawn += staticCount;
+                bReused = false;
+            }
+
+            if (dynamicCount > 0 && bDynamicDirty)
+            {
+                RenderRoot.PoseOperations.ShadowComposite(this);
+                for (int i = 0; i < dynamicCount; i++) { mDynamicCasters[i].ShadowingPose(this); }
+                ShadowMaps.msCompositeRenderCount++;
+                drawn += dynamicCount;
+                bReused = false;
+            }
+
+            if (bReused) { ShadowMaps.msReusedCount++; }
+
+            if (bStaticDirty)
+            {
+                mLastStaticCasters.Clear();
+                mLastStaticCasters.AddRange(mStaticCasters);
+            }
+            if (bDynamicDirty)
+            {
+                mLastDynamicCasters.Clear();
+                mLastDynamicCasters.AddRange(mDynamicCasters);
+            }
+            mbDynamicShadowLayer = (dynamicCount > 0);
+            mbShadowsDirty = false;
+
+            #region Stats
+            uint tick = Siat.Singleton.FrameTick;
+            if (mCasterStatsTick != tick)
+            {
+                mCasterStatsTick = tick;
+                mCastersConsidered = 0;
+                mCastersDrawn = 0;
+            }
+            mCastersConsidered += considered;
+            mCastersDrawn += drawn;
+            ShadowMaps.msCastersConsidered += considered;
+            ShadowMaps.msCastersDrawn += drawn;
+            #endregion
+
+            mStaticCasters.Clear();
+            mDynamicCasters.Clear();
+            _ClearShadowReceivers();
+        }
+
+        protected void _ClearShadowReceivers()
+        {
+            mReceivers.Clear();
+            mReceiverUnion = ShadowBounds.kEmpty;
         }
 
         protected void _ReleaseTarget()
@@ -98,6 +348,62 @@ namespace siat.scene
             {
                 ShadowMaps.Release(mShadowRenderTarget);
                 mShadowRenderTarget = -1;
+                mbDynamicShadowLayer = false;
+            }
+        }
+        #endregion
+
+        #region Internal members
+        /// <summary>
+        /// Adds a shadow caster for this light. Called during LightingPose(), casters are
+        /// posed at the end of the pose of this light.
+        /// </summary>
+        internal void _AddShadowCaster(PoseableNode aCaster)
+        {
+            if (aCaster.bDynamicShadowCaster) { mDynamicCasters.Add(aCaster); }
+            else { mStaticCasters.Add(aCaster); }
+        }
+
+        /// <summary>
+        /// Adds an entry lit by this light and visible to the camera as a shadow receiver.
+        /// Called during LightingPose(), receivers are used to cull casters at the end of
+        /// the pose of this light.
+        /// </summary>
+        internal void _AddShadowReceiver(PoseableNode aReceiver)
+        {
+            if (!ShadowMaps.msbReceiverCulling) { return; }
+
+            BoundingBox aabb = aReceiver.AABB;
+            ShadowBounds bounds;
+            _GetShadowBounds(ref aabb, out bounds);
+
+            mReceiverUnion.Merge(ref bounds);
+            if (mReceivers.Count < kMaxShadowReceivers) { mReceivers.Add(bounds); }
+        }
+
+        /// <summary>
+        /// Poses the results of a job recorded by _Pose(). Called by PoseJobs.Run() on the
+        /// posing thread, in the order the jobs were recorded.
+        /// </summary>
+        internal void _ApplyPoseJob(LightPoseJob aJob)
+        {
+            List<PoseableNode> lit = aJob.Lit;
+            int count = lit.Count;
+            for (int i = 0; i < count; i++) { lit[i].LightingPose(this); }
+
+            if (mbCastShadow)
+            {
+                mStaticCasters.Clear();
+                mDynamicCasters.Clear();
+                _ClearShadowReceivers();
+
+                for (int i = 0; i < count; i++) { _AddShadowReceiver(lit[i]); }
+
+                List<PoseableNode> casters = aJob.Casters;
+                count = casters.Count;
+                for (int i = 0; i < count; i++) { _AddShadowCaster(casters[i]); }
+
+                _PoseShadowCasters();
             }
         }
         #endregion
@@ -115,7 +421,11 @@ namespace siat.scene
         {
             if (aPoseable != null)
             {
-                if (RenderRoot.bDeferredLighting && mLightMask == kDefaultMask) { RenderRoot.msDeferredLightList.Add(this); }
+                if (RenderRoot.bDeferredLighting && mLightMask == kDefaultMask)
+                {
+                    RenderRoot.msDeferredLightList.Add(this);
+                    RenderRoot.msDeferredLightRects.Add(PortalScissor._Active);
+                }
 
                 if (mLight.Type == LightType.Spot) { _PoseSpot(aPoseable); }
                 else { _PoseDirectionalPoint(aPoseable); }
@@ -151,6 +461,7 @@ namespace siat.scene
 
             l.mbCastShadow = mbCastShadow;
             l.mLight = mLight;
+            l.mResolution = mResolution;
             l._SetPoseableDirty();
         }
 
@@ -253,7 +564,24 @@ namespace siat.scene
         public bool bCastShadow { get { return mbCastShadow; } set { mbCastShadow = value; } }
         public bool bShadowsDirty { get { return mbShadowsDirty; } set { mbShadowsDirty = value; } }
 
+        /// <summary>
+        /// Number of shadow casters gathered for this light this frame.
+        /// </summary>
+        public int ShadowCastersConsidered { get { return (mCasterStatsTick == Siat.Singleton.FrameTick) ? mCastersConsidered : 0; } }
+
+        /// <summary>
+        /// Number of shadow casters posed into the shadow map of this light this frame.
+        /// </summary>
+        public int ShadowCastersDrawn { get { return (mCasterStatsTick == Siat.Singleton.FrameTick) ? mCastersDrawn : 0; } }
+
+        /// <summary>
+        /// Resolution the light is accumulated at in deferred mode. Shadow casting lights, and all
+        /// lights on hardware without shader model 3.0, are accumulated at full resolution.
+        /// </summary>
+        public LightResolution Resolution { get { return mResolution; } set { mResolution = value; } }
+
         public float Range { get { return mRange; } }
+        public int SortId { get { return mSortId; } }
         public object RangeBoxed { get { return mRangeBoxed; } }
         public Matrix ShadowProjection { get { return mShadowProjection; } }
         public Matrix ShadowView { get { return mShadowViewWrapped.Matrix; } }
@@ -271,6 +599,29 @@ namespace siat.scene
             }
         }
 
+        public RenderRoot.RenderTargetPackage StaticShadowRenderTarget
+        {
+            get
+            {
+                if (mShadowRenderTarget >= 0) { return ShadowMaps.GetStatic(mShadowRenderTarget); }
+                else { return null; }
+            }
+        }
+
+        /// <summary>
+        /// The shadow map that should be sampled when lighting with this light. This is the
+        /// composited map if dynamic casters were posed, otherwise the cached static layer.
+        /// </summary>
+        public Texture2D ShadowTexture
+        {
+            get
+            {
+                if (mShadowRenderTarget < 0) { return null; }
+                else if (mbDynamicShadowLayer) { return ShadowMaps.Get(mShadowRenderTarget).Target.GetTexture(); }
+                else { return ShadowMaps.GetStatic(mShadowRenderTarget).Target.GetTexture(); }
+            }
+        }
+
         public Light Light
         {
             get { return mLight; }
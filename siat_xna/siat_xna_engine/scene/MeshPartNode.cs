@@ -70,6 +70,7 @@ namespace siat.scene
         protected uint mLastTick = 0;
         protected SiatMaterial mMaterial = null;
         protected MeshPart mMeshPart = null;
+        protected OccluderMesh mOccluder = null;
         protected float mViewDepth = 0.0f;
         protected BoundingBox mWorldAABB = Utilities.kZeroBox;
         #endregion
@@ -200,6 +201,11 @@ namespace siat.scene
                 mViewDepth = Vector3.Transform(WorldPosition, Shared.ViewTransform).Z;
             }
             #endregion
+
+            if (mOccluder != null)
+            {
+                OcclusionRasterizer._AddOccluder(mOccluder, ref mWorldWrapped.Matrix, ref mWorldAABB);
+            }
             
             base.PostUpdate(aCell, abChanged);
         }
@@ -247,6 +253,12 @@ namespace siat.scene
             }
         }
 
+        /// <summary>
+        /// If not null, this node is drawn as an occluder by OcclusionRasterizer. Usually either
+        /// OccluderMesh.FromMeshPart(MeshPart) or a simplified mesh that fits inside MeshPart.
+        /// </summary>
+        public OccluderMesh Occluder { get { return mOccluder; } set { mOccluder = value; } }
+
         public SiatEffect Effect
         {
             get
@@ -32,6 +32,10 @@ namespace siat.scene
     /// <summary>
     /// A kdTree that also uses hardware occlusion queries to check for occlusion before traversing.
     /// </summary>
+    /// <remarks>
+    /// Depending on OcclusionRasterizer.Mode, nodes are instead tested against the depth pyramid of
+    /// OcclusionRasterizer, or against both with the results compared.
+    /// </remarks>
     /// \todo Hardware occlusion queries are apparently not thread-safe - this is managed in Cell by building
     ///       the kdTree in the main thread. However, this is not explicitly enforced but should be in order to
     ///       avoid bugs from accidentally updating of the kd-Tree in a secondary thread.
@@ -59,13 +63,20 @@ namespace siat.scene
 
         OcclusionEntry[] mQueries;
         MatrixWrapper[] mWorldWrapped;
+        LightPoseJob mLightingJob = new LightPoseJob();
 
-        private bool _IsOccluded(int i)
+        private bool _IsHardwareOccluded(int i)
         {
             if (mQueries[i].Query == null) { return false; }
             else { return mQueries[i].bLastOcclusionCheck; }
         }
 
+        private bool _IsOccluded(int i)
+        {
+            if (OcclusionRasterizer.Mode == OcclusionMode.Software) { return OcclusionRasterizer.IsOccluded(ref mNodes[i].AABB); }
+            else { return _IsHardwareOccluded(i); }
+        }
+
         private void _Remove(int aIndex, int aSubIndex)
         {
             List<PoseableNode> objects = mNodes[aIndex].Objects;
@@ -223,7 +234,14 @@ namespace siat.scene
         {
             for (int i = 0; i < mNodeCount; )
             {
-                bool bIntersects = (Shared.ActiveWorldFrustum.Contains(ref mNodes[i].AABB) != ContainmentType.Disjoint) && !_IsOccluded(i);
+                bool bIntersects = (Shared.ActiveWorldFrustum.Contains(ref mNodes[i].AABB) != ContainmentType.Disjoint);
+
+                if (bIntersects && OcclusionRasterizer.Mode == OcclusionMode.Compare)
+                {
+                    OcclusionRasterizer._Compare(_IsHardwareOccluded(i), OcclusionRasterizer.IsOccluded(ref mNodes[i].AABB));
+                }
+
+                bIntersects = bIntersects && !_IsOccluded(i);
 
                 if (bIntersects)
                 {
@@ -244,15 +262,24 @@ namespace siat.scene
             }
         }
 
-        public bool LightingPose(LightNode aLight)
+        /// <summary>
+        /// Collects the entries lit by and the entries casting shadow from the light of aJob.
+        /// </summary>
+        /// <remarks>
+        /// This does not modify the tree, its entries, or the light and only writes to aJob, so
+        /// it can be called for different jobs from multiple threads at the same time.
+        /// </remarks>
+        internal void _CollectLighting(LightPoseJob aJob)
         {
-            bool bReturn = false;
+            LightNode light = aJob.Light;
+            SiatPlane[] lightPlanes = aJob.LightPlanes;
+            SiatPlane[] shadowPlanes = aJob.ShadowPlanes;
 
-            if (aLight.bCastShadow)
+            if (light.bCastShadow)
             {
                 for (int i = 0; i < mNodeCount; )
                 {
-                    bool bIntersects = (Utilities.Contains(Shared.ActiveShadowPlanes, ref mNodes[i].AABB) != ContainmentType.Disjoint);
+                    bool bIntersects = (Utilities.Contains(shadowPlanes, ref mNodes[i].AABB) != ContainmentType.Disjoint);
                     bool bOccluded = _IsOccluded(i);
 
                     if (bIntersects)
@@ -264,21 +291,19 @@ namespace siat.scene
                         {
                             PoseableNode entry = list[j];
 
-                            if ((entry.ShadowMask & aLight.ShadowMask) != 0)
+                            if ((entry.ShadowMask & light.ShadowMask) != 0)
                             {
                                 BoundingBox aabb = entry.AABB;
 
-                                if (Utilities.Contains(Shared.ActiveShadowPlanes, ref aabb) != ContainmentType.Disjoint)
+                                if (Utilities.Contains(shadowPlanes, ref aabb) != ContainmentType.Disjoint)
                                 {
-                                    bReturn = bReturn || entry.bMyShadowRequiresUpdate;
-
-                                    if (aLight.bShadowsDirty) { entry.ShadowingPose(aLight); }
+                                    aJob.Casters.Add(entry);
 
-                                    if (!bOccluded && (entry.LightMask & aLight.LightMask) != 0)
+                                    if (!bOccluded && (entry.LightMask & light.LightMask) != 0)
                                     {
-                                        if (Utilities.Contains(Shared.ActiveLightPlanes, ref aabb) != ContainmentType.Disjoint)
+                                        if (Utilities.Contains(lightPlanes, ref aabb) != ContainmentType.Disjoint)
                                         {
-                                            entry.LightingPose(aLight);
+                                            aJob.Lit.Add(entry);
                                         }
                                     }
                                 }
@@ -293,7 +318,7 @@ namespace siat.scene
             {
                 for (int i = 0; i < mNodeCount; )
                 {
-                    bool bIntersects = (Utilities.Contains(Shared.ActiveLightPlanes, ref mNodes[i].AABB) != ContainmentType.Disjoint) && !_IsOccluded(i);
+                    bool bIntersects = (Utilities.Contains(lightPlanes, ref mNodes[i].AABB) != ContainmentType.Disjoint) && !_IsOccluded(i);
 
                     if (bIntersects)
                     {
@@ -304,15 +329,15 @@ namespace siat.scene
                         {
                             PoseableNode entry = list[j];
 
-                            if ((entry.LightMask & aLight.LightMask) != 0)
+                            if ((entry.LightMask & light.LightMask) != 0)
                             {
                                 BoundingBox aabb = entry.AABB;
 
-                                if (aLight.WorldBounding.Contains(aabb) != ContainmentType.Disjoint)
+                                if (light.WorldBounding.Contains(aabb) != ContainmentType.Disjoint)
                                 {
-                                    if (Utilities.Contains(Shared.ActiveLightPlanes, ref aabb) != ContainmentType.Disjoint)
+                                    if (Utilities.Contains(lightPlanes, ref aabb) != ContainmentType.Disjoint)
                                     {
-                                        entry.LightingPose(aLight);
+                                        aJob.Lit.Add(entry);
                                     }
                                 }
                             }
@@ -322,6 +347,33 @@ namespace siat.scene
                     i = _Next(bIntersects, i);
                 }
             }
+        }
+
+        public bool LightingPose(LightNode aLight)
+        {
+            bool bReturn = false;
+
+            mLightingJob.Light = aLight;
+            mLightingJob.LightPlanes = Shared.ActiveLightPlanes;
+            mLightingJob.ShadowPlanes = Shared.ActiveShadowPlanes;
+            _CollectLighting(mLightingJob);
+
+            int count = mLightingJob.Lit.Count;
+            for (int i = 0; i < count; i++) { mLightingJob.Lit[i].LightingPose(aLight); }
+            if (aLight.bCastShadow)
+            {
+                for (int i = 0; i < count; i++) { aLight._AddShadowReceiver(mLightingJob.Lit[i]); }
+            }
+
+            count = mLightingJob.Casters.Count;
+            for (int i = 0; i < count; i++)
+            {
+                PoseableNode entry = mLightingJob.Casters[i];
+                bReturn = bReturn || entry.bMyShadowRequiresUpdate;
+                aLight._AddShadowCaster(entry);
+            }
+
+            mLightingJob.Reset();
 
             return bReturn;
         }
@@ -358,6 +410,9 @@ namespace siat.scene
             TotalQueriesIssued = 0;
 #endif
 
+            // Hardware queries are not needed when only the software rasterizer is used.
+            if (OcclusionRasterizer.Mode == OcclusionMode.Software) { return; }
+
             float factor = (mNodes[0].TotalFacesInSubtree * kMinimumFactorForOcclusionQuery);
             uint currentTick = Siat.Singleton.FrameTick;
 
@@ -114,6 +114,9 @@ namespace siat.scene
             Siat siat = Siat.Singleton;
             Vector3 center = Shared.ActiveWorldFrustum.Center;
 
+            Cell cell = aPoseable as Cell;
+            if (cell != null) { cell._AddPosedPortal(this); }
+
             if (Utilities.Intersect(ref mWorldPlane, ref center) == PlaneIntersectionType.Front)
             {
                 Vector3[] clippedPositions;
@@ -121,12 +124,17 @@ namespace siat.scene
 
                 if (_Clip(out reducedFrustum, out clippedPositions))
                 {
-                    Frustum oldFrustum = Shared.ActiveWorldFrustum;
-                    Shared.ActiveWorldFrustum = reducedFrustum;
+                    PortalRect oldRect = PortalScissor._Active;
+                    if (PortalScissor._Push(clippedPositions))
                     {
-                        mToCell.FrustumPose(aPoseable);
+                        Frustum oldFrustum = Shared.ActiveWorldFrustum;
+                        Shared.ActiveWorldFrustum = reducedFrustum;
+                        {
+                            mToCell.FrustumPose(aPoseable);
+                        }
+                        Shared.ActiveWorldFrustum = oldFrustum;
+                        PortalScissor._Pop(oldRect);
                     }
-                    Shared.ActiveWorldFrustum = oldFrustum;
                 }
             }
         }
@@ -217,6 +225,11 @@ namespace siat.scene
             #region Update ToCell
             if (mToCell != null)
             {
+                // Prefetch by the camera's distance to this portal, see CellStreamer.
+                Vector3 camera = Shared.InverseViewTransform.Translation;
+                float distance = Math.Max(Vector3.Distance(camera, mWorldBounding.Center) - mWorldBounding.Radius, 0.0f);
+                CellStreamer._Request(mToCell, distance);
+
                 mToCell.Update(ref mToCellToWorld);
             }
             #endregion
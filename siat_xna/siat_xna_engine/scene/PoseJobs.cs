@@ -0,0 +1,197 @@
+//
+// Copyright (c) 2009 Joseph A. Zupko
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using siat.render;
+
+namespace siat.scene
+{
+    /// <summary>
+    /// Culling results of one light against one cell, filled by PoseJobs.Run().
+    /// </summary>
+    internal sealed class LightPoseJob
+    {
+        #region Private members
+        private SiatPlane[] mLightPlanes = new SiatPlane[0];
+        private SiatPlane[] mShadowPlanes = new SiatPlane[0];
+
+        private static SiatPlane[] _Copy(SiatPlane[] aFrom, SiatPlane[] aTo)
+        {
+            if (aFrom == null) { return null; }
+            if (aTo == null || aTo.Length != aFrom.Length) { aTo = new SiatPlane[aFrom.Length]; }
+            Array.Copy(aFrom, aTo, aFrom.Length);
+
+            return aTo;
+        }
+        #endregion
+
+        public LightNode Light = null;
+        public Cell Cell = null;
+        public SiatPlane[] LightPlanes = null;
+        public SiatPlane[] ShadowPlanes = null;
+        public PortalRect Scissor = null;
+        public readonly List<PoseableNode> Lit = new List<PoseableNode>();
+        public readonly List<PoseableNode> Casters = new List<PoseableNode>();
+
+        /// <summary>
+        /// Copies the active light and shadow planes, which may be replaced or modified by
+        /// the rest of the pose before the job runs.
+        /// </summary>
+        public void CopyActivePlanes()
+        {
+            if (Shared.ActiveLightPlanes != null) { mLightPlanes = _Copy(Shared.ActiveLightPlanes, mLightPlanes); }
+            if (Shared.ActiveShadowPlanes != null) { mShadowPlanes = _Copy(Shared.ActiveShadowPlanes, mShadowPlanes); }
+
+            LightPlanes = (Shared.ActiveLightPlanes != null) ? mLightPlanes : null;
+            ShadowPlanes = (Shared.ActiveShadowPlanes != null) ? mShadowPlanes : null;
+        }
+
+        public void Reset()
+        {
+            Light = null;
+            Cell = null;
+            LightPlanes = null;
+            ShadowPlanes = null;
+            Scissor = null;
+            Lit.Clear();
+            Casters.Clear();
+        }
+    }
+
+    /// <summary>
+    /// Runs the lighting and shadowing traversals of all lights posed in a frame in parallel.
+    /// </summary>
+    /// <remarks>
+    /// During the camera pose, each pose of a light records a job (a copy of its planes and the
+    /// cell) instead of traversing the cell immediately. PoseJobs.Run() then traverses the OcclusionKdTree of each job on
+    /// WorkPool, with each job writing only to its own lists of lit entries and shadow casters.
+    /// Finally, the jobs are applied on the calling thread in the order they were recorded, which
+    /// is the order the sequential pose would have used, so rendering output does not depend on
+    /// thread timing.
+    ///
+    /// The camera pose itself is not parallel - it recurses through portals and each level
+    /// depends on the frustum clipped by the previous.
+    /// </remarks>
+    public static class PoseJobs
+    {
+        #region Private members
+        private static List<LightPoseJob> msJobs = new List<LightPoseJob>();
+        private static List<LightPoseJob> msFree = new List<LightPoseJob>();
+        private static WorkItem msCollect = _Collect;
+        private static bool msbParallel = true;
+
+        private static Stopwatch msTimer = new Stopwatch();
+        private static int msJobCount = 0;
+        private static double msCollectTime = 0.0;
+        private static double msApplyTime = 0.0;
+
+        private static void _Collect(int aIndex, int aThread)
+        {
+            LightPoseJob job = msJobs[aIndex];
+            job.Cell._CollectLighting(job);
+        }
+        #endregion
+
+        #region Internal members
+        /// <summary>
+        /// Records a job for aLight against aCell using the active light and shadow planes.
+        /// </summary>
+        internal static void _Add(LightNode aLight, Cell aCell)
+        {
+            LightPoseJob job;
+            int free = msFree.Count;
+            if (free > 0) { job = msFree[free - 1]; msFree.RemoveAt(free - 1); }
+            else { job = new LightPoseJob(); }
+
+            job.Light = aLight;
+            job.Cell = aCell;
+            job.CopyActivePlanes();
+            job.Scissor = PortalScissor._Active;
+            msJobs.Add(job);
+        }
+
+        internal static void _ResetStats()
+        {
+            msJobCount = 0;
+            msCollectTime = 0.0;
+            msApplyTime = 0.0;
+        }
+        #endregion
+
+        /// <summary>
+        /// Traverses and applies all recorded jobs. Called by Siat each frame after posing.
+        /// </summary>
+        public static void Run()
+        {
+            int count = msJobs.Count;
+            if (count == 0) { return; }
+
+            msTimer.Reset();
+            msTimer.Start();
+            if (msbParallel) { WorkPool.For(count, msCollect); }
+            else { for (int i = 0; i < count; i++) { _Collect(i, 0); } }
+            msTimer.Stop();
+            msCollectTime += msTimer.Elapsed.TotalMilliseconds;
+
+            msTimer.Reset();
+            msTimer.Start();
+            PortalRect oldRect = PortalScissor._Active;
+            for (int i = 0; i < count; i++)
+            {
+                LightPoseJob job = msJobs[i];
+                // Objects lit by the job are drawn through the same portal as the light was posed.
+                PortalScissor._Active = job.Scissor;
+                job.Light._ApplyPoseJob(job);
+                job.Reset();
+                msFree.Add(job);
+            }
+            PortalScissor._Active = oldRect;
+            msTimer.Stop();
+            msApplyTime += msTimer.Elapsed.TotalMilliseconds;
+
+            msJobCount += count;
+            msJobs.Clear();
+        }
+
+        /// <summary>
+        /// If false, jobs are traversed serially on the calling thread. Useful for comparing timings.
+        /// </summary>
+        public static bool bParallel { get { return msbParallel; } set { msbParallel = value; } }
+
+        /// <summary>
+        /// Number of light jobs run this frame.
+        /// </summary>
+        public static int JobCount { get { return msJobCount; } }
+
+        /// <summary>
+        /// Time in milliseconds spent traversing jobs this frame.
+        /// </summary>
+        public static double CollectTime { get { return msCollectTime; } }
+
+        /// <summary>
+        /// Time in milliseconds spent applying job results this frame.
+        /// </summary>
+        public static double ApplyTime { get { return msApplyTime; } }
+    }
+}
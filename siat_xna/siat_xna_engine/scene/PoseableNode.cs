@@ -113,6 +113,12 @@ namespace siat.scene
         protected abstract bool IsPoseable();
 
         public abstract bool bMyShadowRequiresUpdate { get; }
+
+        /// <summary>
+        /// True if this node is expected to change its shadow most frames. Dynamic casters are
+        /// drawn over the cached static shadow layer of a light instead of into it.
+        /// </summary>
+        public virtual bool bDynamicShadowCaster { get { return false; } }
         public virtual void FrustumPose(IPoseable aPoseable) { }
         public virtual bool LightingPose(LightNode aLight) { return bDirty; }
         public virtual void Pick(Cell aCell, ref Ray aWorldRay) { }